@@ -0,0 +1,640 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libredxx/libredxx.h"
+#include "libredxx/libredxx_ft260.h"
+
+/*
+ * Measures a single device, found by type, vid, pid and optionally serial, or
+ * devices made up by the simulator with --sim. Read throughput needs a device
+ * that keeps sending data, round trip latency one that sends back what it gets,
+ * the simulator uses a source device for the first and a loopback device for
+ * the second. FT260 transfers are I2C reports to --i2c-address.
+ */
+
+#define BENCH_MAX_SIZES 16
+#define BENCH_SIM_SOURCE_SERIAL "BENCHSRC"
+#define BENCH_SIM_LOOPBACK_SERIAL "BENCHLOOP"
+#define BENCH_FT260_I2C_PAYLOAD 60
+
+enum bench_test {
+	BENCH_TEST_FIND = 1 << 0,
+	BENCH_TEST_WRITE = 1 << 1,
+	BENCH_TEST_READ = 1 << 2,
+	BENCH_TEST_LATENCY = 1 << 3,
+	BENCH_TEST_INTERRUPT = 1 << 4,
+};
+
+struct bench_options {
+	libredxx_device_type type;
+	libredxx_device_id id;
+	const char* serial;
+	bool sim;
+	uint64_t sim_bandwidth;
+	uint32_t sim_latency_us;
+	uint32_t tests;
+	size_t sizes[BENCH_MAX_SIZES];
+	size_t sizes_count;
+	uint32_t duration_ms;
+	uint32_t iterations;
+	uint8_t i2c_address;
+	bool csv;
+	const char* output;
+};
+
+struct bench_result {
+	const char* test;
+	size_t size;
+	uint64_t transfers;
+	uint64_t bytes;
+	uint64_t elapsed_ns;
+	uint64_t* samples_ns; // sorted, NULL for throughput tests
+	size_t samples_count;
+	uint64_t errors;
+};
+
+static uint64_t bench_time_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void bench_sleep_ms(uint32_t ms)
+{
+#ifdef _WIN32
+	Sleep(ms);
+#else
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (long)(ms % 1000) * 1000000;
+	nanosleep(&ts, NULL);
+#endif
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+	const uint64_t x = *(const uint64_t*)a;
+	const uint64_t y = *(const uint64_t*)b;
+	return x < y ? -1 : x > y;
+}
+
+// throughput tests have no samples, their percentiles are left empty
+static void bench_write_percentiles(FILE* file, const struct bench_result* result, bool json)
+{
+	static const double percentiles[] = {50, 90, 99, 100};
+	static const char* const names[] = {"p50_us", "p90_us", "p99_us", "max_us"};
+	for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i) {
+		if (json) {
+			fprintf(file, "\"%s\": ", names[i]);
+		}
+		if (result->samples_count) {
+			const size_t index = (size_t)(percentiles[i] / 100.0 * (double)(result->samples_count - 1) + 0.5);
+			fprintf(file, "%.3f", (double)result->samples_ns[index] / 1000.0);
+		} else if (json) {
+			fprintf(file, "null");
+		}
+		fprintf(file, json ? ", " : ",");
+	}
+}
+
+// FT260
+
+static libredxx_status bench_ft260_write(libredxx_opened_device* device, uint8_t address, const uint8_t* data, size_t size)
+{
+	struct libredxx_ft260_out_i2c_write report = {0};
+	report.report_id = (uint8_t)(0xD0 + (size - 1) / 4);
+	report.slave_addr = address;
+	report.flags = 0x06; // START | STOP
+	report.length = (uint8_t)size;
+	memcpy(report.data, data, size);
+	size_t report_size = sizeof(report);
+	return libredxx_write(device, &report, &report_size, LIBREDXX_ENDPOINT_A);
+}
+
+static libredxx_status bench_ft260_read(libredxx_opened_device* device, uint8_t address, uint8_t* data, size_t size)
+{
+	struct libredxx_ft260_out_i2c_read request = {0};
+	request.report_id = 0xC2;
+	request.slave_addr = address;
+	request.flags = 0x06;
+	request.length = (uint8_t)size;
+	size_t request_size = sizeof(request);
+	libredxx_status status = libredxx_write(device, &request, &request_size, LIBREDXX_ENDPOINT_A);
+	size_t received = 0;
+	while (status == LIBREDXX_STATUS_SUCCESS && received < size) {
+		struct libredxx_ft260_in_i2c_read report = {0};
+		size_t report_size = sizeof(report);
+		status = libredxx_read(device, &report, &report_size, LIBREDXX_ENDPOINT_A);
+		if (status == LIBREDXX_STATUS_SUCCESS) {
+			const size_t length = report.length < size - received ? report.length : size - received;
+			memcpy(&data[received], report.data, length);
+			received += length;
+		}
+	}
+	return status;
+}
+
+// one transfer of up to size bytes in the given direction, FT260 moves at most one report of I2C data
+static libredxx_status bench_transfer(const struct bench_options* options, libredxx_opened_device* device, bool write, uint8_t* buffer, size_t* size)
+{
+	if (options->type == LIBREDXX_DEVICE_TYPE_FT260) {
+		*size = *size < BENCH_FT260_I2C_PAYLOAD ? *size : BENCH_FT260_I2C_PAYLOAD;
+		if (write) {
+			return bench_ft260_write(device, options->i2c_address, buffer, *size);
+		}
+		return bench_ft260_read(device, options->i2c_address, buffer, *size);
+	}
+	if (write) {
+		return libredxx_write(device, buffer, size, LIBREDXX_ENDPOINT_A);
+	}
+	return libredxx_read(device, buffer, size, LIBREDXX_ENDPOINT_A);
+}
+
+// tests
+
+static void bench_find(const struct bench_options* options, struct bench_result* result)
+{
+	libredxx_find_filter filter = {options->type, options->id};
+	result->samples_ns = calloc(options->iterations, sizeof(uint64_t));
+	for (uint32_t i = 0; i < options->iterations && result->samples_ns; ++i) {
+		libredxx_found_device** found = NULL;
+		size_t found_count = 0;
+		const uint64_t start_ns = bench_time_ns();
+		libredxx_status status = libredxx_find_devices(&filter, 1, &found, &found_count);
+		result->samples_ns[result->samples_count] = bench_time_ns() - start_ns;
+		result->elapsed_ns += result->samples_ns[result->samples_count++];
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			++result->errors;
+		} else if (found_count) {
+			libredxx_free_found(found);
+		}
+	}
+}
+
+static void bench_throughput(const struct bench_options* options, libredxx_opened_device* device, bool write, size_t size, struct bench_result* result)
+{
+	uint8_t* buffer = malloc(size);
+	if (!buffer) {
+		++result->errors;
+		return;
+	}
+	for (size_t i = 0; i < size; ++i) {
+		buffer[i] = (uint8_t)i;
+	}
+	if (!write && options->type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		libredxx_d3xx_set_stream_size(device, LIBREDXX_ENDPOINT_A, size);
+	}
+	const uint64_t start_ns = bench_time_ns();
+	const uint64_t end_ns = start_ns + (uint64_t)options->duration_ms * 1000000;
+	uint64_t now_ns = start_ns;
+	while (now_ns < end_ns) {
+		size_t transferred = size;
+		if (bench_transfer(options, device, write, buffer, &transferred) != LIBREDXX_STATUS_SUCCESS) {
+			++result->errors;
+			break;
+		}
+		++result->transfers;
+		result->bytes += transferred;
+		now_ns = bench_time_ns();
+	}
+	result->elapsed_ns = now_ns - start_ns;
+	if (!write && options->type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		libredxx_d3xx_set_stream_size(device, LIBREDXX_ENDPOINT_A, 0);
+	}
+	free(buffer);
+}
+
+// writes size bytes and reads until they are all back
+static void bench_latency(const struct bench_options* options, libredxx_opened_device* device, size_t size, struct bench_result* result)
+{
+	uint8_t* tx = malloc(size);
+	uint8_t* rx = malloc(size);
+	result->samples_ns = calloc(options->iterations, sizeof(uint64_t));
+	if (!tx || !rx || !result->samples_ns) {
+		++result->errors;
+		free(tx);
+		free(rx);
+		return;
+	}
+	for (uint32_t i = 0; i < options->iterations; ++i) {
+		for (size_t j = 0; j < size; ++j) {
+			tx[j] = (uint8_t)(i + j);
+		}
+		const uint64_t start_ns = bench_time_ns();
+		size_t transferred = size;
+		libredxx_status status;
+		if (options->type == LIBREDXX_DEVICE_TYPE_FT260) {
+			// register 0, then the data, then read it back from register 0
+			uint8_t write[BENCH_FT260_I2C_PAYLOAD] = {0};
+			transferred = size < BENCH_FT260_I2C_PAYLOAD - 1 ? size : BENCH_FT260_I2C_PAYLOAD - 1;
+			memcpy(&write[1], tx, transferred);
+			status = bench_ft260_write(device, options->i2c_address, write, transferred + 1);
+			if (status == LIBREDXX_STATUS_SUCCESS) {
+				status = bench_ft260_write(device, options->i2c_address, write, 1);
+			}
+			if (status == LIBREDXX_STATUS_SUCCESS) {
+				status = bench_ft260_read(device, options->i2c_address, rx, transferred);
+			}
+		} else {
+			status = libredxx_write(device, tx, &transferred, LIBREDXX_ENDPOINT_A);
+			size_t received = 0;
+			while (status == LIBREDXX_STATUS_SUCCESS && received < transferred) {
+				size_t read_size = transferred - received;
+				status = libredxx_read(device, &rx[received], &read_size, LIBREDXX_ENDPOINT_A);
+				received += read_size;
+			}
+		}
+		const uint64_t elapsed_ns = bench_time_ns() - start_ns;
+		if (status != LIBREDXX_STATUS_SUCCESS || memcmp(tx, rx, transferred) != 0) {
+			++result->errors;
+			break;
+		}
+		result->samples_ns[result->samples_count++] = elapsed_ns;
+		++result->transfers;
+		result->bytes += transferred;
+		result->elapsed_ns += elapsed_ns;
+	}
+	free(tx);
+	free(rx);
+}
+
+struct bench_reader {
+	libredxx_opened_device* device;
+	libredxx_status status;
+	uint64_t return_ns;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI bench_reader_thread(void* arg)
+#else
+static void* bench_reader_thread(void* arg)
+#endif
+{
+	struct bench_reader* reader = arg;
+	uint8_t buffer[512];
+	size_t size = sizeof(buffer);
+	reader->status = libredxx_read(reader->device, buffer, &size, LIBREDXX_ENDPOINT_A);
+	reader->return_ns = bench_time_ns();
+#ifdef _WIN32
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
+// time from libredxx_interrupt to a read that has nothing to return giving up
+static void bench_interrupt(const struct bench_options* options, libredxx_opened_device* device, struct bench_result* result)
+{
+	result->samples_ns = calloc(options->iterations, sizeof(uint64_t));
+	for (uint32_t i = 0; i < options->iterations && result->samples_ns; ++i) {
+		struct bench_reader reader = {device, LIBREDXX_STATUS_SUCCESS, 0};
+#ifdef _WIN32
+		HANDLE thread = CreateThread(NULL, 0, bench_reader_thread, &reader, 0, NULL);
+#else
+		pthread_t thread;
+		pthread_create(&thread, NULL, bench_reader_thread, &reader);
+#endif
+		bench_sleep_ms(2); // let the read block
+		const uint64_t start_ns = bench_time_ns();
+		libredxx_interrupt(device);
+#ifdef _WIN32
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+#else
+		pthread_join(thread, NULL);
+#endif
+		if (reader.status != LIBREDXX_STATUS_ERROR_INTERRUPTED) {
+			++result->errors; // the read got data instead, or failed
+			continue;
+		}
+		result->samples_ns[result->samples_count] = reader.return_ns - start_ns;
+		result->elapsed_ns += result->samples_ns[result->samples_count++];
+		++result->transfers;
+	}
+}
+
+// output
+
+static void bench_write_csv(FILE* file, const struct bench_options* options, const struct bench_result* results, size_t results_count)
+{
+	static const char* const types[] = {"d2xx", "d3xx", "ft260"};
+	fprintf(file, "test,type,sim,size,transfers,bytes,seconds,mb_per_s,p50_us,p90_us,p99_us,max_us,errors\n");
+	for (size_t i = 0; i < results_count; ++i) {
+		const struct bench_result* result = &results[i];
+		const double seconds = (double)result->elapsed_ns / 1e9;
+		fprintf(file, "%s,%s,%d,%zu,%llu,%llu,%.6f,%.3f,", result->test, types[options->type], options->sim, result->size,
+			(unsigned long long)result->transfers, (unsigned long long)result->bytes, seconds, seconds > 0 ? (double)result->bytes / seconds / 1e6 : 0);
+		bench_write_percentiles(file, result, false);
+		fprintf(file, "%llu\n", (unsigned long long)result->errors);
+	}
+}
+
+static void bench_write_json(FILE* file, const struct bench_options* options, const struct bench_result* results, size_t results_count)
+{
+	static const char* const types[] = {"d2xx", "d3xx", "ft260"};
+	fprintf(file, "{\n\t\"device\": {\"type\": \"%s\", \"vid\": %u, \"pid\": %u, \"sim\": %s},\n\t\"results\": [", types[options->type],
+		options->id.vid, options->id.pid, options->sim ? "true" : "false");
+	for (size_t i = 0; i < results_count; ++i) {
+		const struct bench_result* result = &results[i];
+		const double seconds = (double)result->elapsed_ns / 1e9;
+		fprintf(file, "%s\n\t\t{\"test\": \"%s\", \"size\": %zu, \"transfers\": %llu, \"bytes\": %llu, \"seconds\": %.6f, \"mb_per_s\": %.3f, ", i ? "," : "",
+			result->test, result->size, (unsigned long long)result->transfers, (unsigned long long)result->bytes, seconds,
+			seconds > 0 ? (double)result->bytes / seconds / 1e6 : 0);
+		bench_write_percentiles(file, result, true);
+		fprintf(file, "\"errors\": %llu}", (unsigned long long)result->errors);
+	}
+	fprintf(file, "\n\t]\n}\n");
+}
+
+// setup
+
+static libredxx_status bench_add_sim_devices(const struct bench_options* options)
+{
+	libredxx_status status = libredxx_sim_start();
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	const char* serials[] = {BENCH_SIM_SOURCE_SERIAL, BENCH_SIM_LOOPBACK_SERIAL};
+	for (size_t i = 0; i < 2; ++i) {
+		libredxx_sim_device_config config = {0};
+		config.type = options->type;
+		config.id = options->id;
+		strcpy(config.serial.serial, serials[i]);
+		config.release = options->type == LIBREDXX_DEVICE_TYPE_D2XX ? 0x0700 : 0; // FT2232H
+		config.mode = i == 0 ? LIBREDXX_SIM_SOURCE : LIBREDXX_SIM_LOOPBACK;
+		config.bandwidth = options->sim_bandwidth;
+		config.latency_us = options->sim_latency_us;
+		uint32_t device_id;
+		status = libredxx_sim_add_device(&config, &device_id);
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			return status;
+		}
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static libredxx_opened_device* bench_open(const struct bench_options* options, const char* serial)
+{
+	libredxx_find_filter filter = {options->type, options->id};
+	libredxx_found_device** found = NULL;
+	size_t found_count = 0;
+	if (libredxx_find_devices(&filter, 1, &found, &found_count) != LIBREDXX_STATUS_SUCCESS || !found_count) {
+		return NULL;
+	}
+	libredxx_opened_device* opened = NULL;
+	for (size_t i = 0; i < found_count && !opened; ++i) {
+		libredxx_serial found_serial;
+		uint8_t interface_index;
+		libredxx_get_serial(found[i], &found_serial);
+		libredxx_get_interface_index(found[i], &interface_index);
+		if (interface_index != 0 || (serial && strcmp(found_serial.serial, serial) != 0)) {
+			continue;
+		}
+		if (libredxx_open_device(found[i], &opened) != LIBREDXX_STATUS_SUCCESS) {
+			opened = NULL;
+		}
+	}
+	libredxx_free_found(found);
+	if (opened && options->type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		libredxx_d2xx_set_latency_timer(opened, 1);
+	}
+	return opened;
+}
+
+static void bench_usage(const char* name)
+{
+	printf("usage: %s [options]\n", name);
+	printf("  --type d2xx|d3xx|ft260   device type (d2xx)\n");
+	printf("  --vid VID --pid PID      hex device id (0403:6010, 0403:601F, 0403:6030 by type)\n");
+	printf("  --serial SERIAL          device to use, the first one otherwise\n");
+	printf("  --sim                    use simulated devices instead of hardware\n");
+	printf("  --sim-bandwidth BYTES    simulated bytes per second (0 for unlimited)\n");
+	printf("  --sim-latency US         simulated latency per transfer\n");
+	printf("  --tests LIST             any of find,write,read,latency,interrupt (all)\n");
+	printf("  --sizes LIST             transfer sizes (64,512,4096,65536, FT260 8,60)\n");
+	printf("  --duration MS            per throughput test (1000)\n");
+	printf("  --iterations N           per latency, interrupt and find test (1000)\n");
+	printf("  --i2c-address ADDRESS    hex FT260 target (50)\n");
+	printf("  --format json|csv        output format (json)\n");
+	printf("  --output PATH            output file (stdout)\n");
+	printf("read throughput needs a device that keeps sending, latency one that loops back\n");
+}
+
+static bool bench_parse(int argc, char** argv, struct bench_options* options)
+{
+	static const char* const tests[] = {"find", "write", "read", "latency", "interrupt"};
+	options->type = LIBREDXX_DEVICE_TYPE_D2XX;
+	options->tests = BENCH_TEST_FIND | BENCH_TEST_WRITE | BENCH_TEST_READ | BENCH_TEST_LATENCY | BENCH_TEST_INTERRUPT;
+	options->duration_ms = 1000;
+	options->iterations = 1000;
+	options->i2c_address = 0x50;
+	bool id_set = false;
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (strcmp(arg, "--sim") == 0) {
+			options->sim = true;
+			continue;
+		}
+		if (!value) {
+			return false;
+		}
+		++i;
+		if (strcmp(arg, "--type") == 0) {
+			if (strcmp(value, "d2xx") == 0) {
+				options->type = LIBREDXX_DEVICE_TYPE_D2XX;
+			} else if (strcmp(value, "d3xx") == 0) {
+				options->type = LIBREDXX_DEVICE_TYPE_D3XX;
+			} else if (strcmp(value, "ft260") == 0) {
+				options->type = LIBREDXX_DEVICE_TYPE_FT260;
+			} else {
+				return false;
+			}
+		} else if (strcmp(arg, "--vid") == 0) {
+			options->id.vid = (uint16_t)strtoul(value, NULL, 16);
+			id_set = true;
+		} else if (strcmp(arg, "--pid") == 0) {
+			options->id.pid = (uint16_t)strtoul(value, NULL, 16);
+			id_set = true;
+		} else if (strcmp(arg, "--serial") == 0) {
+			options->serial = value;
+		} else if (strcmp(arg, "--sim-bandwidth") == 0) {
+			options->sim_bandwidth = strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--sim-latency") == 0) {
+			options->sim_latency_us = (uint32_t)strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--tests") == 0) {
+			options->tests = 0;
+			for (size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); ++t) {
+				if (strstr(value, tests[t])) {
+					options->tests |= 1u << t;
+				}
+			}
+		} else if (strcmp(arg, "--sizes") == 0) {
+			options->sizes_count = 0;
+			for (char* end = (char*)value; *end && options->sizes_count < BENCH_MAX_SIZES; end += *end == ',') {
+				const size_t size = strtoul(end, &end, 10);
+				if (!size) {
+					return false;
+				}
+				options->sizes[options->sizes_count++] = size;
+			}
+		} else if (strcmp(arg, "--duration") == 0) {
+			options->duration_ms = (uint32_t)strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--iterations") == 0) {
+			options->iterations = (uint32_t)strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--i2c-address") == 0) {
+			options->i2c_address = (uint8_t)strtoul(value, NULL, 16);
+		} else if (strcmp(arg, "--format") == 0) {
+			options->csv = strcmp(value, "csv") == 0;
+		} else if (strcmp(arg, "--output") == 0) {
+			options->output = value;
+		} else {
+			return false;
+		}
+	}
+	if (!id_set) {
+		static const uint16_t pids[] = {0x6010, 0x601F, 0x6030};
+		options->id.vid = 0x0403;
+		options->id.pid = pids[options->type];
+	}
+	if (!options->sizes_count && options->type == LIBREDXX_DEVICE_TYPE_FT260) {
+		options->sizes[0] = 8;
+		options->sizes[1] = BENCH_FT260_I2C_PAYLOAD;
+		options->sizes_count = 2;
+	} else if (!options->sizes_count) {
+		static const size_t sizes[] = {64, 512, 4096, 65536};
+		memcpy(options->sizes, sizes, sizeof(sizes));
+		options->sizes_count = sizeof(sizes) / sizeof(sizes[0]);
+	}
+	return options->iterations > 0;
+}
+
+int main(int argc, char** argv)
+{
+	struct bench_options options = {0};
+	if (!bench_parse(argc, argv, &options)) {
+		bench_usage(argv[0]);
+		return -1;
+	}
+	if (options.sim) {
+		libredxx_status status = bench_add_sim_devices(&options);
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			printf("error: unable to simulate devices: %d\n", status);
+			return -1;
+		}
+	}
+	libredxx_opened_device* source = bench_open(&options, options.sim ? BENCH_SIM_SOURCE_SERIAL : options.serial);
+	libredxx_opened_device* loopback = options.sim ? bench_open(&options, BENCH_SIM_LOOPBACK_SERIAL) : source;
+	if (!source || !loopback) {
+		printf("error: unable to open device\n");
+		return -1;
+	}
+
+	struct bench_result results[3 + BENCH_MAX_SIZES * 3];
+	size_t results_count = 0;
+	memset(results, 0, sizeof(results));
+	if (options.tests & BENCH_TEST_FIND) {
+		fprintf(stderr, "find\n");
+		results[results_count].test = "find";
+		bench_find(&options, &results[results_count++]);
+	}
+	for (size_t i = 0; i < options.sizes_count; ++i) {
+		const size_t size = options.sizes[i];
+		if (options.tests & BENCH_TEST_WRITE) {
+			fprintf(stderr, "write %zu\n", size);
+			results[results_count].test = "write";
+			results[results_count].size = size;
+			bench_throughput(&options, source, true, size, &results[results_count++]);
+		}
+		if (options.tests & BENCH_TEST_READ) {
+			fprintf(stderr, "read %zu\n", size);
+			results[results_count].test = "read";
+			results[results_count].size = size;
+			bench_throughput(&options, source, false, size, &results[results_count++]);
+		}
+		if (options.tests & BENCH_TEST_LATENCY) {
+			fprintf(stderr, "latency %zu\n", size);
+			results[results_count].test = "latency";
+			results[results_count].size = size;
+			bench_latency(&options, loopback, size, &results[results_count++]);
+		}
+	}
+	if (options.tests & BENCH_TEST_INTERRUPT) {
+		fprintf(stderr, "interrupt\n");
+		results[results_count].test = "interrupt";
+		bench_interrupt(&options, loopback, &results[results_count++]);
+	}
+	for (size_t i = 0; i < results_count; ++i) {
+		if (results[i].samples_ns) {
+			qsort(results[i].samples_ns, results[i].samples_count, sizeof(uint64_t), bench_compare);
+		}
+	}
+
+	FILE* file = options.output ? fopen(options.output, "w") : stdout;
+	if (!file) {
+		printf("error: unable to open %s\n", options.output);
+	} else {
+		if (options.csv) {
+			bench_write_csv(file, &options, results, results_count);
+		} else {
+			bench_write_json(file, &options, results, results_count);
+		}
+		if (file != stdout) {
+			fclose(file);
+		}
+	}
+
+	for (size_t i = 0; i < results_count; ++i) {
+		free(results[i].samples_ns);
+	}
+	if (loopback != source) {
+		libredxx_close_device(loopback);
+	}
+	libredxx_close_device(source);
+	if (options.sim) {
+		libredxx_sim_stop();
+	}
+	return file ? 0 : -1;
+}
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "libredxx/libredxx.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+/*
+ * Compares the C++ layer against the C API it wraps on one device, or on a
+ * simulated source device with --sim. Blocking reads go through libredxx_read
+ * and device::read, asynchronous ones through libredxx_transfer callbacks and
+ * coroutines awaiting device::async_read. Every global operator new is counted,
+ * the C++ loops are expected to report none.
+ */
+
+static std::atomic<uint64_t> bench_allocations;
+
+void* operator new(std::size_t size)
+{
+	++bench_allocations;
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace {
+
+constexpr const char* bench_sim_serial = "BENCHSRC";
+
+struct bench_options {
+	libredxx_device_type type = LIBREDXX_DEVICE_TYPE_D2XX;
+	libredxx_device_id id = {};
+	const char* serial = nullptr;
+	bool sim = false;
+	std::size_t size = 4096;
+	std::size_t depth = 4;
+	uint32_t duration_ms = 1000;
+};
+
+struct bench_result {
+	const char* test;
+	const char* api;
+	uint64_t transfers = 0;
+	uint64_t bytes = 0;
+	uint64_t elapsed_ns = 0;
+	uint64_t allocations = 0;
+	uint64_t errors = 0;
+};
+
+uint64_t bench_time_ns()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// starts running right away and stays suspended at the end until destroyed
+struct bench_task {
+	struct promise_type {
+		bench_task get_return_object() { return bench_task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::abort(); }
+	};
+
+	std::coroutine_handle<promise_type> handle;
+
+	bench_task(std::coroutine_handle<promise_type> h) : handle(h) {}
+	bench_task(const bench_task&) = delete;
+	bench_task(bench_task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	~bench_task()
+	{
+		if (handle) {
+			handle.destroy();
+		}
+	}
+	bool done() const { return handle.done(); }
+};
+
+void bench_c_blocking(const bench_options& options, libredxx_opened_device* device, std::byte* buffer, bench_result& result)
+{
+	const uint64_t allocations = bench_allocations;
+	const uint64_t start_ns = bench_time_ns();
+	const uint64_t end_ns = start_ns + uint64_t{options.duration_ms} * 1000000;
+	uint64_t now_ns = start_ns;
+	while (now_ns < end_ns) {
+		std::size_t size = options.size;
+		if (libredxx_read(device, buffer, &size, LIBREDXX_ENDPOINT_A) != LIBREDXX_STATUS_SUCCESS) {
+			++result.errors;
+			break;
+		}
+		++result.transfers;
+		result.bytes += size;
+		now_ns = bench_time_ns();
+	}
+	result.elapsed_ns = now_ns - start_ns;
+	result.allocations = bench_allocations - allocations;
+}
+
+void bench_cpp_blocking(const bench_options& options, libredxx::device& device, std::byte* buffer, bench_result& result)
+{
+	const std::span<std::byte> span(buffer, options.size);
+	const uint64_t allocations = bench_allocations;
+	const uint64_t start_ns = bench_time_ns();
+	const uint64_t end_ns = start_ns + uint64_t{options.duration_ms} * 1000000;
+	uint64_t now_ns = start_ns;
+	while (now_ns < end_ns) {
+		libredxx::result<std::size_t> read = device.read(span);
+		if (!read) {
+			++result.errors;
+			break;
+		}
+		++result.transfers;
+		result.bytes += *read;
+		now_ns = bench_time_ns();
+	}
+	result.elapsed_ns = now_ns - start_ns;
+	result.allocations = bench_allocations - allocations;
+}
+
+struct bench_c_async_state {
+	bench_result* result;
+	uint64_t end_ns;
+	std::size_t in_flight;
+};
+
+void bench_c_async_callback(libredxx_transfer* transfer)
+{
+	bench_c_async_state* state = static_cast<bench_c_async_state*>(transfer->user_data);
+	--state->in_flight;
+	if (transfer->status == LIBREDXX_STATUS_SUCCESS) {
+		++state->result->transfers;
+		state->result->bytes += transfer->transferred;
+	} else {
+		++state->result->errors;
+		return;
+	}
+	if (bench_time_ns() < state->end_ns && libredxx_submit_transfer(transfer) == LIBREDXX_STATUS_SUCCESS) {
+		++state->in_flight;
+	}
+}
+
+void bench_c_async(const bench_options& options, libredxx_opened_device* device, std::byte* buffers, libredxx_transfer** transfers, bench_result& result)
+{
+	bench_c_async_state state = {&result, 0, 0};
+	const uint64_t allocations = bench_allocations;
+	const uint64_t start_ns = bench_time_ns();
+	state.end_ns = start_ns + uint64_t{options.duration_ms} * 1000000;
+	for (std::size_t i = 0; i < options.depth; ++i) {
+		libredxx_transfer* transfer = transfers[i];
+		transfer->device = device;
+		transfer->endpoint = LIBREDXX_ENDPOINT_A;
+		transfer->write = false;
+		transfer->buffer = buffers + i * options.size;
+		transfer->size = options.size;
+		transfer->callback = bench_c_async_callback;
+		transfer->user_data = &state;
+		if (libredxx_submit_transfer(transfer) == LIBREDXX_STATUS_SUCCESS) {
+			++state.in_flight;
+		}
+	}
+	while (state.in_flight) {
+		libredxx_status status = libredxx_poll_completions(device, 1000);
+		if (status != LIBREDXX_STATUS_SUCCESS && status != LIBREDXX_STATUS_ERROR_TIMEOUT) {
+			++result.errors;
+			break;
+		}
+	}
+	result.elapsed_ns = bench_time_ns() - start_ns;
+	result.allocations = bench_allocations - allocations;
+}
+
+bench_task bench_cpp_reader(libredxx::device& device, libredxx::transfer& transfer, std::span<std::byte> buffer, uint64_t end_ns, bench_result& result)
+{
+	while (bench_time_ns() < end_ns) {
+		libredxx::result<std::size_t> read = co_await device.async_read(transfer, buffer);
+		if (!read) {
+			++result.errors;
+			co_return;
+		}
+		++result.transfers;
+		result.bytes += *read;
+	}
+}
+
+void bench_cpp_async(const bench_options& options, libredxx::device& device, std::byte* buffers, std::vector<libredxx::transfer>& transfers, bench_result& result)
+{
+	std::vector<bench_task> tasks;
+	tasks.reserve(options.depth);
+	// the coroutine frames are allocated up front, before counting starts
+	const uint64_t start_ns = bench_time_ns();
+	const uint64_t end_ns = start_ns + uint64_t{options.duration_ms} * 1000000;
+	uint64_t allocations = bench_allocations;
+	for (std::size_t i = 0; i < options.depth; ++i) {
+		tasks.push_back(bench_cpp_reader(device, transfers[i], std::span<std::byte>(buffers + i * options.size, options.size), end_ns, result));
+	}
+	const uint64_t frame_allocations = bench_allocations - allocations;
+	allocations = bench_allocations;
+	while (true) {
+		bool done = true;
+		for (const bench_task& task : tasks) {
+			done = done && task.done();
+		}
+		if (done) {
+			break;
+		}
+		libredxx::result<void> polled = device.poll_completions(std::chrono::milliseconds(1000));
+		if (!polled && polled.error() != LIBREDXX_STATUS_ERROR_TIMEOUT) {
+			++result.errors;
+			break;
+		}
+	}
+	result.elapsed_ns = bench_time_ns() - start_ns;
+	result.allocations = bench_allocations - allocations;
+	std::fprintf(stderr, "coroutine frames took %llu allocations before the loop\n", static_cast<unsigned long long>(frame_allocations));
+}
+
+libredxx::device bench_open(const bench_options& options, const char* serial)
+{
+	const libredxx_find_filter filter = {options.type, options.id};
+	libredxx::result<libredxx::found_devices> found = libredxx::found_devices::find(std::span(&filter, 1));
+	if (!found) {
+		return {};
+	}
+	for (libredxx_found_device* candidate : *found) {
+		libredxx::result<libredxx_serial> found_serial = libredxx::get_serial(candidate);
+		libredxx::result<uint8_t> interface_index = libredxx::get_interface_index(candidate);
+		if (!found_serial || !interface_index || *interface_index != 0 || (serial && std::strcmp(found_serial->serial, serial) != 0)) {
+			continue;
+		}
+		libredxx::result<libredxx::device> opened = libredxx::device::open(candidate);
+		if (opened) {
+			if (options.type == LIBREDXX_DEVICE_TYPE_D2XX) {
+				opened->d2xx_set_latency_timer(1);
+			}
+			return std::move(*opened);
+		}
+	}
+	return {};
+}
+
+bool bench_add_sim_device(const bench_options& options)
+{
+	if (libredxx_sim_start() != LIBREDXX_STATUS_SUCCESS) {
+		return false;
+	}
+	libredxx_sim_device_config config = {};
+	config.type = options.type;
+	config.id = options.id;
+	std::strcpy(config.serial.serial, bench_sim_serial);
+	config.release = options.type == LIBREDXX_DEVICE_TYPE_D2XX ? 0x0700 : 0; // FT2232H
+	config.mode = LIBREDXX_SIM_SOURCE;
+	uint32_t device_id;
+	return libredxx_sim_add_device(&config, &device_id) == LIBREDXX_STATUS_SUCCESS;
+}
+
+void bench_usage(const char* name)
+{
+	std::printf("usage: %s [options]\n", name);
+	std::printf("  --type d2xx|d3xx         device type (d2xx)\n");
+	std::printf("  --vid VID --pid PID      hex device id (0403:6010, 0403:601F by type)\n");
+	std::printf("  --serial SERIAL          device to use, the first one otherwise\n");
+	std::printf("  --sim                    use a simulated source device instead of hardware\n");
+	std::printf("  --size BYTES             per read (4096), D2XX needs a multiple of 512\n");
+	std::printf("  --depth N                asynchronous reads in flight (4)\n");
+	std::printf("  --duration MS            per test (1000)\n");
+	std::printf("reads need a device that keeps sending\n");
+}
+
+bool bench_parse(int argc, char** argv, bench_options& options)
+{
+	bool id_set = false;
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (std::strcmp(arg, "--sim") == 0) {
+			options.sim = true;
+			continue;
+		}
+		if (!value) {
+			return false;
+		}
+		++i;
+		if (std::strcmp(arg, "--type") == 0) {
+			if (std::strcmp(value, "d2xx") == 0) {
+				options.type = LIBREDXX_DEVICE_TYPE_D2XX;
+			} else if (std::strcmp(value, "d3xx") == 0) {
+				options.type = LIBREDXX_DEVICE_TYPE_D3XX;
+			} else {
+				return false;
+			}
+		} else if (std::strcmp(arg, "--vid") == 0) {
+			options.id.vid = static_cast<uint16_t>(std::strtoul(value, nullptr, 16));
+			id_set = true;
+		} else if (std::strcmp(arg, "--pid") == 0) {
+			options.id.pid = static_cast<uint16_t>(std::strtoul(value, nullptr, 16));
+			id_set = true;
+		} else if (std::strcmp(arg, "--serial") == 0) {
+			options.serial = value;
+		} else if (std::strcmp(arg, "--size") == 0) {
+			options.size = std::strtoul(value, nullptr, 10);
+		} else if (std::strcmp(arg, "--depth") == 0) {
+			options.depth = std::strtoul(value, nullptr, 10);
+		} else if (std::strcmp(arg, "--duration") == 0) {
+			options.duration_ms = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		} else {
+			return false;
+		}
+	}
+	if (!id_set) {
+		options.id.vid = 0x0403;
+		options.id.pid = options.type == LIBREDXX_DEVICE_TYPE_D3XX ? 0x601F : 0x6010;
+	}
+	return options.size > 0 && options.depth > 0;
+}
+
+void bench_print(const bench_result* results, std::size_t results_count)
+{
+	std::printf("[\n");
+	for (std::size_t i = 0; i < results_count; ++i) {
+		const bench_result& result = results[i];
+		const double seconds = static_cast<double>(result.elapsed_ns) / 1e9;
+		const double ns_per_transfer = result.transfers ? static_cast<double>(result.elapsed_ns) / static_cast<double>(result.transfers) : 0.0;
+		std::printf("  {\"test\": \"%s\", \"api\": \"%s\", \"transfers\": %llu, \"bytes\": %llu, \"elapsed_ns\": %llu, \"bytes_per_second\": %.0f, \"ns_per_transfer\": %.1f, \"allocations\": %llu, \"errors\": %llu}%s\n",
+			result.test, result.api, static_cast<unsigned long long>(result.transfers), static_cast<unsigned long long>(result.bytes),
+			static_cast<unsigned long long>(result.elapsed_ns), seconds > 0 ? static_cast<double>(result.bytes) / seconds : 0.0, ns_per_transfer,
+			static_cast<unsigned long long>(result.allocations), static_cast<unsigned long long>(result.errors), i + 1 < results_count ? "," : "");
+	}
+	std::printf("]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench_options options;
+	if (!bench_parse(argc, argv, options)) {
+		bench_usage(argv[0]);
+		return -1;
+	}
+	if (options.sim && !bench_add_sim_device(options)) {
+		std::printf("error: unable to simulate a device\n");
+		return -1;
+	}
+	bench_result results[4] = {{"read", "c"}, {"read", "cpp"}, {"async_read", "c"}, {"async_read", "cpp"}};
+	{
+		libredxx::device device = bench_open(options, options.sim ? bench_sim_serial : options.serial);
+		if (!device) {
+			std::printf("error: unable to open device\n");
+			return -1;
+		}
+		std::vector<std::byte> buffers(options.size * options.depth);
+		std::vector<libredxx::transfer> transfers;
+		std::vector<libredxx_transfer*> native_transfers;
+		for (std::size_t i = 0; i < options.depth; ++i) {
+			libredxx::result<libredxx::transfer> transfer = libredxx::transfer::alloc();
+			if (!transfer) {
+				std::printf("error: unable to allocate transfers\n");
+				return -1;
+			}
+			native_transfers.push_back(transfer->native_handle());
+			transfers.push_back(std::move(*transfer));
+		}
+
+		std::fprintf(stderr, "read c\n");
+		bench_c_blocking(options, device.native_handle(), buffers.data(), results[0]);
+		std::fprintf(stderr, "read cpp\n");
+		bench_cpp_blocking(options, device, buffers.data(), results[1]);
+		std::fprintf(stderr, "async_read c\n");
+		bench_c_async(options, device.native_handle(), buffers.data(), native_transfers.data(), results[2]);
+		std::fprintf(stderr, "async_read cpp\n");
+		bench_cpp_async(options, device, buffers.data(), transfers, results[3]);
+	}
+	bench_print(results, sizeof(results) / sizeof(results[0]));
+	if (options.sim) {
+		libredxx_sim_stop();
+	}
+	return 0;
+}
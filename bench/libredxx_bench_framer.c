@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libredxx/libredxx.h"
+
+/*
+ * Runs every framer type over a large synthetic stream held in memory, pushed
+ * in fixed size chunks the way reads would hand them over, once with the
+ * scalar scan and once with the vectorized one. Payloads are random so sync
+ * words, SLIP escapes and COBS codes land anywhere in them.
+ */
+
+struct bench_options {
+	size_t stream_size;
+	size_t chunk_size;
+	size_t frame_size;
+	uint32_t repeat;
+	bool csv;
+};
+
+struct bench_stream {
+	uint8_t* data;
+	size_t size;
+	uint64_t frames;
+};
+
+static uint64_t bench_time_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint32_t bench_random(uint64_t* state)
+{
+	// xorshift64*
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return (uint32_t)((*state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static void bench_fill(uint64_t* state, uint8_t* payload, size_t size)
+{
+	for (size_t i = 0; i < size; ++i) {
+		payload[i] = (uint8_t)bench_random(state);
+	}
+}
+
+// encodes random frames until size bytes are used, the worst case encoding of a frame is twice its size plus two
+static bool bench_generate(const struct bench_options* options, const libredxx_framer_config* config, struct bench_stream* stream)
+{
+	const size_t capacity = options->stream_size + options->frame_size * 2 + 16;
+	stream->data = malloc(capacity);
+	uint8_t* payload = malloc(options->frame_size);
+	if (!stream->data || !payload) {
+		free(payload);
+		return false;
+	}
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+	stream->size = 0;
+	stream->frames = 0;
+	while (stream->size < options->stream_size) {
+		uint8_t* out = &stream->data[stream->size];
+		size_t size = config->type == LIBREDXX_FRAMER_SYNC_WORD ? config->frame_size : 1 + bench_random(&state) % options->frame_size;
+		bench_fill(&state, payload, size);
+		switch (config->type) {
+		case LIBREDXX_FRAMER_SYNC_WORD:
+			memcpy(out, config->sync, config->sync_size);
+			out += config->sync_size;
+			memcpy(out, payload, size);
+			out += size;
+			break;
+		case LIBREDXX_FRAMER_LENGTH_PREFIX:
+			memcpy(out, config->sync, config->sync_size);
+			out += config->sync_size;
+			*out++ = (uint8_t)size;
+			*out++ = (uint8_t)(size >> 8);
+			memcpy(out, payload, size);
+			out += size;
+			break;
+		case LIBREDXX_FRAMER_SLIP:
+			for (size_t i = 0; i < size; ++i) {
+				if (payload[i] == 0xC0) {
+					*out++ = 0xDB;
+					*out++ = 0xDC;
+				} else if (payload[i] == 0xDB) {
+					*out++ = 0xDB;
+					*out++ = 0xDD;
+				} else {
+					*out++ = payload[i];
+				}
+			}
+			*out++ = 0xC0;
+			break;
+		case LIBREDXX_FRAMER_COBS: {
+			uint8_t* code = out++;
+			*code = 1;
+			for (size_t i = 0; i < size; ++i) {
+				if (payload[i] == 0) {
+					code = out++;
+					*code = 1;
+					continue;
+				}
+				*out++ = payload[i];
+				if (++*code == 0xFF && i + 1 < size) {
+					code = out++;
+					*code = 1;
+				}
+			}
+			*out++ = 0;
+			break;
+		}
+		}
+		stream->size = (size_t)(out - stream->data);
+		++stream->frames;
+	}
+	free(payload);
+	return true;
+}
+
+static void bench_frame(void* context, const void* frame, size_t size)
+{
+	// touch the frame so a zero-copy callback is not cheaper than a real consumer
+	uint64_t* sum = context;
+	*sum += ((const uint8_t*)frame)[0] + ((const uint8_t*)frame)[size - 1];
+}
+
+static void bench_usage(const char* name)
+{
+	printf("usage: %s [options]\n", name);
+	printf("  --size BYTES             synthetic stream per framer type (268435456)\n");
+	printf("  --chunk BYTES            bytes per push (65536)\n");
+	printf("  --frame BYTES            largest payload, the SYNC_WORD payload is a quarter of it (256)\n");
+	printf("  --repeat N               passes over each stream, the best one is reported (3)\n");
+	printf("  --format text|csv        output format (text)\n");
+}
+
+static bool bench_parse(int argc, char** argv, struct bench_options* options)
+{
+	options->stream_size = 256 * 1024 * 1024;
+	options->chunk_size = 64 * 1024;
+	options->frame_size = 256;
+	options->repeat = 3;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const char* arg = argv[i];
+		const char* value = argv[i + 1];
+		if (strcmp(arg, "--size") == 0) {
+			options->stream_size = (size_t)strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--chunk") == 0) {
+			options->chunk_size = (size_t)strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--frame") == 0) {
+			options->frame_size = (size_t)strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--repeat") == 0) {
+			options->repeat = (uint32_t)strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--format") == 0) {
+			if (strcmp(value, "csv") == 0) {
+				options->csv = true;
+			} else if (strcmp(value, "text") != 0) {
+				return false;
+			}
+		} else {
+			return false;
+		}
+	}
+	return argc % 2 == 1 && options->stream_size && options->chunk_size && options->frame_size >= 4 && options->frame_size <= 65535 && options->repeat;
+}
+
+int main(int argc, char** argv)
+{
+	struct bench_options options = {0};
+	if (!bench_parse(argc, argv, &options)) {
+		bench_usage(argv[0]);
+		return -1;
+	}
+	static const char* const names[] = {"sync_word", "length_prefix", "slip", "cobs"};
+	libredxx_framer_config configs[4];
+	memset(configs, 0, sizeof(configs));
+	for (size_t i = 0; i < 4; ++i) {
+		configs[i].type = (libredxx_framer_type)i;
+		configs[i].max_frame_size = options.frame_size;
+	}
+	configs[LIBREDXX_FRAMER_SYNC_WORD].sync[0] = 0xA5;
+	configs[LIBREDXX_FRAMER_SYNC_WORD].sync[1] = 0x5A;
+	configs[LIBREDXX_FRAMER_SYNC_WORD].sync_size = 2;
+	configs[LIBREDXX_FRAMER_SYNC_WORD].frame_size = options.frame_size / 4;
+	configs[LIBREDXX_FRAMER_LENGTH_PREFIX].sync[0] = 0xA5;
+	configs[LIBREDXX_FRAMER_LENGTH_PREFIX].sync_size = 1;
+	configs[LIBREDXX_FRAMER_LENGTH_PREFIX].length_size = 2;
+
+	if (options.csv) {
+		printf("type,scan,bytes,frames,errors,best_ns,mb_per_s\n");
+	}
+	int result = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		struct bench_stream stream;
+		if (!bench_generate(&options, &configs[i], &stream)) {
+			printf("error: unable to allocate %zu bytes\n", options.stream_size);
+			return -1;
+		}
+		for (uint32_t scalar = 0; scalar < 2; ++scalar) {
+			uint64_t sum = 0;
+			libredxx_framer_config config = configs[i];
+			config.flags = scalar ? LIBREDXX_FRAMER_SCALAR : 0;
+			config.callback = bench_frame;
+			config.context = &sum;
+			libredxx_framer* framer = NULL;
+			libredxx_status status = libredxx_framer_create(&config, &framer);
+			if (status != LIBREDXX_STATUS_SUCCESS) {
+				printf("error: unable to create %s framer: %d\n", names[i], status);
+				free(stream.data);
+				return -1;
+			}
+			uint64_t best_ns = UINT64_MAX;
+			for (uint32_t pass = 0; pass < options.repeat; ++pass) {
+				libredxx_framer_reset(framer);
+				const uint64_t start_ns = bench_time_ns();
+				for (size_t offset = 0; offset < stream.size; offset += options.chunk_size) {
+					const size_t remaining = stream.size - offset;
+					libredxx_framer_push(framer, &stream.data[offset], remaining < options.chunk_size ? remaining : options.chunk_size);
+				}
+				const uint64_t elapsed_ns = bench_time_ns() - start_ns;
+				best_ns = elapsed_ns < best_ns ? elapsed_ns : best_ns;
+			}
+			libredxx_framer_stats stats;
+			libredxx_framer_get_stats(framer, &stats);
+			libredxx_framer_destroy(framer);
+			const uint64_t frames = stats.frames / options.repeat;
+			const uint64_t errors = stats.errors / options.repeat;
+			const double mb_per_s = (double)stream.size / ((double)best_ns / 1e9) / 1e6;
+			const char* scan = scalar ? "scalar" : "vector";
+			if (options.csv) {
+				printf("%s,%s,%zu,%llu,%llu,%llu,%.1f\n", names[i], scan, stream.size, (unsigned long long)frames, (unsigned long long)errors, (unsigned long long)best_ns, mb_per_s);
+			} else {
+				printf("%-14s %-7s %10.1f MB/s %12llu frames %6llu errors\n", names[i], scan, mb_per_s, (unsigned long long)frames, (unsigned long long)errors);
+			}
+			if (frames != stream.frames) {
+				printf("error: %s %s framed %llu of %llu frames\n", names[i], scan, (unsigned long long)frames, (unsigned long long)stream.frames);
+				result = -1;
+			}
+		}
+		free(stream.data);
+	}
+	return result;
+}
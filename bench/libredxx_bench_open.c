@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libredxx/libredxx.h"
+
+/*
+ * Measures how long it takes to open and set up every device of a type, one
+ * after the other and with libredxx_open_many on 1, 2, 4, ... workers. Setup
+ * is what an application does first: a D2XX device gets its latency timer,
+ * baud rate and data characteristics, an FT260 its I2C clock, a D3XX nothing.
+ * --sim adds that many simulated devices, whose control transfers take the
+ * simulated latency like they take a round trip on real hardware.
+ */
+
+#define BENCH_MAX_DEVICES 127 // one USB bus
+#define BENCH_FT260_REPORT_SIZE 64
+
+struct bench_options {
+	libredxx_device_type type;
+	libredxx_device_id id;
+	uint32_t sim_devices;
+	uint32_t sim_latency_us;
+	size_t max_workers;
+	uint32_t repeat;
+	bool csv;
+};
+
+static uint64_t bench_time_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static libredxx_status bench_setup(void* context, libredxx_opened_device* device, size_t index)
+{
+	(void)index;
+	const struct bench_options* options = context;
+	if (options->type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		libredxx_status status = libredxx_d2xx_set_latency_timer(device, 1);
+		if (status == LIBREDXX_STATUS_SUCCESS) {
+			status = libredxx_d2xx_set_baud_rate(device, 115200);
+		}
+		if (status == LIBREDXX_STATUS_SUCCESS) {
+			status = libredxx_d2xx_set_data_characteristics(device, 8, LIBREDXX_D2XX_STOP_BITS_1, LIBREDXX_D2XX_PARITY_NONE);
+		}
+		return status;
+	}
+	if (options->type == LIBREDXX_DEVICE_TYPE_FT260) {
+		uint8_t report[BENCH_FT260_REPORT_SIZE] = {0xA1, 0x22, 100, 0}; // I2C clock, 100 kHz
+		size_t size = sizeof(report);
+		return libredxx_write(device, report, &size, LIBREDXX_ENDPOINT_B);
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+// workers 0 opens the devices one by one with libredxx_open_device
+static libredxx_status bench_open(struct bench_options* options, libredxx_found_device** found, size_t found_count, size_t workers, libredxx_opened_device** opened, libredxx_status* statuses)
+{
+	if (workers) {
+		libredxx_open_config config = {0};
+		config.workers = workers;
+		config.setup = bench_setup;
+		config.context = options;
+		return libredxx_open_many(found, found_count, &config, opened, statuses);
+	}
+	libredxx_status result = LIBREDXX_STATUS_SUCCESS;
+	for (size_t i = 0; i < found_count; ++i) {
+		statuses[i] = libredxx_open_device(found[i], &opened[i]);
+		if (statuses[i] == LIBREDXX_STATUS_SUCCESS) {
+			statuses[i] = bench_setup(options, opened[i], i);
+			if (statuses[i] != LIBREDXX_STATUS_SUCCESS) {
+				libredxx_close_device(opened[i]);
+			}
+		}
+		if (statuses[i] != LIBREDXX_STATUS_SUCCESS) {
+			opened[i] = NULL;
+			result = result == LIBREDXX_STATUS_SUCCESS ? statuses[i] : result;
+		}
+	}
+	return result;
+}
+
+static libredxx_status bench_add_sim_devices(const struct bench_options* options)
+{
+	libredxx_status status = libredxx_sim_start();
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	for (uint32_t i = 0; i < options->sim_devices; ++i) {
+		libredxx_sim_device_config config = {0};
+		config.type = options->type;
+		config.id = options->id;
+		snprintf(config.serial.serial, sizeof(config.serial.serial), "OPEN%03u", i);
+		config.release = options->type == LIBREDXX_DEVICE_TYPE_D2XX ? 0x0900 : 0; // FT232H
+		config.mode = LIBREDXX_SIM_LOOPBACK;
+		config.latency_us = options->sim_latency_us;
+		uint32_t device_id;
+		status = libredxx_sim_add_device(&config, &device_id);
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			return status;
+		}
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static void bench_usage(const char* name)
+{
+	printf("usage: %s [options]\n", name);
+	printf("  --type d2xx|d3xx|ft260   device type (d2xx)\n");
+	printf("  --vid VID --pid PID      hex device id (0403:6014, 0403:601F, 0403:6030 by type)\n");
+	printf("  --sim N                  use N simulated devices instead of hardware, up to 127\n");
+	printf("  --sim-latency US         simulated latency per transfer (1000)\n");
+	printf("  --workers N              most workers tried, doubling from 1 (16)\n");
+	printf("  --repeat N               opens of every device per worker count, the best one is reported (3)\n");
+	printf("  --format text|csv        output format (text)\n");
+}
+
+static bool bench_parse(int argc, char** argv, struct bench_options* options)
+{
+	options->type = LIBREDXX_DEVICE_TYPE_D2XX;
+	options->sim_latency_us = 1000;
+	options->max_workers = 16;
+	options->repeat = 3;
+	bool id_set = false;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const char* arg = argv[i];
+		const char* value = argv[i + 1];
+		if (strcmp(arg, "--type") == 0) {
+			if (strcmp(value, "d2xx") == 0) {
+				options->type = LIBREDXX_DEVICE_TYPE_D2XX;
+			} else if (strcmp(value, "d3xx") == 0) {
+				options->type = LIBREDXX_DEVICE_TYPE_D3XX;
+			} else if (strcmp(value, "ft260") == 0) {
+				options->type = LIBREDXX_DEVICE_TYPE_FT260;
+			} else {
+				return false;
+			}
+		} else if (strcmp(arg, "--vid") == 0) {
+			options->id.vid = (uint16_t)strtoul(value, NULL, 16);
+			id_set = true;
+		} else if (strcmp(arg, "--pid") == 0) {
+			options->id.pid = (uint16_t)strtoul(value, NULL, 16);
+			id_set = true;
+		} else if (strcmp(arg, "--sim") == 0) {
+			options->sim_devices = (uint32_t)strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--sim-latency") == 0) {
+			options->sim_latency_us = (uint32_t)strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--workers") == 0) {
+			options->max_workers = (size_t)strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--repeat") == 0) {
+			options->repeat = (uint32_t)strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--format") == 0) {
+			if (strcmp(value, "csv") == 0) {
+				options->csv = true;
+			} else if (strcmp(value, "text") != 0) {
+				return false;
+			}
+		} else {
+			return false;
+		}
+	}
+	if (!id_set) {
+		static const uint16_t pids[] = {0x6014, 0x601F, 0x6030};
+		options->id.vid = 0x0403;
+		options->id.pid = pids[options->type];
+	}
+	return argc % 2 == 1 && options->sim_devices <= BENCH_MAX_DEVICES && options->max_workers && options->repeat;
+}
+
+int main(int argc, char** argv)
+{
+	struct bench_options options = {0};
+	if (!bench_parse(argc, argv, &options)) {
+		bench_usage(argv[0]);
+		return -1;
+	}
+	libredxx_status status;
+	if (options.sim_devices && (status = bench_add_sim_devices(&options)) != LIBREDXX_STATUS_SUCCESS) {
+		printf("error: unable to add simulated devices: %d\n", status);
+		return -1;
+	}
+	libredxx_find_filter filter = {options.type, options.id};
+	libredxx_found_device** found = NULL;
+	size_t found_count = 0;
+	status = libredxx_find_devices(&filter, 1, &found, &found_count);
+	if (status != LIBREDXX_STATUS_SUCCESS || !found_count) {
+		printf("error: no devices found\n");
+		return -1;
+	}
+	libredxx_opened_device** opened = calloc(found_count, sizeof(libredxx_opened_device*));
+	libredxx_status* statuses = calloc(found_count, sizeof(libredxx_status));
+	if (!opened || !statuses) {
+		printf("error: out of memory\n");
+		return -1;
+	}
+
+	if (options.csv) {
+		printf("workers,devices,best_ns,us_per_device,speedup\n");
+	}
+	int result = 0;
+	uint64_t serial_ns = 0;
+	// 0 stands for opening them one by one, the baseline
+	for (size_t workers = 0; workers <= options.max_workers && !result; workers = workers ? workers * 2 : 1) {
+		uint64_t best_ns = UINT64_MAX;
+		for (uint32_t pass = 0; pass < options.repeat; ++pass) {
+			const uint64_t start_ns = bench_time_ns();
+			status = bench_open(&options, found, found_count, workers, opened, statuses);
+			const uint64_t elapsed_ns = bench_time_ns() - start_ns;
+			best_ns = elapsed_ns < best_ns ? elapsed_ns : best_ns;
+			for (size_t i = 0; i < found_count; ++i) {
+				if (opened[i]) {
+					libredxx_close_device(opened[i]);
+				}
+			}
+			if (status != LIBREDXX_STATUS_SUCCESS) {
+				for (size_t i = 0; i < found_count; ++i) {
+					if (statuses[i] != LIBREDXX_STATUS_SUCCESS) {
+						printf("error: device %zu failed to open: %d\n", i, statuses[i]);
+					}
+				}
+				result = -1;
+				break;
+			}
+		}
+		if (result) {
+			break;
+		}
+		serial_ns = workers ? serial_ns : best_ns;
+		const double per_device_us = (double)best_ns / 1e3 / (double)found_count;
+		const double speedup = (double)serial_ns / (double)best_ns;
+		if (options.csv) {
+			printf("%zu,%zu,%llu,%.1f,%.2f\n", workers, found_count, (unsigned long long)best_ns, per_device_us, speedup);
+		} else if (workers) {
+			printf("%3zu workers %5zu devices %10.2f ms %10.1f us/device %6.2fx\n", workers, found_count, (double)best_ns / 1e6, per_device_us, speedup);
+		} else {
+			printf("one by one  %5zu devices %10.2f ms %10.1f us/device\n", found_count, (double)best_ns / 1e6, per_device_us);
+		}
+	}
+	free(statuses);
+	free(opened);
+	libredxx_free_found(found);
+	if (options.sim_devices) {
+		libredxx_sim_stop();
+	}
+	return result;
+}
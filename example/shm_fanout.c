@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libredxx/libredxx.h"
+
+#define SLOT_SIZE (64 * 1024)
+#define SLOT_COUNT 256
+
+// streams endpoint A of the device into the fan-out until reading fails
+static int owner_scope(libredxx_opened_device* opened, const char* name)
+{
+	libredxx_shm_owner* owner = NULL;
+	libredxx_status status = libredxx_shm_create(name, SLOT_SIZE, SLOT_COUNT, &owner);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		printf("error: unable to create fan-out: %d\n", status);
+		return -1;
+	}
+	libredxx_stream_source source = {opened, LIBREDXX_ENDPOINT_A};
+	libredxx_stream_config config = {SLOT_SIZE, 32, 8, 0, -1, 0};
+	libredxx_stream* stream = NULL;
+	status = libredxx_stream_start(&source, 1, &config, &stream);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		printf("error: unable to start streaming: %d\n", status);
+		libredxx_shm_destroy(owner);
+		return -1;
+	}
+	printf("info: publishing as '%s'\n", name);
+	while (true) {
+		libredxx_stream_chunk chunk;
+		status = libredxx_stream_pop(stream, 0, &chunk, 1000);
+		if (status == LIBREDXX_STATUS_ERROR_TIMEOUT) {
+			continue;
+		}
+		if (status != LIBREDXX_STATUS_SUCCESS || chunk.status != LIBREDXX_STATUS_SUCCESS) {
+			printf("error: read failed: %d\n", status != LIBREDXX_STATUS_SUCCESS ? status : chunk.status);
+			break;
+		}
+		libredxx_shm_publish(owner, chunk.data, chunk.size, chunk.timestamp_ns);
+		libredxx_stream_release(stream, 0, &chunk);
+	}
+	libredxx_stream_stop(stream);
+	libredxx_shm_destroy(owner);
+	return 0;
+}
+
+static int owner_main(const char* name, uint16_t vid, uint16_t pid, const char* serial, libredxx_device_type type)
+{
+	libredxx_find_filter filter = {type, {vid, pid}};
+	libredxx_found_device** found_devices = NULL;
+	size_t found_devices_count = 0;
+	libredxx_status status = libredxx_find_devices(&filter, 1, &found_devices, &found_devices_count);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		printf("error: failed to find devices: %d\n", status);
+		return -1;
+	}
+	int result = -1;
+	for (size_t i = 0; i < found_devices_count; ++i) {
+		libredxx_serial device_serial;
+		if (libredxx_get_serial(found_devices[i], &device_serial) != LIBREDXX_STATUS_SUCCESS || strcmp(device_serial.serial, serial) != 0) {
+			continue;
+		}
+		libredxx_opened_device* opened = NULL;
+		status = libredxx_open_device(found_devices[i], &opened);
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			printf("error: unable to open device: %d\n", status);
+			continue;
+		}
+		result = owner_scope(opened, name);
+		libredxx_close_device(opened);
+		break;
+	}
+	libredxx_free_found(found_devices);
+	return result;
+}
+
+// prints the throughput seen by this client and what it missed, about once a second
+static int client_main(const char* name)
+{
+	libredxx_shm_client* client = NULL;
+	libredxx_status status = libredxx_shm_attach(name, &client);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		printf("error: unable to attach to '%s': %d\n", name, status);
+		return -1;
+	}
+	size_t slot_size = 0;
+	libredxx_shm_get_slot_size(client, &slot_size);
+	uint8_t* buffer = malloc(slot_size);
+	if (!buffer) {
+		libredxx_shm_detach(client);
+		return -1;
+	}
+	uint64_t bytes = 0;
+	uint64_t start_ns = 0;
+	while (true) {
+		size_t size = slot_size;
+		uint64_t timestamp_ns = 0;
+		status = libredxx_shm_read(client, buffer, &size, &timestamp_ns, 1000);
+		if (status == LIBREDXX_STATUS_ERROR_TIMEOUT || status == LIBREDXX_STATUS_ERROR_OVERFLOW) {
+			continue;
+		}
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			printf("info: the owner is gone\n");
+			break;
+		}
+		if (!start_ns) {
+			start_ns = timestamp_ns;
+		}
+		bytes += size;
+		if (timestamp_ns - start_ns >= 1000000000) {
+			uint64_t lost = 0;
+			libredxx_shm_get_lost(client, &lost);
+			printf("info: %.1f MB/s, %llu chunks lost so far\n", (double)bytes / ((double)(timestamp_ns - start_ns) / 1e9) / 1e6, (unsigned long long)lost);
+			bytes = 0;
+			start_ns = timestamp_ns;
+		}
+	}
+	free(buffer);
+	libredxx_shm_detach(client);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc == 3 && strcmp(argv[1], "client") == 0) {
+		return client_main(argv[2]);
+	}
+	if (argc != 7 || strcmp(argv[1], "owner") != 0) {
+		printf("usage: %s owner <name> <vid> <pid> <serial> <d2xx | d3xx>\n", argv[0]);
+		printf("       %s client <name>\n", argv[0]);
+		printf("example: %s owner ft601 0403 601F FT601 d3xx\n", argv[0]);
+		return -1;
+	}
+	libredxx_device_type type;
+	if (strcmp(argv[6], "d2xx") == 0) {
+		type = LIBREDXX_DEVICE_TYPE_D2XX;
+	} else if (strcmp(argv[6], "d3xx") == 0) {
+		type = LIBREDXX_DEVICE_TYPE_D3XX;
+	} else {
+		printf("error: invalid device type, must be \"d2xx\" or \"d3xx\"\n");
+		return -1;
+	}
+	return owner_main(argv[2], (uint16_t)strtoul(argv[3], NULL, 16), (uint16_t)strtoul(argv[4], NULL, 16), argv[5], type);
+}
@@ -62,19 +62,317 @@ enum libredxx_status {
 	LIBREDXX_STATUS_ERROR_OVERFLOW,
 	LIBREDXX_STATUS_ERROR_IO, // invalid IO with the device
 	LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT,
+	LIBREDXX_STATUS_ERROR_UNSUPPORTED, // not available for the device type or platform
+	LIBREDXX_STATUS_ERROR_TIMEOUT,
+	LIBREDXX_STATUS_ERROR_DISCONNECTED, // the device went away, see libredxx_set_reconnect
+	LIBREDXX_STATUS_ERROR_STALL, // the endpoint stalled and was cleared, see libredxx_set_stall_retries
+	LIBREDXX_STATUS_ERROR_BABBLE, // the device sent more than was asked for, the endpoint was reset
 };
 typedef enum libredxx_status libredxx_status;
 
+// D3XX: endpoints A to D are FIFO channels 1 to 4
 enum libredxx_endpoint {
 	LIBREDXX_ENDPOINT_A,
 	LIBREDXX_ENDPOINT_B,
+	LIBREDXX_ENDPOINT_C,
+	LIBREDXX_ENDPOINT_D,
 };
 typedef enum libredxx_endpoint libredxx_endpoint;
 
+enum libredxx_pool_flags {
+	LIBREDXX_POOL_HUGE_PAGES = 1 << 0, // falls back to normal pages if there are none
+	LIBREDXX_POOL_LOCKED = 1 << 1, // fails if the locked memory limit is too low
+};
+typedef enum libredxx_pool_flags libredxx_pool_flags;
+
+enum libredxx_replay_flags {
+	LIBREDXX_REPLAY_REALTIME = 1 << 0, // keep the recorded timing instead of replaying as fast as possible
+};
+typedef enum libredxx_replay_flags libredxx_replay_flags;
+
+enum libredxx_capture_flags {
+	LIBREDXX_CAPTURE_GAP = 1 << 0, // data was lost right before this chunk, such as after a failed read
+	LIBREDXX_CAPTURE_OVERFLOW = 1 << 1, // the writer dropped chunks right before this one, the disk was behind
+};
+typedef enum libredxx_capture_flags libredxx_capture_flags;
+
+enum libredxx_framer_type {
+	LIBREDXX_FRAMER_SYNC_WORD, // frame_size bytes after every sync word
+	LIBREDXX_FRAMER_LENGTH_PREFIX, // an optional sync word, then a length_size byte length of the payload after it
+	LIBREDXX_FRAMER_SLIP, // RFC 1055
+	LIBREDXX_FRAMER_COBS, // consistent overhead byte stuffing, frames end with a zero byte
+};
+typedef enum libredxx_framer_type libredxx_framer_type;
+
+enum libredxx_framer_flags {
+	LIBREDXX_FRAMER_SCALAR = 1 << 0, // scan byte by byte instead of with SSE2, AVX2 or NEON, for comparison
+};
+typedef enum libredxx_framer_flags libredxx_framer_flags;
+
+enum libredxx_d2xx_stop_bits {
+	LIBREDXX_D2XX_STOP_BITS_1,
+	LIBREDXX_D2XX_STOP_BITS_1_5,
+	LIBREDXX_D2XX_STOP_BITS_2,
+};
+typedef enum libredxx_d2xx_stop_bits libredxx_d2xx_stop_bits;
+
+enum libredxx_d2xx_parity {
+	LIBREDXX_D2XX_PARITY_NONE,
+	LIBREDXX_D2XX_PARITY_ODD,
+	LIBREDXX_D2XX_PARITY_EVEN,
+	LIBREDXX_D2XX_PARITY_MARK,
+	LIBREDXX_D2XX_PARITY_SPACE,
+};
+typedef enum libredxx_d2xx_parity libredxx_d2xx_parity;
+
+enum libredxx_d2xx_flow_control {
+	LIBREDXX_D2XX_FLOW_CONTROL_NONE,
+	LIBREDXX_D2XX_FLOW_CONTROL_RTS_CTS,
+	LIBREDXX_D2XX_FLOW_CONTROL_DTR_DSR,
+	LIBREDXX_D2XX_FLOW_CONTROL_XON_XOFF,
+};
+typedef enum libredxx_d2xx_flow_control libredxx_d2xx_flow_control;
+
+enum libredxx_d2xx_bit_mode {
+	LIBREDXX_D2XX_BIT_MODE_RESET = 0x00, // back to the UART or FIFO mode the EEPROM sets
+	LIBREDXX_D2XX_BIT_MODE_ASYNC_BITBANG = 0x01,
+	LIBREDXX_D2XX_BIT_MODE_MPSSE = 0x02,
+	LIBREDXX_D2XX_BIT_MODE_SYNC_BITBANG = 0x04,
+	LIBREDXX_D2XX_BIT_MODE_MCU_HOST = 0x08,
+	LIBREDXX_D2XX_BIT_MODE_FAST_SERIAL = 0x10,
+	LIBREDXX_D2XX_BIT_MODE_CBUS_BITBANG = 0x20,
+	LIBREDXX_D2XX_BIT_MODE_SYNC_FIFO = 0x40,
+};
+typedef enum libredxx_d2xx_bit_mode libredxx_d2xx_bit_mode;
+
+enum libredxx_link_speed {
+	LIBREDXX_LINK_SPEED_UNKNOWN,
+	LIBREDXX_LINK_SPEED_LOW, // 1.5 Mbit/s
+	LIBREDXX_LINK_SPEED_FULL, // 12 Mbit/s
+	LIBREDXX_LINK_SPEED_HIGH, // 480 Mbit/s
+	LIBREDXX_LINK_SPEED_SUPER, // 5 Gbit/s
+	LIBREDXX_LINK_SPEED_SUPER_PLUS, // 10 Gbit/s or more
+};
+typedef enum libredxx_link_speed libredxx_link_speed;
+
+#define LIBREDXX_STATS_ENDPOINT_COUNT 4
+#define LIBREDXX_LATENCY_BUCKET_COUNT 32
+
+// latency bucket n counts transfers that took [2^n, 2^(n+1)) microseconds, bucket 0 also has everything below 1 us
+struct libredxx_endpoint_stats {
+	uint64_t read_bytes;
+	uint64_t read_transfers;
+	uint64_t short_reads; // reads that returned less than was asked for
+	uint64_t read_ns; // time spent in libredxx_read
+	uint64_t write_bytes;
+	uint64_t write_transfers;
+	uint64_t write_ns; // time spent in libredxx_write
+	uint64_t errors;
+	uint64_t interrupted;
+	uint64_t read_latency[LIBREDXX_LATENCY_BUCKET_COUNT];
+	uint64_t write_latency[LIBREDXX_LATENCY_BUCKET_COUNT];
+};
+typedef struct libredxx_endpoint_stats libredxx_endpoint_stats;
+
+struct libredxx_stats {
+	libredxx_endpoint_stats endpoints[LIBREDXX_STATS_ENDPOINT_COUNT];
+	uint64_t d2xx_status_packets; // D2XX packets that only had the modem status
+	uint64_t interrupts;
+};
+typedef struct libredxx_stats libredxx_stats;
+
 typedef struct libredxx_found_device libredxx_found_device;
 
 typedef struct libredxx_opened_device libredxx_opened_device;
 
+// both are called on the thread whose read or write noticed the disconnect
+typedef void (*libredxx_disconnect_callback)(void* context, libredxx_opened_device* device);
+// gap_ns is the time from noticing the disconnect to the device being configured again
+typedef void (*libredxx_reconnect_callback)(void* context, libredxx_opened_device* device, uint64_t gap_ns);
+
+struct libredxx_reconnect_config {
+	uint32_t timeout_ms; // how long to wait for the device to come back, 0 waits until interrupted
+	uint32_t poll_interval_ms; // between looking for the device, 0 for 100
+	bool match_location; // the device on the same USB port instead of with the same serial
+	libredxx_disconnect_callback disconnected; // optional
+	libredxx_reconnect_callback reconnected; // optional
+	void* context;
+};
+typedef struct libredxx_reconnect_config libredxx_reconnect_config;
+
+// index is the device's position in the list, a failure closes the device again
+typedef libredxx_status (*libredxx_open_callback)(void* context, libredxx_opened_device* device, size_t index);
+
+struct libredxx_open_config {
+	size_t workers; // threads opening devices, the calling one included, 0 for up to 8
+	libredxx_open_callback setup; // optional, configures each device right after it opened
+	void* context;
+};
+typedef struct libredxx_open_config libredxx_open_config;
+
+enum libredxx_trace_event_type {
+	LIBREDXX_TRACE_SUBMIT, // a read or write was started
+	LIBREDXX_TRACE_COMPLETE,
+	LIBREDXX_TRACE_ERROR, // the read or write failed or was interrupted, see status
+	LIBREDXX_TRACE_INTERRUPT, // libredxx_interrupt or libredxx_interrupt_endpoint was called
+};
+typedef enum libredxx_trace_event_type libredxx_trace_event_type;
+
+struct libredxx_trace_event {
+	libredxx_trace_event_type type;
+	const libredxx_opened_device* device;
+	libredxx_endpoint endpoint;
+	bool write;
+	size_t size; // requested on submit, transferred on complete
+	libredxx_status status;
+	uint64_t timestamp_ns; // monotonic clock
+};
+typedef struct libredxx_trace_event libredxx_trace_event;
+
+typedef void (*libredxx_trace_callback)(const libredxx_trace_event* event, void* context);
+
+enum libredxx_sim_mode {
+	LIBREDXX_SIM_LOOPBACK, // data written to a channel is read back from it
+	LIBREDXX_SIM_SOURCE, // reads always get a counting byte pattern, writes are dropped
+};
+typedef enum libredxx_sim_mode libredxx_sim_mode;
+
+enum libredxx_sim_fault {
+	LIBREDXX_SIM_FAULT_IO, // the transfer fails like a bus error
+	LIBREDXX_SIM_FAULT_STALL, // the endpoint stalls and stays halted until cleared
+	LIBREDXX_SIM_FAULT_BABBLE, // the device sends more than was asked for
+};
+typedef enum libredxx_sim_fault libredxx_sim_fault;
+
+// return false to not acknowledge the address, data has size bytes to fill on read
+typedef bool (*libredxx_sim_i2c_callback)(void* context, uint8_t address, bool read, uint8_t* data, size_t size);
+
+struct libredxx_sim_device_config {
+	libredxx_device_type type;
+	libredxx_device_id id;
+	libredxx_serial serial;
+	uint16_t release; // bcdDevice, for D2XX this picks the chip and with it the channel count and packet size
+	libredxx_sim_mode mode;
+	uint64_t bandwidth; // bytes per second shared by all transfers, 0 for unlimited
+	uint32_t latency_us; // added to every transfer
+	uint32_t fault_interval; // every nth transfer fails, 0 for never
+	libredxx_sim_fault fault;
+	libredxx_sim_i2c_callback i2c; // FT260, NULL for a 256 byte memory behind every address
+	void* i2c_context;
+};
+typedef struct libredxx_sim_device_config libredxx_sim_device_config;
+
+struct libredxx_sim_d2xx_channel {
+	uint16_t baud_value; // wValue and wIndex of the last SET_BAUD_RATE, 0 before the first
+	uint16_t baud_index;
+	uint8_t latency_ms;
+};
+typedef struct libredxx_sim_d2xx_channel libredxx_sim_d2xx_channel;
+
+struct libredxx_stream_source {
+	libredxx_opened_device* device;
+	libredxx_endpoint endpoint;
+};
+typedef struct libredxx_stream_source libredxx_stream_source;
+
+struct libredxx_stream_config {
+	size_t buffer_size; // bytes per read, D2XX chunks come out smaller by the packet headers
+	size_t buffer_count; // buffers per source, in flight or waiting to be popped
+	size_t depth; // reads kept in flight per source, at most buffer_count
+	uint32_t pool_flags; // libredxx_pool_flags for the buffers
+	int cpu; // pins the completion thread to this CPU, -1 lets it run anywhere
+	int priority; // SCHED_FIFO priority of the completion thread, 0 keeps the normal scheduler
+};
+typedef struct libredxx_stream_config libredxx_stream_config;
+
+struct libredxx_stream_chunk {
+	void* data;
+	size_t size;
+	libredxx_status status; // a source stops after a failed read, its last chunk carries the error
+	uint64_t timestamp_ns; // CLOCK_MONOTONIC when the read completed, never older than the source's previous chunk
+};
+typedef struct libredxx_stream_chunk libredxx_stream_chunk;
+
+typedef struct libredxx_stream libredxx_stream;
+
+typedef struct libredxx_transfer libredxx_transfer;
+typedef void (*libredxx_transfer_callback)(libredxx_transfer* transfer);
+
+struct libredxx_transfer {
+	libredxx_opened_device* device;
+	libredxx_endpoint endpoint;
+	bool write;
+	void* buffer;
+	size_t size; // bytes to write or room to read into, D2XX reads take whole packets
+	libredxx_transfer_callback callback; // NULL when only libredxx_poll_completions' return matters
+	void* user_data;
+	size_t transferred; // set on completion
+	libredxx_status status; // set on completion, ERROR_INTERRUPTED when cancelled before any data
+	uint64_t timestamp_ns; // set on completion, CLOCK_MONOTONIC when the kernel gave the transfer back
+};
+
+typedef struct libredxx_shm_owner libredxx_shm_owner;
+typedef struct libredxx_shm_client libredxx_shm_client;
+
+typedef struct libredxx_framer libredxx_framer;
+// frame is only valid during the call
+typedef void (*libredxx_frame_callback)(void* context, const void* frame, size_t size);
+
+struct libredxx_framer_config {
+	libredxx_framer_type type;
+	uint32_t flags; // libredxx_framer_flags
+	size_t max_frame_size; // payload bytes, longer frames are dropped and counted as errors
+	uint8_t sync[4];
+	size_t sync_size; // SYNC_WORD 1 to 4, LENGTH_PREFIX 0 to 4
+	size_t frame_size; // SYNC_WORD payload bytes
+	size_t length_size; // LENGTH_PREFIX 1, 2 or 4
+	bool big_endian; // LENGTH_PREFIX byte order of the length
+	libredxx_frame_callback callback;
+	void* context;
+};
+typedef struct libredxx_framer_config libredxx_framer_config;
+
+struct libredxx_framer_stats {
+	uint64_t frames;
+	uint64_t frame_bytes;
+	uint64_t dropped_bytes; // skipped looking for a frame start or in broken frames
+	uint64_t errors; // frames that were too long or broken
+};
+typedef struct libredxx_framer_stats libredxx_framer_stats;
+
+typedef struct libredxx_capture_writer libredxx_capture_writer;
+typedef struct libredxx_capture libredxx_capture;
+
+struct libredxx_capture_config {
+	size_t segment_size; // bytes per write to disk, a multiple of 4096, 0 for 8 MiB
+	size_t segment_count; // segments being filled or written, at least 2, 0 for 4
+	uint64_t preallocate_size; // disk space reserved up front, 0 for none
+};
+typedef struct libredxx_capture_config libredxx_capture_config;
+
+struct libredxx_capture_info {
+	size_t chunks_count;
+	uint64_t bytes; // data bytes in every chunk
+	uint64_t dropped_bytes; // data bytes the writer dropped
+	bool complete; // false when the capture was never finished, its index is rebuilt from what made it to disk
+};
+typedef struct libredxx_capture_info libredxx_capture_info;
+
+struct libredxx_capture_chunk {
+	const void* data;
+	size_t size;
+	uint64_t timestamp_ns;
+	uint64_t offset; // data bytes captured before this chunk
+	uint32_t flags; // libredxx_capture_flags
+};
+typedef struct libredxx_capture_chunk libredxx_capture_chunk;
+
+/*
+ * Link speed and packet size, URB splitting, streams, asynchronous transfers,
+ * reconnecting, stall recovery, shared memory and the simulator are Linux only,
+ * elsewhere their functions return LIBREDXX_STATUS_ERROR_UNSUPPORTED. The D2XX
+ * UART setters return it on Windows too, where the FTDI bus driver owns the UART.
+ */
 libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_t filters_count, libredxx_found_device*** devices, size_t* devices_count);
 libredxx_status libredxx_free_found(libredxx_found_device** devices);
 
@@ -83,14 +381,195 @@ libredxx_status libredxx_get_serial(const libredxx_found_device* found, libredxx
 libredxx_status libredxx_get_device_id(const libredxx_found_device* found, libredxx_device_id* id);
 libredxx_status libredxx_get_device_type(const libredxx_found_device* found, libredxx_device_type* type);
 
+/*
+ * Multi-channel D2XX devices are found once per channel with the same serial,
+ * interface 0 is channel A. Opening a channel only claims its interface.
+ */
+libredxx_status libredxx_get_interface_index(const libredxx_found_device* found, uint8_t* interface_index);
+
+/*
+ * Negotiated link speed and data endpoint packet size, 64 bytes on a full speed
+ * FT232R, 512 on high speed and 1024 on USB 3. D2XX packets start with 2 status bytes.
+ */
+libredxx_status libredxx_get_link_speed(const libredxx_found_device* found, libredxx_link_speed* speed);
+libredxx_status libredxx_get_packet_size(const libredxx_found_device* found, size_t* packet_size);
+
 libredxx_status libredxx_open_device(const libredxx_found_device* found, libredxx_opened_device** opened);
 libredxx_status libredxx_close_device(libredxx_opened_device* device);
 
+/*
+ * Opens devices in parallel on worker threads, statuses gets one entry each and
+ * the first failure is returned. The setup callback runs on the workers.
+ */
+libredxx_status libredxx_open_many(libredxx_found_device* const* found, size_t found_count, const libredxx_open_config* config, libredxx_opened_device** opened, libredxx_status* statuses);
+
+/*
+ * Cancels a read in progress on every endpoint, or just endpoint, which returns
+ * ERROR_INTERRUPTED, or what already arrived as a successful read.
+ */
 libredxx_status libredxx_interrupt(libredxx_opened_device* device);
+libredxx_status libredxx_interrupt_endpoint(libredxx_opened_device* device, libredxx_endpoint endpoint);
 
+/*
+ * One read and one write per endpoint may run in parallel, interrupts and stats
+ * are safe from any thread. Closing must not race with anything on the device.
+ */
 libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint);
 libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint);
 
+/*
+ * After a read of exactly size bytes the next read request is sent right away,
+ * 0 stops. Windows always streams, there this only sets the size up front.
+ */
+libredxx_status libredxx_d3xx_set_stream_size(libredxx_opened_device* device, libredxx_endpoint endpoint, size_t size);
+
+/*
+ * Transfers larger than urb_size go out as up to urb_count URBs in flight, 0 for
+ * the defaults. Allocates the URBs, so no transfer may be in flight.
+ */
+libredxx_status libredxx_set_urb_size(libredxx_opened_device* device, size_t urb_size, size_t urb_count);
+
+/*
+ * Per device pool of cache line aligned buffers, lock-free from any thread.
+ * ERROR_OVERFLOW while every buffer is in use, freed with the device.
+ */
+libredxx_status libredxx_create_pool(libredxx_opened_device* device, size_t buffer_size, size_t buffer_count, uint32_t flags);
+libredxx_status libredxx_get_buffer(libredxx_opened_device* device, void** buffer);
+libredxx_status libredxx_free_buffer(libredxx_opened_device* device, void* buffer);
+
+/*
+ * A completion thread keeps depth reads in flight per source and pushes filled
+ * chunks into a ring, popped per source or merged in timestamp order, not both.
+ */
+libredxx_status libredxx_stream_start(const libredxx_stream_source* sources, size_t sources_count, const libredxx_stream_config* config, libredxx_stream** stream);
+libredxx_status libredxx_stream_stop(libredxx_stream* stream);
+libredxx_status libredxx_stream_pop(libredxx_stream* stream, size_t source, libredxx_stream_chunk* chunk, uint32_t timeout_ms);
+libredxx_status libredxx_stream_pop_merged(libredxx_stream* stream, size_t* source, libredxx_stream_chunk* chunk, uint32_t timeout_ms);
+libredxx_status libredxx_stream_release(libredxx_stream* stream, size_t source, const libredxx_stream_chunk* chunk);
+
+/*
+ * Submitted transfers complete in order, their callbacks run in the one thread
+ * calling libredxx_poll_completions. All must complete before the device closes.
+ */
+libredxx_status libredxx_alloc_transfer(libredxx_transfer** transfer);
+libredxx_status libredxx_free_transfer(libredxx_transfer* transfer);
+libredxx_status libredxx_submit_transfer(libredxx_transfer* transfer);
+libredxx_status libredxx_cancel_transfer(libredxx_transfer* transfer);
+libredxx_status libredxx_poll_completions(libredxx_opened_device* device, uint32_t timeout_ms);
+
+/*
+ * D2XX UART configuration. The baud rate is rounded to the closest divisor, up
+ * to 12 Mbaud on H series chips and 3 Mbaud otherwise, data_bits must be 7 or 8.
+ */
+libredxx_status libredxx_d2xx_set_baud_rate(libredxx_opened_device* device, uint32_t baud_rate);
+libredxx_status libredxx_d2xx_set_data_characteristics(libredxx_opened_device* device, uint8_t data_bits, libredxx_d2xx_stop_bits stop_bits, libredxx_d2xx_parity parity);
+libredxx_status libredxx_d2xx_set_flow_control(libredxx_opened_device* device, libredxx_d2xx_flow_control flow_control, uint8_t xon, uint8_t xoff);
+libredxx_status libredxx_d2xx_set_latency_timer(libredxx_opened_device* device, uint8_t latency_ms);
+// mask sets the direction of each pin in the bit bang modes, 1 for output
+libredxx_status libredxx_d2xx_set_bit_mode(libredxx_opened_device* device, uint8_t mask, libredxx_d2xx_bit_mode mode);
+
+/*
+ * A read or write that loses the device waits for it to come back, reopens it with
+ * the same settings and still returns ERROR_DISCONNECTED. NULL turns it off.
+ */
+libredxx_status libredxx_set_reconnect(libredxx_opened_device* device, const libredxx_reconnect_config* config);
+
+/*
+ * Stalled or babbling endpoints are cleared in place, blocking reads and writes
+ * retry up to retries times first. A retried write may repeat its start.
+ */
+libredxx_status libredxx_set_stall_retries(libredxx_opened_device* device, uint32_t retries);
+
+/*
+ * I/O counters since open or the last reset, each read with relaxed atomics, so a
+ * snapshot isn't consistent across counters.
+ */
+libredxx_status libredxx_get_stats(libredxx_opened_device* device, libredxx_stats* stats);
+libredxx_status libredxx_reset_stats(libredxx_opened_device* device);
+
+/*
+ * Calls callback on the I/O thread for every transfer, NULL stops. Needs
+ * LIBREDXX_ENABLE_TRACE, otherwise ERROR_UNSUPPORTED is returned.
+ */
+libredxx_status libredxx_set_trace_callback(libredxx_trace_callback callback, void* context);
+
+/*
+ * Lock-free per-thread recorder of events_per_thread events, written out as Chrome
+ * trace JSON. Starting must not race with I/O.
+ */
+libredxx_status libredxx_trace_start(size_t events_per_thread);
+libredxx_status libredxx_trace_stop(void);
+libredxx_status libredxx_trace_write_json(const char* path);
+
+/*
+ * Captures every USB transfer to a pcap file with the usbmon link type through a
+ * ring of buffer_size bytes (0 for 16 MiB), counting what gets dropped.
+ */
+libredxx_status libredxx_pcap_start(const char* path, size_t buffer_size);
+libredxx_status libredxx_pcap_stop(uint64_t* dropped);
+
+/*
+ * Records finding, opening, closing, reads, writes and interrupts of devices
+ * opened while recording to path, including everything that was read.
+ */
+libredxx_status libredxx_record_start(const char* path);
+libredxx_status libredxx_record_stop(void);
+
+/*
+ * Plays a recording back instead of hardware, for devices found while replaying.
+ * Stops once every replayed device is closed.
+ */
+libredxx_status libredxx_replay_start(const char* path, uint32_t flags);
+libredxx_status libredxx_replay_stop(void);
+
+/*
+ * Indexed capture files of timestamped chunks, written from a thread of their own
+ * with O_DIRECT where possible and mapped read-only to open. NULL config for defaults.
+ */
+libredxx_status libredxx_capture_create(const char* path, const libredxx_capture_config* config, libredxx_capture_writer** writer);
+libredxx_status libredxx_capture_write(libredxx_capture_writer* writer, const void* data, size_t size, uint64_t timestamp_ns, uint32_t flags);
+libredxx_status libredxx_capture_finish(libredxx_capture_writer* writer);
+libredxx_status libredxx_capture_open(const char* path, libredxx_capture** capture);
+libredxx_status libredxx_capture_close(libredxx_capture* capture);
+libredxx_status libredxx_capture_get_info(const libredxx_capture* capture, libredxx_capture_info* info);
+libredxx_status libredxx_capture_get_chunk(const libredxx_capture* capture, size_t index, libredxx_capture_chunk* chunk);
+libredxx_status libredxx_capture_find(const libredxx_capture* capture, uint64_t timestamp_ns, size_t* index);
+
+/*
+ * Fan-out of chunks to other processes of the same user through a named ring.
+ * Clients that fall behind get ERROR_OVERFLOW once, the owner never waits for
+ * them.
+ */
+libredxx_status libredxx_shm_create(const char* name, size_t slot_size, size_t slot_count, libredxx_shm_owner** owner);
+libredxx_status libredxx_shm_publish(libredxx_shm_owner* owner, const void* data, size_t size, uint64_t timestamp_ns);
+libredxx_status libredxx_shm_destroy(libredxx_shm_owner* owner);
+libredxx_status libredxx_shm_attach(const char* name, libredxx_shm_client** client);
+libredxx_status libredxx_shm_detach(libredxx_shm_client* client);
+libredxx_status libredxx_shm_get_slot_size(const libredxx_shm_client* client, size_t* slot_size);
+libredxx_status libredxx_shm_get_lost(const libredxx_shm_client* client, uint64_t* lost);
+libredxx_status libredxx_shm_read(libredxx_shm_client* client, void* buffer, size_t* buffer_size, uint64_t* timestamp_ns, uint32_t timeout_ms);
+
+/*
+ * Splits a byte stream into frames handed to the callback, scanning with SSE2,
+ * AVX2 or NEON where available, and resynchronising after garbage.
+ */
+libredxx_status libredxx_framer_create(const libredxx_framer_config* config, libredxx_framer** framer);
+libredxx_status libredxx_framer_destroy(libredxx_framer* framer);
+libredxx_status libredxx_framer_push(libredxx_framer* framer, const void* data, size_t size);
+libredxx_status libredxx_framer_reset(libredxx_framer* framer);
+libredxx_status libredxx_framer_get_stats(const libredxx_framer* framer, libredxx_framer_stats* stats);
+
+/*
+ * Simulated devices standing in for usbfs and sysfs, built with LIBREDXX_ENABLE_SIM.
+ * Removing a device unplugs it, stopping fails while any are open.
+ */
+libredxx_status libredxx_sim_start(void);
+libredxx_status libredxx_sim_stop(void);
+libredxx_status libredxx_sim_add_device(const libredxx_sim_device_config* config, uint32_t* device_id);
+libredxx_status libredxx_sim_remove_device(uint32_t device_id);
+// what a channel of a simulated D2XX device was configured to, from the device's side
+libredxx_status libredxx_sim_get_d2xx_channel(uint32_t device_id, uint8_t interface_index, libredxx_sim_d2xx_channel* channel);
+
 #ifdef __cplusplus
 }
 #endif
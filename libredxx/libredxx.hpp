@@ -0,0 +1,449 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LIBREDXX_LIBREDXX_HPP
+#define LIBREDXX_LIBREDXX_HPP
+
+#include "libredxx.h"
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Header-only C++20 layer over the C API. Handles are move-only and release what
+ * they own, calls return a result holding either the value or the libredxx_status.
+ * Nothing here allocates or copies data, a read or write hands the span straight
+ * to the C call and an awaited transfer reuses the libredxx_transfer it is given.
+ */
+namespace libredxx {
+
+using status = libredxx_status;
+using endpoint = libredxx_endpoint;
+
+// holds a value or the status that prevented it, shaped after std::expected
+template<class T>
+class result {
+public:
+	result(T value) noexcept(std::is_nothrow_move_constructible_v<T>) : m_value(std::move(value)), m_status(LIBREDXX_STATUS_SUCCESS) {}
+	result(status error) noexcept : m_status(error) {}
+
+	bool has_value() const noexcept { return m_status == LIBREDXX_STATUS_SUCCESS; }
+	explicit operator bool() const noexcept { return has_value(); }
+	status error() const noexcept { return m_status; }
+	T& value() & noexcept { return m_value; }
+	const T& value() const& noexcept { return m_value; }
+	T&& value() && noexcept { return std::move(m_value); }
+	T& operator*() & noexcept { return m_value; }
+	const T& operator*() const& noexcept { return m_value; }
+	T&& operator*() && noexcept { return std::move(m_value); }
+	T* operator->() noexcept { return &m_value; }
+	const T* operator->() const noexcept { return &m_value; }
+
+private:
+	T m_value{};
+	status m_status;
+};
+
+template<>
+class result<void> {
+public:
+	result() noexcept : m_status(LIBREDXX_STATUS_SUCCESS) {}
+	result(status error) noexcept : m_status(error) {}
+
+	bool has_value() const noexcept { return m_status == LIBREDXX_STATUS_SUCCESS; }
+	explicit operator bool() const noexcept { return has_value(); }
+	status error() const noexcept { return m_status; }
+
+private:
+	status m_status;
+};
+
+namespace detail {
+
+inline result<void> to_result(status s) noexcept
+{
+	return s == LIBREDXX_STATUS_SUCCESS ? result<void>() : result<void>(s);
+}
+
+} // namespace detail
+
+class found_devices {
+public:
+	found_devices() noexcept = default;
+	found_devices(const found_devices&) = delete;
+	found_devices& operator=(const found_devices&) = delete;
+	found_devices(found_devices&& other) noexcept : m_devices(std::exchange(other.m_devices, nullptr)), m_count(std::exchange(other.m_count, 0)) {}
+	found_devices& operator=(found_devices&& other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			m_devices = std::exchange(other.m_devices, nullptr);
+			m_count = std::exchange(other.m_count, 0);
+		}
+		return *this;
+	}
+	~found_devices() { reset(); }
+
+	static result<found_devices> find(std::span<const libredxx_find_filter> filters) noexcept
+	{
+		found_devices found;
+		status s = libredxx_find_devices(filters.data(), filters.size(), &found.m_devices, &found.m_count);
+		if (s != LIBREDXX_STATUS_SUCCESS) {
+			return s;
+		}
+		return found;
+	}
+
+	std::size_t size() const noexcept { return m_count; }
+	bool empty() const noexcept { return m_count == 0; }
+	libredxx_found_device* operator[](std::size_t index) const noexcept { return m_devices[index]; }
+	libredxx_found_device* const* begin() const noexcept { return m_devices; }
+	libredxx_found_device* const* end() const noexcept { return m_devices + m_count; }
+
+private:
+	void reset() noexcept
+	{
+		// nothing is allocated when nothing was found
+		if (m_devices && m_count) {
+			libredxx_free_found(m_devices);
+		}
+		m_devices = nullptr;
+		m_count = 0;
+	}
+
+	libredxx_found_device** m_devices = nullptr;
+	std::size_t m_count = 0;
+};
+
+inline result<libredxx_serial> get_serial(const libredxx_found_device* found) noexcept
+{
+	libredxx_serial serial;
+	status s = libredxx_get_serial(found, &serial);
+	if (s != LIBREDXX_STATUS_SUCCESS) {
+		return s;
+	}
+	return serial;
+}
+
+inline result<libredxx_device_id> get_device_id(const libredxx_found_device* found) noexcept
+{
+	libredxx_device_id id;
+	status s = libredxx_get_device_id(found, &id);
+	if (s != LIBREDXX_STATUS_SUCCESS) {
+		return s;
+	}
+	return id;
+}
+
+inline result<libredxx_device_type> get_device_type(const libredxx_found_device* found) noexcept
+{
+	libredxx_device_type type;
+	status s = libredxx_get_device_type(found, &type);
+	if (s != LIBREDXX_STATUS_SUCCESS) {
+		return s;
+	}
+	return type;
+}
+
+inline result<uint8_t> get_interface_index(const libredxx_found_device* found) noexcept
+{
+	uint8_t interface_index;
+	status s = libredxx_get_interface_index(found, &interface_index);
+	if (s != LIBREDXX_STATUS_SUCCESS) {
+		return s;
+	}
+	return interface_index;
+}
+
+inline result<libredxx_link_speed> get_link_speed(const libredxx_found_device* found) noexcept
+{
+	libredxx_link_speed speed;
+	status s = libredxx_get_link_speed(found, &speed);
+	if (s != LIBREDXX_STATUS_SUCCESS) {
+		return s;
+	}
+	return speed;
+}
+
+inline result<std::size_t> get_packet_size(const libredxx_found_device* found) noexcept
+{
+	std::size_t packet_size;
+	status s = libredxx_get_packet_size(found, &packet_size);
+	if (s != LIBREDXX_STATUS_SUCCESS) {
+		return s;
+	}
+	return packet_size;
+}
+
+/*
+ * A libredxx_transfer to await, allocated once and reused by every read or write
+ * awaited on it. It must outlive the operation in flight.
+ */
+class transfer {
+public:
+	transfer() noexcept = default;
+	transfer(const transfer&) = delete;
+	transfer& operator=(const transfer&) = delete;
+	transfer(transfer&& other) noexcept : m_transfer(std::exchange(other.m_transfer, nullptr)) {}
+	transfer& operator=(transfer&& other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			m_transfer = std::exchange(other.m_transfer, nullptr);
+		}
+		return *this;
+	}
+	~transfer() { reset(); }
+
+	static result<transfer> alloc() noexcept
+	{
+		transfer t;
+		status s = libredxx_alloc_transfer(&t.m_transfer);
+		if (s != LIBREDXX_STATUS_SUCCESS) {
+			return s;
+		}
+		return t;
+	}
+
+	result<void> cancel() noexcept { return detail::to_result(libredxx_cancel_transfer(m_transfer)); }
+	// CLOCK_MONOTONIC completion time of the last run
+	std::uint64_t timestamp_ns() const noexcept { return m_transfer->timestamp_ns; }
+	libredxx_transfer* native_handle() const noexcept { return m_transfer; }
+
+private:
+	void reset() noexcept
+	{
+		if (m_transfer) {
+			libredxx_free_transfer(m_transfer);
+			m_transfer = nullptr;
+		}
+	}
+
+	libredxx_transfer* m_transfer = nullptr;
+};
+
+/*
+ * Awaiting submits the transfer and suspends, the coroutine resumes on the thread
+ * running device::poll_completions once it finishes and gets the bytes moved.
+ * Linux only like the C API, transfer::alloc returns ERROR_UNSUPPORTED elsewhere.
+ */
+class transfer_awaiter {
+public:
+	transfer_awaiter(libredxx_transfer* t) noexcept : m_transfer(t) {}
+
+	bool await_ready() const noexcept { return false; }
+	bool await_suspend(std::coroutine_handle<> handle) noexcept
+	{
+		m_transfer->callback = &transfer_awaiter::resume;
+		m_transfer->user_data = handle.address();
+		// once submitted another thread may resume and destroy the awaiter, so this isn't touched again
+		const status submit_status = libredxx_submit_transfer(m_transfer);
+		if (submit_status == LIBREDXX_STATUS_SUCCESS) {
+			return true;
+		}
+		// not submitted, carry on right away with the error
+		m_submit_status = submit_status;
+		return false;
+	}
+	result<std::size_t> await_resume() const noexcept
+	{
+		if (m_submit_status != LIBREDXX_STATUS_SUCCESS) {
+			return m_submit_status;
+		}
+		if (m_transfer->status != LIBREDXX_STATUS_SUCCESS) {
+			return m_transfer->status;
+		}
+		return m_transfer->transferred;
+	}
+
+private:
+	static void resume(libredxx_transfer* t) noexcept
+	{
+		std::coroutine_handle<>::from_address(t->user_data).resume();
+	}
+
+	libredxx_transfer* m_transfer;
+	status m_submit_status = LIBREDXX_STATUS_SUCCESS;
+};
+
+class device {
+public:
+	device() noexcept = default;
+	explicit device(libredxx_opened_device* opened) noexcept : m_device(opened) {}
+	device(const device&) = delete;
+	device& operator=(const device&) = delete;
+	device(device&& other) noexcept : m_device(std::exchange(other.m_device, nullptr)) {}
+	device& operator=(device&& other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			m_device = std::exchange(other.m_device, nullptr);
+		}
+		return *this;
+	}
+	~device() { reset(); }
+
+	static result<device> open(const libredxx_found_device* found) noexcept
+	{
+		libredxx_opened_device* opened = nullptr;
+		status s = libredxx_open_device(found, &opened);
+		if (s != LIBREDXX_STATUS_SUCCESS) {
+			return s;
+		}
+		return device(opened);
+	}
+
+	result<std::size_t> read(std::span<std::byte> buffer, endpoint ep = LIBREDXX_ENDPOINT_A) noexcept
+	{
+		std::size_t size = buffer.size();
+		status s = libredxx_read(m_device, buffer.data(), &size, ep);
+		if (s != LIBREDXX_STATUS_SUCCESS) {
+			return s;
+		}
+		return size;
+	}
+	template<class T, std::size_t N>
+		requires std::is_trivially_copyable_v<T> && (!std::is_const_v<T>)
+	result<std::size_t> read(std::span<T, N> buffer, endpoint ep = LIBREDXX_ENDPOINT_A) noexcept
+	{
+		return read(std::span<std::byte>(std::as_writable_bytes(buffer)), ep);
+	}
+
+	// the C API takes a non-const buffer for writes but never modifies it
+	result<std::size_t> write(std::span<const std::byte> buffer, endpoint ep = LIBREDXX_ENDPOINT_A) noexcept
+	{
+		std::size_t size = buffer.size();
+		status s = libredxx_write(m_device, const_cast<std::byte*>(buffer.data()), &size, ep);
+		if (s != LIBREDXX_STATUS_SUCCESS) {
+			return s;
+		}
+		return size;
+	}
+	template<class T, std::size_t N>
+		requires std::is_trivially_copyable_v<T>
+	result<std::size_t> write(std::span<T, N> buffer, endpoint ep = LIBREDXX_ENDPOINT_A) noexcept
+	{
+		return write(std::span<const std::byte>(std::as_bytes(buffer)), ep);
+	}
+
+	transfer_awaiter async_read(transfer& t, std::span<std::byte> buffer, endpoint ep = LIBREDXX_ENDPOINT_A) noexcept
+	{
+		return prepare(t, buffer.data(), buffer.size(), false, ep);
+	}
+	transfer_awaiter async_write(transfer& t, std::span<const std::byte> buffer, endpoint ep = LIBREDXX_ENDPOINT_A) noexcept
+	{
+		return prepare(t, const_cast<std::byte*>(buffer.data()), buffer.size(), true, ep);
+	}
+
+	// resumes the coroutines whose transfers finished, ERROR_TIMEOUT when none did in time
+	result<void> poll_completions(std::chrono::milliseconds timeout) noexcept
+	{
+		const auto count = timeout.count() < 0 ? 0 : timeout.count();
+		return detail::to_result(libredxx_poll_completions(m_device, static_cast<uint32_t>(count)));
+	}
+
+	result<void> interrupt() noexcept { return detail::to_result(libredxx_interrupt(m_device)); }
+	result<void> interrupt(endpoint ep) noexcept { return detail::to_result(libredxx_interrupt_endpoint(m_device, ep)); }
+
+	result<libredxx_stats> stats() noexcept
+	{
+		libredxx_stats stats;
+		status s = libredxx_get_stats(m_device, &stats);
+		if (s != LIBREDXX_STATUS_SUCCESS) {
+			return s;
+		}
+		return stats;
+	}
+	result<void> reset_stats() noexcept { return detail::to_result(libredxx_reset_stats(m_device)); }
+
+	result<void> d2xx_set_baud_rate(uint32_t baud_rate) noexcept
+	{
+		return detail::to_result(libredxx_d2xx_set_baud_rate(m_device, baud_rate));
+	}
+	result<void> d2xx_set_data_characteristics(uint8_t data_bits, libredxx_d2xx_stop_bits stop_bits, libredxx_d2xx_parity parity) noexcept
+	{
+		return detail::to_result(libredxx_d2xx_set_data_characteristics(m_device, data_bits, stop_bits, parity));
+	}
+	result<void> d2xx_set_flow_control(libredxx_d2xx_flow_control flow_control, uint8_t xon = 0x11, uint8_t xoff = 0x13) noexcept
+	{
+		return detail::to_result(libredxx_d2xx_set_flow_control(m_device, flow_control, xon, xoff));
+	}
+	result<void> d2xx_set_latency_timer(uint8_t latency_ms) noexcept
+	{
+		return detail::to_result(libredxx_d2xx_set_latency_timer(m_device, latency_ms));
+	}
+	result<void> d2xx_set_bit_mode(uint8_t mask, libredxx_d2xx_bit_mode mode) noexcept
+	{
+		return detail::to_result(libredxx_d2xx_set_bit_mode(m_device, mask, mode));
+	}
+	result<void> d3xx_set_stream_size(endpoint ep, std::size_t size) noexcept
+	{
+		return detail::to_result(libredxx_d3xx_set_stream_size(m_device, ep, size));
+	}
+	result<void> set_urb_size(std::size_t urb_size, std::size_t urb_count = 0) noexcept
+	{
+		return detail::to_result(libredxx_set_urb_size(m_device, urb_size, urb_count));
+	}
+	// nullptr turns reconnecting off
+	result<void> set_reconnect(const libredxx_reconnect_config* config) noexcept
+	{
+		return detail::to_result(libredxx_set_reconnect(m_device, config));
+	}
+	result<void> set_stall_retries(std::uint32_t retries) noexcept
+	{
+		return detail::to_result(libredxx_set_stall_retries(m_device, retries));
+	}
+
+	libredxx_opened_device* native_handle() const noexcept { return m_device; }
+	explicit operator bool() const noexcept { return m_device != nullptr; }
+
+private:
+	transfer_awaiter prepare(transfer& t, std::byte* data, std::size_t size, bool write, endpoint ep) noexcept
+	{
+		libredxx_transfer* native = t.native_handle();
+		native->device = m_device;
+		native->endpoint = ep;
+		native->write = write;
+		native->buffer = data;
+		native->size = size;
+		return transfer_awaiter(native);
+	}
+
+	void reset() noexcept
+	{
+		if (m_device) {
+			libredxx_close_device(m_device);
+			m_device = nullptr;
+		}
+	}
+
+	libredxx_opened_device* m_device = nullptr;
+};
+
+} // namespace libredxx
+
+#endif // LIBREDXX_LIBREDXX_HPP
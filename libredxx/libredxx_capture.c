@@ -0,0 +1,696 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WIN32
+#define _GNU_SOURCE // O_DIRECT, sync_file_range
+#endif
+
+#include "libredxx.h"
+#include "libredxx_thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * A capture is a 4096 byte header block followed by records, each a record
+ * header and size bytes of data padded to 8 bytes, then the index once the
+ * capture is finished, all in host byte order. The header's data_end stays 0
+ * until then, and opening such a capture rebuilds the index by walking the
+ * records up to the first one that doesn't check out. The index starts on a
+ * block boundary and has an entry per record, offset counting the data bytes
+ * captured before it.
+ */
+#define LIBREDXX_CAPTURE_MAGIC "RDXXCAP1"
+#define LIBREDXX_CAPTURE_MAGIC_SIZE 8
+#define LIBREDXX_CAPTURE_RECORD_MAGIC 0x43584452 // "RDXC"
+#define LIBREDXX_CAPTURE_BLOCK_SIZE 4096 // O_DIRECT needs block aligned offsets, sizes and memory
+#define LIBREDXX_CAPTURE_DEFAULT_SEGMENT_SIZE (8 * 1024 * 1024)
+#define LIBREDXX_CAPTURE_DEFAULT_SEGMENT_COUNT 4
+
+struct libredxx_capture_header {
+	char magic[LIBREDXX_CAPTURE_MAGIC_SIZE];
+	uint64_t data_end;
+	uint64_t index_offset;
+	uint64_t chunks_count;
+	uint64_t bytes;
+	uint64_t dropped_bytes;
+};
+
+struct libredxx_capture_record {
+	uint32_t magic;
+	uint32_t flags;
+	uint64_t timestamp_ns;
+	uint64_t size;
+};
+_Static_assert(sizeof(struct libredxx_capture_record) == 24, "records have a 24 byte header");
+
+struct libredxx_capture_index_entry {
+	uint64_t timestamp_ns;
+	uint64_t position; // of the record header in the file
+	uint64_t offset;
+	uint32_t size;
+	uint32_t flags;
+};
+_Static_assert(sizeof(struct libredxx_capture_index_entry) == 32, "index entries are 32 bytes");
+
+#ifdef _WIN32
+typedef HANDLE libredxx_capture_file;
+#else
+typedef int libredxx_capture_file;
+#endif
+
+struct libredxx_capture_writer {
+	libredxx_capture_file file;
+	bool direct; // the page cache is bypassed, otherwise written ranges are flushed and dropped from it
+	uint8_t** segments;
+	uint64_t* segment_positions; // file offset of each segment's first byte
+	size_t* segment_lengths; // bytes to write of a submitted segment
+	size_t segment_size;
+	size_t segment_count;
+	size_t current;
+	size_t fill;
+	libredxx_mutex mutex;
+	libredxx_cond cond;
+	uint64_t submitted; // segments handed to the thread
+	uint64_t written; // segments the thread is done with
+	bool stopping;
+	bool failed;
+	libredxx_thread thread;
+	bool thread_started;
+	struct libredxx_capture_index_entry* index;
+	size_t index_count;
+	size_t index_capacity;
+	uint64_t bytes;
+	uint64_t dropped_bytes;
+	uint32_t pending_flags; // OVERFLOW after a dropped chunk, goes on the next one written
+};
+
+struct libredxx_capture {
+	const uint8_t* data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+	const struct libredxx_capture_index_entry* index;
+	struct libredxx_capture_index_entry* rebuilt_index; // the index of an unfinished capture, NULL otherwise
+	libredxx_capture_info info;
+};
+
+static uint64_t libredxx_capture_round_up(uint64_t value, uint64_t multiple)
+{
+	return (value + multiple - 1) / multiple * multiple;
+}
+
+// files
+
+static libredxx_status libredxx_capture_file_create(const char* path, uint64_t preallocate_size, libredxx_capture_file* file, bool* direct)
+{
+#ifdef _WIN32
+	*file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, NULL);
+	if (*file == INVALID_HANDLE_VALUE) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	*direct = true;
+	if (preallocate_size) {
+		FILE_ALLOCATION_INFO allocation;
+		allocation.AllocationSize.QuadPart = (LONGLONG)preallocate_size;
+		// only a hint, a capture larger than this still grows the file
+		SetFileInformationByHandle(*file, FileAllocationInfo, &allocation, sizeof(allocation));
+	}
+#else
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+	*direct = false;
+#ifdef O_DIRECT
+	*file = open(path, flags | O_DIRECT, 0644);
+	if (*file != -1) {
+		*direct = true;
+	} else if (errno == EINVAL) {
+		// file systems like tmpfs don't do direct IO
+		*file = open(path, flags, 0644);
+	}
+#else
+	*file = open(path, flags, 0644);
+#ifdef F_NOCACHE
+	if (*file != -1) {
+		*direct = fcntl(*file, F_NOCACHE, 1) == 0;
+	}
+#endif
+#endif
+	if (*file == -1) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+#ifdef __linux__
+	if (preallocate_size && fallocate(*file, FALLOC_FL_KEEP_SIZE, 0, (off_t)preallocate_size) != 0 && errno != EOPNOTSUPP) {
+		close(*file);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+#endif
+#endif
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static bool libredxx_capture_file_write(libredxx_capture_file file, bool direct, const void* data, size_t size, uint64_t position)
+{
+#ifdef _WIN32
+	(void)direct;
+	const uint8_t* bytes = data;
+	while (size) {
+		OVERLAPPED overlapped = {0};
+		overlapped.Offset = (DWORD)position;
+		overlapped.OffsetHigh = (DWORD)(position >> 32);
+		const DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+		DWORD written = 0;
+		if (!WriteFile(file, bytes, chunk, &written, &overlapped) || written == 0) {
+			return false;
+		}
+		bytes += written;
+		size -= written;
+		position += written;
+	}
+	return true;
+#else
+	const uint8_t* bytes = data;
+	const uint64_t start = position;
+	const size_t length = size;
+	while (size) {
+		const ssize_t written = pwrite(file, bytes, size, (off_t)position);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return false;
+		}
+		bytes += written;
+		size -= (size_t)written;
+		position += (uint64_t)written;
+	}
+#ifdef __linux__
+	if (!direct) {
+		// writes back now and drops the pages, so the page cache never has a pile to flush at once
+		sync_file_range(file, (off_t)start, (off_t)length, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+		posix_fadvise(file, (off_t)start, (off_t)length, POSIX_FADV_DONTNEED);
+	}
+#else
+	(void)direct;
+	(void)start;
+	(void)length;
+#endif
+	return true;
+#endif
+}
+
+static bool libredxx_capture_file_close(libredxx_capture_file file, uint64_t size)
+{
+#ifdef _WIN32
+	FILE_END_OF_FILE_INFO end;
+	end.EndOfFile.QuadPart = (LONGLONG)size;
+	bool success = SetFileInformationByHandle(file, FileEndOfFileInfo, &end, sizeof(end));
+	success &= CloseHandle(file) != 0;
+	return success;
+#else
+	// drops what preallocation reserved beyond the end
+	bool success = ftruncate(file, (off_t)size) == 0;
+	success &= close(file) == 0;
+	return success;
+#endif
+}
+
+static void* libredxx_capture_alloc_segment(size_t size)
+{
+#ifdef _WIN32
+	return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+	void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return memory == MAP_FAILED ? NULL : memory;
+#endif
+}
+
+static void libredxx_capture_free_segment(void* segment, size_t size)
+{
+#ifdef _WIN32
+	(void)size;
+	VirtualFree(segment, 0, MEM_RELEASE);
+#else
+	munmap(segment, size);
+#endif
+}
+
+// writing
+
+static void libredxx_capture_main(void* arg)
+{
+	libredxx_capture_writer* writer = arg;
+	libredxx_mutex_lock(&writer->mutex);
+	while (true) {
+		while (writer->written == writer->submitted && !writer->stopping) {
+			libredxx_cond_wait(&writer->cond, &writer->mutex);
+		}
+		if (writer->written == writer->submitted) {
+			break;
+		}
+		const size_t segment = (size_t)(writer->written % writer->segment_count);
+		libredxx_mutex_unlock(&writer->mutex);
+		const bool success = libredxx_capture_file_write(writer->file, writer->direct, writer->segments[segment], writer->segment_lengths[segment], writer->segment_positions[segment]);
+		libredxx_mutex_lock(&writer->mutex);
+		writer->failed |= !success;
+		++writer->written;
+		libredxx_cond_broadcast(&writer->cond);
+	}
+	libredxx_mutex_unlock(&writer->mutex);
+}
+
+// segments neither waiting for the disk nor being filled, call with the mutex held
+static size_t libredxx_capture_free_segments(const libredxx_capture_writer* writer)
+{
+	return writer->segment_count - 1 - (size_t)(writer->submitted - writer->written);
+}
+
+// hands the whole blocks of the current segment to the thread and carries the rest over to the next one, waiting for the disk when no segment is free
+static void libredxx_capture_rotate(libredxx_capture_writer* writer)
+{
+	libredxx_mutex_lock(&writer->mutex);
+	while (!libredxx_capture_free_segments(writer)) {
+		libredxx_cond_wait(&writer->cond, &writer->mutex);
+	}
+	const size_t blocks = writer->fill / LIBREDXX_CAPTURE_BLOCK_SIZE * LIBREDXX_CAPTURE_BLOCK_SIZE;
+	const size_t next = (writer->current + 1) % writer->segment_count;
+	memcpy(writer->segments[next], writer->segments[writer->current] + blocks, writer->fill - blocks);
+	writer->segment_positions[next] = writer->segment_positions[writer->current] + blocks;
+	writer->segment_lengths[writer->current] = blocks;
+	++writer->submitted;
+	libredxx_cond_broadcast(&writer->cond);
+	libredxx_mutex_unlock(&writer->mutex);
+	writer->current = next;
+	writer->fill -= blocks;
+}
+
+static void libredxx_capture_append(libredxx_capture_writer* writer, const void* data, size_t size)
+{
+	const uint8_t* bytes = data;
+	while (size) {
+		if (writer->fill == writer->segment_size) {
+			libredxx_capture_rotate(writer);
+		}
+		const size_t room = writer->segment_size - writer->fill;
+		const size_t copy = size < room ? size : room;
+		memcpy(writer->segments[writer->current] + writer->fill, bytes, copy);
+		writer->fill += copy;
+		bytes += copy;
+		size -= copy;
+	}
+}
+
+static void libredxx_capture_pad(libredxx_capture_writer* writer, size_t alignment)
+{
+	static const uint8_t zeros[LIBREDXX_CAPTURE_BLOCK_SIZE];
+	const uint64_t position = writer->segment_positions[writer->current] + writer->fill;
+	libredxx_capture_append(writer, zeros, (size_t)(libredxx_capture_round_up(position, alignment) - position));
+}
+
+static void libredxx_capture_destroy(libredxx_capture_writer* writer)
+{
+	if (writer->thread_started) {
+		libredxx_mutex_lock(&writer->mutex);
+		writer->stopping = true;
+		libredxx_cond_broadcast(&writer->cond);
+		libredxx_mutex_unlock(&writer->mutex);
+		libredxx_thread_join(writer->thread);
+	}
+	if (writer->segments) {
+		for (size_t i = 0; i < writer->segment_count; ++i) {
+			if (writer->segments[i]) {
+				libredxx_capture_free_segment(writer->segments[i], writer->segment_size);
+			}
+		}
+	}
+	libredxx_cond_destroy(&writer->cond);
+	libredxx_mutex_destroy(&writer->mutex);
+	free(writer->segments);
+	free(writer->segment_positions);
+	free(writer->segment_lengths);
+	free(writer->index);
+	free(writer);
+}
+
+libredxx_status libredxx_capture_create(const char* path, const libredxx_capture_config* config, libredxx_capture_writer** writer)
+{
+	if (!path || !writer) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const size_t segment_size = config && config->segment_size ? config->segment_size : LIBREDXX_CAPTURE_DEFAULT_SEGMENT_SIZE;
+	const size_t segment_count = config && config->segment_count ? config->segment_count : LIBREDXX_CAPTURE_DEFAULT_SEGMENT_COUNT;
+	if (segment_size % LIBREDXX_CAPTURE_BLOCK_SIZE != 0 || segment_size < 2 * LIBREDXX_CAPTURE_BLOCK_SIZE || segment_count < 2) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_capture_writer* private_writer = calloc(1, sizeof(libredxx_capture_writer));
+	if (!private_writer) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	libredxx_mutex_init(&private_writer->mutex);
+	libredxx_cond_init(&private_writer->cond);
+	private_writer->segment_size = segment_size;
+	private_writer->segment_count = segment_count;
+	private_writer->segments = calloc(segment_count, sizeof(uint8_t*));
+	private_writer->segment_positions = calloc(segment_count, sizeof(uint64_t));
+	private_writer->segment_lengths = calloc(segment_count, sizeof(size_t));
+	if (!private_writer->segments || !private_writer->segment_positions || !private_writer->segment_lengths) {
+		libredxx_capture_destroy(private_writer);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	for (size_t i = 0; i < segment_count; ++i) {
+		private_writer->segments[i] = libredxx_capture_alloc_segment(segment_size);
+		if (!private_writer->segments[i]) {
+			libredxx_capture_destroy(private_writer);
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+	}
+	libredxx_status status = libredxx_capture_file_create(path, config ? config->preallocate_size : 0, &private_writer->file, &private_writer->direct);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_capture_destroy(private_writer);
+		return status;
+	}
+	status = libredxx_thread_create(&private_writer->thread, libredxx_capture_main, private_writer);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_capture_file_close(private_writer->file, 0);
+		libredxx_capture_destroy(private_writer);
+		return status;
+	}
+	private_writer->thread_started = true;
+	// the header is rewritten once the capture is finished, until then it says unfinished
+	struct libredxx_capture_header header = {0};
+	memcpy(header.magic, LIBREDXX_CAPTURE_MAGIC, LIBREDXX_CAPTURE_MAGIC_SIZE);
+	libredxx_capture_append(private_writer, &header, sizeof(header));
+	libredxx_capture_pad(private_writer, LIBREDXX_CAPTURE_BLOCK_SIZE);
+	*writer = private_writer;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_capture_write(libredxx_capture_writer* writer, const void* data, size_t size, uint64_t timestamp_ns, uint32_t flags)
+{
+	if (!writer || (!data && size) || size > UINT32_MAX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const size_t record_size = sizeof(struct libredxx_capture_record) + (size_t)libredxx_capture_round_up(size, 8);
+	// less what a rotation can carry over, so a record always fits into the segments still free
+	const size_t segment_room = writer->segment_size - LIBREDXX_CAPTURE_BLOCK_SIZE;
+	if (record_size > segment_room) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_mutex_lock(&writer->mutex);
+	const bool failed = writer->failed;
+	const size_t free_segments = libredxx_capture_free_segments(writer);
+	libredxx_mutex_unlock(&writer->mutex);
+	if (failed) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	if (record_size > writer->segment_size - writer->fill + free_segments * segment_room) {
+		// the disk is behind, dropping keeps the caller reading
+		writer->dropped_bytes += size;
+		writer->pending_flags |= LIBREDXX_CAPTURE_OVERFLOW;
+		return LIBREDXX_STATUS_ERROR_OVERFLOW;
+	}
+	if (writer->index_count == writer->index_capacity) {
+		const size_t capacity = writer->index_capacity ? writer->index_capacity * 2 : 4096;
+		struct libredxx_capture_index_entry* index = realloc(writer->index, capacity * sizeof(struct libredxx_capture_index_entry));
+		if (!index) {
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		writer->index = index;
+		writer->index_capacity = capacity;
+	}
+	struct libredxx_capture_record record;
+	record.magic = LIBREDXX_CAPTURE_RECORD_MAGIC;
+	record.flags = flags | writer->pending_flags;
+	record.timestamp_ns = timestamp_ns;
+	record.size = size;
+	struct libredxx_capture_index_entry* entry = &writer->index[writer->index_count++];
+	entry->timestamp_ns = timestamp_ns;
+	entry->position = writer->segment_positions[writer->current] + writer->fill;
+	entry->offset = writer->bytes;
+	entry->size = (uint32_t)size;
+	entry->flags = record.flags;
+	writer->pending_flags = 0;
+	writer->bytes += size;
+	libredxx_capture_append(writer, &record, sizeof(record));
+	libredxx_capture_append(writer, data, size);
+	libredxx_capture_pad(writer, 8);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_capture_finish(libredxx_capture_writer* writer)
+{
+	if (!writer) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	struct libredxx_capture_header header = {0};
+	memcpy(header.magic, LIBREDXX_CAPTURE_MAGIC, LIBREDXX_CAPTURE_MAGIC_SIZE);
+	header.data_end = writer->segment_positions[writer->current] + writer->fill;
+	header.chunks_count = writer->index_count;
+	header.bytes = writer->bytes;
+	header.dropped_bytes = writer->dropped_bytes;
+	libredxx_capture_pad(writer, LIBREDXX_CAPTURE_BLOCK_SIZE);
+	header.index_offset = writer->segment_positions[writer->current] + writer->fill;
+	libredxx_capture_append(writer, writer->index, writer->index_count * sizeof(struct libredxx_capture_index_entry));
+	const uint64_t end = writer->segment_positions[writer->current] + writer->fill;
+	libredxx_capture_pad(writer, LIBREDXX_CAPTURE_BLOCK_SIZE);
+	libredxx_capture_rotate(writer);
+	libredxx_mutex_lock(&writer->mutex);
+	while (writer->written != writer->submitted) {
+		libredxx_cond_wait(&writer->cond, &writer->mutex);
+	}
+	bool success = !writer->failed;
+	libredxx_mutex_unlock(&writer->mutex);
+	// every segment is back, the current one holds the header block
+	uint8_t* block = writer->segments[writer->current];
+	memset(block, 0, LIBREDXX_CAPTURE_BLOCK_SIZE);
+	memcpy(block, &header, sizeof(header));
+	success &= libredxx_capture_file_write(writer->file, writer->direct, block, LIBREDXX_CAPTURE_BLOCK_SIZE, 0);
+	success &= libredxx_capture_file_close(writer->file, end);
+	libredxx_capture_destroy(writer);
+	return success ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+}
+
+// reading
+
+static libredxx_status libredxx_capture_map(const char* path, libredxx_capture* capture)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (uint64_t)size.QuadPart > SIZE_MAX) {
+		CloseHandle(file);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	if ((uint64_t)size.QuadPart < LIBREDXX_CAPTURE_BLOCK_SIZE) {
+		CloseHandle(file);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	capture->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!capture->mapping) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	capture->data = MapViewOfFile(capture->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!capture->data) {
+		CloseHandle(capture->mapping);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	capture->size = (size_t)size.QuadPart;
+#else
+	int file = open(path, O_RDONLY | O_CLOEXEC);
+	if (file == -1) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	struct stat st;
+	if (fstat(file, &st) != 0 || (uint64_t)st.st_size > SIZE_MAX) {
+		close(file);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	if (st.st_size < LIBREDXX_CAPTURE_BLOCK_SIZE) {
+		close(file);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (data == MAP_FAILED) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	capture->data = data;
+	capture->size = (size_t)st.st_size;
+#endif
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static void libredxx_capture_unmap(libredxx_capture* capture)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(capture->data);
+	CloseHandle(capture->mapping);
+#else
+	munmap((void*)capture->data, capture->size);
+#endif
+}
+
+// walks the records of a capture that was never finished
+static libredxx_status libredxx_capture_rebuild_index(libredxx_capture* capture)
+{
+	size_t capacity = 0;
+	size_t position = LIBREDXX_CAPTURE_BLOCK_SIZE;
+	while (capture->size - position >= sizeof(struct libredxx_capture_record)) {
+		struct libredxx_capture_record record;
+		memcpy(&record, capture->data + position, sizeof(record));
+		const size_t available = capture->size - position - sizeof(record);
+		if (record.magic != LIBREDXX_CAPTURE_RECORD_MAGIC || record.size > available || record.size > UINT32_MAX) {
+			// the unwritten rest, or a record cut short
+			break;
+		}
+		if (capture->info.chunks_count == capacity) {
+			capacity = capacity ? capacity * 2 : 4096;
+			struct libredxx_capture_index_entry* index = realloc(capture->rebuilt_index, capacity * sizeof(struct libredxx_capture_index_entry));
+			if (!index) {
+				return LIBREDXX_STATUS_ERROR_SYS;
+			}
+			capture->rebuilt_index = index;
+		}
+		struct libredxx_capture_index_entry* entry = &capture->rebuilt_index[capture->info.chunks_count++];
+		entry->timestamp_ns = record.timestamp_ns;
+		entry->position = position;
+		entry->offset = capture->info.bytes;
+		entry->size = (uint32_t)record.size;
+		entry->flags = record.flags;
+		capture->info.bytes += record.size;
+		position += sizeof(record) + (size_t)record.size;
+		position = position > capture->size - 8 ? capture->size : (size_t)libredxx_capture_round_up(position, 8);
+	}
+	capture->index = capture->rebuilt_index;
+	capture->info.complete = false;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_capture_open(const char* path, libredxx_capture** capture)
+{
+	if (!path || !capture) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_capture* private_capture = calloc(1, sizeof(libredxx_capture));
+	if (!private_capture) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	libredxx_status status = libredxx_capture_map(path, private_capture);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		free(private_capture);
+		return status;
+	}
+	struct libredxx_capture_header header;
+	memcpy(&header, private_capture->data, sizeof(header));
+	if (memcmp(header.magic, LIBREDXX_CAPTURE_MAGIC, LIBREDXX_CAPTURE_MAGIC_SIZE) != 0) {
+		status = LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	} else if (!header.data_end) {
+		status = libredxx_capture_rebuild_index(private_capture);
+	} else if (header.data_end > private_capture->size || header.index_offset % LIBREDXX_CAPTURE_BLOCK_SIZE != 0 || header.index_offset > private_capture->size
+		|| header.chunks_count > (private_capture->size - header.index_offset) / sizeof(struct libredxx_capture_index_entry)) {
+		status = LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	} else {
+		private_capture->index = (const struct libredxx_capture_index_entry*)(private_capture->data + header.index_offset);
+		private_capture->info.chunks_count = (size_t)header.chunks_count;
+		private_capture->info.bytes = header.bytes;
+		private_capture->info.dropped_bytes = header.dropped_bytes;
+		private_capture->info.complete = true;
+	}
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_capture_close(private_capture);
+		return status;
+	}
+	*capture = private_capture;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_capture_close(libredxx_capture* capture)
+{
+	if (!capture) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_capture_unmap(capture);
+	free(capture->rebuilt_index);
+	free(capture);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_capture_get_info(const libredxx_capture* capture, libredxx_capture_info* info)
+{
+	if (!capture || !info) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	*info = capture->info;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_capture_get_chunk(const libredxx_capture* capture, size_t index, libredxx_capture_chunk* chunk)
+{
+	if (!capture || index >= capture->info.chunks_count || !chunk) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const struct libredxx_capture_index_entry* entry = &capture->index[index];
+	if (entry->position > capture->size - sizeof(struct libredxx_capture_record) || entry->size > capture->size - entry->position - sizeof(struct libredxx_capture_record)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	chunk->data = capture->data + entry->position + sizeof(struct libredxx_capture_record);
+	chunk->size = entry->size;
+	chunk->timestamp_ns = entry->timestamp_ns;
+	chunk->offset = entry->offset;
+	chunk->flags = entry->flags;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_capture_find(const libredxx_capture* capture, uint64_t timestamp_ns, size_t* index)
+{
+	if (!capture || !index) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	// timestamps only grow within a capture written from one stream source
+	size_t low = 0;
+	size_t high = capture->info.chunks_count;
+	while (low < high) {
+		const size_t middle = low + (high - low) / 2;
+		if (capture->index[middle].timestamp_ns < timestamp_ns) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	*index = low;
+	return LIBREDXX_STATUS_SUCCESS;
+}
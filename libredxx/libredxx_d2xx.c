@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "libredxx_d2xx.h"
+
+// baud rate clocks in eighths, so a divisor of 8 is 1.0 (see FTDI AN_120)
+#define LIBREDXX_D2XX_CLOCK   24000000 // 3 MHz
+#define LIBREDXX_D2XX_H_CLOCK 96000000 // 12 MHz, H chips without the divide by 2.5
+#define LIBREDXX_D2XX_H_MIN_BAUD_RATE 1200
+#define LIBREDXX_D2XX_MAX_DIVISOR 0x3FFF
+
+libredxx_d2xx_chip libredxx_d2xx_get_chip(uint16_t release)
+{
+	switch (release >> 8) {
+	case 0x02:
+		return LIBREDXX_D2XX_CHIP_AM;
+	case 0x05:
+		return LIBREDXX_D2XX_CHIP_2232C;
+	case 0x06:
+		return LIBREDXX_D2XX_CHIP_R;
+	case 0x07:
+	case 0x28: // FT2233HP
+	case 0x30: // FT2232HP
+		return LIBREDXX_D2XX_CHIP_2232H;
+	case 0x08:
+	case 0x29: // FT4233HP
+	case 0x31: // FT4232HP
+	case 0x36: // FT4232HA
+		return LIBREDXX_D2XX_CHIP_4232H;
+	case 0x09:
+	case 0x32: // FT233HP
+	case 0x33: // FT232HP
+		return LIBREDXX_D2XX_CHIP_232H;
+	case 0x10:
+		return LIBREDXX_D2XX_CHIP_X;
+	default:
+		return LIBREDXX_D2XX_CHIP_BM; // also the best guess for anything unknown
+	}
+}
+
+uint8_t libredxx_d2xx_get_channel(uint8_t interface_index, uint8_t interface_count)
+{
+	return interface_count > 1 ? (uint8_t)(interface_index + 1) : 0;
+}
+
+static bool libredxx_d2xx_is_h(libredxx_d2xx_chip chip)
+{
+	return chip == LIBREDXX_D2XX_CHIP_2232H || chip == LIBREDXX_D2XX_CHIP_4232H || chip == LIBREDXX_D2XX_CHIP_232H;
+}
+
+// chips that take the high divisor bits in the upper byte of wIndex, whether or not the low byte has a channel
+static bool libredxx_d2xx_shifts_index(libredxx_d2xx_chip chip)
+{
+	return chip == LIBREDXX_D2XX_CHIP_2232C || chip == LIBREDXX_D2XX_CHIP_X || libredxx_d2xx_is_h(chip);
+}
+
+static uint32_t libredxx_d2xx_round_divisor(libredxx_d2xx_chip chip, uint32_t divisor)
+{
+	// between 1 and 2 only 1 and 1.5 are possible, and the AM can't do 1.5 either
+	if (divisor > 8 && divisor < 16) {
+		if (chip == LIBREDXX_D2XX_CHIP_AM) {
+			return divisor < 12 ? 8 : 16;
+		}
+		if (divisor < 10) {
+			return 8;
+		}
+		return divisor < 14 ? 12 : 16;
+	}
+	if (chip == LIBREDXX_D2XX_CHIP_AM) {
+		// AM only has fractions of 0, 1/8, 1/4 and 1/2
+		static const uint8_t am_fractions[8] = {0, 1, 2, 2, 4, 4, 4, 8};
+		return (divisor & ~0x7u) + am_fractions[divisor & 0x7];
+	}
+	return divisor;
+}
+
+static uint32_t libredxx_d2xx_encode_divisor(libredxx_d2xx_chip chip, uint32_t divisor)
+{
+	if (divisor == 8) {
+		return 0;
+	}
+	if (divisor == 12) {
+		return 1;
+	}
+	uint32_t encoded = divisor >> 3;
+	if (chip == LIBREDXX_D2XX_CHIP_AM) {
+		static const uint32_t am_fractions[8] = {0, 0xC000, 0x8000, 0, 0x4000, 0, 0, 0};
+		return encoded | am_fractions[divisor & 0x7];
+	}
+	static const uint32_t fractions[8] = {0, 3, 2, 4, 1, 5, 6, 7};
+	return encoded | (fractions[divisor & 0x7] << 14);
+}
+
+libredxx_status libredxx_d2xx_baud_rate_request(libredxx_d2xx_chip chip, uint8_t channel, uint32_t baud_rate, libredxx_d2xx_request* request, uint32_t* actual_baud_rate)
+{
+	if (baud_rate == 0) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	uint32_t clock = LIBREDXX_D2XX_CLOCK;
+	uint32_t encoded = 0;
+	if (libredxx_d2xx_is_h(chip) && baud_rate >= LIBREDXX_D2XX_H_MIN_BAUD_RATE) {
+		clock = LIBREDXX_D2XX_H_CLOCK;
+		encoded = 0x20000; // disables the divide by 2.5, which also loses rates below 1200
+	}
+	if (baud_rate > clock / 8) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	uint32_t divisor = libredxx_d2xx_round_divisor(chip, (clock + baud_rate / 2) / baud_rate);
+	if ((divisor >> 3) > LIBREDXX_D2XX_MAX_DIVISOR) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	encoded |= libredxx_d2xx_encode_divisor(chip, divisor);
+
+	const uint16_t high = (uint16_t)(encoded >> 16);
+	request->request = LIBREDXX_D2XX_SIO_SET_BAUD_RATE;
+	request->value = (uint16_t)encoded;
+	request->index = libredxx_d2xx_shifts_index(chip) ? (uint16_t)((high << 8) | channel) : high;
+	if (actual_baud_rate) {
+		*actual_baud_rate = (clock + divisor / 2) / divisor;
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_d2xx_data_characteristics_request(uint8_t channel, uint8_t data_bits, libredxx_d2xx_stop_bits stop_bits, libredxx_d2xx_parity parity, libredxx_d2xx_request* request)
+{
+	if (data_bits != 7 && data_bits != 8) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	if (stop_bits > LIBREDXX_D2XX_STOP_BITS_2 || parity > LIBREDXX_D2XX_PARITY_SPACE) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	request->request = LIBREDXX_D2XX_SIO_SET_DATA;
+	request->value = (uint16_t)(data_bits | (parity << 8) | (stop_bits << 11));
+	request->index = channel;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_d2xx_flow_control_request(uint8_t channel, libredxx_d2xx_flow_control flow_control, uint8_t xon, uint8_t xoff, libredxx_d2xx_request* request)
+{
+	uint16_t mode;
+	switch (flow_control) {
+	case LIBREDXX_D2XX_FLOW_CONTROL_NONE:
+		mode = 0x0000;
+		break;
+	case LIBREDXX_D2XX_FLOW_CONTROL_RTS_CTS:
+		mode = 0x0100;
+		break;
+	case LIBREDXX_D2XX_FLOW_CONTROL_DTR_DSR:
+		mode = 0x0200;
+		break;
+	case LIBREDXX_D2XX_FLOW_CONTROL_XON_XOFF:
+		mode = 0x0400;
+		break;
+	default:
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	request->request = LIBREDXX_D2XX_SIO_SET_FLOW_CTRL;
+	request->value = flow_control == LIBREDXX_D2XX_FLOW_CONTROL_XON_XOFF ? (uint16_t)(xon | (xoff << 8)) : 0;
+	request->index = mode | channel;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_d2xx_latency_timer_request(uint8_t channel, uint8_t latency_ms, libredxx_d2xx_request* request)
+{
+	if (latency_ms == 0) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	request->request = LIBREDXX_D2XX_SIO_SET_LATENCY_TIMER;
+	request->value = latency_ms;
+	request->index = channel;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_d2xx_bit_mode_request(uint8_t channel, uint8_t mask, libredxx_d2xx_bit_mode mode, libredxx_d2xx_request* request)
+{
+	switch (mode) {
+	case LIBREDXX_D2XX_BIT_MODE_RESET:
+	case LIBREDXX_D2XX_BIT_MODE_ASYNC_BITBANG:
+	case LIBREDXX_D2XX_BIT_MODE_MPSSE:
+	case LIBREDXX_D2XX_BIT_MODE_SYNC_BITBANG:
+	case LIBREDXX_D2XX_BIT_MODE_MCU_HOST:
+	case LIBREDXX_D2XX_BIT_MODE_FAST_SERIAL:
+	case LIBREDXX_D2XX_BIT_MODE_CBUS_BITBANG:
+	case LIBREDXX_D2XX_BIT_MODE_SYNC_FIFO:
+		break;
+	default:
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	request->request = LIBREDXX_D2XX_SIO_SET_BIT_MODE;
+	request->value = (uint16_t)(mask | (mode << 8));
+	request->index = channel;
+	return LIBREDXX_STATUS_SUCCESS;
+}
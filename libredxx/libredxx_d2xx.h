@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LIBREDXX_LIBREDXX_D2XX_H
+#define LIBREDXX_LIBREDXX_D2XX_H
+
+#include "libredxx.h"
+
+/*
+ * Platform independent helpers for the D2XX "SIO" vendor requests, the backends
+ * only have to send the resulting control transfers.
+ */
+
+#define LIBREDXX_D2XX_REQUEST_TYPE_OUT 0x40 // vendor, host to device
+
+#define LIBREDXX_D2XX_SIO_RESET             0x00
+#define LIBREDXX_D2XX_SIO_SET_MODEM_CTRL    0x01
+#define LIBREDXX_D2XX_SIO_SET_FLOW_CTRL     0x02
+#define LIBREDXX_D2XX_SIO_SET_BAUD_RATE     0x03
+#define LIBREDXX_D2XX_SIO_SET_DATA          0x04
+#define LIBREDXX_D2XX_SIO_SET_LATENCY_TIMER 0x09
+#define LIBREDXX_D2XX_SIO_SET_BIT_MODE      0x0B
+
+enum libredxx_d2xx_chip {
+	LIBREDXX_D2XX_CHIP_AM,
+	LIBREDXX_D2XX_CHIP_BM,
+	LIBREDXX_D2XX_CHIP_2232C,
+	LIBREDXX_D2XX_CHIP_R,
+	LIBREDXX_D2XX_CHIP_X,
+	LIBREDXX_D2XX_CHIP_2232H,
+	LIBREDXX_D2XX_CHIP_4232H,
+	LIBREDXX_D2XX_CHIP_232H,
+};
+typedef enum libredxx_d2xx_chip libredxx_d2xx_chip;
+
+struct libredxx_d2xx_request {
+	uint8_t request;
+	uint16_t value;
+	uint16_t index;
+};
+typedef struct libredxx_d2xx_request libredxx_d2xx_request;
+
+// chip family from the bcdDevice field of the device descriptor
+libredxx_d2xx_chip libredxx_d2xx_get_chip(uint16_t release);
+
+// wIndex channel for SIO requests, 0 on single channel chips, 1-4 for channels A-D otherwise
+uint8_t libredxx_d2xx_get_channel(uint8_t interface_index, uint8_t interface_count);
+
+// actual_baud_rate is optional, it receives the rate the chip will really run at
+libredxx_status libredxx_d2xx_baud_rate_request(libredxx_d2xx_chip chip, uint8_t channel, uint32_t baud_rate, libredxx_d2xx_request* request, uint32_t* actual_baud_rate);
+libredxx_status libredxx_d2xx_data_characteristics_request(uint8_t channel, uint8_t data_bits, libredxx_d2xx_stop_bits stop_bits, libredxx_d2xx_parity parity, libredxx_d2xx_request* request);
+libredxx_status libredxx_d2xx_flow_control_request(uint8_t channel, libredxx_d2xx_flow_control flow_control, uint8_t xon, uint8_t xoff, libredxx_d2xx_request* request);
+libredxx_status libredxx_d2xx_latency_timer_request(uint8_t channel, uint8_t latency_ms, libredxx_d2xx_request* request);
+libredxx_status libredxx_d2xx_bit_mode_request(uint8_t channel, uint8_t mask, libredxx_d2xx_bit_mode mode, libredxx_d2xx_request* request);
+
+#endif // LIBREDXX_LIBREDXX_D2XX_H
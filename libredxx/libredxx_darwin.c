@@ -21,13 +21,24 @@
  */
 
 #include "libredxx.h"
+#include "libredxx_d2xx.h"
+#include "libredxx_pool.h"
+#include "libredxx_pcap.h"
+#include "libredxx_replay.h"
+#include "libredxx_stats.h"
+#include "libredxx_time.h"
+#include "libredxx_trace.h"
 
 #include <IOKit/usb/IOUSBLib.h>
 #include <IOKit/IOCFPlugIn.h>
 #include <CoreFoundation/CoreFoundation.h>
+#include <errno.h>
 #include <IOKit/IOCFPlugIn.h>
+#include <stdatomic.h>
 
 #define D2XX_HEADER_SIZE 2
+#define D2XX_RX_SIZE 4096
+#define D3XX_CHANNEL_COUNT 4
 
 // for details: https://developer.apple.com/library/archive/documentation/DeviceDrivers/Conceptual/USBBook/USBDeviceInterfaces/USBDevInterfaces.html
 
@@ -36,19 +47,77 @@ struct libredxx_found_device {
 	libredxx_device_id id;
 	libredxx_device_type type;
 	uint32_t location;
+	uint16_t release;
+	uint8_t interface_count;
+	uint8_t interface_index;
+	bool replay;
+};
+
+struct libredxx_d3xx_channel {
+	size_t stream_size;
+	bool trigger_ahead; // already requested the data of the next read
 };
 
 struct libredxx_opened_device {
 	libredxx_found_device found;
 	IOUSBDeviceInterface** device;
 	IOUSBInterfaceInterface** interfaces[2];
-	uint8_t* d2xx_rx_buffer;
+	size_t max_packet;
+	libredxx_buffer_pool d2xx_rx_pool; // backs d2xx_rx_buffer, so reads stage through mapped, faulted in memory
+	uint8_t* d2xx_rx_buffer; // payload of whole packets, headers stripped
 	size_t d2xx_rx_buffer_size;
-	bool read_interrupted;
+	size_t d2xx_rx_offset; // read up to here
+	size_t d2xx_rx_fill;
+	struct libredxx_d3xx_channel d3xx_channels[D3XX_CHANNEL_COUNT];
+	libredxx_buffer_pool pool;
+	libredxx_stats_counters stats;
+	libredxx_pcap_address pcap_address;
+	uint32_t record_session;
+	libredxx_replay_session* replay;
+	atomic_bool read_interrupted[D3XX_CHANNEL_COUNT];
 };
 
+static libredxx_status libredxx_find_replay_devices(const libredxx_find_filter* filters, size_t filters_count, libredxx_found_device*** devices, size_t* devices_count)
+{
+	libredxx_replay_device* replay_devices;
+	size_t replay_devices_count;
+	libredxx_status status = libredxx_replay_find(filters, filters_count, &replay_devices, &replay_devices_count);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	*devices = NULL;
+	*devices_count = 0;
+	if (replay_devices_count > 0) {
+		libredxx_found_device* private_devices = calloc(replay_devices_count, sizeof(libredxx_found_device));
+		*devices = malloc(sizeof(libredxx_found_device*) * replay_devices_count);
+		if (!private_devices || !*devices) {
+			free(private_devices);
+			free(*devices);
+			free(replay_devices);
+			*devices = NULL;
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		for (size_t i = 0; i < replay_devices_count; ++i) {
+			libredxx_found_device* private_device = &private_devices[i];
+			private_device->serial = replay_devices[i].serial;
+			private_device->id = replay_devices[i].id;
+			private_device->type = replay_devices[i].type;
+			private_device->interface_index = replay_devices[i].interface_index;
+			private_device->interface_count = (uint8_t)(replay_devices[i].interface_index + 1);
+			private_device->replay = true;
+			(*devices)[i] = private_device;
+		}
+		*devices_count = replay_devices_count;
+	}
+	free(replay_devices);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
 libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_t filters_count, libredxx_found_device*** devices, size_t* devices_count)
 {
+	if (libredxx_replay_enabled()) {
+		return libredxx_find_replay_devices(filters, filters_count, devices, devices_count);
+	}
 	io_iterator_t device_it;
 	{
 		CFMutableDictionaryRef dict = IOServiceMatching(kIOUSBDeviceClassName);
@@ -83,12 +152,30 @@ libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_
 				device->type = filter->type;
 
 				(*darwin_device)->GetLocationID(darwin_device, &device->location);
+				(*darwin_device)->GetDeviceReleaseNumber(darwin_device, &device->release);
+				IOUSBConfigurationDescriptorPtr config;
+				if ((*darwin_device)->GetConfigurationDescriptorPtr(darwin_device, 0, &config) == kIOReturnSuccess) {
+					device->interface_count = config->bNumInterfaces;
+				}
 
 				CFTypeRef serial = IORegistryEntryCreateCFProperty(darwin_device_service, CFSTR(kUSBSerialNumberString), kCFAllocatorDefault, 0);
 				if (serial) {
 					CFStringGetCString((CFStringRef)serial, device->serial.serial, sizeof(device->serial.serial), kCFStringEncodingUTF8);
 					CFRelease(serial);
 				}
+
+				// every channel of a multi-channel D2XX device is its own interface, and found separately
+				if (device->type == LIBREDXX_DEVICE_TYPE_D2XX && device->interface_count > 1) {
+					// grow once for every channel, device is stale after the realloc
+					const uint8_t interface_count = device->interface_count;
+					const size_t first_index = device_index - 1;
+					private_devices = realloc(private_devices, sizeof(libredxx_found_device) * (device_index + interface_count - 1));
+					for (uint8_t interface_index = 1; interface_index < interface_count; ++interface_index) {
+						private_devices[device_index] = private_devices[first_index];
+						private_devices[device_index].interface_index = interface_index;
+						++device_index;
+					}
+				}
 				break;
 			}
 		}
@@ -103,6 +190,7 @@ libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_
 			(*devices)[i] = &private_devices[i];
 		}
 	}
+	libredxx_record_find(*devices, *devices_count);
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
@@ -131,8 +219,52 @@ libredxx_status libredxx_get_device_type(const libredxx_found_device* found, lib
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
+libredxx_status libredxx_get_interface_index(const libredxx_found_device* found, uint8_t* interface_index)
+{
+	*interface_index = found->interface_index;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_get_link_speed(const libredxx_found_device* found, libredxx_link_speed* speed)
+{
+	(void)found;
+	(void)speed;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_get_packet_size(const libredxx_found_device* found, size_t* packet_size)
+{
+	(void)found;
+	(void)packet_size;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+static libredxx_status libredxx_open_replay_device(const libredxx_found_device* found, libredxx_opened_device** opened)
+{
+	libredxx_replay_device device = {0};
+	device.id = found->id;
+	device.type = found->type;
+	device.interface_index = found->interface_index;
+	device.serial = found->serial;
+	libredxx_opened_device* private_opened = calloc(1, sizeof(libredxx_opened_device));
+	if (!private_opened) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	private_opened->found = *found;
+	private_opened->replay = libredxx_replay_open(&device);
+	if (!private_opened->replay) {
+		free(private_opened);
+		return LIBREDXX_STATUS_ERROR_IO; // no recorded session left for this device
+	}
+	*opened = private_opened;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
 libredxx_status libredxx_open_device(const libredxx_found_device* found, libredxx_opened_device** opened)
 {
+	if (found->replay) {
+		return libredxx_open_replay_device(found, opened);
+	}
 	libredxx_opened_device* private_device = calloc(1, sizeof(libredxx_opened_device));
 	private_device->found = *found;
 
@@ -165,6 +297,11 @@ libredxx_status libredxx_open_device(const libredxx_found_device* found, libredx
 		(*darwin_device)->USBDeviceOpenSeize(darwin_device);
 		private_device->device = darwin_device;
 
+		USBDeviceAddress address = 0;
+		(*darwin_device)->GetDeviceAddress(darwin_device, &address);
+		private_device->pcap_address.bus = (uint16_t)(found->location >> 24);
+		private_device->pcap_address.device = (uint8_t)address;
+
 		IOUSBFindInterfaceRequest request;
 		request.bInterfaceClass = kIOUSBFindInterfaceDontCare;
 		request.bInterfaceSubClass = kIOUSBFindInterfaceDontCare;
@@ -185,23 +322,57 @@ libredxx_status libredxx_open_device(const libredxx_found_device* found, libredx
 		IOUSBInterfaceInterface** interface = NULL;
 		(*plug_in_interface)->QueryInterface(plug_in_interface, CFUUIDGetUUIDBytes(kIOUSBInterfaceInterfaceID), (LPVOID *)&interface);
 		(*plug_in_interface)->Release(plug_in_interface);
+
+		// D2XX only opens the interface of its channel, leaving the other channels free to be opened
+		UInt8 interface_number = 0;
+		(*interface)->GetInterfaceNumber(interface, &interface_number);
+		const bool wanted = found->type != LIBREDXX_DEVICE_TYPE_D2XX || interface_number == found->interface_index;
+		if (!wanted || interface_index >= sizeof(private_device->interfaces) / sizeof(private_device->interfaces[0])) {
+			(*interface)->Release(interface);
+			continue;
+		}
 		(*interface)->USBInterfaceOpen(interface);
 		private_device->interfaces[interface_index] = interface;
 		++interface_index;
 	}
 
+	if (found->type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		// as many whole packets as fit, every one starts with its own modem status
+		IOUSBInterfaceInterface** interface = private_device->interfaces[0];
+		UInt8 direction, number, transfer_type, interval;
+		UInt16 max_packet = 0;
+		if (!interface || (*interface)->GetPipeProperties(interface, 1, &direction, &number, &transfer_type, &max_packet, &interval) != kIOReturnSuccess || max_packet <= D2XX_HEADER_SIZE) {
+			max_packet = 64; // full speed
+		}
+		private_device->max_packet = max_packet;
+		private_device->d2xx_rx_buffer_size = max_packet < D2XX_RX_SIZE ? D2XX_RX_SIZE / max_packet * max_packet : max_packet;
+		if (libredxx_buffer_pool_init(&private_device->d2xx_rx_pool, private_device->d2xx_rx_buffer_size, 1, 0) != LIBREDXX_STATUS_SUCCESS) {
+			libredxx_close_device(private_device);
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		libredxx_buffer_pool_get(&private_device->d2xx_rx_pool, (void**)&private_device->d2xx_rx_buffer);
+	}
+
+	private_device->record_session = libredxx_record_open(found);
 	*opened = private_device;
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
 libredxx_status libredxx_close_device(libredxx_opened_device* device)
 {
+	libredxx_record_close(device->record_session);
+	if (device->replay) {
+		libredxx_replay_close(device->replay);
+		libredxx_buffer_pool_destroy(&device->pool);
+		free(device);
+		return LIBREDXX_STATUS_SUCCESS;
+	}
 	libredxx_status status;
 	status = libredxx_interrupt(device);
 	if (status != LIBREDXX_STATUS_SUCCESS) {
 		return status;
 	}
-	for (size_t i = 0; i < sizeof(device->interfaces); ++i) {
+	for (size_t i = 0; i < sizeof(device->interfaces) / sizeof(device->interfaces[0]); ++i) {
 		IOUSBInterfaceInterface** interface = device->interfaces[i];
 		if (!interface) {
 			break;
@@ -211,91 +382,433 @@ libredxx_status libredxx_close_device(libredxx_opened_device* device)
 	}
 	(*device->device)->USBDeviceClose(device->device);
 	(*device->device)->Release(device->device);
-	free(device->d2xx_rx_buffer);
+	libredxx_buffer_pool_destroy(&device->d2xx_rx_pool);
+	libredxx_buffer_pool_destroy(&device->pool);
 	free(device);
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
-libredxx_status libredxx_interrupt(libredxx_opened_device* device)
+libredxx_status libredxx_create_pool(libredxx_opened_device* device, size_t buffer_size, size_t buffer_count, uint32_t flags)
 {
-	device->read_interrupted = true;
-	size_t interface_index;
-	uint8_t pipe;
+	return libredxx_buffer_pool_init(&device->pool, buffer_size, buffer_count, flags);
+}
+
+libredxx_status libredxx_get_buffer(libredxx_opened_device* device, void** buffer)
+{
+	return libredxx_buffer_pool_get(&device->pool, buffer);
+}
+
+libredxx_status libredxx_free_buffer(libredxx_opened_device* device, void* buffer)
+{
+	return libredxx_buffer_pool_free(&device->pool, buffer);
+}
+
+// the completion thread is built on usbfs URBs, not available here yet
+libredxx_status libredxx_stream_start(const libredxx_stream_source* sources, size_t sources_count, const libredxx_stream_config* config, libredxx_stream** stream)
+{
+	(void)sources;
+	(void)sources_count;
+	(void)config;
+	(void)stream;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_stream_stop(libredxx_stream* stream)
+{
+	(void)stream;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_stream_pop(libredxx_stream* stream, size_t source, libredxx_stream_chunk* chunk, uint32_t timeout_ms)
+{
+	(void)stream;
+	(void)source;
+	(void)chunk;
+	(void)timeout_ms;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_stream_pop_merged(libredxx_stream* stream, size_t* source, libredxx_stream_chunk* chunk, uint32_t timeout_ms)
+{
+	(void)stream;
+	(void)source;
+	(void)chunk;
+	(void)timeout_ms;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_stream_release(libredxx_stream* stream, size_t source, const libredxx_stream_chunk* chunk)
+{
+	(void)stream;
+	(void)source;
+	(void)chunk;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+// asynchronous transfers are Linux only, IOKit pipe reads aren't wired up
+libredxx_status libredxx_alloc_transfer(libredxx_transfer** transfer)
+{
+	(void)transfer;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_free_transfer(libredxx_transfer* transfer)
+{
+	(void)transfer;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_submit_transfer(libredxx_transfer* transfer)
+{
+	(void)transfer;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_cancel_transfer(libredxx_transfer* transfer)
+{
+	(void)transfer;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_poll_completions(libredxx_opened_device* device, uint32_t timeout_ms)
+{
+	(void)device;
+	(void)timeout_ms;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_get_stats(libredxx_opened_device* device, libredxx_stats* stats)
+{
+	libredxx_stats_snapshot(&device->stats, stats);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_reset_stats(libredxx_opened_device* device)
+{
+	libredxx_stats_reset(&device->stats);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+// endpoints a read can block on, and so can be interrupted
+static unsigned int libredxx_read_endpoint_count(const libredxx_found_device* found)
+{
+	return found->type == LIBREDXX_DEVICE_TYPE_D2XX ? 1 : D3XX_CHANNEL_COUNT;
+}
+
+static libredxx_status libredxx_interrupt_endpoints(libredxx_opened_device* device, unsigned int first, unsigned int end)
+{
+	libredxx_stats_interrupt(&device->stats);
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_INTERRUPT, device, (libredxx_endpoint)first, false, 0, LIBREDXX_STATUS_SUCCESS);
+	libredxx_record_interrupt(device->record_session);
+	if (device->replay) {
+		return libredxx_replay_interrupt(device->replay);
+	}
+	for (unsigned int endpoint = first; endpoint < end; ++endpoint) {
+		atomic_store_explicit(&device->read_interrupted[endpoint], true, memory_order_release);
+	}
 	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
-		interface_index = 0;
-		pipe = 1;
+		IOUSBInterfaceInterface** interface = device->interfaces[0];
+		(*interface)->AbortPipe(interface, 1);
 	} else {
-		interface_index = 1;
-		pipe = 2;
+		// pipes of channels the chip isn't configured for just fail to abort
+		IOUSBInterfaceInterface** interface = device->interfaces[1];
+		for (unsigned int channel = first; channel < end; ++channel) {
+			(*interface)->AbortPipe(interface, (UInt8)(2 + channel * 2));
+		}
 	}
-	IOUSBInterfaceInterface** interface = device->interfaces[interface_index];
-	(*interface)->AbortPipe(interface, pipe);
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
-static libredxx_status libredxx_d3xx_trigger_read(libredxx_opened_device* device, uint32_t size)
+libredxx_status libredxx_interrupt(libredxx_opened_device* device)
 {
+	return libredxx_interrupt_endpoints(device, 0, libredxx_read_endpoint_count(&device->found));
+}
+
+libredxx_status libredxx_interrupt_endpoint(libredxx_opened_device* device, libredxx_endpoint endpoint)
+{
+	if ((unsigned int)endpoint >= libredxx_read_endpoint_count(&device->found)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return libredxx_interrupt_endpoints(device, endpoint, endpoint + 1u);
+}
+
+static int libredxx_pcap_status(IOReturn ret)
+{
+	if (ret == kIOReturnSuccess) {
+		return 0;
+	}
+	return ret == kIOUSBTransactionReturned || ret == kIOReturnAborted ? -ENOENT : -EIO;
+}
+
+// pipe transfers go through these so they can be captured, endpoint is the address of the pipe
+static IOReturn libredxx_read_pipe(libredxx_opened_device* device, IOUSBInterfaceInterface** interface, UInt8 pipe, uint8_t endpoint, void* buffer, UInt32* size)
+{
+	libredxx_pcap_submit(&device->pcap_address, size, LIBREDXX_PCAP_BULK, endpoint, NULL, buffer, *size);
+	IOReturn ret = (*interface)->ReadPipe(interface, pipe, buffer, size);
+	libredxx_pcap_complete(&device->pcap_address, size, LIBREDXX_PCAP_BULK, endpoint, libredxx_pcap_status(ret), buffer, ret == kIOReturnSuccess ? *size : 0);
+	return ret;
+}
+
+static IOReturn libredxx_write_pipe(libredxx_opened_device* device, IOUSBInterfaceInterface** interface, UInt8 pipe, uint8_t endpoint, void* buffer, UInt32 size)
+{
+	libredxx_pcap_submit(&device->pcap_address, buffer, LIBREDXX_PCAP_BULK, endpoint, NULL, buffer, size);
+	IOReturn ret = (*interface)->WritePipe(interface, pipe, buffer, size);
+	libredxx_pcap_complete(&device->pcap_address, buffer, LIBREDXX_PCAP_BULK, endpoint, libredxx_pcap_status(ret), buffer, ret == kIOReturnSuccess ? size : 0);
+	return ret;
+}
+
+static libredxx_status libredxx_d3xx_trigger_read(libredxx_opened_device* device, uint8_t channel, uint32_t size)
+{
+	const uint8_t pipe = (uint8_t)(0x82 + channel);
 	uint8_t* size_bytes = (uint8_t*)&size;
-	uint8_t data[] = {0x00, 0x00, 0x00, 0x00, 0x82, 0x01, 0x00, 0x00, size_bytes[0], size_bytes[1], size_bytes[2], size_bytes[3], 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+	uint8_t data[] = {0x00, 0x00, 0x00, 0x00, pipe, 0x01, 0x00, 0x00, size_bytes[0], size_bytes[1], size_bytes[2], size_bytes[3], 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 	IOUSBInterfaceInterface** interface = (IOUSBInterfaceInterface**)device->interfaces[0];
-	return (*interface)->WritePipe(interface, 0x01, data, sizeof(data)) == kIOReturnSuccess ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+	return libredxx_write_pipe(device, interface, 0x01, 0x01, data, sizeof(data)) == kIOReturnSuccess ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
 }
 
-libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+// drops the D2XX modem status header at the start of every packet, returns the payload size
+static size_t libredxx_strip_d2xx_headers(libredxx_opened_device* device, uint8_t* buffer, size_t size)
 {
-	(void)endpoint;
-	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
-		size_t headered_buffer_size = *buffer_size + D2XX_HEADER_SIZE;
-		if (headered_buffer_size > device->d2xx_rx_buffer_size) {
-			device->d2xx_rx_buffer = realloc(device->d2xx_rx_buffer, headered_buffer_size);
-			device->d2xx_rx_buffer_size = headered_buffer_size;
+	const size_t packet_size = device->max_packet;
+	size_t payload = 0;
+	for (size_t offset = 0; offset < size; offset += packet_size) {
+		const size_t packet = size - offset < packet_size ? size - offset : packet_size;
+		if (packet <= D2XX_HEADER_SIZE) {
+			libredxx_stats_d2xx_status_packet(&device->stats);
+			continue;
 		}
+		memmove(&buffer[payload], &buffer[offset + D2XX_HEADER_SIZE], packet - D2XX_HEADER_SIZE);
+		payload += packet - D2XX_HEADER_SIZE;
+	}
+	return payload;
+}
+
+static libredxx_status libredxx_read_endpoint(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	if (device->replay) {
+		return libredxx_replay_read(device->replay, buffer, buffer_size, endpoint);
+	}
+	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
 		IOUSBInterfaceInterface** interface = device->interfaces[0];
-		device->read_interrupted = false;
-		while (true) {
-			UInt32 size = headered_buffer_size;
-			IOReturn ret = (*interface)->ReadPipe(interface, 1, device->d2xx_rx_buffer, &size);
+		atomic_store_explicit(&device->read_interrupted[LIBREDXX_ENDPOINT_A], false, memory_order_relaxed);
+		while (device->d2xx_rx_offset == device->d2xx_rx_fill) {
+			// whole packets only, a transfer ending within a packet overflows when a full one arrives
+			const size_t payload = device->max_packet - D2XX_HEADER_SIZE;
+			const size_t packets = *buffer_size > payload ? (*buffer_size + payload - 1) / payload : 1;
+			UInt32 size = (UInt32)(packets * device->max_packet < device->d2xx_rx_buffer_size ? packets * device->max_packet : device->d2xx_rx_buffer_size);
+			IOReturn ret = libredxx_read_pipe(device, interface, 1, (uint8_t)(0x81 + device->found.interface_index * 2), device->d2xx_rx_buffer, &size);
 			if (ret != kIOReturnSuccess) {
 				return LIBREDXX_STATUS_ERROR_SYS;
 			}
-			if (size > D2XX_HEADER_SIZE) {
-				size -= D2XX_HEADER_SIZE;
-				memcpy(buffer, &device->d2xx_rx_buffer[D2XX_HEADER_SIZE], size);
-				*buffer_size = size;
-				return LIBREDXX_STATUS_SUCCESS;
-			}
-			if (device->read_interrupted) {
+			device->d2xx_rx_offset = 0;
+			device->d2xx_rx_fill = libredxx_strip_d2xx_headers(device, device->d2xx_rx_buffer, size);
+			if (device->d2xx_rx_fill == 0 && atomic_load_explicit(&device->read_interrupted[LIBREDXX_ENDPOINT_A], memory_order_acquire)) {
 				return LIBREDXX_STATUS_ERROR_INTERRUPTED;
 			}
 		}
+		// the rest of the packets stays for the next read
+		const size_t available = device->d2xx_rx_fill - device->d2xx_rx_offset;
+		*buffer_size = *buffer_size < available ? *buffer_size : available;
+		memcpy(buffer, &device->d2xx_rx_buffer[device->d2xx_rx_offset], *buffer_size);
+		device->d2xx_rx_offset += *buffer_size;
+		return LIBREDXX_STATUS_SUCCESS;
 	} else {
+		// endpoints A to D are FIFO channels 1 to 4, their pipes are in endpoint address order
+		if (endpoint >= D3XX_CHANNEL_COUNT) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		struct libredxx_d3xx_channel* channel = &device->d3xx_channels[endpoint];
+		const uint8_t channel_index = (uint8_t)endpoint;
 		IOUSBInterfaceInterface** interface = (IOUSBInterfaceInterface**)device->interfaces[1];
 		libredxx_status status;
-		device->read_interrupted = false;
-		status = libredxx_d3xx_trigger_read(device, *buffer_size);
-		if (status != LIBREDXX_STATUS_SUCCESS) {
-			return status;
+		atomic_store_explicit(&device->read_interrupted[endpoint], false, memory_order_relaxed);
+		const size_t size = *buffer_size;
+		if (!channel->trigger_ahead) {
+			status = libredxx_d3xx_trigger_read(device, channel_index, (uint32_t)size);
+			if (status != LIBREDXX_STATUS_SUCCESS) {
+				return status;
+			}
 		}
-		IOReturn ret = (*interface)->ReadPipe(interface, 2, buffer, (UInt32*)buffer_size);
-		if (ret == kIOUSBTransactionReturned && device->read_interrupted) {
+		channel->trigger_ahead = false;
+		IOReturn ret = libredxx_read_pipe(device, interface, (UInt8)(2 + channel_index * 2), (uint8_t)(0x82 + channel_index), buffer, (UInt32*)buffer_size);
+		if (ret == kIOUSBTransactionReturned && atomic_load_explicit(&device->read_interrupted[endpoint], memory_order_acquire)) {
+			// the chip still has the request, the next read takes its data instead of asking again
+			channel->trigger_ahead = true;
 			return LIBREDXX_STATUS_ERROR_INTERRUPTED;
 		}
-		return ret == kIOReturnSuccess ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+		if (ret != kIOReturnSuccess) {
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		if (channel->stream_size != 0 && channel->stream_size == size) {
+			// request the next read now so its data is already on the way when it is asked for
+			channel->trigger_ahead = libredxx_d3xx_trigger_read(device, channel_index, (uint32_t)size) == LIBREDXX_STATUS_SUCCESS;
+		}
+		return LIBREDXX_STATUS_SUCCESS;
 	}
 }
 
-libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+libredxx_status libredxx_d3xx_set_stream_size(libredxx_opened_device* device, libredxx_endpoint endpoint, size_t size)
 {
-	(void)endpoint;
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D3XX || endpoint >= D3XX_CHANNEL_COUNT || size > UINT32_MAX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	device->d3xx_channels[endpoint].stream_size = size;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_set_urb_size(libredxx_opened_device* device, size_t urb_size, size_t urb_count)
+{
+	(void)device;
+	(void)urb_size;
+	(void)urb_count;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_set_reconnect(libredxx_opened_device* device, const libredxx_reconnect_config* config)
+{
+	(void)device;
+	(void)config;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_set_stall_retries(libredxx_opened_device* device, uint32_t retries)
+{
+	(void)device;
+	(void)retries;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+static libredxx_status libredxx_write_endpoint(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	if (device->replay) {
+		return libredxx_replay_write(device->replay, buffer_size, endpoint);
+	}
 	size_t interface_index;
 	uint8_t pipe;
+	uint8_t address;
 	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
 		interface_index = 0;
 		pipe = 2;
+		address = (uint8_t)(0x02 + device->found.interface_index * 2);
 	} else {
+		if (endpoint >= D3XX_CHANNEL_COUNT) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
 		interface_index = 1;
-		pipe = 1;
+		pipe = (uint8_t)(1 + endpoint * 2);
+		address = (uint8_t)(0x02 + endpoint);
 	}
 	IOUSBInterfaceInterface** interface = (IOUSBInterfaceInterface**)device->interfaces[interface_index];
-	return (*interface)->WritePipe(interface, pipe, buffer, *buffer_size) == kIOReturnSuccess ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+	return libredxx_write_pipe(device, interface, pipe, address, buffer, (UInt32)*buffer_size) == kIOReturnSuccess ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+}
+
+libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	const size_t requested = *buffer_size;
+	const uint64_t start_ns = libredxx_time_ns();
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_SUBMIT, device, endpoint, false, requested, LIBREDXX_STATUS_SUCCESS);
+	libredxx_status status = libredxx_read_endpoint(device, buffer, buffer_size, endpoint);
+	LIBREDXX_TRACE_EVENT(status == LIBREDXX_STATUS_SUCCESS ? LIBREDXX_TRACE_COMPLETE : LIBREDXX_TRACE_ERROR, device, endpoint, false, *buffer_size, status);
+	libredxx_stats_read(&device->stats, endpoint, status, requested, *buffer_size, start_ns);
+	libredxx_record_read(device->record_session, endpoint, status, buffer, *buffer_size);
+	return status;
+}
+
+libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	const uint64_t start_ns = libredxx_time_ns();
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_SUBMIT, device, endpoint, true, *buffer_size, LIBREDXX_STATUS_SUCCESS);
+	libredxx_status status = libredxx_write_endpoint(device, buffer, buffer_size, endpoint);
+	LIBREDXX_TRACE_EVENT(status == LIBREDXX_STATUS_SUCCESS ? LIBREDXX_TRACE_COMPLETE : LIBREDXX_TRACE_ERROR, device, endpoint, true, *buffer_size, status);
+	libredxx_stats_write(&device->stats, endpoint, status, *buffer_size, start_ns);
+	libredxx_record_write(device->record_session, endpoint, status, *buffer_size);
+	return status;
+}
+
+static libredxx_status libredxx_d2xx_send_request(libredxx_opened_device* device, const libredxx_d2xx_request* request)
+{
+	if (device->replay) {
+		return LIBREDXX_STATUS_SUCCESS;
+	}
+	IOUSBDevRequest dev_request = {0};
+	dev_request.bmRequestType = LIBREDXX_D2XX_REQUEST_TYPE_OUT;
+	dev_request.bRequest = request->request;
+	dev_request.wValue = request->value;
+	dev_request.wIndex = request->index;
+	uint8_t setup[8];
+	libredxx_pcap_setup(setup, dev_request.bmRequestType, dev_request.bRequest, dev_request.wValue, dev_request.wIndex, 0);
+	libredxx_pcap_submit(&device->pcap_address, &dev_request, LIBREDXX_PCAP_CONTROL, 0x00, setup, NULL, 0);
+	IOReturn ret = (*device->device)->DeviceRequest(device->device, &dev_request);
+	libredxx_pcap_complete(&device->pcap_address, &dev_request, LIBREDXX_PCAP_CONTROL, 0x00, libredxx_pcap_status(ret), NULL, 0);
+	return ret == kIOReturnSuccess ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+}
+
+static uint8_t libredxx_d2xx_channel(const libredxx_opened_device* device)
+{
+	return libredxx_d2xx_get_channel(device->found.interface_index, device->found.interface_count);
+}
+
+libredxx_status libredxx_d2xx_set_baud_rate(libredxx_opened_device* device, uint32_t baud_rate)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_baud_rate_request(libredxx_d2xx_get_chip(device->found.release), libredxx_d2xx_channel(device), baud_rate, &request, NULL);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
+}
+
+libredxx_status libredxx_d2xx_set_data_characteristics(libredxx_opened_device* device, uint8_t data_bits, libredxx_d2xx_stop_bits stop_bits, libredxx_d2xx_parity parity)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_data_characteristics_request(libredxx_d2xx_channel(device), data_bits, stop_bits, parity, &request);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
+}
+
+libredxx_status libredxx_d2xx_set_flow_control(libredxx_opened_device* device, libredxx_d2xx_flow_control flow_control, uint8_t xon, uint8_t xoff)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_flow_control_request(libredxx_d2xx_channel(device), flow_control, xon, xoff, &request);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
+}
+
+libredxx_status libredxx_d2xx_set_latency_timer(libredxx_opened_device* device, uint8_t latency_ms)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_latency_timer_request(libredxx_d2xx_channel(device), latency_ms, &request);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
+}
+
+libredxx_status libredxx_d2xx_set_bit_mode(libredxx_opened_device* device, uint8_t mask, libredxx_d2xx_bit_mode mode)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_bit_mode_request(libredxx_d2xx_channel(device), mask, mode, &request);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
 }
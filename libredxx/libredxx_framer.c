@@ -0,0 +1,513 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "libredxx.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LIBREDXX_FRAMER_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define LIBREDXX_FRAMER_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define LIBREDXX_FRAMER_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define LIBREDXX_SLIP_END 0xC0
+#define LIBREDXX_SLIP_ESC 0xDB
+#define LIBREDXX_SLIP_ESC_END 0xDC
+#define LIBREDXX_SLIP_ESC_ESC 0xDD
+
+// offset of the first byte that is a or b, size when there is none
+typedef size_t (*libredxx_framer_scan)(const uint8_t* data, size_t size, uint8_t a, uint8_t b);
+
+struct libredxx_framer {
+	libredxx_framer_config config;
+	libredxx_framer_scan scan;
+	size_t header_size; // sync word and length field
+	uint8_t* buffer; // a frame spread over several pushes, or a decoded one
+	size_t fill;
+	size_t payload_size; // of the buffered frame once its header is complete
+	bool discarding; // SLIP and COBS, the frame is too long or broken, wait for the delimiter
+	bool escaped; // SLIP, the last push ended on ESC
+	size_t cobs_remaining; // COBS, data bytes left in the current block
+	uint8_t cobs_code; // COBS, code of the current block, 0 before the first
+	libredxx_framer_stats stats;
+};
+
+static unsigned int libredxx_ctz32(uint32_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return (unsigned int)index;
+#else
+	return (unsigned int)__builtin_ctz(value);
+#endif
+}
+
+static size_t libredxx_framer_scan_scalar(const uint8_t* data, size_t size, uint8_t a, uint8_t b)
+{
+	for (size_t i = 0; i < size; ++i) {
+		if (data[i] == a || data[i] == b) {
+			return i;
+		}
+	}
+	return size;
+}
+
+#ifdef LIBREDXX_FRAMER_SSE2
+static size_t libredxx_framer_scan_sse2(const uint8_t* data, size_t size, uint8_t a, uint8_t b)
+{
+	const __m128i va = _mm_set1_epi8((char)a);
+	const __m128i vb = _mm_set1_epi8((char)b);
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i*)&data[i]);
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+		if (mask) {
+			return i + libredxx_ctz32(mask);
+		}
+	}
+	return i + libredxx_framer_scan_scalar(&data[i], size - i, a, b);
+}
+#endif
+
+#ifdef LIBREDXX_FRAMER_AVX2
+__attribute__((target("avx2"))) static size_t libredxx_framer_scan_avx2(const uint8_t* data, size_t size, uint8_t a, uint8_t b)
+{
+	const __m256i va = _mm256_set1_epi8((char)a);
+	const __m256i vb = _mm256_set1_epi8((char)b);
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32) {
+		const __m256i v = _mm256_loadu_si256((const __m256i*)&data[i]);
+		const uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+		if (mask) {
+			return i + libredxx_ctz32(mask);
+		}
+	}
+	return i + libredxx_framer_scan_scalar(&data[i], size - i, a, b);
+}
+#endif
+
+#ifdef LIBREDXX_FRAMER_NEON
+static unsigned int libredxx_ctz64(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (unsigned int)index;
+#else
+	return (unsigned int)__builtin_ctzll(value);
+#endif
+}
+
+static size_t libredxx_framer_scan_neon(const uint8_t* data, size_t size, uint8_t a, uint8_t b)
+{
+	const uint8x16_t va = vdupq_n_u8(a);
+	const uint8x16_t vb = vdupq_n_u8(b);
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		const uint8x16_t v = vld1q_u8(&data[i]);
+		const uint8x16_t match = vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb));
+		// narrows every byte of the match to a nibble, so the first set nibble gives the offset
+		const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+		if (mask) {
+			return i + libredxx_ctz64(mask) / 4;
+		}
+	}
+	return i + libredxx_framer_scan_scalar(&data[i], size - i, a, b);
+}
+#endif
+
+static libredxx_framer_scan libredxx_framer_pick_scan(uint32_t flags)
+{
+	if (flags & LIBREDXX_FRAMER_SCALAR) {
+		return libredxx_framer_scan_scalar;
+	}
+#ifdef LIBREDXX_FRAMER_AVX2
+	if (__builtin_cpu_supports("avx2")) {
+		return libredxx_framer_scan_avx2;
+	}
+#endif
+#if defined(LIBREDXX_FRAMER_SSE2)
+	return libredxx_framer_scan_sse2;
+#elif defined(LIBREDXX_FRAMER_NEON)
+	return libredxx_framer_scan_neon;
+#else
+	return libredxx_framer_scan_scalar;
+#endif
+}
+
+static void libredxx_framer_emit(libredxx_framer* framer, const uint8_t* frame, size_t size)
+{
+	++framer->stats.frames;
+	framer->stats.frame_bytes += size;
+	framer->config.callback(framer->config.context, frame, size);
+}
+
+// sync word and length prefix
+
+static size_t libredxx_framer_payload_size(const libredxx_framer* framer, const uint8_t* header)
+{
+	if (framer->config.type == LIBREDXX_FRAMER_SYNC_WORD) {
+		return framer->config.frame_size;
+	}
+	const uint8_t* length = &header[framer->config.sync_size];
+	size_t payload = 0;
+	for (size_t i = 0; i < framer->config.length_size; ++i) {
+		const size_t byte = framer->config.big_endian ? i : framer->config.length_size - 1 - i;
+		payload = payload << 8 | length[byte];
+	}
+	return payload;
+}
+
+// checks a complete header, false when it is no frame start and a byte has to go
+static bool libredxx_framer_check_header(libredxx_framer* framer, const uint8_t* header, size_t* payload_size)
+{
+	if (memcmp(header, framer->config.sync, framer->config.sync_size) != 0) {
+		return false;
+	}
+	*payload_size = libredxx_framer_payload_size(framer, header);
+	if (*payload_size > framer->config.max_frame_size) {
+		++framer->stats.errors;
+		return false;
+	}
+	return true;
+}
+
+// drops the first buffered byte and moves the next possible sync word to the front
+static void libredxx_framer_resync_buffer(libredxx_framer* framer)
+{
+	size_t next = 1;
+	if (framer->config.sync_size) {
+		next += framer->scan(&framer->buffer[1], framer->fill - 1, framer->config.sync[0], framer->config.sync[0]);
+	}
+	framer->stats.dropped_bytes += next;
+	memmove(framer->buffer, &framer->buffer[next], framer->fill - next);
+	framer->fill -= next;
+}
+
+static void libredxx_framer_push_header(libredxx_framer* framer, const uint8_t* data, size_t size)
+{
+	const size_t header_size = framer->header_size;
+	while (size) {
+		if (!framer->fill) {
+			if (framer->config.sync_size && *data != framer->config.sync[0]) {
+				// in sync the next frame starts right here, only scan after garbage
+				const size_t skip = framer->scan(data, size, framer->config.sync[0], framer->config.sync[0]);
+				framer->stats.dropped_bytes += skip;
+				data += skip;
+				size -= skip;
+				if (!size) {
+					break;
+				}
+			}
+			if (size >= header_size) {
+				size_t payload_size;
+				if (!libredxx_framer_check_header(framer, data, &payload_size)) {
+					++framer->stats.dropped_bytes;
+					++data;
+					--size;
+					continue;
+				}
+				if (size - header_size >= payload_size) {
+					// the whole frame is in this push, no copy
+					libredxx_framer_emit(framer, &data[header_size], payload_size);
+					data += header_size + payload_size;
+					size -= header_size + payload_size;
+					continue;
+				}
+			}
+		}
+		const size_t wanted = framer->fill < header_size ? header_size : header_size + framer->payload_size;
+		const size_t copy = wanted - framer->fill < size ? wanted - framer->fill : size;
+		memcpy(&framer->buffer[framer->fill], data, copy);
+		framer->fill += copy;
+		data += copy;
+		size -= copy;
+		if (framer->fill == header_size && wanted == header_size) {
+			if (!libredxx_framer_check_header(framer, framer->buffer, &framer->payload_size)) {
+				libredxx_framer_resync_buffer(framer);
+				continue;
+			}
+		}
+		if (framer->fill >= header_size && framer->fill == header_size + framer->payload_size) {
+			libredxx_framer_emit(framer, &framer->buffer[header_size], framer->payload_size);
+			framer->fill = 0;
+		}
+	}
+}
+
+// SLIP
+
+static void libredxx_framer_slip_append(libredxx_framer* framer, const uint8_t* data, size_t size)
+{
+	if (framer->discarding) {
+		return;
+	}
+	if (size > framer->config.max_frame_size - framer->fill) {
+		++framer->stats.errors;
+		framer->discarding = true;
+		return;
+	}
+	memcpy(&framer->buffer[framer->fill], data, size);
+	framer->fill += size;
+}
+
+static void libredxx_framer_slip_end(libredxx_framer* framer)
+{
+	if (framer->discarding) {
+		framer->stats.dropped_bytes += framer->fill;
+	} else if (framer->fill) {
+		// back to back ENDs are allowed and make no frame
+		libredxx_framer_emit(framer, framer->buffer, framer->fill);
+	}
+	framer->fill = 0;
+	framer->discarding = false;
+}
+
+static void libredxx_framer_slip_escaped(libredxx_framer* framer, uint8_t byte)
+{
+	if (byte == LIBREDXX_SLIP_ESC_END || byte == LIBREDXX_SLIP_ESC_ESC) {
+		const uint8_t decoded = byte == LIBREDXX_SLIP_ESC_END ? LIBREDXX_SLIP_END : LIBREDXX_SLIP_ESC;
+		libredxx_framer_slip_append(framer, &decoded, 1);
+	} else if (!framer->discarding) {
+		++framer->stats.errors;
+		framer->discarding = true;
+	}
+}
+
+static void libredxx_framer_push_slip(libredxx_framer* framer, const uint8_t* data, size_t size)
+{
+	if (size && framer->escaped) {
+		framer->escaped = false;
+		if (*data == LIBREDXX_SLIP_END) {
+			// an aborted frame
+			++framer->stats.errors;
+			framer->discarding = true;
+		} else {
+			libredxx_framer_slip_escaped(framer, *data);
+			++data;
+			--size;
+		}
+	}
+	while (size) {
+		const size_t run = framer->scan(data, size, LIBREDXX_SLIP_END, LIBREDXX_SLIP_ESC);
+		libredxx_framer_slip_append(framer, data, run);
+		data += run;
+		size -= run;
+		if (!size) {
+			break;
+		}
+		if (*data == LIBREDXX_SLIP_END) {
+			libredxx_framer_slip_end(framer);
+			++data;
+			--size;
+		} else if (size == 1) {
+			framer->escaped = true;
+			break;
+		} else if (data[1] == LIBREDXX_SLIP_END) {
+			++framer->stats.errors;
+			framer->discarding = true;
+			++data;
+			--size;
+		} else {
+			libredxx_framer_slip_escaped(framer, data[1]);
+			data += 2;
+			size -= 2;
+		}
+	}
+}
+
+// COBS
+
+static void libredxx_framer_cobs_append(libredxx_framer* framer, const uint8_t* data, size_t size)
+{
+	if (framer->discarding) {
+		return;
+	}
+	if (size > framer->config.max_frame_size - framer->fill) {
+		++framer->stats.errors;
+		framer->discarding = true;
+		return;
+	}
+	memcpy(&framer->buffer[framer->fill], data, size);
+	framer->fill += size;
+}
+
+static void libredxx_framer_cobs_end(libredxx_framer* framer)
+{
+	if (framer->cobs_remaining && !framer->discarding) {
+		// a block cut short by the delimiter
+		++framer->stats.errors;
+		framer->discarding = true;
+	}
+	if (framer->discarding) {
+		framer->stats.dropped_bytes += framer->fill;
+	} else if (framer->cobs_code) {
+		libredxx_framer_emit(framer, framer->buffer, framer->fill);
+	}
+	framer->fill = 0;
+	framer->discarding = false;
+	framer->cobs_remaining = 0;
+	framer->cobs_code = 0;
+}
+
+static void libredxx_framer_push_cobs(libredxx_framer* framer, const uint8_t* data, size_t size)
+{
+	static const uint8_t zero = 0;
+	while (size) {
+		if (!framer->cobs_remaining) {
+			const uint8_t code = *data;
+			++data;
+			--size;
+			if (!code) {
+				libredxx_framer_cobs_end(framer);
+				continue;
+			}
+			if (framer->cobs_code && framer->cobs_code != 0xFF) {
+				// the zero the previous block stood for, the last block's one is not part of the frame
+				libredxx_framer_cobs_append(framer, &zero, 1);
+			}
+			framer->cobs_code = code;
+			framer->cobs_remaining = code - 1u;
+			continue;
+		}
+		const size_t block = framer->cobs_remaining < size ? framer->cobs_remaining : size;
+		const size_t run = framer->scan(data, block, 0, 0);
+		libredxx_framer_cobs_append(framer, data, run);
+		framer->cobs_remaining -= run;
+		data += run;
+		size -= run;
+		if (run < block) {
+			// the delimiter, handled as a code byte
+			libredxx_framer_cobs_end(framer);
+			++data;
+			--size;
+		}
+	}
+}
+
+libredxx_status libredxx_framer_create(const libredxx_framer_config* config, libredxx_framer** framer)
+{
+	if (!config || !framer || !config->callback || !config->max_frame_size || config->sync_size > sizeof(config->sync)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	size_t header_size = 0;
+	switch (config->type) {
+	case LIBREDXX_FRAMER_SYNC_WORD:
+		if (!config->sync_size || !config->frame_size || config->frame_size > config->max_frame_size) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		header_size = config->sync_size;
+		break;
+	case LIBREDXX_FRAMER_LENGTH_PREFIX:
+		if (config->length_size != 1 && config->length_size != 2 && config->length_size != 4) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		header_size = config->sync_size + config->length_size;
+		break;
+	case LIBREDXX_FRAMER_SLIP:
+	case LIBREDXX_FRAMER_COBS:
+		break;
+	default:
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_framer* private_framer = calloc(1, sizeof(libredxx_framer));
+	if (!private_framer) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	private_framer->buffer = malloc(header_size + config->max_frame_size);
+	if (!private_framer->buffer) {
+		free(private_framer);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	private_framer->config = *config;
+	private_framer->header_size = header_size;
+	private_framer->scan = libredxx_framer_pick_scan(config->flags);
+	*framer = private_framer;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_framer_destroy(libredxx_framer* framer)
+{
+	if (!framer) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	free(framer->buffer);
+	free(framer);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_framer_push(libredxx_framer* framer, const void* data, size_t size)
+{
+	if (!framer || (!data && size)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	switch (framer->config.type) {
+	case LIBREDXX_FRAMER_SYNC_WORD:
+	case LIBREDXX_FRAMER_LENGTH_PREFIX:
+		libredxx_framer_push_header(framer, data, size);
+		break;
+	case LIBREDXX_FRAMER_SLIP:
+		libredxx_framer_push_slip(framer, data, size);
+		break;
+	case LIBREDXX_FRAMER_COBS:
+		libredxx_framer_push_cobs(framer, data, size);
+		break;
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_framer_reset(libredxx_framer* framer)
+{
+	if (!framer) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	framer->stats.dropped_bytes += framer->fill;
+	framer->fill = 0;
+	framer->payload_size = 0;
+	framer->discarding = false;
+	framer->escaped = false;
+	framer->cobs_remaining = 0;
+	framer->cobs_code = 0;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_framer_get_stats(const libredxx_framer* framer, libredxx_framer_stats* stats)
+{
+	if (!framer || !stats) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	*stats = framer->stats;
+	return LIBREDXX_STATUS_SUCCESS;
+}
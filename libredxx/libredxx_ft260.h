@@ -27,6 +27,9 @@
 
 #define LIBREDXX_FT260_REPORT_SIZE 64
 
+#define LIBREDXX_FT260_REPORT_SYSTEM_SETTING 0xA1 // feature report, the request byte picks the setting
+#define LIBREDXX_FT260_REQUEST_I2C_RESET 0x20
+
 /*
  * NOTE: not all reports are included. Consult the FT260 user guide.
  */
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "libredxx_heap.h"
+
+#include <stdlib.h>
+
+static bool libredxx_heap_less(const libredxx_heap_entry* a, const libredxx_heap_entry* b)
+{
+	return a->key < b->key || (a->key == b->key && a->index < b->index);
+}
+
+libredxx_status libredxx_heap_init(libredxx_heap* heap, size_t capacity)
+{
+	if (!capacity) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	heap->entries = calloc(capacity, sizeof(libredxx_heap_entry));
+	if (!heap->entries) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	heap->count = 0;
+	heap->capacity = capacity;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+void libredxx_heap_destroy(libredxx_heap* heap)
+{
+	free(heap->entries);
+	heap->entries = NULL;
+	heap->count = 0;
+	heap->capacity = 0;
+}
+
+bool libredxx_heap_push(libredxx_heap* heap, uint64_t key, size_t index)
+{
+	if (heap->count == heap->capacity) {
+		return false;
+	}
+	const libredxx_heap_entry entry = {key, index};
+	size_t child = heap->count++;
+	while (child > 0) {
+		const size_t parent = (child - 1) / 2;
+		if (!libredxx_heap_less(&entry, &heap->entries[parent])) {
+			break;
+		}
+		heap->entries[child] = heap->entries[parent];
+		child = parent;
+	}
+	heap->entries[child] = entry;
+	return true;
+}
+
+bool libredxx_heap_peek(const libredxx_heap* heap, libredxx_heap_entry* entry)
+{
+	if (!heap->count) {
+		return false;
+	}
+	*entry = heap->entries[0];
+	return true;
+}
+
+bool libredxx_heap_pop(libredxx_heap* heap, libredxx_heap_entry* entry)
+{
+	if (!heap->count) {
+		return false;
+	}
+	*entry = heap->entries[0];
+	const libredxx_heap_entry last = heap->entries[--heap->count];
+	size_t parent = 0;
+	while (true) {
+		size_t child = parent * 2 + 1;
+		if (child >= heap->count) {
+			break;
+		}
+		if (child + 1 < heap->count && libredxx_heap_less(&heap->entries[child + 1], &heap->entries[child])) {
+			++child;
+		}
+		if (!libredxx_heap_less(&heap->entries[child], &last)) {
+			break;
+		}
+		heap->entries[parent] = heap->entries[child];
+		parent = child;
+	}
+	if (heap->count) {
+		heap->entries[parent] = last;
+	}
+	return true;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LIBREDXX_LIBREDXX_HEAP_H
+#define LIBREDXX_LIBREDXX_HEAP_H
+
+#include "libredxx.h"
+
+/*
+ * Binary min-heap of (key, index) pairs with a fixed capacity, so a k-way merge
+ * allocates once up front. Equal keys come out by index.
+ */
+struct libredxx_heap_entry {
+	uint64_t key;
+	size_t index;
+};
+typedef struct libredxx_heap_entry libredxx_heap_entry;
+
+struct libredxx_heap {
+	libredxx_heap_entry* entries;
+	size_t count;
+	size_t capacity;
+};
+typedef struct libredxx_heap libredxx_heap;
+
+libredxx_status libredxx_heap_init(libredxx_heap* heap, size_t capacity);
+void libredxx_heap_destroy(libredxx_heap* heap);
+// false when full
+bool libredxx_heap_push(libredxx_heap* heap, uint64_t key, size_t index);
+// false when empty
+bool libredxx_heap_peek(const libredxx_heap* heap, libredxx_heap_entry* entry);
+bool libredxx_heap_pop(libredxx_heap* heap, libredxx_heap_entry* entry);
+
+#endif // LIBREDXX_LIBREDXX_HEAP_H
@@ -22,6 +22,17 @@
 
 #include "libredxx.h"
 #include "libredxx_ft260.h"
+#include "libredxx_d2xx.h"
+#include "libredxx_heap.h"
+#include "libredxx_pool.h"
+#include "libredxx_pcap.h"
+#include "libredxx_replay.h"
+#include "libredxx_ring.h"
+#include "libredxx_stats.h"
+#include "libredxx_thread.h"
+#include "libredxx_time.h"
+#include "libredxx_trace.h"
+#include "libredxx_usbfs.h"
 
 #include <dirent.h>
 #include <sys/types.h>
@@ -37,30 +48,109 @@
 #include <linux/hid.h>
 #include <linux/hiddev.h>
 #include <errno.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <limits.h>
 
 #define USBFS_PATH "/dev/bus/usb"
 #define SYSFS_DEVICES_PATH "/sys/bus/usb/devices"
 #define D2XX_HEADER_SIZE 2
+// whole packets a blocking D2XX read asks for at most
+#define LIBREDXX_D2XX_RX_SIZE 4096
 
 #define LIBREDXX_FT260_ENDPOINT_IN  0x81
 #define LIBREDXX_FT260_ENDPOINT_OUT 0x02
 #define LIBREDXX_FT260_INTERFACE    0
 
+#define LIBREDXX_D3XX_CHANNEL_COUNT 4
+// D2XX interfaces, D3XX channels or the FT260 interrupt pipe, each with an endpoint per direction
+#define LIBREDXX_ENDPOINT_SLOT_COUNT 4
+// a wakeup per read endpoint, one for asynchronous transfers, then one per write endpoint
+#define LIBREDXX_ASYNC_WAKEUP LIBREDXX_D3XX_CHANNEL_COUNT
+#define LIBREDXX_WRITE_WAKEUP (LIBREDXX_D3XX_CHANNEL_COUNT + 1)
+#define LIBREDXX_WAKEUP_COUNT (LIBREDXX_D3XX_CHANNEL_COUNT * 2 + 1)
+
+// transfers larger than this many packets are split
+#define LIBREDXX_URB_PACKETS 1024
+#define LIBREDXX_URB_COUNT 4
+
+// D2XX requests or FT260 feature reports kept to apply again after reconnecting
+#define LIBREDXX_SETTING_COUNT 16
+#define LIBREDXX_RECONNECT_POLL_MS 100
+
 struct libredxx_found_device {
 	char path[512];
+	char location[256]; // sysfs name, the port path such as 1-4.2
 	libredxx_serial serial;
 	libredxx_device_id id;
 	libredxx_device_type type;
+	uint16_t release;
 	uint8_t interface_count;
+	uint8_t interface_index;
+	uint8_t endpoints_in[LIBREDXX_ENDPOINT_SLOT_COUNT]; // from the configuration descriptor
+	uint8_t endpoints_out[LIBREDXX_ENDPOINT_SLOT_COUNT];
+	uint16_t max_packets[LIBREDXX_ENDPOINT_SLOT_COUNT]; // wMaxPacketSize of the IN endpoints
+	libredxx_link_speed speed;
+	bool replay;
+	const libredxx_usbfs_ops* usbfs;
+};
+
+// usercontext of every submitted URB, whichever reader reaps it hands it to its owner through this
+struct libredxx_urb {
+	struct usbdevfs_urb urb;
+	unsigned int endpoint; // wakeup signalled once reaped, the read endpoint or LIBREDXX_ASYNC_WAKEUP
+	struct libredxx_urb* trigger; // D3XX request the data depends on, the read fails with it
+	uint64_t reaped_ns; // published by reaped
+	atomic_bool reaped;
+};
+
+struct libredxx_d3xx_channel {
+	struct libredxx_urb trigger;
+	uint8_t trigger_data[20];
+	bool trigger_pending; // submitted and not waited for by the channel's reader yet
+	bool trigger_ahead; // already requested the data of the next read
+	size_t stream_size;
 };
 
 struct libredxx_opened_device {
 	libredxx_found_device found;
-	int handle;
-	int pipes[2];
-	uint8_t* d2xx_rx_buffer;
+	const libredxx_usbfs_ops* usbfs;
+	atomic_int handle; // replaced when reconnecting
+	int wakeups[LIBREDXX_WAKEUP_COUNT]; // eventfds, written on interrupt and when another thread reaps a URB
+	size_t max_packet;
+	libredxx_buffer_pool d2xx_rx_pool; // backs d2xx_rx_buffer, so reads stage through mapped, faulted in memory
+	uint8_t* d2xx_rx_buffer; // payload of whole packets, headers stripped
 	size_t d2xx_rx_buffer_size;
-	bool read_interrupted;
+	size_t d2xx_rx_offset; // read up to here
+	size_t d2xx_rx_fill;
+	struct libredxx_d3xx_channel d3xx_channels[LIBREDXX_D3XX_CHANNEL_COUNT];
+	libredxx_buffer_pool pool;
+	libredxx_stats_counters stats;
+	libredxx_pcap_address pcap_address;
+	uint32_t record_session;
+	libredxx_replay_session* replay;
+	atomic_bool read_interrupted[LIBREDXX_D3XX_CHANNEL_COUNT];
+	size_t urb_size;
+	size_t urb_count;
+	struct libredxx_urb* split_urbs; // urb_count per wakeup endpoint, for transfers larger than urb_size
+	uint32_t stall_retries;
+	libredxx_mutex transfers_mutex;
+	struct libredxx_transfer_private* transfers; // submitted and not completed yet, oldest first
+	struct libredxx_transfer_private* transfers_tail;
+	libredxx_rwlock io_lock; // shared by reads, writes and submits, exclusive while the handle is replaced
+	libredxx_mutex session_mutex; // settings and reconnecting, taken after io_lock
+	libredxx_cond session_cond; // signalled on interrupt
+	bool reconnect_enabled;
+	bool reconnecting; // one thread waits for the device, the others fail right away
+	atomic_uint interrupts; // so far, a wait for the device ends on one made since its read or write started
+	libredxx_reconnect_config reconnect;
+	atomic_uint generation; // reconnects so far
+	int* stale_handles; // of the devices that went away, closed with the device so no thread can use a reused fd
+	size_t stale_handles_count;
+	libredxx_d2xx_request d2xx_settings[LIBREDXX_SETTING_COUNT]; // the last request of each kind
+	size_t d2xx_settings_count;
+	uint8_t ft260_settings[LIBREDXX_SETTING_COUNT][LIBREDXX_FT260_REPORT_SIZE];
+	size_t ft260_settings_count;
 };
 
 #pragma pack(push, 1)
@@ -82,6 +172,32 @@ struct usb_descriptor {
 };
 #pragma pack(pop)
 
+static int libredxx_system_open(const char* path, int flags)
+{
+	return open(path, flags);
+}
+
+static int libredxx_system_ioctl(int fd, unsigned long request, void* arg)
+{
+	return ioctl(fd, request, arg);
+}
+
+static const libredxx_usbfs_ops libredxx_usbfs_system = {
+	.usbfs_path = USBFS_PATH,
+	.sysfs_path = SYSFS_DEVICES_PATH,
+	.open = libredxx_system_open,
+	.close = close,
+	.ioctl = libredxx_system_ioctl,
+	.poll = poll,
+};
+
+static _Atomic(const libredxx_usbfs_ops*) libredxx_usbfs = &libredxx_usbfs_system;
+
+void libredxx_usbfs_set_ops(const libredxx_usbfs_ops* ops)
+{
+	atomic_store_explicit(&libredxx_usbfs, ops ? ops : &libredxx_usbfs_system, memory_order_release);
+}
+
 static ssize_t libredxx_read_text_file(const char* path, void* buffer, size_t buffer_size)
 {
 	const int fd = open(path, O_RDONLY);
@@ -107,12 +223,137 @@ static const libredxx_find_filter* libredxx_match_filter(uint16_t vid, uint16_t
 	return NULL;
 }
 
-libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_t filters_count, libredxx_found_device*** devices, size_t* devices_count)
+// the endpoint slot a device's transfers use, per D2XX interface, per D3XX channel or FT260's one
+static unsigned int libredxx_endpoint_slot(const libredxx_found_device* found, unsigned int interface_number, unsigned int* channels)
+{
+	if (found->type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		return interface_number;
+	}
+	if (found->type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		// interface 0 carries the session endpoints, the channels follow in order on the next one
+		return interface_number ? (*channels)++ : LIBREDXX_ENDPOINT_SLOT_COUNT;
+	}
+	return 0;
+}
+
+// endpoints and packet sizes from the device descriptor and active configuration that sysfs has
+static void libredxx_parse_descriptors(libredxx_found_device* found, const uint8_t* data, size_t size)
+{
+	const uint8_t transfer_type = found->type == LIBREDXX_DEVICE_TYPE_FT260 ? USB_ENDPOINT_XFER_INT : USB_ENDPOINT_XFER_BULK;
+	unsigned int interface_number = 0;
+	unsigned int alternate_setting = 0;
+	unsigned int channels_in = 0;
+	unsigned int channels_out = 0;
+	unsigned int configurations = 0;
+	for (size_t offset = 0; offset + 2 <= size && data[offset] >= 2 && offset + data[offset] <= size; offset += data[offset]) {
+		const uint8_t* descriptor = &data[offset];
+		if (descriptor[1] == USB_DT_CONFIG && ++configurations > 1) {
+			break; // only the first configuration is used
+		}
+		if (descriptor[1] == USB_DT_INTERFACE && descriptor[0] >= USB_DT_INTERFACE_SIZE) {
+			interface_number = descriptor[2];
+			alternate_setting = descriptor[3];
+			continue;
+		}
+		if (descriptor[1] != USB_DT_ENDPOINT || descriptor[0] < USB_DT_ENDPOINT_SIZE || alternate_setting != 0 || (descriptor[3] & USB_ENDPOINT_XFERTYPE_MASK) != transfer_type) {
+			continue;
+		}
+		const uint8_t address = descriptor[2];
+		const bool in = address & USB_DIR_IN;
+		const unsigned int slot = libredxx_endpoint_slot(found, interface_number, in ? &channels_in : &channels_out);
+		if (slot >= LIBREDXX_ENDPOINT_SLOT_COUNT) {
+			continue;
+		}
+		if (in && !found->endpoints_in[slot]) {
+			found->endpoints_in[slot] = address;
+			found->max_packets[slot] = (uint16_t)((descriptor[4] | descriptor[5] << 8) & USB_ENDPOINT_MAXP_MASK);
+		} else if (!in && !found->endpoints_out[slot]) {
+			found->endpoints_out[slot] = address;
+		}
+	}
+	// what the chips have always used, for when sysfs leaves something out
+	for (unsigned int slot = 0; slot < LIBREDXX_ENDPOINT_SLOT_COUNT; ++slot) {
+		if (found->type == LIBREDXX_DEVICE_TYPE_D2XX) {
+			found->endpoints_in[slot] = found->endpoints_in[slot] ? found->endpoints_in[slot] : (uint8_t)(0x81 + slot * 2);
+			found->endpoints_out[slot] = found->endpoints_out[slot] ? found->endpoints_out[slot] : (uint8_t)(0x02 + slot * 2);
+		} else if (found->type == LIBREDXX_DEVICE_TYPE_D3XX) {
+			found->endpoints_in[slot] = found->endpoints_in[slot] ? found->endpoints_in[slot] : (uint8_t)(0x82 + slot);
+			found->endpoints_out[slot] = found->endpoints_out[slot] ? found->endpoints_out[slot] : (uint8_t)(0x02 + slot);
+		} else {
+			found->endpoints_in[slot] = found->endpoints_in[slot] ? found->endpoints_in[slot] : LIBREDXX_FT260_ENDPOINT_IN;
+			found->endpoints_out[slot] = found->endpoints_out[slot] ? found->endpoints_out[slot] : LIBREDXX_FT260_ENDPOINT_OUT;
+		}
+		if (!found->max_packets[slot]) {
+			found->max_packets[slot] = found->type == LIBREDXX_DEVICE_TYPE_D3XX ? 1024 : found->type == LIBREDXX_DEVICE_TYPE_D2XX ? 512 : 64;
+		}
+	}
+}
+
+static libredxx_link_speed libredxx_parse_speed(const char* speed)
+{
+	// Mbit/s as sysfs writes them
+	static const struct {
+		const char* text;
+		libredxx_link_speed speed;
+	} speeds[] = {
+		{"1.5", LIBREDXX_LINK_SPEED_LOW},
+		{"12", LIBREDXX_LINK_SPEED_FULL},
+		{"480", LIBREDXX_LINK_SPEED_HIGH},
+		{"5000", LIBREDXX_LINK_SPEED_SUPER},
+		{"10000", LIBREDXX_LINK_SPEED_SUPER_PLUS},
+		{"20000", LIBREDXX_LINK_SPEED_SUPER_PLUS},
+	};
+	for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); ++i) {
+		if (strcmp(speed, speeds[i].text) == 0) {
+			return speeds[i].speed;
+		}
+	}
+	return LIBREDXX_LINK_SPEED_UNKNOWN;
+}
+
+static libredxx_status libredxx_find_replay_devices(const libredxx_find_filter* filters, size_t filters_count, libredxx_found_device*** devices, size_t* devices_count)
+{
+	libredxx_replay_device* replay_devices;
+	size_t replay_devices_count;
+	libredxx_status status = libredxx_replay_find(filters, filters_count, &replay_devices, &replay_devices_count);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	*devices = NULL;
+	*devices_count = 0;
+	if (replay_devices_count > 0) {
+		libredxx_found_device* private_devices = calloc(replay_devices_count, sizeof(libredxx_found_device));
+		*devices = malloc(sizeof(libredxx_found_device*) * replay_devices_count);
+		if (!private_devices || !*devices) {
+			free(private_devices);
+			free(*devices);
+			free(replay_devices);
+			*devices = NULL;
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		for (size_t i = 0; i < replay_devices_count; ++i) {
+			libredxx_found_device* private_device = &private_devices[i];
+			private_device->serial = replay_devices[i].serial;
+			private_device->id = replay_devices[i].id;
+			private_device->type = replay_devices[i].type;
+			private_device->interface_index = replay_devices[i].interface_index;
+			private_device->interface_count = (uint8_t)(replay_devices[i].interface_index + 1);
+			private_device->replay = true;
+			libredxx_parse_descriptors(private_device, NULL, 0);
+			(*devices)[i] = private_device;
+		}
+		*devices_count = replay_devices_count;
+	}
+	free(replay_devices);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static libredxx_status libredxx_find_usbfs_devices(const libredxx_usbfs_ops* usbfs, const libredxx_find_filter* filters, size_t filters_count, libredxx_found_device*** devices, size_t* devices_count)
 {
 	libredxx_status status = LIBREDXX_STATUS_SUCCESS;
 	size_t device_index = 0;
 	libredxx_found_device* private_devices = NULL;
-	DIR* devices_dir = opendir(SYSFS_DEVICES_PATH);
+	DIR* devices_dir = opendir(usbfs->sysfs_path);
 	if (devices_dir == NULL) {
 		return LIBREDXX_STATUS_ERROR_SYS;
 	}
@@ -122,27 +363,29 @@ libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_
 			continue;
 		}
 		char path[512];
-		snprintf(path, sizeof(path), SYSFS_DEVICES_PATH "/%s/descriptors", device_entry->d_name);
+		snprintf(path, sizeof(path), "%s/%s/descriptors", usbfs->sysfs_path, device_entry->d_name);
 		int fd;
 		fd = open(path, O_RDONLY);
 		if (fd == -1) {
 			continue;
 		}
-		struct usb_descriptor descriptors = {0};
-		if (read(fd, &descriptors, sizeof(descriptors)) != sizeof(descriptors)) {
-			close(fd);
+		uint8_t descriptors_data[4096];
+		const ssize_t descriptors_size = read(fd, descriptors_data, sizeof(descriptors_data));
+		close(fd);
+		struct usb_descriptor descriptors;
+		if (descriptors_size < (ssize_t)sizeof(descriptors)) {
 			continue;
 		}
-		close(fd);
+		memcpy(&descriptors, descriptors_data, sizeof(descriptors));
 		const libredxx_find_filter* filter = libredxx_match_filter(descriptors.idVendor, descriptors.idProduct, filters, filters_count);
 		if (filter) {
-			snprintf(path, sizeof(path), SYSFS_DEVICES_PATH "/%s/busnum", device_entry->d_name);
+			snprintf(path, sizeof(path), "%s/%s/busnum", usbfs->sysfs_path, device_entry->d_name);
 			char busnum[4];
 			if (libredxx_read_text_file(path, busnum, sizeof(busnum)) == -1) {
 				continue; // this is a warning, the filter matched but we couldn't find the usbfs location
 			}
 
-			snprintf(path, sizeof(path), SYSFS_DEVICES_PATH "/%s/devnum", device_entry->d_name);
+			snprintf(path, sizeof(path), "%s/%s/devnum", usbfs->sysfs_path, device_entry->d_name);
 			char devnum[4];
 			if (libredxx_read_text_file(path, devnum, sizeof(devnum)) == -1) {
 				continue; // this is a warning, the filter matched but we couldn't find the usbfs location
@@ -152,19 +395,42 @@ libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_
 			libredxx_found_device* private_device = &private_devices[device_index++];
 			memset(private_device, 0, sizeof(libredxx_found_device));
 
-			snprintf(private_device->path, sizeof(private_device->path), USBFS_PATH "/%03d/%03d", atoi(busnum), atoi(devnum));
+			snprintf(private_device->path, sizeof(private_device->path), "%s/%03d/%03d", usbfs->usbfs_path, atoi(busnum), atoi(devnum));
+			snprintf(private_device->location, sizeof(private_device->location), "%s", device_entry->d_name);
 
 			private_device->id = filter->id;
 			private_device->type = filter->type;
+			private_device->release = descriptors.bcdDevice;
+			private_device->usbfs = usbfs;
 
-			snprintf(path, sizeof(path), SYSFS_DEVICES_PATH "/%s/serial", device_entry->d_name);
+			snprintf(path, sizeof(path), "%s/%s/serial", usbfs->sysfs_path, device_entry->d_name);
 			libredxx_read_text_file(path, private_device->serial.serial, sizeof(private_device->serial.serial));
 
-			snprintf(path, sizeof(path), SYSFS_DEVICES_PATH "/%s/bNumInterfaces", device_entry->d_name);
+			snprintf(path, sizeof(path), "%s/%s/bNumInterfaces", usbfs->sysfs_path, device_entry->d_name);
 			char interface_count[4] = {0};
 			if (libredxx_read_text_file(path, interface_count, sizeof(interface_count)) != -1) {
 				private_device->interface_count = atoi(interface_count);
 			}
+
+			snprintf(path, sizeof(path), "%s/%s/speed", usbfs->sysfs_path, device_entry->d_name);
+			char speed[8] = {0};
+			if (libredxx_read_text_file(path, speed, sizeof(speed)) != -1) {
+				private_device->speed = libredxx_parse_speed(speed);
+			}
+			libredxx_parse_descriptors(private_device, descriptors_data, (size_t)descriptors_size);
+
+			// every channel of a multi-channel D2XX device is its own interface, and found separately
+			if (private_device->type == LIBREDXX_DEVICE_TYPE_D2XX && private_device->interface_count > 1) {
+				// grow once for every channel, private_device is stale after the realloc
+				const uint8_t channel_count = private_device->interface_count;
+				const size_t first_index = device_index - 1;
+				private_devices = realloc(private_devices, sizeof(libredxx_found_device) * (device_index + channel_count - 1));
+				for (uint8_t interface_index = 1; interface_index < channel_count; ++interface_index) {
+					private_devices[device_index] = private_devices[first_index];
+					private_devices[device_index].interface_index = interface_index;
+					++device_index;
+				}
+			}
 		}
 	}
 	closedir(devices_dir);
@@ -179,6 +445,19 @@ libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_
 	return status;
 }
 
+libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_t filters_count, libredxx_found_device*** devices, size_t* devices_count)
+{
+	if (libredxx_replay_enabled()) {
+		return libredxx_find_replay_devices(filters, filters_count, devices, devices_count);
+	}
+	const libredxx_usbfs_ops* usbfs = atomic_load_explicit(&libredxx_usbfs, memory_order_acquire);
+	libredxx_status status = libredxx_find_usbfs_devices(usbfs, filters, filters_count, devices, devices_count);
+	if (status == LIBREDXX_STATUS_SUCCESS) {
+		libredxx_record_find(*devices, *devices_count);
+	}
+	return status;
+}
+
 libredxx_status libredxx_free_found(libredxx_found_device** devices)
 {
 	free(devices[0]);
@@ -204,192 +483,847 @@ libredxx_status libredxx_get_device_type(const libredxx_found_device* found, lib
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
-libredxx_status libredxx_open_device(const libredxx_found_device* found, libredxx_opened_device** opened)
+libredxx_status libredxx_get_interface_index(const libredxx_found_device* found, uint8_t* interface_index)
 {
-	int handle = open(found->path, O_RDWR);
-	if (handle == -1) {
+	*interface_index = found->interface_index;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_get_link_speed(const libredxx_found_device* found, libredxx_link_speed* speed)
+{
+	*speed = found->speed;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_get_packet_size(const libredxx_found_device* found, size_t* packet_size)
+{
+	*packet_size = found->max_packets[found->type == LIBREDXX_DEVICE_TYPE_D2XX ? found->interface_index : 0];
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+// D2XX only claims the interface of its channel, leaving the other channels free to be opened
+static unsigned int libredxx_first_interface(const libredxx_found_device* found)
+{
+	return found->type == LIBREDXX_DEVICE_TYPE_D2XX ? found->interface_index : 0;
+}
+
+static unsigned int libredxx_end_interface(const libredxx_found_device* found)
+{
+	return found->type == LIBREDXX_DEVICE_TYPE_D2XX ? found->interface_index + 1u : found->interface_count;
+}
+
+// endpoints a read can block on, and so can be interrupted
+static unsigned int libredxx_read_endpoint_count(const libredxx_found_device* found)
+{
+	return found->type == LIBREDXX_DEVICE_TYPE_D3XX ? LIBREDXX_D3XX_CHANNEL_COUNT : 1;
+}
+
+static uint8_t libredxx_usb_endpoint(const libredxx_opened_device* device, libredxx_endpoint endpoint, bool in)
+{
+	const unsigned int slot = device->found.type == LIBREDXX_DEVICE_TYPE_D2XX ? device->found.interface_index : device->found.type == LIBREDXX_DEVICE_TYPE_D3XX ? (unsigned int)endpoint : 0;
+	return in ? device->found.endpoints_in[slot] : device->found.endpoints_out[slot];
+}
+
+static void libredxx_close_wakeups(libredxx_opened_device* device)
+{
+	for (unsigned int endpoint = 0; endpoint < LIBREDXX_WAKEUP_COUNT; ++endpoint) {
+		if (device->wakeups[endpoint] != -1) {
+			close(device->wakeups[endpoint]);
+			device->wakeups[endpoint] = -1;
+		}
+	}
+}
+
+// consumes an interrupt's wakeup, a stale one would wake the next read for nothing
+static void libredxx_reset_wakeup(libredxx_opened_device* device, libredxx_endpoint endpoint)
+{
+	uint64_t count;
+	while (read(device->wakeups[endpoint], &count, sizeof(count)) == -1 && errno == EINTR) {
+	}
+}
+
+static libredxx_status libredxx_open_replay_device(const libredxx_found_device* found, libredxx_opened_device** opened)
+{
+	libredxx_replay_device device = {0};
+	device.id = found->id;
+	device.type = found->type;
+	device.interface_index = found->interface_index;
+	device.serial = found->serial;
+	libredxx_opened_device* private_opened = calloc(1, sizeof(libredxx_opened_device));
+	if (!private_opened) {
 		return LIBREDXX_STATUS_ERROR_SYS;
 	}
-	for (unsigned int i = 0; i < found->interface_count; ++i) {
-		if (ioctl(handle, USBDEVFS_CLAIMINTERFACE, &i) == -1) {
-			close(handle);
-			return LIBREDXX_STATUS_ERROR_SYS;
+	private_opened->found = *found;
+	private_opened->handle = -1;
+	for (unsigned int endpoint = 0; endpoint < LIBREDXX_WAKEUP_COUNT; ++endpoint) {
+		private_opened->wakeups[endpoint] = -1;
+	}
+	private_opened->replay = libredxx_replay_open(&device);
+	if (!private_opened->replay) {
+		free(private_opened);
+		return LIBREDXX_STATUS_ERROR_IO; // no recorded session left for this device
+	}
+	libredxx_rwlock_init(&private_opened->io_lock);
+	*opened = private_opened;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+// opens the usbfs device and claims the interfaces found uses, -1 on failure
+static int libredxx_open_handle(const libredxx_found_device* found)
+{
+	const libredxx_usbfs_ops* usbfs = found->usbfs;
+	int handle = usbfs->open(found->path, O_RDWR);
+	if (handle == -1) {
+		return -1;
+	}
+	for (unsigned int i = libredxx_first_interface(found); i < libredxx_end_interface(found); ++i) {
+		if (usbfs->ioctl(handle, USBDEVFS_CLAIMINTERFACE, &i) == -1) {
+			usbfs->close(handle);
+			return -1;
 		}
 	}
+	return handle;
+}
+
+static void libredxx_set_pcap_address(libredxx_opened_device* device)
+{
+	unsigned int bus = 0;
+	unsigned int address = 0;
+	sscanf(device->found.path + strlen(device->usbfs->usbfs_path), "/%u/%u", &bus, &address);
+	device->pcap_address.bus = (uint16_t)bus;
+	device->pcap_address.device = (uint8_t)address;
+}
+
+libredxx_status libredxx_open_device(const libredxx_found_device* found, libredxx_opened_device** opened)
+{
+	if (found->replay) {
+		return libredxx_open_replay_device(found, opened);
+	}
+	const libredxx_usbfs_ops* usbfs = found->usbfs;
+	int handle = libredxx_open_handle(found);
+	if (handle == -1) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
 	libredxx_opened_device* private_opened = calloc(1, sizeof(libredxx_opened_device));
 	if (!private_opened) {
-		close(handle);
+		usbfs->close(handle);
 		return LIBREDXX_STATUS_ERROR_SYS;
 	}
 	private_opened->found = *found;
+	private_opened->usbfs = usbfs;
 	private_opened->handle = handle;
-	if (found->type == LIBREDXX_DEVICE_TYPE_D3XX || found->type == LIBREDXX_DEVICE_TYPE_FT260) {
-		if (pipe(private_opened->pipes) == -1) {
+	for (unsigned int endpoint = 0; endpoint < LIBREDXX_WAKEUP_COUNT; ++endpoint) {
+		private_opened->wakeups[endpoint] = -1;
+	}
+	libredxx_set_pcap_address(private_opened);
+	for (unsigned int endpoint = 0; endpoint < LIBREDXX_WAKEUP_COUNT; ++endpoint) {
+		const bool read = endpoint < libredxx_read_endpoint_count(found);
+		const bool write = endpoint >= LIBREDXX_WRITE_WAKEUP && endpoint - LIBREDXX_WRITE_WAKEUP < libredxx_read_endpoint_count(found);
+		if (!read && !write && endpoint != LIBREDXX_ASYNC_WAKEUP) {
+			continue;
+		}
+		private_opened->wakeups[endpoint] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (private_opened->wakeups[endpoint] == -1) {
+			libredxx_close_wakeups(private_opened);
+			free(private_opened);
+			usbfs->close(handle);
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+	}
+	size_t max_packet;
+	libredxx_get_packet_size(found, &max_packet);
+	private_opened->max_packet = max_packet;
+	if (found->type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		// as many whole packets as fit, every one starts with its own modem status
+		private_opened->d2xx_rx_buffer_size = max_packet < LIBREDXX_D2XX_RX_SIZE ? LIBREDXX_D2XX_RX_SIZE / max_packet * max_packet : max_packet;
+		if (libredxx_buffer_pool_init(&private_opened->d2xx_rx_pool, private_opened->d2xx_rx_buffer_size, 1, 0) != LIBREDXX_STATUS_SUCCESS) {
+			libredxx_close_wakeups(private_opened);
 			free(private_opened);
-			close(handle);
+			usbfs->close(handle);
 			return LIBREDXX_STATUS_ERROR_SYS;
 		}
-	} else if (found->type == LIBREDXX_DEVICE_TYPE_D2XX) {
-		// wMaxPacketSize
-		private_opened->d2xx_rx_buffer = malloc(512);
-		private_opened->d2xx_rx_buffer_size = 512;
+		libredxx_buffer_pool_get(&private_opened->d2xx_rx_pool, (void**)&private_opened->d2xx_rx_buffer);
 	}
+	private_opened->urb_size = max_packet * LIBREDXX_URB_PACKETS;
+	private_opened->urb_count = LIBREDXX_URB_COUNT;
+	private_opened->split_urbs = calloc(LIBREDXX_WAKEUP_COUNT * LIBREDXX_URB_COUNT, sizeof(struct libredxx_urb));
+	if (!private_opened->split_urbs) {
+		libredxx_buffer_pool_destroy(&private_opened->d2xx_rx_pool);
+		libredxx_close_wakeups(private_opened);
+		free(private_opened);
+		usbfs->close(handle);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	libredxx_mutex_init(&private_opened->transfers_mutex);
+	libredxx_rwlock_init(&private_opened->io_lock);
+	libredxx_mutex_init(&private_opened->session_mutex);
+	libredxx_cond_init(&private_opened->session_cond);
+	private_opened->record_session = libredxx_record_open(found);
 	*opened = private_opened;
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
 libredxx_status libredxx_close_device(libredxx_opened_device* device)
 {
+	libredxx_record_close(device->record_session);
+	if (device->replay) {
+		libredxx_replay_close(device->replay);
+		libredxx_rwlock_destroy(&device->io_lock);
+		free(device->split_urbs);
+		libredxx_buffer_pool_destroy(&device->pool);
+		free(device);
+		return LIBREDXX_STATUS_SUCCESS;
+	}
 	libredxx_interrupt(device);
-	if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX || device->found.type == LIBREDXX_DEVICE_TYPE_FT260) {
-		close(device->pipes[1]);
-		close(device->pipes[0]);
-	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
-		free(device->d2xx_rx_buffer);
+	libredxx_close_wakeups(device);
+	libredxx_mutex_destroy(&device->transfers_mutex);
+	libredxx_cond_destroy(&device->session_cond);
+	libredxx_mutex_destroy(&device->session_mutex);
+	libredxx_rwlock_destroy(&device->io_lock);
+	libredxx_buffer_pool_destroy(&device->d2xx_rx_pool);
+	for (unsigned int i = libredxx_first_interface(&device->found); i < libredxx_end_interface(&device->found); ++i) {
+		device->usbfs->ioctl(device->handle, USBDEVFS_RELEASEINTERFACE, &i);
 	}
-	for (unsigned int i = 0; i < device->found.interface_count; ++i) {
-		ioctl(device->handle, USBDEVFS_RELEASEINTERFACE, &i);
+	device->usbfs->close(device->handle);
+	for (size_t i = 0; i < device->stale_handles_count; ++i) {
+		device->usbfs->close(device->stale_handles[i]);
 	}
-	close(device->handle);
+	free(device->stale_handles);
+	free(device->split_urbs);
+	libredxx_buffer_pool_destroy(&device->pool);
 	free(device);
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
-libredxx_status libredxx_interrupt(libredxx_opened_device* device)
+libredxx_status libredxx_create_pool(libredxx_opened_device* device, size_t buffer_size, size_t buffer_count, uint32_t flags)
 {
-	device->read_interrupted = true;
-	if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX || device->found.type == LIBREDXX_DEVICE_TYPE_FT260) {
-		uint64_t one = 1;
-		if (write(device->pipes[1], &one, sizeof(one)) != sizeof(one)) {
-			return LIBREDXX_STATUS_ERROR_SYS;
-		}
-	} else if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+	return libredxx_buffer_pool_init(&device->pool, buffer_size, buffer_count, flags);
+}
+
+libredxx_status libredxx_get_buffer(libredxx_opened_device* device, void** buffer)
+{
+	return libredxx_buffer_pool_get(&device->pool, buffer);
+}
+
+libredxx_status libredxx_free_buffer(libredxx_opened_device* device, void* buffer)
+{
+	return libredxx_buffer_pool_free(&device->pool, buffer);
+}
+
+libredxx_status libredxx_get_stats(libredxx_opened_device* device, libredxx_stats* stats)
+{
+	libredxx_stats_snapshot(&device->stats, stats);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_reset_stats(libredxx_opened_device* device)
+{
+	libredxx_stats_reset(&device->stats);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static libredxx_status libredxx_interrupt_endpoints(libredxx_opened_device* device, unsigned int first, unsigned int end)
+{
+	libredxx_stats_interrupt(&device->stats);
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_INTERRUPT, device, (libredxx_endpoint)first, false, 0, LIBREDXX_STATUS_SUCCESS);
+	libredxx_record_interrupt(device->record_session);
+	if (device->replay) {
+		return libredxx_replay_interrupt(device->replay);
+	}
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX && device->found.type != LIBREDXX_DEVICE_TYPE_D3XX && device->found.type != LIBREDXX_DEVICE_TYPE_FT260) {
 		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
 	}
+	// ends a read or write waiting for the device to come back
+	libredxx_mutex_lock(&device->session_mutex);
+	atomic_fetch_add_explicit(&device->interrupts, 1, memory_order_relaxed);
+	libredxx_cond_broadcast(&device->session_cond);
+	libredxx_mutex_unlock(&device->session_mutex);
+	for (unsigned int endpoint = first; endpoint < end; ++endpoint) {
+		atomic_store_explicit(&device->read_interrupted[endpoint], true, memory_order_release);
+		if (device->wakeups[endpoint] != -1) {
+			uint64_t one = 1;
+			if (write(device->wakeups[endpoint], &one, sizeof(one)) != sizeof(one)) {
+				return LIBREDXX_STATUS_ERROR_SYS;
+			}
+		}
+	}
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
-static libredxx_status libredxx_d3xx_trigger_read(libredxx_opened_device* device, uint32_t size)
+libredxx_status libredxx_interrupt(libredxx_opened_device* device)
 {
-	uint8_t* size_bytes = (uint8_t*)&size;
-	uint8_t data[] = {0x00, 0x00, 0x00, 0x00, 0x82, 0x01, 0x00, 0x00, size_bytes[0], size_bytes[1], size_bytes[2], size_bytes[3], 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-	struct usbdevfs_bulktransfer bulk = {0};
-	bulk.ep = 0x01;
-	bulk.len = sizeof(data);
-	bulk.data = data;
-	return ioctl(device->handle, USBDEVFS_BULK, &bulk) == -1 ? LIBREDXX_STATUS_ERROR_SYS : LIBREDXX_STATUS_SUCCESS;
+	return libredxx_interrupt_endpoints(device, 0, libredxx_read_endpoint_count(&device->found));
 }
 
-static libredxx_status libredxx_read_urb_poll(libredxx_opened_device* device, uint8_t endpoint, void* buffer, size_t* buffer_size)
+libredxx_status libredxx_interrupt_endpoint(libredxx_opened_device* device, libredxx_endpoint endpoint)
 {
-	device->read_interrupted = false;
+	if ((unsigned int)endpoint >= libredxx_read_endpoint_count(&device->found)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return libredxx_interrupt_endpoints(device, endpoint, endpoint + 1u);
+}
 
-	struct usbdevfs_urb urb = {0};
-	urb.type = USBDEVFS_URB_TYPE_BULK;
-	urb.endpoint = endpoint;
-	urb.buffer = buffer;
-	urb.buffer_length = *buffer_size;
+// the FT260 endpoints are interrupt endpoints, usbfs just runs them as bulk
+static uint8_t libredxx_pcap_transfer_type(const libredxx_opened_device* device)
+{
+	return device->found.type == LIBREDXX_DEVICE_TYPE_FT260 ? LIBREDXX_PCAP_INTERRUPT : LIBREDXX_PCAP_BULK;
+}
 
-	if (ioctl(device->handle, USBDEVFS_SUBMITURB, &urb) != 0) {
-		return LIBREDXX_STATUS_ERROR_SYS;
+// usbfs transfers go through these so they can be captured
+static int libredxx_usbfs_bulk(libredxx_opened_device* device, struct usbdevfs_bulktransfer* bulk)
+{
+	const uint8_t transfer_type = libredxx_pcap_transfer_type(device);
+	const uint8_t endpoint = (uint8_t)bulk->ep;
+	libredxx_pcap_submit(&device->pcap_address, bulk, transfer_type, endpoint, NULL, bulk->data, bulk->len);
+	const int r = device->usbfs->ioctl(device->handle, USBDEVFS_BULK, bulk);
+	const int error = errno;
+	libredxx_pcap_complete(&device->pcap_address, bulk, transfer_type, endpoint, r == -1 ? -error : 0, bulk->data, r == -1 ? 0 : (size_t)r);
+	errno = error;
+	return r;
+}
+
+static int libredxx_usbfs_control(libredxx_opened_device* device, struct usbdevfs_ctrltransfer* ctrl)
+{
+	uint8_t setup[8];
+	libredxx_pcap_setup(setup, ctrl->bRequestType, ctrl->bRequest, ctrl->wValue, ctrl->wIndex, ctrl->wLength);
+	const uint8_t endpoint = ctrl->bRequestType & USB_DIR_IN;
+	libredxx_pcap_submit(&device->pcap_address, ctrl, LIBREDXX_PCAP_CONTROL, endpoint, setup, ctrl->data, ctrl->wLength);
+	const int r = device->usbfs->ioctl(device->handle, USBDEVFS_CONTROL, ctrl);
+	const int error = errno;
+	libredxx_pcap_complete(&device->pcap_address, ctrl, LIBREDXX_PCAP_CONTROL, endpoint, r == -1 ? -error : 0, ctrl->data, r == -1 ? 0 : (size_t)r);
+	errno = error;
+	return r;
+}
+
+static int libredxx_usbfs_submit_urb(libredxx_opened_device* device, struct usbdevfs_urb* urb)
+{
+	const uint8_t transfer_type = libredxx_pcap_transfer_type(device);
+	libredxx_pcap_submit(&device->pcap_address, urb, transfer_type, urb->endpoint, NULL, urb->buffer, (size_t)urb->buffer_length);
+	const int r = device->usbfs->ioctl(device->handle, USBDEVFS_SUBMITURB, urb);
+	if (r != 0) {
+		const int error = errno;
+		libredxx_pcap_complete(&device->pcap_address, urb, transfer_type, urb->endpoint, -error, NULL, 0);
+		errno = error;
 	}
-	struct pollfd fds[2] = {0};
-	fds[0].fd = device->handle;
-	fds[0].events = POLLOUT;
-	// for int
-	fds[1].fd = device->pipes[0];
-	fds[1].events = POLLIN;
-	if (poll(fds, 2, -1) < 0) {
+	return r;
+}
+
+// the status of a transfer that failed with error, an errno
+static libredxx_status libredxx_transfer_status(int error)
+{
+	switch (error) {
+	case 0:
+		return LIBREDXX_STATUS_SUCCESS;
+	case EPIPE:
+		return LIBREDXX_STATUS_ERROR_STALL;
+	case EOVERFLOW:
+		return LIBREDXX_STATUS_ERROR_BABBLE;
+	default:
 		return LIBREDXX_STATUS_ERROR_SYS;
 	}
-	if (device->read_interrupted) {
-		return LIBREDXX_STATUS_ERROR_INTERRUPTED;
+}
+
+/*
+ * A stall or babble leaves the pipe halted until it is cleared, which is done in place so
+ * the next transfer goes through without reopening the device. CLEAR_HALT clears the stall
+ * on the device and resets the data toggle on both sides. After babble the device may not
+ * have stalled at all and refuse it, resetting the host side is enough then. ERROR_SYS when
+ * the pipe can't be cleared, so the caller checks for a disconnect.
+ */
+static libredxx_status libredxx_recover_endpoint(libredxx_opened_device* device, uint8_t usb_endpoint, libredxx_status status)
+{
+	if (status != LIBREDXX_STATUS_ERROR_STALL && status != LIBREDXX_STATUS_ERROR_BABBLE) {
+		return status;
 	}
-	if (ioctl(device->handle, USBDEVFS_REAPURB, &urb) != 0) {
-		return LIBREDXX_STATUS_ERROR_SYS;
+	unsigned int pipe = usb_endpoint;
+	if (device->usbfs->ioctl(device->handle, USBDEVFS_CLEAR_HALT, &pipe) == 0) {
+		return status;
 	}
-	*buffer_size = urb.actual_length;
-	return LIBREDXX_STATUS_SUCCESS;
+	if (status == LIBREDXX_STATUS_ERROR_BABBLE && errno != ENODEV && device->usbfs->ioctl(device->handle, USBDEVFS_RESETEP, &pipe) == 0) {
+		return status;
+	}
+	return LIBREDXX_STATUS_ERROR_SYS;
 }
 
-libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+// reaps every URB that is ready and hands each to the read waiting for it, which may be a reader of another endpoint
+static libredxx_status libredxx_reap_ready(libredxx_opened_device* device, unsigned int self_endpoint)
 {
-	libredxx_status status;
-	if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
-		if (endpoint == LIBREDXX_ENDPOINT_A) {
-			status = libredxx_d3xx_trigger_read(device, *buffer_size);
-			if (status != LIBREDXX_STATUS_SUCCESS) {
-				return status;
+	while (true) {
+		struct usbdevfs_urb* reaped = NULL;
+		if (device->usbfs->ioctl(device->handle, USBDEVFS_REAPURBNDELAY, &reaped) != 0) {
+			return errno == EAGAIN ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+		}
+		libredxx_pcap_complete(&device->pcap_address, reaped, libredxx_pcap_transfer_type(device), reaped->endpoint, reaped->status, reaped->buffer, (size_t)reaped->actual_length);
+		struct libredxx_urb* owner = reaped->usercontext;
+		const unsigned int endpoint = owner->endpoint;
+		owner->reaped_ns = libredxx_time_ns();
+		atomic_store_explicit(&owner->reaped, true, memory_order_release);
+		if (endpoint != self_endpoint) {
+			const uint64_t one = 1;
+			if (write(device->wakeups[endpoint], &one, sizeof(one)) != sizeof(one)) {
+				// only fails when the counter is about to overflow, the reader is awake then anyway
 			}
-			return libredxx_read_urb_poll(device, 0x82, buffer, buffer_size);
-		} else {
-			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
 		}
-    } else if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
-    	if (endpoint == LIBREDXX_ENDPOINT_A) {
-    		struct usbdevfs_bulktransfer bulk = {0};
-    		bulk.ep = 0x81;
-    		bulk.len = device->d2xx_rx_buffer_size;
-    		bulk.data = device->d2xx_rx_buffer;
-    		device->read_interrupted = false;
-    		while (true) {
-    			int r = ioctl(device->handle, USBDEVFS_BULK, &bulk);
-    			if (r == -1) {
-    				return LIBREDXX_STATUS_ERROR_SYS;
-    			}
-    			if (r > D2XX_HEADER_SIZE) {
-    				*buffer_size = r - D2XX_HEADER_SIZE;
-    				memcpy(buffer, &device->d2xx_rx_buffer[2], *buffer_size);
-    				return LIBREDXX_STATUS_SUCCESS;
-    			}
-    			if (device->read_interrupted) {
-    				return LIBREDXX_STATUS_ERROR_INTERRUPTED;
-    			}
-    		}
-    	} else {
-    		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
-    	}
-    } else if (device->found.type == LIBREDXX_DEVICE_TYPE_FT260) {
-        if (endpoint == LIBREDXX_ENDPOINT_A) {
-            return libredxx_read_urb_poll(device, LIBREDXX_FT260_ENDPOINT_IN, buffer, buffer_size);
-        } else if (endpoint == LIBREDXX_ENDPOINT_B) {
-        	if (*buffer_size != LIBREDXX_FT260_REPORT_SIZE) {
-        		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
-        	}
-        	const uint8_t report_id = ((uint8_t*)buffer)[0];
-        	if (!report_id) {
-        		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
-        	}
-        	struct usbdevfs_ctrltransfer ctrl = {0};
-        	ctrl.bRequestType = USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE;
-        	ctrl.bRequest = HID_REQ_GET_REPORT;
-        	ctrl.wValue = (uint16_t)((HID_REPORT_TYPE_FEATURE << 8) | report_id);
-        	ctrl.wIndex = LIBREDXX_FT260_INTERFACE;
-        	ctrl.wLength = *buffer_size;
-        	ctrl.data = buffer;
-        	if (-1 == ioctl(device->handle, USBDEVFS_CONTROL, &ctrl)) {
-        		return LIBREDXX_STATUS_ERROR_SYS;
-        	}
-        	return LIBREDXX_STATUS_SUCCESS;
-        } else {
-            return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
-        }
-    } else {
-        return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
-    }
+	}
 }
 
-libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint) {
-	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX || device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
-		if (endpoint == LIBREDXX_ENDPOINT_A) {
-			struct usbdevfs_bulktransfer bulk = {0};
-			bulk.ep = 0x02;
-			bulk.len = *buffer_size;
-			bulk.data = buffer;
-			int r = ioctl(device->handle, USBDEVFS_BULK, &bulk);
-			return r == -1 ? LIBREDXX_STATUS_ERROR_SYS : LIBREDXX_STATUS_SUCCESS;
-		} else {
-			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+// urb's trigger when that failed and took the data with it, otherwise urb
+static const struct libredxx_urb* libredxx_failed_urb(const struct libredxx_urb* urb)
+{
+	if (urb->trigger && atomic_load_explicit(&urb->trigger->reaped, memory_order_acquire) && urb->trigger->urb.status != 0) {
+		return urb->trigger;
+	}
+	return urb;
+}
+
+static libredxx_status libredxx_wait_urb(libredxx_opened_device* device, struct libredxx_urb* urb, bool interruptible);
+
+// discards urb and waits until it is reaped, so it never outlives the read that owns it
+static libredxx_status libredxx_cancel_urb(libredxx_opened_device* device, struct libredxx_urb* urb)
+{
+	// fails when urb already completed, it is reaped all the same
+	device->usbfs->ioctl(device->handle, USBDEVFS_DISCARDURB, &urb->urb);
+	libredxx_wait_urb(device, urb, false);
+	// data that made it before the discard is not thrown away
+	return urb->urb.actual_length > 0 ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_INTERRUPTED;
+}
+
+/*
+ * Waits until urb is reaped, by this thread or by a reader of another endpoint. Readers
+ * only ever sleep on the usbfs handle and their own wakeup, so whoever reaps a URB
+ * signals its owner's wakeup. An interruptible wait ends on an interrupt of the URB's
+ * endpoint, cancelling it.
+ */
+static libredxx_status libredxx_wait_urb(libredxx_opened_device* device, struct libredxx_urb* urb, bool interruptible)
+{
+	const unsigned int endpoint = urb->endpoint;
+	bool discarded = false;
+	while (!atomic_load_explicit(&urb->reaped, memory_order_acquire)) {
+		if (interruptible && atomic_load_explicit(&device->read_interrupted[endpoint], memory_order_acquire)) {
+			return libredxx_cancel_urb(device, urb);
+		}
+		if (!discarded && urb->trigger && atomic_load_explicit(&urb->trigger->reaped, memory_order_acquire) && urb->trigger->urb.status != 0) {
+			// a failed trigger, the data it requested will never arrive
+			device->usbfs->ioctl(device->handle, USBDEVFS_DISCARDURB, &urb->urb);
+			discarded = true;
+		}
+		struct pollfd fds[2] = {0};
+		fds[0].fd = device->handle;
+		fds[0].events = POLLOUT;
+		fds[1].fd = device->wakeups[endpoint];
+		fds[1].events = POLLIN;
+		if (device->usbfs->poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (interruptible) {
+				libredxx_cancel_urb(device, urb);
+			}
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		if (fds[1].revents & POLLIN) {
+			libredxx_reset_wakeup(device, (libredxx_endpoint)endpoint);
+		}
+		if (fds[0].revents && libredxx_reap_ready(device, endpoint) != LIBREDXX_STATUS_SUCCESS) {
+			// gone, the kernel gave back every URB before failing so urb is reaped unless another reader has it
+			if (!atomic_load_explicit(&urb->reaped, memory_order_acquire)) {
+				return LIBREDXX_STATUS_ERROR_SYS;
+			}
+		}
+	}
+	return libredxx_transfer_status(-libredxx_failed_urb(urb)->urb.status);
+}
+
+// clears the pipe a stall or babble of urb halted
+static libredxx_status libredxx_recover_urb(libredxx_opened_device* device, const struct libredxx_urb* urb, libredxx_status status)
+{
+	return libredxx_recover_endpoint(device, libredxx_failed_urb(urb)->urb.endpoint, status);
+}
+
+static libredxx_status libredxx_submit_read_urb(libredxx_opened_device* device, struct libredxx_urb* urb)
+{
+	atomic_store_explicit(&urb->reaped, false, memory_order_relaxed);
+	urb->urb.usercontext = urb;
+	return libredxx_usbfs_submit_urb(device, &urb->urb) == 0 ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+}
+
+// asks the chip to send size bytes on the channel, data holds the request until the URB is reaped
+static libredxx_status libredxx_d3xx_submit_trigger(libredxx_opened_device* device, struct libredxx_urb* trigger, uint8_t data[20], uint8_t channel_index, uint32_t size, unsigned int wakeup)
+{
+	const uint8_t pipe = libredxx_usb_endpoint(device, (libredxx_endpoint)channel_index, true);
+	uint8_t* size_bytes = (uint8_t*)&size;
+	const uint8_t request[] = {0x00, 0x00, 0x00, 0x00, pipe, 0x01, 0x00, 0x00, size_bytes[0], size_bytes[1], size_bytes[2], size_bytes[3], 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+	memcpy(data, request, sizeof(request));
+	struct usbdevfs_urb* urb = &trigger->urb;
+	memset(urb, 0, sizeof(*urb));
+	urb->type = USBDEVFS_URB_TYPE_BULK;
+	urb->endpoint = 0x01;
+	urb->buffer = data;
+	urb->buffer_length = sizeof(request);
+	trigger->endpoint = wakeup;
+	trigger->trigger = NULL;
+	return libredxx_submit_read_urb(device, trigger);
+}
+
+static libredxx_status libredxx_d3xx_trigger_read(libredxx_opened_device* device, uint8_t channel_index, uint32_t size)
+{
+	struct libredxx_d3xx_channel* channel = &device->d3xx_channels[channel_index];
+	if (channel->trigger_pending) {
+		// the URB is reused, the last trigger is long done since its data arrived
+		libredxx_status status = libredxx_wait_urb(device, &channel->trigger, false);
+		channel->trigger_pending = false;
+		// a stall or babble was returned and cleared by the read the trigger was for
+		if (status != LIBREDXX_STATUS_SUCCESS && status != LIBREDXX_STATUS_ERROR_STALL && status != LIBREDXX_STATUS_ERROR_BABBLE) {
+			return status;
+		}
+	}
+	// submitted without waiting, the data URB can be queued while the trigger is still in flight
+	if (libredxx_d3xx_submit_trigger(device, &channel->trigger, channel->trigger_data, channel_index, size, channel_index) != LIBREDXX_STATUS_SUCCESS) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	channel->trigger_pending = true;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+/*
+ * Moves a transfer larger than urb_size as a run of URBs with up to urb_count in
+ * flight. Every URB after the first continues the bulk transfer and all but the
+ * last must not come back short, so a short packet or an error makes the kernel
+ * cancel the rest instead of letting them take the data of the next transfer.
+ * Whatever arrived before that is packed to the front of buffer and counted.
+ */
+static libredxx_status libredxx_split_urbs(libredxx_opened_device* device, unsigned int endpoint, uint8_t usb_endpoint, struct libredxx_urb* trigger, uint8_t* buffer, size_t* buffer_size, bool interruptible)
+{
+	const size_t size = *buffer_size;
+	const size_t urb_count = device->urb_count;
+	struct libredxx_urb* urbs = &device->split_urbs[endpoint * urb_count];
+	const bool in = usb_endpoint & USB_DIR_IN;
+	size_t submitted = 0; // bytes
+	size_t first = 0; // oldest URB in flight, by submission count
+	size_t next = 0;
+	size_t done = 0; // bytes of the URBs that came back full
+	struct libredxx_urb* waited = NULL; // the last one, it ended the run if anything did
+	bool submitting = true;
+	libredxx_status status = LIBREDXX_STATUS_SUCCESS;
+	while (status == LIBREDXX_STATUS_SUCCESS && done < size) {
+		while (submitting && submitted < size && next - first < urb_count) {
+			struct libredxx_urb* urb = &urbs[next % urb_count];
+			const size_t length = size - submitted < device->urb_size ? size - submitted : device->urb_size;
+			memset(urb, 0, sizeof(struct libredxx_urb));
+			urb->urb.type = USBDEVFS_URB_TYPE_BULK;
+			urb->urb.endpoint = usb_endpoint;
+			urb->urb.buffer = &buffer[submitted];
+			urb->urb.buffer_length = (int)length;
+			urb->urb.flags = (next ? USBDEVFS_URB_BULK_CONTINUATION : 0) | (in && submitted + length < size ? USBDEVFS_URB_SHORT_NOT_OK : 0);
+			urb->endpoint = endpoint;
+			urb->trigger = trigger;
+			if (libredxx_submit_read_urb(device, urb) != LIBREDXX_STATUS_SUCCESS) {
+				if (errno == EREMOTEIO && next > first) {
+					// one in flight failed and the kernel refuses to continue, waiting for it tells why
+					submitting = false;
+					break;
+				}
+				// usbfs_memory_mb is used up, or the device is gone
+				status = LIBREDXX_STATUS_ERROR_SYS;
+				break;
+			}
+			submitted += length;
+			++next;
+		}
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			break;
+		}
+		if (first == next) {
+			// refused with none of its own failing, which usbfs doesn't do
+			status = LIBREDXX_STATUS_ERROR_SYS;
+			break;
+		}
+		struct libredxx_urb* urb = &urbs[first % urb_count];
+		status = libredxx_wait_urb(device, urb, interruptible);
+		const bool reaped = atomic_load_explicit(&urb->reaped, memory_order_acquire);
+		if (reaped && urb->urb.status == -EREMOTEIO) {
+			status = LIBREDXX_STATUS_SUCCESS; // short, the end of the transfer
+		}
+		waited = urb;
+		if (!reaped || urb->urb.actual_length != urb->urb.buffer_length) {
+			break;
+		}
+		done += (size_t)urb->urb.actual_length;
+		++first;
+	}
+	// newest first, so nothing lands behind a URB that was already cut short
+	for (size_t i = next; i-- > first;) {
+		libredxx_cancel_urb(device, &urbs[i % urb_count]);
+	}
+	size_t transferred = done;
+	for (size_t i = first; i < next; ++i) {
+		const struct libredxx_urb* urb = &urbs[i % urb_count];
+		const size_t actual = (size_t)urb->urb.actual_length;
+		if (in) {
+			memmove(&buffer[transferred], urb->urb.buffer, actual);
+		} else if (transferred != (size_t)((uint8_t*)urb->urb.buffer - buffer)) {
+			break; // the device has these bytes, but not the ones before them
+		}
+		transferred += actual;
+	}
+	if (waited) {
+		// only once the rest is cancelled, the kernel doesn't reset a pipe with URBs queued
+		status = libredxx_recover_urb(device, waited, status);
+	}
+	*buffer_size = transferred;
+	// data of a read that was interrupted or failed part way is returned like a short read
+	return in && transferred ? LIBREDXX_STATUS_SUCCESS : status;
+}
+
+static libredxx_status libredxx_read_urb_poll(libredxx_opened_device* device, libredxx_endpoint endpoint, uint8_t usb_endpoint, void* buffer, size_t* buffer_size)
+{
+	libredxx_reset_wakeup(device, endpoint);
+	atomic_store_explicit(&device->read_interrupted[endpoint], false, memory_order_relaxed);
+
+	struct libredxx_urb urb = {0};
+	urb.urb.type = USBDEVFS_URB_TYPE_BULK;
+	urb.urb.endpoint = usb_endpoint;
+	urb.urb.buffer = buffer;
+	urb.urb.buffer_length = *buffer_size;
+	urb.endpoint = endpoint;
+	if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX && device->d3xx_channels[endpoint].trigger_pending) {
+		urb.trigger = &device->d3xx_channels[endpoint].trigger;
+	}
+	if (*buffer_size > device->urb_size) {
+		return libredxx_split_urbs(device, endpoint, usb_endpoint, urb.trigger, buffer, buffer_size, true);
+	}
+
+	libredxx_status status = libredxx_submit_read_urb(device, &urb);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	status = libredxx_wait_urb(device, &urb, true);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return libredxx_recover_urb(device, &urb, status);
+	}
+	*buffer_size = urb.urb.actual_length;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_d3xx_set_stream_size(libredxx_opened_device* device, libredxx_endpoint endpoint, size_t size)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D3XX || endpoint >= LIBREDXX_D3XX_CHANNEL_COUNT || size > UINT32_MAX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	device->d3xx_channels[endpoint].stream_size = size;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_set_urb_size(libredxx_opened_device* device, size_t urb_size, size_t urb_count)
+{
+	// a URB ending within a packet would overflow on a full one
+	urb_size = urb_size ? urb_size / device->max_packet * device->max_packet : device->max_packet * LIBREDXX_URB_PACKETS;
+	urb_count = urb_count ? urb_count : LIBREDXX_URB_COUNT;
+	if (!urb_size || urb_size > INT_MAX || urb_count > SIZE_MAX / LIBREDXX_WAKEUP_COUNT) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	// preallocated so a split transfer doesn't allocate, every endpoint gets its own run
+	if (urb_count != device->urb_count) {
+		struct libredxx_urb* split_urbs = calloc(LIBREDXX_WAKEUP_COUNT * urb_count, sizeof(struct libredxx_urb));
+		if (!split_urbs) {
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		free(device->split_urbs);
+		device->split_urbs = split_urbs;
+	}
+	device->urb_size = urb_size;
+	device->urb_count = urb_count;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+// drops the D2XX modem status header at the start of every packet, returns the payload size
+static size_t libredxx_strip_d2xx_headers(libredxx_opened_device* device, uint8_t* buffer, size_t size)
+{
+	const size_t packet_size = device->max_packet;
+	size_t payload = 0;
+	for (size_t offset = 0; offset < size; offset += packet_size) {
+		const size_t packet = size - offset < packet_size ? size - offset : packet_size;
+		if (packet <= D2XX_HEADER_SIZE) {
+			libredxx_stats_d2xx_status_packet(&device->stats);
+			continue;
+		}
+		memmove(&buffer[payload], &buffer[offset + D2XX_HEADER_SIZE], packet - D2XX_HEADER_SIZE);
+		payload += packet - D2XX_HEADER_SIZE;
+	}
+	return payload;
+}
+
+static libredxx_status libredxx_read_endpoint(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	libredxx_status status;
+	if (device->replay) {
+		return libredxx_replay_read(device->replay, buffer, buffer_size, endpoint);
+	}
+	if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		if (endpoint < LIBREDXX_D3XX_CHANNEL_COUNT) {
+			// endpoints A to D are FIFO channels 1 to 4
+			struct libredxx_d3xx_channel* channel = &device->d3xx_channels[endpoint];
+			const uint8_t channel_index = (uint8_t)endpoint;
+			const size_t size = *buffer_size;
+			if (!channel->trigger_ahead) {
+				status = libredxx_d3xx_trigger_read(device, channel_index, (uint32_t)size);
+				if (status != LIBREDXX_STATUS_SUCCESS) {
+					return status;
+				}
+			}
+			channel->trigger_ahead = false;
+			status = libredxx_read_urb_poll(device, endpoint, libredxx_usb_endpoint(device, endpoint, true), buffer, buffer_size);
+			if (status == LIBREDXX_STATUS_ERROR_INTERRUPTED) {
+				// the chip still has the request, the next read takes its data instead of asking again
+				channel->trigger_ahead = true;
+			} else if (status == LIBREDXX_STATUS_ERROR_STALL && !(atomic_load_explicit(&channel->trigger.reaped, memory_order_acquire) && channel->trigger.urb.status != 0)) {
+				// so does a stall of the data pipe, only a failed trigger has to be sent again
+				channel->trigger_ahead = true;
+			} else if (status == LIBREDXX_STATUS_SUCCESS && channel->stream_size != 0 && channel->stream_size == size) {
+				// request the next read now so its data is already on the way when it is asked for
+				channel->trigger_ahead = libredxx_d3xx_trigger_read(device, channel_index, (uint32_t)size) == LIBREDXX_STATUS_SUCCESS;
+			}
+			return status;
+		} else {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+    } else if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
+    	if (endpoint == LIBREDXX_ENDPOINT_A) {
+    		atomic_store_explicit(&device->read_interrupted[LIBREDXX_ENDPOINT_A], false, memory_order_relaxed);
+    		while (device->d2xx_rx_offset == device->d2xx_rx_fill) {
+    			// whole packets only, a transfer ending within a packet overflows when a full one arrives
+    			const size_t payload = device->max_packet - D2XX_HEADER_SIZE;
+    			const size_t packets = *buffer_size > payload ? (*buffer_size + payload - 1) / payload : 1;
+    			struct usbdevfs_bulktransfer bulk = {0};
+    			bulk.ep = libredxx_usb_endpoint(device, endpoint, true);
+    			bulk.len = (unsigned int)(packets * device->max_packet < device->d2xx_rx_buffer_size ? packets * device->max_packet : device->d2xx_rx_buffer_size);
+    			bulk.data = device->d2xx_rx_buffer;
+    			int r = libredxx_usbfs_bulk(device, &bulk);
+    			if (r == -1) {
+    				return libredxx_recover_endpoint(device, (uint8_t)bulk.ep, libredxx_transfer_status(errno));
+    			}
+    			device->d2xx_rx_offset = 0;
+    			device->d2xx_rx_fill = libredxx_strip_d2xx_headers(device, device->d2xx_rx_buffer, (size_t)r);
+    			if (device->d2xx_rx_fill == 0 && atomic_load_explicit(&device->read_interrupted[LIBREDXX_ENDPOINT_A], memory_order_acquire)) {
+    				return LIBREDXX_STATUS_ERROR_INTERRUPTED;
+    			}
+    		}
+    		// the rest of the packets stays for the next read
+    		const size_t available = device->d2xx_rx_fill - device->d2xx_rx_offset;
+    		*buffer_size = *buffer_size < available ? *buffer_size : available;
+    		memcpy(buffer, &device->d2xx_rx_buffer[device->d2xx_rx_offset], *buffer_size);
+    		device->d2xx_rx_offset += *buffer_size;
+    		return LIBREDXX_STATUS_SUCCESS;
+    	} else {
+    		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+    	}
+    } else if (device->found.type == LIBREDXX_DEVICE_TYPE_FT260) {
+        if (endpoint == LIBREDXX_ENDPOINT_A) {
+            return libredxx_read_urb_poll(device, endpoint, libredxx_usb_endpoint(device, endpoint, true), buffer, buffer_size);
+        } else if (endpoint == LIBREDXX_ENDPOINT_B) {
+        	if (*buffer_size != LIBREDXX_FT260_REPORT_SIZE) {
+        		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+        	}
+        	const uint8_t report_id = ((uint8_t*)buffer)[0];
+        	if (!report_id) {
+        		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+        	}
+        	struct usbdevfs_ctrltransfer ctrl = {0};
+        	ctrl.bRequestType = USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE;
+        	ctrl.bRequest = HID_REQ_GET_REPORT;
+        	ctrl.wValue = (uint16_t)((HID_REPORT_TYPE_FEATURE << 8) | report_id);
+        	ctrl.wIndex = LIBREDXX_FT260_INTERFACE;
+        	ctrl.wLength = *buffer_size;
+        	ctrl.data = buffer;
+        	if (-1 == libredxx_usbfs_control(device, &ctrl)) {
+        		return LIBREDXX_STATUS_ERROR_SYS;
+        	}
+        	return LIBREDXX_STATUS_SUCCESS;
+        } else {
+            return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+        }
+    } else {
+        return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+static libredxx_status libredxx_d2xx_control(libredxx_opened_device* device, const libredxx_d2xx_request* request)
+{
+	struct usbdevfs_ctrltransfer ctrl = {0};
+	ctrl.bRequestType = LIBREDXX_D2XX_REQUEST_TYPE_OUT;
+	ctrl.bRequest = request->request;
+	ctrl.wValue = request->value;
+	ctrl.wIndex = request->index;
+	return libredxx_usbfs_control(device, &ctrl) == -1 ? LIBREDXX_STATUS_ERROR_SYS : LIBREDXX_STATUS_SUCCESS;
+}
+
+static libredxx_status libredxx_ft260_set_feature(libredxx_opened_device* device, const uint8_t* report)
+{
+	struct usbdevfs_ctrltransfer ctrl = {0};
+	ctrl.bRequestType = USB_DIR_OUT | USB_TYPE_CLASS | USB_RECIP_INTERFACE;
+	ctrl.bRequest = HID_REQ_SET_REPORT;
+	ctrl.wValue = (uint16_t)((HID_REPORT_TYPE_FEATURE << 8) | report[0]);
+	ctrl.wIndex = LIBREDXX_FT260_INTERFACE;
+	ctrl.wLength = LIBREDXX_FT260_REPORT_SIZE;
+	ctrl.data = (void*)report;
+	return libredxx_usbfs_control(device, &ctrl) == -1 ? LIBREDXX_STATUS_ERROR_SYS : LIBREDXX_STATUS_SUCCESS;
+}
+
+// settings are kept with the session mutex held, the last of each kind in the order they were first made
+static void libredxx_keep_d2xx_setting(libredxx_opened_device* device, const libredxx_d2xx_request* request)
+{
+	size_t i = 0;
+	while (i < device->d2xx_settings_count && device->d2xx_settings[i].request != request->request) {
+		++i;
+	}
+	if (i == LIBREDXX_SETTING_COUNT) {
+		return;
+	}
+	device->d2xx_settings[i] = *request;
+	device->d2xx_settings_count += i == device->d2xx_settings_count;
+}
+
+static void libredxx_keep_ft260_setting(libredxx_opened_device* device, const uint8_t* report)
+{
+	const bool system = report[0] == LIBREDXX_FT260_REPORT_SYSTEM_SETTING;
+	if (system && report[1] == LIBREDXX_FT260_REQUEST_I2C_RESET) {
+		return; // a command, not a setting
+	}
+	size_t i = 0;
+	while (i < device->ft260_settings_count && (device->ft260_settings[i][0] != report[0] || (system && device->ft260_settings[i][1] != report[1]))) {
+		++i;
+	}
+	if (i == LIBREDXX_SETTING_COUNT) {
+		return;
+	}
+	memcpy(device->ft260_settings[i], report, LIBREDXX_FT260_REPORT_SIZE);
+	device->ft260_settings_count += i == device->ft260_settings_count;
+}
+
+static libredxx_status libredxx_write_endpoint(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint) {
+	if (device->replay) {
+		return libredxx_replay_write(device->replay, buffer_size, endpoint);
+	}
+	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX || device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		const bool d2xx = device->found.type == LIBREDXX_DEVICE_TYPE_D2XX;
+		if ((d2xx && endpoint == LIBREDXX_ENDPOINT_A) || (!d2xx && endpoint < LIBREDXX_D3XX_CHANNEL_COUNT)) {
+			const uint8_t usb_endpoint = libredxx_usb_endpoint(device, endpoint, false);
+			if (*buffer_size > device->urb_size) {
+				libredxx_reset_wakeup(device, (libredxx_endpoint)(LIBREDXX_WRITE_WAKEUP + endpoint));
+				return libredxx_split_urbs(device, LIBREDXX_WRITE_WAKEUP + endpoint, usb_endpoint, NULL, buffer, buffer_size, false);
+			}
+			struct usbdevfs_bulktransfer bulk = {0};
+			bulk.ep = usb_endpoint;
+			bulk.len = *buffer_size;
+			bulk.data = buffer;
+			if (libredxx_usbfs_bulk(device, &bulk) == -1) {
+				// usbfs doesn't say how much went out before the failure
+				*buffer_size = 0;
+				return libredxx_recover_endpoint(device, usb_endpoint, libredxx_transfer_status(errno));
+			}
+			return LIBREDXX_STATUS_SUCCESS;
+		} else {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
 		}
 	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_FT260) {
 		if (*buffer_size == 0) {
@@ -401,28 +1335,25 @@ libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, siz
 		}
 		if (endpoint == LIBREDXX_ENDPOINT_A) {
 			struct usbdevfs_bulktransfer bulk = {0};
-			bulk.ep = LIBREDXX_FT260_ENDPOINT_OUT;
+			bulk.ep = libredxx_usb_endpoint(device, endpoint, false);
 			bulk.len = (int)*buffer_size;
 			bulk.data = buffer;
-			if (-1 == ioctl(device->handle, USBDEVFS_BULK, &bulk)) {
-				return LIBREDXX_STATUS_ERROR_SYS;
+			if (-1 == libredxx_usbfs_bulk(device, &bulk)) {
+				*buffer_size = 0;
+				return libredxx_recover_endpoint(device, (uint8_t)bulk.ep, libredxx_transfer_status(errno));
 			}
 			return LIBREDXX_STATUS_SUCCESS;
 		} else if (endpoint == LIBREDXX_ENDPOINT_B) {
 			if (*buffer_size != LIBREDXX_FT260_REPORT_SIZE) {
 				return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
 			}
-			struct usbdevfs_ctrltransfer ctrl = {0};
-			ctrl.bRequestType = USB_DIR_OUT | USB_TYPE_CLASS | USB_RECIP_INTERFACE;
-			ctrl.bRequest = HID_REQ_SET_REPORT;
-			ctrl.wValue = (uint16_t)((HID_REPORT_TYPE_FEATURE << 8) | report_id);
-			ctrl.wIndex = LIBREDXX_FT260_INTERFACE;
-			ctrl.wLength = *buffer_size;
-			ctrl.data = buffer;
-			if (-1 == ioctl(device->handle, USBDEVFS_CONTROL, &ctrl)) {
-				return LIBREDXX_STATUS_ERROR_SYS;
+			libredxx_mutex_lock(&device->session_mutex);
+			libredxx_status status = libredxx_ft260_set_feature(device, buffer);
+			if (status == LIBREDXX_STATUS_SUCCESS) {
+				libredxx_keep_ft260_setting(device, buffer);
 			}
-			return LIBREDXX_STATUS_SUCCESS;
+			libredxx_mutex_unlock(&device->session_mutex);
+			return status;
 		} else {
 			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
 		}
@@ -430,3 +1361,1149 @@ libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, siz
 		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
 	}
 }
+
+// opens the device that came back in place of device, -1 while it hasn't
+static int libredxx_reopen(const libredxx_opened_device* device, bool match_location, libredxx_found_device* reopened)
+{
+	const libredxx_find_filter filter = {device->found.type, device->found.id};
+	libredxx_found_device** devices;
+	size_t devices_count;
+	if (libredxx_find_usbfs_devices(device->usbfs, &filter, 1, &devices, &devices_count) != LIBREDXX_STATUS_SUCCESS) {
+		return -1;
+	}
+	int handle = -1;
+	for (size_t i = 0; i < devices_count && handle == -1; ++i) {
+		const libredxx_found_device* found = devices[i];
+		if (found->interface_index != device->found.interface_index) {
+			continue;
+		}
+		if (match_location ? strcmp(found->location, device->found.location) != 0 : memcmp(&found->serial, &device->found.serial, sizeof(libredxx_serial)) != 0) {
+			continue;
+		}
+		handle = libredxx_open_handle(found);
+		if (handle != -1) {
+			*reopened = *found;
+		}
+	}
+	if (devices_count > 0) {
+		libredxx_free_found(devices);
+	}
+	return handle;
+}
+
+// with io_lock and the session mutex held, the old handle stays open for async transfers and streams that still have it
+static libredxx_status libredxx_replace_handle(libredxx_opened_device* device, int handle, const libredxx_found_device* found)
+{
+	int* stale_handles = realloc(device->stale_handles, sizeof(int) * (device->stale_handles_count + 1));
+	if (!stale_handles) {
+		device->usbfs->close(handle);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	device->stale_handles = stale_handles;
+	device->stale_handles[device->stale_handles_count++] = device->handle;
+	device->found = *found;
+	device->handle = handle;
+	libredxx_set_pcap_address(device);
+	// the packet size changes when the device comes back on a slower port
+	size_t max_packet;
+	libredxx_get_packet_size(found, &max_packet);
+	if (max_packet != device->max_packet) {
+		device->max_packet = max_packet;
+		device->urb_size = device->urb_size > max_packet ? device->urb_size / max_packet * max_packet : max_packet;
+	}
+	// whatever was buffered or requested is gone with the old device
+	device->d2xx_rx_offset = 0;
+	device->d2xx_rx_fill = 0;
+	for (unsigned int i = 0; i < LIBREDXX_D3XX_CHANNEL_COUNT; ++i) {
+		device->d3xx_channels[i].trigger_pending = false;
+		device->d3xx_channels[i].trigger_ahead = false;
+	}
+	for (size_t i = 0; i < device->d2xx_settings_count; ++i) {
+		libredxx_d2xx_control(device, &device->d2xx_settings[i]);
+	}
+	for (size_t i = 0; i < device->ft260_settings_count; ++i) {
+		libredxx_ft260_set_feature(device, device->ft260_settings[i]);
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+/*
+ * Waits for the device to come back and reopens it in place, with no io_lock
+ * held. generation and interrupts are from before the failed transfer, when
+ * another thread already reopened the device there is nothing left to do.
+ */
+static libredxx_status libredxx_reconnect(libredxx_opened_device* device, unsigned int generation, unsigned int interrupts)
+{
+	// hands the URBs the kernel gave back to their owners, so every read and transfer in flight ends
+	libredxx_reap_ready(device, LIBREDXX_WAKEUP_COUNT);
+	libredxx_mutex_lock(&device->session_mutex);
+	if (!device->reconnect_enabled || device->reconnecting || atomic_load_explicit(&device->generation, memory_order_relaxed) != generation) {
+		libredxx_mutex_unlock(&device->session_mutex);
+		return LIBREDXX_STATUS_ERROR_DISCONNECTED;
+	}
+	device->reconnecting = true;
+	const libredxx_reconnect_config config = device->reconnect;
+	const uint64_t interval_ns = (uint64_t)(config.poll_interval_ms ? config.poll_interval_ms : LIBREDXX_RECONNECT_POLL_MS) * 1000000;
+	const uint64_t start_ns = libredxx_time_ns();
+	const uint64_t deadline_ns = start_ns + (uint64_t)config.timeout_ms * 1000000;
+	if (config.disconnected) {
+		config.disconnected(config.context, device);
+	}
+	libredxx_status status = LIBREDXX_STATUS_ERROR_DISCONNECTED;
+	while (true) {
+		libredxx_found_device found;
+		const int handle = libredxx_reopen(device, config.match_location, &found);
+		if (handle != -1) {
+			/*
+			 * Every read and write still on the old device fails there and lets go of
+			 * io_lock, only then is it safe to swap what they use. io_lock comes first,
+			 * the FT260 feature report write takes the session mutex within it.
+			 */
+			libredxx_mutex_unlock(&device->session_mutex);
+			libredxx_rwlock_lock(&device->io_lock);
+			libredxx_mutex_lock(&device->session_mutex);
+			const libredxx_status replaced = libredxx_replace_handle(device, handle, &found);
+			if (replaced == LIBREDXX_STATUS_SUCCESS) {
+				atomic_fetch_add_explicit(&device->generation, 1, memory_order_relaxed);
+			}
+			libredxx_rwlock_unlock(&device->io_lock);
+			if (replaced == LIBREDXX_STATUS_SUCCESS && config.reconnected) {
+				config.reconnected(config.context, device, libredxx_time_ns() - start_ns);
+			}
+			break;
+		}
+		if (atomic_load_explicit(&device->interrupts, memory_order_relaxed) != interrupts) {
+			status = LIBREDXX_STATUS_ERROR_INTERRUPTED;
+			break;
+		}
+		const uint64_t now_ns = libredxx_time_ns();
+		if (config.timeout_ms && now_ns >= deadline_ns) {
+			break;
+		}
+		libredxx_cond_wait_for(&device->session_cond, &device->session_mutex, config.timeout_ms && deadline_ns - now_ns < interval_ns ? deadline_ns - now_ns : interval_ns);
+	}
+	device->reconnecting = false;
+	libredxx_mutex_unlock(&device->session_mutex);
+	return status;
+}
+
+// a read or write failed with ERROR_SYS, finds out whether the device went away
+static libredxx_status libredxx_check_disconnected(libredxx_opened_device* device, unsigned int generation, unsigned int interrupts)
+{
+	if (device->replay) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	// usbfs fails every ioctl on a device that is gone with ENODEV
+	uint32_t capabilities;
+	const bool gone = device->usbfs->ioctl(device->handle, USBDEVFS_GET_CAPABILITIES, &capabilities) == -1 && errno == ENODEV;
+	if (!gone && atomic_load_explicit(&device->generation, memory_order_relaxed) == generation) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	return libredxx_reconnect(device, generation, interrupts);
+}
+
+libredxx_status libredxx_set_reconnect(libredxx_opened_device* device, const libredxx_reconnect_config* config)
+{
+	if (device->replay) {
+		return LIBREDXX_STATUS_SUCCESS; // a replayed device never goes away
+	}
+	libredxx_mutex_lock(&device->session_mutex);
+	device->reconnect_enabled = config != NULL;
+	if (config) {
+		device->reconnect = *config;
+	}
+	libredxx_mutex_unlock(&device->session_mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_set_stall_retries(libredxx_opened_device* device, uint32_t retries)
+{
+	device->stall_retries = retries;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static bool libredxx_retry_stall(const libredxx_opened_device* device, libredxx_status status, uint32_t* retries)
+{
+	if ((status != LIBREDXX_STATUS_ERROR_STALL && status != LIBREDXX_STATUS_ERROR_BABBLE) || *retries == device->stall_retries) {
+		return false;
+	}
+	++*retries;
+	return true;
+}
+
+libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	const size_t requested = *buffer_size;
+	const uint64_t start_ns = libredxx_time_ns();
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_SUBMIT, device, endpoint, false, requested, LIBREDXX_STATUS_SUCCESS);
+	const unsigned int generation = atomic_load_explicit(&device->generation, memory_order_relaxed);
+	const unsigned int interrupts = atomic_load_explicit(&device->interrupts, memory_order_relaxed);
+	libredxx_rwlock_lock_shared(&device->io_lock);
+	libredxx_status status = libredxx_read_endpoint(device, buffer, buffer_size, endpoint);
+	uint32_t retries = 0;
+	while (libredxx_retry_stall(device, status, &retries)) {
+		*buffer_size = requested;
+		status = libredxx_read_endpoint(device, buffer, buffer_size, endpoint);
+	}
+	libredxx_rwlock_unlock_shared(&device->io_lock);
+	if (status == LIBREDXX_STATUS_ERROR_SYS) {
+		status = libredxx_check_disconnected(device, generation, interrupts);
+	}
+	LIBREDXX_TRACE_EVENT(status == LIBREDXX_STATUS_SUCCESS ? LIBREDXX_TRACE_COMPLETE : LIBREDXX_TRACE_ERROR, device, endpoint, false, *buffer_size, status);
+	libredxx_stats_read(&device->stats, endpoint, status, requested, *buffer_size, start_ns);
+	libredxx_record_read(device->record_session, endpoint, status, buffer, *buffer_size);
+	return status;
+}
+
+libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	const uint64_t start_ns = libredxx_time_ns();
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_SUBMIT, device, endpoint, true, *buffer_size, LIBREDXX_STATUS_SUCCESS);
+	const unsigned int generation = atomic_load_explicit(&device->generation, memory_order_relaxed);
+	const unsigned int interrupts = atomic_load_explicit(&device->interrupts, memory_order_relaxed);
+	const size_t requested = *buffer_size;
+	libredxx_rwlock_lock_shared(&device->io_lock);
+	libredxx_status status = libredxx_write_endpoint(device, buffer, buffer_size, endpoint);
+	// a retry picks up after the bytes the device took
+	size_t written = 0;
+	uint32_t retries = 0;
+	while (libredxx_retry_stall(device, status, &retries)) {
+		written += *buffer_size;
+		*buffer_size = requested - written;
+		status = libredxx_write_endpoint(device, (uint8_t*)buffer + written, buffer_size, endpoint);
+	}
+	libredxx_rwlock_unlock_shared(&device->io_lock);
+	*buffer_size += written;
+	if (status == LIBREDXX_STATUS_ERROR_SYS) {
+		status = libredxx_check_disconnected(device, generation, interrupts);
+	}
+	LIBREDXX_TRACE_EVENT(status == LIBREDXX_STATUS_SUCCESS ? LIBREDXX_TRACE_COMPLETE : LIBREDXX_TRACE_ERROR, device, endpoint, true, *buffer_size, status);
+	libredxx_stats_write(&device->stats, endpoint, status, *buffer_size, start_ns);
+	libredxx_record_write(device->record_session, endpoint, status, *buffer_size);
+	return status;
+}
+
+struct libredxx_stream_slot {
+	struct libredxx_urb urb;
+	struct libredxx_urb trigger; // D3XX request for the data of urb
+	uint8_t trigger_data[20];
+	uint64_t submit_ns;
+};
+
+struct libredxx_stream_source_state {
+	libredxx_opened_device* device;
+	libredxx_endpoint endpoint;
+	uint8_t usb_endpoint;
+	libredxx_buffer_pool pool;
+	libredxx_ring ring; // filled chunks waiting to be popped
+	struct libredxx_stream_slot* slots; // in flight reads in submission order, starting at slot_head
+	size_t slot_head;
+	size_t in_flight;
+	bool failed;
+	uint64_t last_ns; // timestamp of the last chunk, they never go back
+	int ready; // eventfd the consumer sleeps on
+	atomic_bool consumer_waiting;
+	libredxx_stream_chunk head; // taken from the ring by the merge, waiting in the heap
+	bool has_head;
+};
+
+struct libredxx_stream {
+	struct libredxx_stream_source_state* sources;
+	size_t sources_count;
+	size_t buffer_size;
+	size_t depth;
+	struct pollfd* fds; // per source the device handle and the endpoint's wakeup, then the stream wakeup
+	const libredxx_usbfs_ops* usbfs; // polls every device, the simulator's passes kernel fds through
+	libredxx_thread thread;
+	bool thread_started;
+	int wakeup; // written on stop and when a buffer comes back to a starved thread
+	atomic_bool stopping;
+	atomic_bool starved;
+	uint64_t published_ns; // the thread's copy of watermark_ns
+	_Atomic uint64_t watermark_ns; // no chunk pushed after this is older than it
+	libredxx_heap heap; // heads of the sources by timestamp, for libredxx_stream_pop_merged
+	int merge_ready; // eventfd the merging consumer sleeps on
+	atomic_bool merge_waiting;
+};
+
+static void libredxx_stream_signal(int fd)
+{
+	const uint64_t one = 1;
+	if (write(fd, &one, sizeof(one)) != sizeof(one)) {
+		// only fails when the counter is about to overflow, the sleeper is awake then anyway
+	}
+}
+
+static void libredxx_stream_drain(int fd)
+{
+	uint64_t count;
+	while (read(fd, &count, sizeof(count)) == -1 && errno == EINTR) {
+	}
+}
+
+static void libredxx_stream_push(struct libredxx_stream* stream, struct libredxx_stream_source_state* source, libredxx_stream_chunk* chunk)
+{
+	// another thread may have reaped the URB before the last watermark, the merge relies on chunks not being older
+	if (chunk->timestamp_ns < stream->published_ns) {
+		chunk->timestamp_ns = stream->published_ns;
+	}
+	if (chunk->timestamp_ns < source->last_ns) {
+		chunk->timestamp_ns = source->last_ns;
+	}
+	source->last_ns = chunk->timestamp_ns;
+	// never full, the ring holds every buffer of the source and one error
+	libredxx_ring_push(&source->ring, chunk);
+	// pairs with the fence in libredxx_stream_pop, either the consumer sees the chunk or this sees it waiting
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&source->consumer_waiting, memory_order_relaxed)) {
+		libredxx_stream_signal(source->ready);
+	}
+}
+
+static libredxx_status libredxx_stream_submit(struct libredxx_stream* stream, struct libredxx_stream_source_state* source, struct libredxx_stream_slot* slot, void* buffer)
+{
+	libredxx_opened_device* device = source->device;
+	memset(&slot->urb.urb, 0, sizeof(slot->urb.urb));
+	slot->urb.urb.type = USBDEVFS_URB_TYPE_BULK;
+	slot->urb.urb.endpoint = source->usb_endpoint;
+	slot->urb.urb.buffer = buffer;
+	slot->urb.urb.buffer_length = (int)stream->buffer_size;
+	slot->urb.endpoint = source->endpoint;
+	slot->urb.trigger = NULL;
+	slot->submit_ns = libredxx_time_ns();
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_SUBMIT, device, source->endpoint, false, stream->buffer_size, LIBREDXX_STATUS_SUCCESS);
+	if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		if (libredxx_d3xx_submit_trigger(device, &slot->trigger, slot->trigger_data, (uint8_t)source->endpoint, (uint32_t)stream->buffer_size, source->endpoint) != LIBREDXX_STATUS_SUCCESS) {
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		slot->urb.trigger = &slot->trigger;
+	}
+	if (libredxx_submit_read_urb(device, &slot->urb) != LIBREDXX_STATUS_SUCCESS) {
+		if (slot->urb.trigger) {
+			libredxx_cancel_urb(device, &slot->trigger);
+		}
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+// reports a failed read once, the source reads no more after it
+static void libredxx_stream_fail(struct libredxx_stream* stream, struct libredxx_stream_source_state* source, libredxx_status status, uint64_t timestamp_ns)
+{
+	if (!source->failed) {
+		source->failed = true;
+		libredxx_stream_chunk chunk = {NULL, 0, status, timestamp_ns};
+		libredxx_stream_push(stream, source, &chunk);
+	}
+}
+
+// tops up the reads in flight, false when the consumer holds the buffers needed for it
+static bool libredxx_stream_fill(struct libredxx_stream* stream, struct libredxx_stream_source_state* source)
+{
+	while (!source->failed && source->in_flight < stream->depth) {
+		void* buffer;
+		if (libredxx_buffer_pool_get(&source->pool, &buffer) != LIBREDXX_STATUS_SUCCESS) {
+			return false;
+		}
+		struct libredxx_stream_slot* slot = &source->slots[(source->slot_head + source->in_flight) % stream->depth];
+		libredxx_status status = libredxx_stream_submit(stream, source, slot, buffer);
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			libredxx_buffer_pool_free(&source->pool, buffer);
+			LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_ERROR, source->device, source->endpoint, false, 0, status);
+			libredxx_stats_read(&source->device->stats, source->endpoint, status, stream->buffer_size, 0, slot->submit_ns);
+			libredxx_stream_fail(stream, source, status, libredxx_time_ns());
+			break;
+		}
+		++source->in_flight;
+	}
+	return true;
+}
+
+// hands out the completed reads in the order they were submitted
+static void libredxx_stream_complete(struct libredxx_stream* stream, struct libredxx_stream_source_state* source)
+{
+	libredxx_opened_device* device = source->device;
+	while (source->in_flight) {
+		struct libredxx_stream_slot* slot = &source->slots[source->slot_head];
+		if (slot->urb.trigger && atomic_load_explicit(&slot->trigger.reaped, memory_order_acquire) && slot->trigger.urb.status != 0) {
+			// a failed trigger, the data it requested will never arrive
+			device->usbfs->ioctl(device->handle, USBDEVFS_DISCARDURB, &slot->urb.urb);
+		}
+		if (!atomic_load_explicit(&slot->urb.reaped, memory_order_acquire)) {
+			break;
+		}
+		if (slot->urb.trigger && !atomic_load_explicit(&slot->trigger.reaped, memory_order_acquire)) {
+			// the slot is reused for the next read, its trigger has to be back too
+			break;
+		}
+		source->slot_head = (source->slot_head + 1) % stream->depth;
+		--source->in_flight;
+
+		uint8_t* buffer = slot->urb.urb.buffer;
+		libredxx_status status = LIBREDXX_STATUS_SUCCESS;
+		if (slot->urb.urb.status != 0) {
+			status = libredxx_recover_urb(device, &slot->urb, libredxx_transfer_status(-libredxx_failed_urb(&slot->urb)->urb.status));
+		}
+		size_t size = status == LIBREDXX_STATUS_SUCCESS ? (size_t)slot->urb.urb.actual_length : 0;
+		if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
+			size = libredxx_strip_d2xx_headers(device, buffer, size);
+		}
+		LIBREDXX_TRACE_EVENT(status == LIBREDXX_STATUS_SUCCESS ? LIBREDXX_TRACE_COMPLETE : LIBREDXX_TRACE_ERROR, device, source->endpoint, false, size, status);
+		libredxx_stats_read(&device->stats, source->endpoint, status, stream->buffer_size, size, slot->submit_ns);
+		libredxx_record_read(device->record_session, source->endpoint, status, buffer, size);
+		if (status != LIBREDXX_STATUS_SUCCESS || source->failed || size == 0) {
+			// nothing for the consumer, a D2XX read may carry only modem status
+			libredxx_buffer_pool_free(&source->pool, buffer);
+			if (status != LIBREDXX_STATUS_SUCCESS) {
+				libredxx_stream_fail(stream, source, status, slot->urb.reaped_ns);
+			}
+			continue;
+		}
+		libredxx_stream_chunk chunk = {buffer, size, LIBREDXX_STATUS_SUCCESS, slot->urb.reaped_ns};
+		libredxx_stream_push(stream, source, &chunk);
+	}
+}
+
+// promises the merge that every chunk from now on is at least this recent
+static void libredxx_stream_publish(struct libredxx_stream* stream)
+{
+	const uint64_t now_ns = libredxx_time_ns();
+	if (now_ns > stream->published_ns) {
+		stream->published_ns = now_ns;
+	}
+	atomic_store_explicit(&stream->watermark_ns, stream->published_ns, memory_order_release);
+	// pairs with the fence in libredxx_stream_pop_merged
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&stream->merge_waiting, memory_order_relaxed)) {
+		libredxx_stream_signal(stream->merge_ready);
+	}
+}
+
+// cancels every read in flight and waits until the kernel gave each back
+static void libredxx_stream_cancel(struct libredxx_stream* stream, struct libredxx_stream_source_state* source)
+{
+	libredxx_opened_device* device = source->device;
+	for (size_t i = 0; i < source->in_flight; ++i) {
+		struct libredxx_stream_slot* slot = &source->slots[(source->slot_head + i) % stream->depth];
+		device->usbfs->ioctl(device->handle, USBDEVFS_DISCARDURB, &slot->urb.urb);
+		if (slot->urb.trigger) {
+			device->usbfs->ioctl(device->handle, USBDEVFS_DISCARDURB, &slot->trigger.urb);
+		}
+	}
+	for (size_t i = 0; i < source->in_flight; ++i) {
+		struct libredxx_stream_slot* slot = &source->slots[(source->slot_head + i) % stream->depth];
+		libredxx_wait_urb(device, &slot->urb, false);
+		if (slot->urb.trigger) {
+			libredxx_wait_urb(device, &slot->trigger, false);
+		}
+		libredxx_buffer_pool_free(&source->pool, slot->urb.urb.buffer);
+	}
+	source->in_flight = 0;
+}
+
+static void libredxx_stream_main(void* arg)
+{
+	struct libredxx_stream* stream = arg;
+	const size_t fds_count = stream->sources_count * 2 + 1;
+	while (!atomic_load_explicit(&stream->stopping, memory_order_acquire)) {
+		bool starved = false;
+		for (size_t i = 0; i < stream->sources_count; ++i) {
+			if (!libredxx_stream_fill(stream, &stream->sources[i])) {
+				starved = true;
+			}
+		}
+		if (starved) {
+			// pairs with libredxx_stream_release, a buffer freed before this is picked up by the retry
+			atomic_store_explicit(&stream->starved, true, memory_order_seq_cst);
+			atomic_thread_fence(memory_order_seq_cst);
+			for (size_t i = 0; i < stream->sources_count; ++i) {
+				libredxx_stream_fill(stream, &stream->sources[i]);
+			}
+		}
+		libredxx_stream_publish(stream);
+		for (size_t i = 0; i < fds_count; ++i) {
+			stream->fds[i].revents = 0;
+		}
+		if (stream->usbfs->poll(stream->fds, (nfds_t)fds_count, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (stream->fds[fds_count - 1].revents & POLLIN) {
+			libredxx_stream_drain(stream->wakeup);
+		}
+		for (size_t i = 0; i < stream->sources_count; ++i) {
+			struct libredxx_stream_source_state* source = &stream->sources[i];
+			if (stream->fds[i * 2 + 1].revents & POLLIN) {
+				libredxx_reset_wakeup(source->device, source->endpoint);
+			}
+			if (stream->fds[i * 2].revents) {
+				// a gone device fails every URB, they are reaped before this fails
+				libredxx_reap_ready(source->device, source->endpoint);
+			}
+			libredxx_stream_complete(stream, source);
+		}
+	}
+	for (size_t i = 0; i < stream->sources_count; ++i) {
+		libredxx_stream_cancel(stream, &stream->sources[i]);
+	}
+	// nothing more is coming, lets a merging consumer drain what is left
+	stream->published_ns = UINT64_MAX;
+	libredxx_stream_publish(stream);
+}
+
+static void libredxx_stream_destroy(struct libredxx_stream* stream)
+{
+	for (size_t i = 0; i < stream->sources_count; ++i) {
+		struct libredxx_stream_source_state* source = &stream->sources[i];
+		if (source->ready != -1) {
+			close(source->ready);
+		}
+		libredxx_ring_destroy(&source->ring);
+		libredxx_buffer_pool_destroy(&source->pool);
+		free(source->slots);
+	}
+	if (stream->wakeup != -1) {
+		close(stream->wakeup);
+	}
+	if (stream->merge_ready != -1) {
+		close(stream->merge_ready);
+	}
+	libredxx_heap_destroy(&stream->heap);
+	free(stream->fds);
+	free(stream->sources);
+	free(stream);
+}
+
+libredxx_status libredxx_stream_stop(libredxx_stream* stream)
+{
+	if (!stream) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	if (stream->thread_started) {
+		atomic_store_explicit(&stream->stopping, true, memory_order_release);
+		libredxx_stream_signal(stream->wakeup);
+		libredxx_thread_join(stream->thread);
+	}
+	libredxx_stream_destroy(stream);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static libredxx_status libredxx_stream_init_source(struct libredxx_stream* stream, struct libredxx_stream_source_state* source, const libredxx_stream_source* config_source, const libredxx_stream_config* config)
+{
+	libredxx_opened_device* device = config_source->device;
+	const libredxx_endpoint endpoint = config_source->endpoint;
+	source->device = device;
+	source->endpoint = endpoint;
+	source->ready = -1;
+	if (!device || (unsigned int)endpoint >= libredxx_read_endpoint_count(&device->found)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	if (device->replay) {
+		return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+	}
+	if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		if (config->buffer_size > UINT32_MAX) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		source->usb_endpoint = libredxx_usb_endpoint(device, endpoint, true);
+	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		// whole packets only, a packet cut short would overflow the URB
+		if (config->buffer_size % device->max_packet != 0) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		source->usb_endpoint = libredxx_usb_endpoint(device, endpoint, true);
+	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_FT260) {
+		// one input report per read
+		if (config->buffer_size != LIBREDXX_FT260_REPORT_SIZE) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		source->usb_endpoint = libredxx_usb_endpoint(device, endpoint, true);
+	} else {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_status status = libredxx_buffer_pool_init(&source->pool, config->buffer_size, config->buffer_count, config->pool_flags);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	status = libredxx_ring_init(&source->ring, sizeof(libredxx_stream_chunk), config->buffer_count + 1);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	source->slots = calloc(config->depth, sizeof(struct libredxx_stream_slot));
+	source->ready = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (!source->slots || source->ready == -1) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	atomic_init(&source->consumer_waiting, false);
+	stream->fds[(source - stream->sources) * 2] = (struct pollfd){device->handle, POLLOUT, 0};
+	stream->fds[(source - stream->sources) * 2 + 1] = (struct pollfd){device->wakeups[endpoint], POLLIN, 0};
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_stream_start(const libredxx_stream_source* sources, size_t sources_count, const libredxx_stream_config* config, libredxx_stream** stream)
+{
+	if (!sources || !sources_count || !config || !stream || !config->buffer_size || config->buffer_size > INT_MAX || !config->depth || config->depth > config->buffer_count) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	struct libredxx_stream* private_stream = calloc(1, sizeof(struct libredxx_stream));
+	if (!private_stream) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	private_stream->buffer_size = config->buffer_size;
+	private_stream->depth = config->depth;
+	private_stream->wakeup = -1;
+	private_stream->merge_ready = -1;
+	private_stream->usbfs = &libredxx_usbfs_system;
+	atomic_init(&private_stream->stopping, false);
+	atomic_init(&private_stream->starved, false);
+	atomic_init(&private_stream->watermark_ns, 0);
+	atomic_init(&private_stream->merge_waiting, false);
+	private_stream->sources = calloc(sources_count, sizeof(struct libredxx_stream_source_state));
+	private_stream->fds = calloc(sources_count * 2 + 1, sizeof(struct pollfd));
+	if (!private_stream->sources || !private_stream->fds) {
+		libredxx_stream_destroy(private_stream);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	for (size_t i = 0; i < sources_count; ++i) {
+		for (size_t j = 0; j < i; ++j) {
+			if (sources[j].device == sources[i].device && sources[j].endpoint == sources[i].endpoint) {
+				libredxx_stream_destroy(private_stream);
+				return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+			}
+		}
+		++private_stream->sources_count;
+		libredxx_status status = libredxx_stream_init_source(private_stream, &private_stream->sources[i], &sources[i], config);
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			libredxx_stream_destroy(private_stream);
+			return status;
+		}
+		if (sources[i].device->usbfs != &libredxx_usbfs_system) {
+			private_stream->usbfs = sources[i].device->usbfs;
+		}
+	}
+	private_stream->wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	private_stream->merge_ready = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (private_stream->wakeup == -1 || private_stream->merge_ready == -1) {
+		libredxx_stream_destroy(private_stream);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	libredxx_status status = libredxx_heap_init(&private_stream->heap, sources_count);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_stream_destroy(private_stream);
+		return status;
+	}
+	private_stream->fds[sources_count * 2] = (struct pollfd){private_stream->wakeup, POLLIN, 0};
+	for (size_t i = 0; i < sources_count; ++i) {
+		libredxx_reset_wakeup(private_stream->sources[i].device, private_stream->sources[i].endpoint);
+	}
+	status = libredxx_thread_create(&private_stream->thread, libredxx_stream_main, private_stream);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_stream_destroy(private_stream);
+		return status;
+	}
+	private_stream->thread_started = true;
+	if (config->cpu >= 0) {
+		status = libredxx_thread_set_affinity(private_stream->thread, config->cpu);
+	}
+	if (status == LIBREDXX_STATUS_SUCCESS && config->priority != 0) {
+		status = libredxx_thread_set_realtime(private_stream->thread, config->priority);
+	}
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_stream_stop(private_stream);
+		return status;
+	}
+	*stream = private_stream;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_stream_pop(libredxx_stream* stream, size_t source, libredxx_stream_chunk* chunk, uint32_t timeout_ms)
+{
+	if (!stream || source >= stream->sources_count || !chunk) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	struct libredxx_stream_source_state* state = &stream->sources[source];
+	if (libredxx_ring_pop(&state->ring, chunk)) {
+		return LIBREDXX_STATUS_SUCCESS;
+	}
+	const uint64_t deadline_ns = libredxx_time_ns() + (uint64_t)timeout_ms * 1000000u;
+	while (true) {
+		atomic_store_explicit(&state->consumer_waiting, true, memory_order_relaxed);
+		// pairs with the fence in libredxx_stream_push
+		atomic_thread_fence(memory_order_seq_cst);
+		if (libredxx_ring_pop(&state->ring, chunk)) {
+			atomic_store_explicit(&state->consumer_waiting, false, memory_order_relaxed);
+			return LIBREDXX_STATUS_SUCCESS;
+		}
+		const uint64_t now_ns = libredxx_time_ns();
+		if (now_ns >= deadline_ns) {
+			atomic_store_explicit(&state->consumer_waiting, false, memory_order_relaxed);
+			return LIBREDXX_STATUS_ERROR_TIMEOUT;
+		}
+		struct pollfd fd = {state->ready, POLLIN, 0};
+		const uint64_t remaining_ms = (deadline_ns - now_ns + 999999u) / 1000000u;
+		if (poll(&fd, 1, (int)remaining_ms) > 0) {
+			libredxx_stream_drain(state->ready);
+		}
+	}
+}
+
+// takes the oldest chunk once no source can still deliver an older one
+static bool libredxx_stream_merge_next(struct libredxx_stream* stream, size_t* source, libredxx_stream_chunk* chunk)
+{
+	// loaded first, a source found empty below can only push chunks at least this recent
+	const uint64_t watermark_ns = atomic_load_explicit(&stream->watermark_ns, memory_order_acquire);
+	bool complete = true;
+	for (size_t i = 0; i < stream->sources_count; ++i) {
+		struct libredxx_stream_source_state* state = &stream->sources[i];
+		if (!state->has_head) {
+			if (libredxx_ring_pop(&state->ring, &state->head)) {
+				state->has_head = true;
+				// never full, it has room for a head of every source
+				libredxx_heap_push(&stream->heap, state->head.timestamp_ns, i);
+			} else {
+				complete = false;
+			}
+		}
+	}
+	libredxx_heap_entry oldest;
+	if (!libredxx_heap_peek(&stream->heap, &oldest) || (!complete && oldest.key > watermark_ns)) {
+		return false;
+	}
+	libredxx_heap_pop(&stream->heap, &oldest);
+	*source = oldest.index;
+	*chunk = stream->sources[oldest.index].head;
+	stream->sources[oldest.index].has_head = false;
+	return true;
+}
+
+libredxx_status libredxx_stream_pop_merged(libredxx_stream* stream, size_t* source, libredxx_stream_chunk* chunk, uint32_t timeout_ms)
+{
+	if (!stream || !source || !chunk) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	if (libredxx_stream_merge_next(stream, source, chunk)) {
+		return LIBREDXX_STATUS_SUCCESS;
+	}
+	const uint64_t deadline_ns = libredxx_time_ns() + (uint64_t)timeout_ms * 1000000u;
+	while (true) {
+		atomic_store_explicit(&stream->merge_waiting, true, memory_order_relaxed);
+		// pairs with the fence in libredxx_stream_publish
+		atomic_thread_fence(memory_order_seq_cst);
+		if (libredxx_stream_merge_next(stream, source, chunk)) {
+			atomic_store_explicit(&stream->merge_waiting, false, memory_order_relaxed);
+			return LIBREDXX_STATUS_SUCCESS;
+		}
+		const uint64_t now_ns = libredxx_time_ns();
+		if (now_ns >= deadline_ns) {
+			atomic_store_explicit(&stream->merge_waiting, false, memory_order_relaxed);
+			return LIBREDXX_STATUS_ERROR_TIMEOUT;
+		}
+		struct pollfd fd = {stream->merge_ready, POLLIN, 0};
+		const uint64_t remaining_ms = (deadline_ns - now_ns + 999999u) / 1000000u;
+		if (poll(&fd, 1, (int)remaining_ms) > 0) {
+			libredxx_stream_drain(stream->merge_ready);
+		}
+	}
+}
+
+libredxx_status libredxx_stream_release(libredxx_stream* stream, size_t source, const libredxx_stream_chunk* chunk)
+{
+	if (!stream || source >= stream->sources_count || !chunk) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	if (!chunk->data) {
+		// an error has no buffer
+		return LIBREDXX_STATUS_SUCCESS;
+	}
+	libredxx_status status = libredxx_buffer_pool_free(&stream->sources[source].pool, chunk->data);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	// pairs with the fence in libredxx_stream_main
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_exchange_explicit(&stream->starved, false, memory_order_seq_cst)) {
+		libredxx_stream_signal(stream->wakeup);
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+struct libredxx_transfer_private {
+	libredxx_transfer transfer;
+	struct libredxx_urb urb;
+	struct libredxx_urb trigger; // D3XX request for the data of a read
+	uint8_t trigger_data[20];
+	uint64_t submit_ns;
+	bool in_flight;
+	bool cancelled;
+	struct libredxx_transfer_private* next; // in the device's in flight list, then in the completed list
+};
+
+libredxx_status libredxx_alloc_transfer(libredxx_transfer** transfer)
+{
+	if (!transfer) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	struct libredxx_transfer_private* private_transfer = calloc(1, sizeof(struct libredxx_transfer_private));
+	if (!private_transfer) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	*transfer = &private_transfer->transfer;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_free_transfer(libredxx_transfer* transfer)
+{
+	struct libredxx_transfer_private* private_transfer = (struct libredxx_transfer_private*)transfer;
+	if (private_transfer && private_transfer->in_flight) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	free(private_transfer);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static libredxx_status libredxx_transfer_usb_endpoint(const libredxx_transfer* transfer, uint8_t* usb_endpoint)
+{
+	const libredxx_opened_device* device = transfer->device;
+	const libredxx_endpoint endpoint = transfer->endpoint;
+	if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX && endpoint < LIBREDXX_D3XX_CHANNEL_COUNT) {
+		if (transfer->size > UINT32_MAX) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		*usb_endpoint = libredxx_usb_endpoint(device, endpoint, !transfer->write);
+	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX && endpoint == LIBREDXX_ENDPOINT_A) {
+		// whole packets only, a packet cut short would overflow the URB
+		if (!transfer->write && (transfer->size == 0 || transfer->size % device->max_packet != 0)) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		*usb_endpoint = libredxx_usb_endpoint(device, endpoint, !transfer->write);
+	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_FT260 && endpoint == LIBREDXX_ENDPOINT_A) {
+		if (transfer->write && (transfer->size == 0 || ((const uint8_t*)transfer->buffer)[0] == 0)) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT; // require report ID
+		}
+		*usb_endpoint = libredxx_usb_endpoint(device, endpoint, !transfer->write);
+	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_FT260 && endpoint == LIBREDXX_ENDPOINT_B) {
+		return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+	} else {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static libredxx_status libredxx_submit_transfer_urb(struct libredxx_transfer_private* private_transfer)
+{
+	libredxx_transfer* transfer = &private_transfer->transfer;
+	libredxx_opened_device* device = transfer->device;
+	if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX && !transfer->write) {
+		if (libredxx_d3xx_submit_trigger(device, &private_transfer->trigger, private_transfer->trigger_data, (uint8_t)transfer->endpoint, (uint32_t)transfer->size, LIBREDXX_ASYNC_WAKEUP) != LIBREDXX_STATUS_SUCCESS) {
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		private_transfer->urb.trigger = &private_transfer->trigger;
+	}
+	if (libredxx_submit_read_urb(device, &private_transfer->urb) != LIBREDXX_STATUS_SUCCESS) {
+		if (private_transfer->urb.trigger) {
+			libredxx_cancel_urb(device, &private_transfer->trigger);
+		}
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static void libredxx_append_transfer(libredxx_opened_device* device, struct libredxx_transfer_private* private_transfer)
+{
+	private_transfer->next = NULL;
+	if (device->transfers_tail) {
+		device->transfers_tail->next = private_transfer;
+	} else {
+		device->transfers = private_transfer;
+	}
+	device->transfers_tail = private_transfer;
+}
+
+libredxx_status libredxx_submit_transfer(libredxx_transfer* transfer)
+{
+	struct libredxx_transfer_private* private_transfer = (struct libredxx_transfer_private*)transfer;
+	if (!transfer || !transfer->device || (!transfer->buffer && transfer->size) || transfer->size > INT_MAX || private_transfer->in_flight) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_opened_device* device = transfer->device;
+	if (device->replay) {
+		return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+	}
+	libredxx_rwlock_lock_shared(&device->io_lock);
+	uint8_t usb_endpoint;
+	libredxx_status status = libredxx_transfer_usb_endpoint(transfer, &usb_endpoint);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_rwlock_unlock_shared(&device->io_lock);
+		return status;
+	}
+	struct usbdevfs_urb* urb = &private_transfer->urb.urb;
+	memset(urb, 0, sizeof(*urb));
+	urb->type = USBDEVFS_URB_TYPE_BULK;
+	urb->endpoint = usb_endpoint;
+	urb->buffer = transfer->buffer;
+	urb->buffer_length = (int)transfer->size;
+	private_transfer->urb.endpoint = LIBREDXX_ASYNC_WAKEUP;
+	private_transfer->urb.trigger = NULL;
+	private_transfer->cancelled = false;
+	transfer->transferred = 0;
+	transfer->status = LIBREDXX_STATUS_SUCCESS;
+	transfer->timestamp_ns = 0;
+	private_transfer->submit_ns = libredxx_time_ns();
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_SUBMIT, device, transfer->endpoint, transfer->write, transfer->size, LIBREDXX_STATUS_SUCCESS);
+
+	libredxx_mutex_lock(&device->transfers_mutex);
+	status = libredxx_submit_transfer_urb(private_transfer);
+	if (status == LIBREDXX_STATUS_SUCCESS) {
+		private_transfer->in_flight = true;
+		libredxx_append_transfer(device, private_transfer);
+	}
+	libredxx_mutex_unlock(&device->transfers_mutex);
+	libredxx_rwlock_unlock_shared(&device->io_lock);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_ERROR, device, transfer->endpoint, transfer->write, 0, status);
+	}
+	return status;
+}
+
+libredxx_status libredxx_cancel_transfer(libredxx_transfer* transfer)
+{
+	struct libredxx_transfer_private* private_transfer = (struct libredxx_transfer_private*)transfer;
+	if (!transfer || !transfer->device) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_opened_device* device = transfer->device;
+	libredxx_status status = LIBREDXX_STATUS_SUCCESS;
+	libredxx_mutex_lock(&device->transfers_mutex);
+	if (private_transfer->in_flight) {
+		private_transfer->cancelled = true;
+		// fails when the URB already completed, it is handed back by libredxx_poll_completions all the same
+		device->usbfs->ioctl(device->handle, USBDEVFS_DISCARDURB, &private_transfer->urb.urb);
+		if (private_transfer->urb.trigger) {
+			device->usbfs->ioctl(device->handle, USBDEVFS_DISCARDURB, &private_transfer->trigger.urb);
+		}
+	} else {
+		status = LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_mutex_unlock(&device->transfers_mutex);
+	return status;
+}
+
+// true once the kernel handed back everything the transfer submitted
+static bool libredxx_transfer_reaped(libredxx_opened_device* device, struct libredxx_transfer_private* private_transfer)
+{
+	struct libredxx_urb* trigger = private_transfer->urb.trigger;
+	if (trigger && atomic_load_explicit(&trigger->reaped, memory_order_acquire) && trigger->urb.status != 0) {
+		// a failed trigger, the data it requested will never arrive
+		device->usbfs->ioctl(device->handle, USBDEVFS_DISCARDURB, &private_transfer->urb.urb);
+	}
+	if (!atomic_load_explicit(&private_transfer->urb.reaped, memory_order_acquire)) {
+		return false;
+	}
+	return !trigger || atomic_load_explicit(&trigger->reaped, memory_order_acquire);
+}
+
+/*
+ * Unlinks every finished transfer, oldest first. The list is in submission order, which
+ * is the order an endpoint completes in. A D2XX read that only got modem status goes
+ * again and moves to the back, behind the reads the kernel now has ahead of it.
+ */
+static struct libredxx_transfer_private* libredxx_take_completed(libredxx_opened_device* device)
+{
+	struct libredxx_transfer_private* completed = NULL;
+	struct libredxx_transfer_private** completed_tail = &completed;
+	libredxx_mutex_lock(&device->transfers_mutex);
+	struct libredxx_transfer_private* previous = NULL;
+	struct libredxx_transfer_private* private_transfer = device->transfers;
+	struct libredxx_transfer_private* resubmitted = NULL;
+	while (private_transfer && private_transfer != resubmitted) {
+		struct libredxx_transfer_private* next = private_transfer->next;
+		if (!libredxx_transfer_reaped(device, private_transfer)) {
+			previous = private_transfer;
+			private_transfer = next;
+			continue;
+		}
+		libredxx_transfer* transfer = &private_transfer->transfer;
+		struct usbdevfs_urb* urb = &private_transfer->urb.urb;
+		size_t transferred = (size_t)urb->actual_length;
+		bool resubmit = false;
+		if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX && !transfer->write) {
+			transferred = libredxx_strip_d2xx_headers(device, transfer->buffer, transferred);
+			resubmit = transferred == 0 && urb->status == 0 && !private_transfer->cancelled && libredxx_submit_transfer_urb(private_transfer) == LIBREDXX_STATUS_SUCCESS;
+		}
+		if (previous) {
+			previous->next = next;
+		} else {
+			device->transfers = next;
+		}
+		if (device->transfers_tail == private_transfer) {
+			device->transfers_tail = previous;
+		}
+		if (resubmit) {
+			libredxx_append_transfer(device, private_transfer);
+			if (!resubmitted) {
+				// everything from here on was looked at already
+				resubmitted = private_transfer;
+			}
+			private_transfer = next;
+			continue;
+		}
+		transfer->transferred = transferred;
+		transfer->timestamp_ns = private_transfer->urb.reaped_ns;
+		if (private_transfer->cancelled && transferred == 0) {
+			transfer->status = LIBREDXX_STATUS_ERROR_INTERRUPTED;
+		} else if (urb->status == 0 || (private_transfer->cancelled && transferred > 0)) {
+			// data that made it before the discard is not thrown away
+			transfer->status = LIBREDXX_STATUS_SUCCESS;
+		} else {
+			transfer->status = libredxx_recover_urb(device, &private_transfer->urb, libredxx_transfer_status(-libredxx_failed_urb(&private_transfer->urb)->urb.status));
+		}
+		private_transfer->in_flight = false;
+		private_transfer->next = NULL;
+		*completed_tail = private_transfer;
+		completed_tail = &private_transfer->next;
+		private_transfer = next;
+	}
+	libredxx_mutex_unlock(&device->transfers_mutex);
+	return completed;
+}
+
+libredxx_status libredxx_poll_completions(libredxx_opened_device* device, uint32_t timeout_ms)
+{
+	if (!device) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	if (device->replay) {
+		return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+	}
+	const uint64_t deadline_ns = libredxx_time_ns() + (uint64_t)timeout_ms * 1000000u;
+	while (true) {
+		const libredxx_status reap_status = libredxx_reap_ready(device, LIBREDXX_ASYNC_WAKEUP);
+		struct libredxx_transfer_private* completed = libredxx_take_completed(device);
+		if (completed) {
+			while (completed) {
+				// the callback may free or resubmit it
+				struct libredxx_transfer_private* next = completed->next;
+				libredxx_transfer* transfer = &completed->transfer;
+				LIBREDXX_TRACE_EVENT(transfer->status == LIBREDXX_STATUS_SUCCESS ? LIBREDXX_TRACE_COMPLETE : LIBREDXX_TRACE_ERROR, device, transfer->endpoint, transfer->write, transfer->transferred, transfer->status);
+				if (transfer->write) {
+					libredxx_stats_write(&device->stats, transfer->endpoint, transfer->status, transfer->transferred, completed->submit_ns);
+					libredxx_record_write(device->record_session, transfer->endpoint, transfer->status, transfer->transferred);
+				} else {
+					libredxx_stats_read(&device->stats, transfer->endpoint, transfer->status, transfer->size, transfer->transferred, completed->submit_ns);
+					libredxx_record_read(device->record_session, transfer->endpoint, transfer->status, transfer->buffer, transfer->transferred);
+				}
+				if (transfer->callback) {
+					transfer->callback(transfer);
+				}
+				completed = next;
+			}
+			return LIBREDXX_STATUS_SUCCESS;
+		}
+		if (reap_status != LIBREDXX_STATUS_SUCCESS) {
+			// gone, the kernel gave back every URB before failing
+			return reap_status;
+		}
+		const uint64_t now_ns = libredxx_time_ns();
+		if (now_ns >= deadline_ns) {
+			return LIBREDXX_STATUS_ERROR_TIMEOUT;
+		}
+		struct pollfd fds[2] = {0};
+		fds[0].fd = device->handle;
+		fds[0].events = POLLOUT;
+		fds[1].fd = device->wakeups[LIBREDXX_ASYNC_WAKEUP];
+		fds[1].events = POLLIN;
+		const uint64_t remaining_ms = (deadline_ns - now_ns + 999999u) / 1000000u;
+		if (device->usbfs->poll(fds, 2, (int)remaining_ms) < 0 && errno != EINTR) {
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		if (fds[1].revents & POLLIN) {
+			libredxx_reset_wakeup(device, (libredxx_endpoint)LIBREDXX_ASYNC_WAKEUP);
+		}
+	}
+}
+
+static libredxx_status libredxx_d2xx_send_request(libredxx_opened_device* device, const libredxx_d2xx_request* request)
+{
+	if (device->replay) {
+		return LIBREDXX_STATUS_SUCCESS;
+	}
+	libredxx_mutex_lock(&device->session_mutex);
+	libredxx_status status = libredxx_d2xx_control(device, request);
+	if (status == LIBREDXX_STATUS_SUCCESS) {
+		libredxx_keep_d2xx_setting(device, request);
+	}
+	libredxx_mutex_unlock(&device->session_mutex);
+	return status;
+}
+
+static uint8_t libredxx_d2xx_channel(const libredxx_opened_device* device)
+{
+	return libredxx_d2xx_get_channel(device->found.interface_index, device->found.interface_count);
+}
+
+libredxx_status libredxx_d2xx_set_baud_rate(libredxx_opened_device* device, uint32_t baud_rate)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_baud_rate_request(libredxx_d2xx_get_chip(device->found.release), libredxx_d2xx_channel(device), baud_rate, &request, NULL);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
+}
+
+libredxx_status libredxx_d2xx_set_data_characteristics(libredxx_opened_device* device, uint8_t data_bits, libredxx_d2xx_stop_bits stop_bits, libredxx_d2xx_parity parity)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_data_characteristics_request(libredxx_d2xx_channel(device), data_bits, stop_bits, parity, &request);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
+}
+
+libredxx_status libredxx_d2xx_set_flow_control(libredxx_opened_device* device, libredxx_d2xx_flow_control flow_control, uint8_t xon, uint8_t xoff)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_flow_control_request(libredxx_d2xx_channel(device), flow_control, xon, xoff, &request);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
+}
+
+libredxx_status libredxx_d2xx_set_latency_timer(libredxx_opened_device* device, uint8_t latency_ms)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_latency_timer_request(libredxx_d2xx_channel(device), latency_ms, &request);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
+}
+
+libredxx_status libredxx_d2xx_set_bit_mode(libredxx_opened_device* device, uint8_t mask, libredxx_d2xx_bit_mode mode)
+{
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_d2xx_request request;
+	libredxx_status status = libredxx_d2xx_bit_mode_request(libredxx_d2xx_channel(device), mask, mode, &request);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	return libredxx_d2xx_send_request(device, &request);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "libredxx.h"
+#include "libredxx_thread.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define LIBREDXX_OPEN_WORKERS 8
+
+/*
+ * Workers take the next device from a shared counter until the list is done,
+ * so a slow device only holds up its own worker. Opening devices from several
+ * threads is safe on every backend, they share no state but the recording.
+ */
+
+struct libredxx_open_job {
+	libredxx_found_device* const* found;
+	size_t found_count;
+	const libredxx_open_config* config;
+	libredxx_opened_device** opened;
+	libredxx_status* statuses;
+	atomic_size_t next;
+};
+
+static void libredxx_open_worker(void* arg)
+{
+	struct libredxx_open_job* job = arg;
+	size_t index;
+	while ((index = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed)) < job->found_count) {
+		libredxx_opened_device* opened = NULL;
+		libredxx_status status = libredxx_open_device(job->found[index], &opened);
+		if (status == LIBREDXX_STATUS_SUCCESS && job->config->setup) {
+			status = job->config->setup(job->config->context, opened, index);
+			if (status != LIBREDXX_STATUS_SUCCESS) {
+				libredxx_close_device(opened);
+			}
+		}
+		job->opened[index] = status == LIBREDXX_STATUS_SUCCESS ? opened : NULL;
+		job->statuses[index] = status;
+	}
+}
+
+libredxx_status libredxx_open_many(libredxx_found_device* const* found, size_t found_count, const libredxx_open_config* config, libredxx_opened_device** opened, libredxx_status* statuses)
+{
+	const libredxx_open_config default_config = {0};
+	if (!config) {
+		config = &default_config;
+	}
+	if (found_count && (!found || !opened || !statuses)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	size_t workers = config->workers ? config->workers : LIBREDXX_OPEN_WORKERS;
+	workers = workers < found_count ? workers : found_count;
+	struct libredxx_open_job job;
+	job.found = found;
+	job.found_count = found_count;
+	job.config = config;
+	job.opened = opened;
+	job.statuses = statuses;
+	atomic_init(&job.next, 0);
+	libredxx_thread* threads = NULL;
+	size_t threads_count = 0;
+	if (workers > 1) {
+		threads = malloc(sizeof(libredxx_thread) * (workers - 1));
+		// with fewer threads than asked for, or none, the calling thread still opens everything
+		while (threads && threads_count < workers - 1 && libredxx_thread_create(&threads[threads_count], libredxx_open_worker, &job) == LIBREDXX_STATUS_SUCCESS) {
+			++threads_count;
+		}
+	}
+	libredxx_open_worker(&job);
+	for (size_t i = 0; i < threads_count; ++i) {
+		libredxx_thread_join(threads[i]);
+	}
+	free(threads);
+	for (size_t i = 0; i < found_count; ++i) {
+		if (statuses[i] != LIBREDXX_STATUS_SUCCESS) {
+			return statuses[i];
+		}
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "libredxx_pcap.h"
+#include "libredxx_thread.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LIBREDXX_PCAP_LINKTYPE_USB_LINUX_MMAPPED 220
+#define LIBREDXX_PCAP_SNAP_LENGTH 262144
+#define LIBREDXX_PCAP_DEFAULT_BUFFER_SIZE (16 * 1024 * 1024)
+#define LIBREDXX_PCAP_EINPROGRESS 115 // Linux value, usbmon submissions always carry it
+
+struct libredxx_pcap_file_header {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t network;
+};
+
+struct libredxx_pcap_record_header {
+	uint32_t ts_sec;
+	uint32_t ts_usec;
+	uint32_t captured;
+	uint32_t length;
+};
+
+// struct usbmon_packet of the Linux kernel, in host byte order like usbmon writes it
+struct libredxx_usbmon_header {
+	uint64_t id;
+	uint8_t type; // 'S'ubmit or 'C'omplete
+	uint8_t transfer_type;
+	uint8_t endpoint;
+	uint8_t device;
+	uint16_t bus;
+	int8_t flag_setup; // 0 when setup is valid
+	int8_t flag_data; // 0 when data follows
+	int64_t ts_sec;
+	int32_t ts_usec;
+	int32_t status;
+	uint32_t length;
+	uint32_t captured;
+	uint8_t setup[8];
+	int32_t interval;
+	int32_t start_frame;
+	uint32_t transfer_flags;
+	uint32_t descriptor_count;
+};
+_Static_assert(sizeof(struct libredxx_usbmon_header) == 64, "usbmon packets have a 64 byte header");
+
+/*
+ * Records are copied into a byte ring under the mutex and written out by a
+ * background thread, so the I/O path never waits on the file. A record that
+ * doesn't fit is dropped rather than blocking. The writer owns the used part of
+ * the ring between taking a snapshot of it and giving it back, producers only
+ * ever append behind it.
+ */
+struct libredxx_pcap_capture {
+	libredxx_mutex mutex;
+	libredxx_cond cond;
+	bool running;
+	uint8_t* ring;
+	size_t ring_size;
+	size_t head;
+	size_t used;
+	uint64_t dropped;
+	FILE* file;
+	bool write_failed;
+	libredxx_thread thread;
+};
+
+static struct libredxx_pcap_capture libredxx_pcap = {.mutex = LIBREDXX_MUTEX_INIT, .cond = LIBREDXX_COND_INIT};
+static libredxx_mutex libredxx_pcap_control = LIBREDXX_MUTEX_INIT; // serializes start and stop
+static _Atomic bool libredxx_pcap_active;
+static _Atomic uint8_t libredxx_pcap_device_count;
+
+static void libredxx_pcap_ring_write(struct libredxx_pcap_capture* capture, const void* data, size_t size)
+{
+	if (size == 0) {
+		return;
+	}
+	const size_t first = size < capture->ring_size - capture->head ? size : capture->ring_size - capture->head;
+	memcpy(&capture->ring[capture->head], data, first);
+	memcpy(capture->ring, (const uint8_t*)data + first, size - first);
+	capture->head = (capture->head + size) % capture->ring_size;
+}
+
+static void libredxx_pcap_record(const libredxx_pcap_address* address, const void* id, uint8_t type, uint8_t transfer_type, uint8_t endpoint, const uint8_t* setup, int status, const void* data, size_t length, bool has_data)
+{
+	struct timespec now;
+	timespec_get(&now, TIME_UTC);
+	const size_t max_data = LIBREDXX_PCAP_SNAP_LENGTH - sizeof(struct libredxx_usbmon_header);
+	const size_t captured = has_data && data ? (length < max_data ? length : max_data) : 0;
+
+	struct libredxx_usbmon_header usbmon = {0};
+	usbmon.id = (uint64_t)(uintptr_t)id;
+	usbmon.type = type;
+	usbmon.transfer_type = transfer_type;
+	usbmon.endpoint = endpoint;
+	usbmon.device = address->device;
+	usbmon.bus = address->bus;
+	usbmon.flag_setup = setup ? 0 : '-';
+	usbmon.flag_data = captured ? 0 : ((endpoint & 0x80) ? '<' : '>');
+	usbmon.ts_sec = (int64_t)now.tv_sec;
+	usbmon.ts_usec = (int32_t)(now.tv_nsec / 1000);
+	usbmon.status = status;
+	usbmon.length = (uint32_t)length;
+	usbmon.captured = (uint32_t)captured;
+	if (setup) {
+		memcpy(usbmon.setup, setup, sizeof(usbmon.setup));
+	}
+
+	struct libredxx_pcap_record_header record;
+	record.ts_sec = (uint32_t)now.tv_sec;
+	record.ts_usec = (uint32_t)(now.tv_nsec / 1000);
+	record.captured = (uint32_t)(sizeof(usbmon) + captured);
+	record.length = (uint32_t)(sizeof(usbmon) + (has_data ? length : 0));
+
+	struct libredxx_pcap_capture* capture = &libredxx_pcap;
+	const size_t total = sizeof(record) + sizeof(usbmon) + captured;
+	libredxx_mutex_lock(&capture->mutex);
+	if (capture->running) {
+		if (capture->ring_size - capture->used < total) {
+			++capture->dropped;
+		} else {
+			libredxx_pcap_ring_write(capture, &record, sizeof(record));
+			libredxx_pcap_ring_write(capture, &usbmon, sizeof(usbmon));
+			libredxx_pcap_ring_write(capture, data, captured);
+			capture->used += total;
+			libredxx_cond_signal(&capture->cond);
+		}
+	}
+	libredxx_mutex_unlock(&capture->mutex);
+}
+
+void libredxx_pcap_submit(const libredxx_pcap_address* address, const void* id, uint8_t transfer_type, uint8_t endpoint, const uint8_t* setup, const void* data, size_t length)
+{
+	if (!atomic_load_explicit(&libredxx_pcap_active, memory_order_relaxed)) {
+		return;
+	}
+	libredxx_pcap_record(address, id, 'S', transfer_type, endpoint, setup, -LIBREDXX_PCAP_EINPROGRESS, data, length, !(endpoint & 0x80));
+}
+
+void libredxx_pcap_complete(const libredxx_pcap_address* address, const void* id, uint8_t transfer_type, uint8_t endpoint, int status, const void* data, size_t length)
+{
+	if (!atomic_load_explicit(&libredxx_pcap_active, memory_order_relaxed)) {
+		return;
+	}
+	libredxx_pcap_record(address, id, 'C', transfer_type, endpoint, NULL, status, data, length, (endpoint & 0x80) != 0);
+}
+
+void libredxx_pcap_setup(uint8_t setup[8], uint8_t request_type, uint8_t request, uint16_t value, uint16_t index, uint16_t length)
+{
+	setup[0] = request_type;
+	setup[1] = request;
+	setup[2] = (uint8_t)value;
+	setup[3] = (uint8_t)(value >> 8);
+	setup[4] = (uint8_t)index;
+	setup[5] = (uint8_t)(index >> 8);
+	setup[6] = (uint8_t)length;
+	setup[7] = (uint8_t)(length >> 8);
+}
+
+uint8_t libredxx_pcap_next_device(void)
+{
+	// usbmon device numbers are 1 to 127
+	return (uint8_t)(atomic_fetch_add_explicit(&libredxx_pcap_device_count, 1, memory_order_relaxed) % 127 + 1);
+}
+
+static void libredxx_pcap_writer(void* arg)
+{
+	struct libredxx_pcap_capture* capture = arg;
+	libredxx_mutex_lock(&capture->mutex);
+	while (true) {
+		while (capture->used == 0 && capture->running) {
+			libredxx_cond_wait(&capture->cond, &capture->mutex);
+		}
+		if (capture->used == 0) {
+			break; // stopped and drained
+		}
+		const size_t size = capture->used;
+		const size_t tail = (capture->head + capture->ring_size - size) % capture->ring_size;
+		libredxx_mutex_unlock(&capture->mutex);
+
+		const size_t first = size < capture->ring_size - tail ? size : capture->ring_size - tail;
+		bool failed = fwrite(&capture->ring[tail], 1, first, capture->file) != first;
+		failed |= fwrite(capture->ring, 1, size - first, capture->file) != size - first;
+
+		libredxx_mutex_lock(&capture->mutex);
+		capture->write_failed |= failed;
+		capture->used -= size;
+	}
+	libredxx_mutex_unlock(&capture->mutex);
+}
+
+libredxx_status libredxx_pcap_start(const char* path, size_t buffer_size)
+{
+	if (buffer_size == 0) {
+		buffer_size = LIBREDXX_PCAP_DEFAULT_BUFFER_SIZE;
+	}
+	struct libredxx_pcap_capture* capture = &libredxx_pcap;
+	libredxx_mutex_lock(&libredxx_pcap_control);
+	if (atomic_load_explicit(&libredxx_pcap_active, memory_order_relaxed)) {
+		libredxx_mutex_unlock(&libredxx_pcap_control);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		libredxx_mutex_unlock(&libredxx_pcap_control);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	struct libredxx_pcap_file_header header = {0};
+	header.magic = 0xA1B2C3D4;
+	header.version_major = 2;
+	header.version_minor = 4;
+	header.snaplen = LIBREDXX_PCAP_SNAP_LENGTH;
+	header.network = LIBREDXX_PCAP_LINKTYPE_USB_LINUX_MMAPPED;
+	uint8_t* ring = malloc(buffer_size);
+	if (!ring || fwrite(&header, sizeof(header), 1, file) != 1) {
+		free(ring);
+		fclose(file);
+		libredxx_mutex_unlock(&libredxx_pcap_control);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+
+	libredxx_mutex_lock(&capture->mutex);
+	capture->ring = ring;
+	capture->ring_size = buffer_size;
+	capture->head = 0;
+	capture->used = 0;
+	capture->dropped = 0;
+	capture->file = file;
+	capture->write_failed = false;
+	capture->running = true;
+	libredxx_mutex_unlock(&capture->mutex);
+
+	libredxx_status status = libredxx_thread_create(&capture->thread, libredxx_pcap_writer, capture);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_mutex_lock(&capture->mutex);
+		capture->running = false;
+		capture->ring = NULL;
+		libredxx_mutex_unlock(&capture->mutex);
+		free(ring);
+		fclose(file);
+		libredxx_mutex_unlock(&libredxx_pcap_control);
+		return status;
+	}
+	atomic_store_explicit(&libredxx_pcap_active, true, memory_order_relaxed);
+	libredxx_mutex_unlock(&libredxx_pcap_control);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_pcap_stop(uint64_t* dropped)
+{
+	struct libredxx_pcap_capture* capture = &libredxx_pcap;
+	libredxx_mutex_lock(&libredxx_pcap_control);
+	if (!atomic_load_explicit(&libredxx_pcap_active, memory_order_relaxed)) {
+		libredxx_mutex_unlock(&libredxx_pcap_control);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	atomic_store_explicit(&libredxx_pcap_active, false, memory_order_relaxed);
+
+	// records that already passed the active check see running is false under the mutex
+	libredxx_mutex_lock(&capture->mutex);
+	capture->running = false;
+	libredxx_cond_broadcast(&capture->cond);
+	libredxx_mutex_unlock(&capture->mutex);
+	libredxx_thread_join(capture->thread);
+
+	bool failed = capture->write_failed;
+	failed |= fclose(capture->file) != 0;
+	free(capture->ring);
+	capture->ring = NULL;
+	capture->file = NULL;
+	if (dropped) {
+		*dropped = capture->dropped;
+	}
+	libredxx_mutex_unlock(&libredxx_pcap_control);
+	return failed ? LIBREDXX_STATUS_ERROR_SYS : LIBREDXX_STATUS_SUCCESS;
+}
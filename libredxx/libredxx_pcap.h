@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LIBREDXX_LIBREDXX_PCAP_H
+#define LIBREDXX_LIBREDXX_PCAP_H
+
+#include "libredxx.h"
+
+// usbmon transfer types
+#define LIBREDXX_PCAP_INTERRUPT 1
+#define LIBREDXX_PCAP_CONTROL 2
+#define LIBREDXX_PCAP_BULK 3
+
+struct libredxx_pcap_address {
+	uint16_t bus;
+	uint8_t device;
+};
+typedef struct libredxx_pcap_address libredxx_pcap_address;
+
+/*
+ * Both return right away while no capture is running. id pairs a submission
+ * with its completion, like the URB pointer of usbmon. Data is only captured
+ * in the direction it travels: on submit for OUT and on complete for IN.
+ * status is 0 or a negative errno.
+ */
+void libredxx_pcap_submit(const libredxx_pcap_address* address, const void* id, uint8_t transfer_type, uint8_t endpoint, const uint8_t* setup, const void* data, size_t length);
+void libredxx_pcap_complete(const libredxx_pcap_address* address, const void* id, uint8_t transfer_type, uint8_t endpoint, int status, const void* data, size_t length);
+
+void libredxx_pcap_setup(uint8_t setup[8], uint8_t request_type, uint8_t request, uint16_t value, uint16_t index, uint16_t length);
+
+// for platforms that don't expose the bus address of a device
+uint8_t libredxx_pcap_next_device(void);
+
+#endif // LIBREDXX_LIBREDXX_PCAP_H
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "libredxx_pool.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#define LIBREDXX_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static size_t libredxx_round_up(size_t value, size_t multiple)
+{
+	return (value + multiple - 1) / multiple * multiple;
+}
+
+static void* libredxx_map_pages(size_t* size, bool huge_pages)
+{
+#ifdef _WIN32
+	if (huge_pages) {
+		// large pages need SeLockMemoryPrivilege, without it this falls back to normal pages
+		const SIZE_T large_page_size = GetLargePageMinimum();
+		if (large_page_size) {
+			const size_t large_size = libredxx_round_up(*size, large_page_size);
+			void* memory = VirtualAlloc(NULL, large_size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (memory) {
+				*size = large_size;
+				return memory;
+			}
+		}
+	}
+	return VirtualAlloc(NULL, *size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+	if (huge_pages) {
+		*size = libredxx_round_up(*size, LIBREDXX_HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+		void* memory = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED) {
+			return memory;
+		}
+#endif
+	}
+	void* memory = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		return NULL;
+	}
+#ifdef MADV_HUGEPAGE
+	if (huge_pages) {
+		// no reserved huge pages, transparent huge pages are the next best thing
+		madvise(memory, *size, MADV_HUGEPAGE);
+	}
+#endif
+	return memory;
+#endif
+}
+
+static void libredxx_unmap_pages(void* memory, size_t size)
+{
+#ifdef _WIN32
+	(void)size;
+	VirtualFree(memory, 0, MEM_RELEASE);
+#else
+	munmap(memory, size);
+#endif
+}
+
+static bool libredxx_lock_pages(void* memory, size_t size)
+{
+#ifdef _WIN32
+	return VirtualLock(memory, size);
+#else
+	return mlock(memory, size) == 0;
+#endif
+}
+
+static void libredxx_unlock_pages(void* memory, size_t size)
+{
+#ifdef _WIN32
+	VirtualUnlock(memory, size);
+#else
+	munlock(memory, size);
+#endif
+}
+
+libredxx_status libredxx_buffer_pool_init(libredxx_buffer_pool* pool, size_t buffer_size, size_t buffer_count, uint32_t flags)
+{
+	if (pool->memory) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT; // one pool per device
+	}
+	if (buffer_size == 0 || buffer_count == 0 || buffer_count >= UINT32_MAX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const size_t stride = libredxx_round_up(buffer_size, LIBREDXX_CACHE_LINE_SIZE);
+	if (stride > SIZE_MAX / buffer_count) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	_Atomic uint32_t* next = malloc(sizeof(_Atomic uint32_t) * buffer_count);
+	if (!next) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	const bool huge_pages = flags & LIBREDXX_POOL_HUGE_PAGES;
+	size_t memory_size = stride * buffer_count;
+	uint8_t* memory = libredxx_map_pages(&memory_size, huge_pages);
+	if (!memory) {
+		free(next);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	const bool locked = flags & LIBREDXX_POOL_LOCKED;
+	if (locked && !libredxx_lock_pages(memory, memory_size)) {
+		libredxx_unmap_pages(memory, memory_size);
+		free(next);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	// fault every page in now instead of on first use
+	memset(memory, 0, memory_size);
+
+	for (size_t i = 0; i < buffer_count; ++i) {
+		atomic_init(&next[i], i + 1 < buffer_count ? (uint32_t)(i + 2) : 0);
+	}
+	pool->memory = memory;
+	pool->memory_size = memory_size;
+	pool->stride = stride;
+	pool->buffer_count = buffer_count;
+	pool->next = next;
+	pool->locked = locked;
+	atomic_store(&pool->head, 1);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+void libredxx_buffer_pool_destroy(libredxx_buffer_pool* pool)
+{
+	if (!pool->memory) {
+		return;
+	}
+	if (pool->locked) {
+		libredxx_unlock_pages(pool->memory, pool->memory_size);
+	}
+	libredxx_unmap_pages(pool->memory, pool->memory_size);
+	free((void*)pool->next);
+	pool->memory = NULL;
+	pool->next = NULL;
+}
+
+libredxx_status libredxx_buffer_pool_get(libredxx_buffer_pool* pool, void** buffer)
+{
+	if (!pool->memory) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	uint64_t head = atomic_load_explicit(&pool->head, memory_order_acquire);
+	uint32_t index;
+	uint64_t new_head;
+	do {
+		index = (uint32_t)head;
+		if (!index) {
+			return LIBREDXX_STATUS_ERROR_OVERFLOW; // all buffers are in use
+		}
+		const uint32_t next = atomic_load_explicit(&pool->next[index - 1], memory_order_relaxed);
+		new_head = (((head >> 32) + 1) << 32) | next;
+	} while (!atomic_compare_exchange_weak_explicit(&pool->head, &head, new_head, memory_order_acquire, memory_order_acquire));
+	*buffer = pool->memory + (index - 1) * pool->stride;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+#ifndef NDEBUG
+// walks the free stack, only the owner of a buffer can push it so a hit is a double free
+static bool libredxx_buffer_pool_is_free(libredxx_buffer_pool* pool, uint32_t index)
+{
+	uint32_t free_index = (uint32_t)atomic_load_explicit(&pool->head, memory_order_acquire);
+	for (size_t steps = 0; free_index && steps < pool->buffer_count; ++steps) {
+		if (free_index == index + 1) {
+			return true;
+		}
+		free_index = atomic_load_explicit(&pool->next[free_index - 1], memory_order_relaxed);
+	}
+	return false;
+}
+#endif
+
+libredxx_status libredxx_buffer_pool_free(libredxx_buffer_pool* pool, void* buffer)
+{
+	const uint8_t* address = buffer;
+	if (!pool->memory || address < pool->memory || address >= pool->memory + pool->stride * pool->buffer_count) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const size_t offset = (size_t)(address - pool->memory);
+	if (offset % pool->stride) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const uint32_t index = (uint32_t)(offset / pool->stride);
+	assert(!libredxx_buffer_pool_is_free(pool, index) && "buffer freed twice");
+	uint64_t head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+	uint64_t new_head;
+	do {
+		atomic_store_explicit(&pool->next[index], (uint32_t)head, memory_order_relaxed);
+		new_head = (((head >> 32) + 1) << 32) | (index + 1);
+	} while (!atomic_compare_exchange_weak_explicit(&pool->head, &head, new_head, memory_order_release, memory_order_relaxed));
+	return LIBREDXX_STATUS_SUCCESS;
+}
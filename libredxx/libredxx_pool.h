@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LIBREDXX_LIBREDXX_POOL_H
+#define LIBREDXX_LIBREDXX_POOL_H
+
+#include "libredxx.h"
+
+#include <stdatomic.h>
+
+#if defined(__APPLE__) && defined(__aarch64__)
+#define LIBREDXX_CACHE_LINE_SIZE 128
+#else
+#define LIBREDXX_CACHE_LINE_SIZE 64
+#endif
+
+/*
+ * Fixed size transfer buffers carved out of one page allocation. Free buffers
+ * are kept on a lock-free stack of indices, the head carries a tag against ABA.
+ */
+struct libredxx_buffer_pool {
+	uint8_t* memory;
+	size_t memory_size;
+	size_t stride; // buffer size rounded up to the cache line size
+	size_t buffer_count;
+	_Atomic uint32_t* next; // index + 1 of the next free buffer, 0 ends the stack
+	_Atomic uint64_t head; // tag << 32 | index + 1
+	bool locked;
+};
+typedef struct libredxx_buffer_pool libredxx_buffer_pool;
+
+libredxx_status libredxx_buffer_pool_init(libredxx_buffer_pool* pool, size_t buffer_size, size_t buffer_count, uint32_t flags);
+void libredxx_buffer_pool_destroy(libredxx_buffer_pool* pool);
+libredxx_status libredxx_buffer_pool_get(libredxx_buffer_pool* pool, void** buffer);
+libredxx_status libredxx_buffer_pool_free(libredxx_buffer_pool* pool, void* buffer);
+
+#endif // LIBREDXX_LIBREDXX_POOL_H
@@ -0,0 +1,580 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "libredxx_replay.h"
+#include "libredxx_thread.h"
+#include "libredxx_time.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A recording is the 8 byte magic followed by records, each a header and size
+ * bytes of payload, all in host byte order. FIND carries every found device,
+ * OPEN the device it opened and READ the data that was read. Sessions are
+ * numbered from 1 in the order they were opened, times are in nanoseconds since
+ * recording started and taken when the call returned.
+ */
+#define LIBREDXX_REPLAY_MAGIC "RDXXRPL1"
+#define LIBREDXX_REPLAY_MAGIC_SIZE 8
+#define LIBREDXX_REPLAY_ENDPOINT_COUNT 4
+
+enum libredxx_replay_kind {
+	LIBREDXX_REPLAY_FIND = 1,
+	LIBREDXX_REPLAY_OPEN,
+	LIBREDXX_REPLAY_CLOSE,
+	LIBREDXX_REPLAY_READ,
+	LIBREDXX_REPLAY_WRITE,
+	LIBREDXX_REPLAY_INTERRUPT,
+};
+
+struct libredxx_replay_record {
+	uint32_t kind;
+	uint32_t session;
+	uint64_t time_ns;
+	uint32_t endpoint;
+	int32_t status;
+	uint64_t size;
+};
+_Static_assert(sizeof(struct libredxx_replay_record) == 32, "records have a 32 byte header");
+
+struct libredxx_replay_device_record {
+	uint16_t vid;
+	uint16_t pid;
+	uint8_t type;
+	uint8_t interface_index;
+	uint8_t reserved[2];
+	char serial[16];
+};
+_Static_assert(sizeof(struct libredxx_replay_device_record) == 24, "devices are recorded in 24 bytes");
+
+static struct {
+	libredxx_mutex mutex;
+	FILE* file;
+	uint64_t start_ns;
+	uint32_t session_count;
+	bool failed;
+} libredxx_recording = {.mutex = LIBREDXX_MUTEX_INIT};
+static _Atomic bool libredxx_recording_active;
+
+static void libredxx_record(uint32_t kind, uint32_t session, libredxx_endpoint endpoint, libredxx_status status, const void* payload, size_t size)
+{
+	struct libredxx_replay_record record;
+	record.kind = kind;
+	record.session = session;
+	record.time_ns = libredxx_time_ns() - libredxx_recording.start_ns;
+	record.endpoint = (uint32_t)endpoint;
+	record.status = (int32_t)status;
+	record.size = size;
+	// the file is only closed under the mutex, a stop racing the active check is caught here
+	if (!libredxx_recording.file) {
+		return;
+	}
+	bool failed = fwrite(&record, sizeof(record), 1, libredxx_recording.file) != 1;
+	if (size) {
+		failed |= fwrite(payload, size, 1, libredxx_recording.file) != 1;
+	}
+	libredxx_recording.failed |= failed;
+}
+
+static void libredxx_record_device(const libredxx_found_device* found, struct libredxx_replay_device_record* device)
+{
+	memset(device, 0, sizeof(*device));
+	libredxx_device_id id;
+	libredxx_device_type type;
+	libredxx_serial serial;
+	libredxx_get_device_id(found, &id);
+	libredxx_get_device_type(found, &type);
+	libredxx_get_interface_index(found, &device->interface_index);
+	libredxx_get_serial(found, &serial);
+	device->vid = id.vid;
+	device->pid = id.pid;
+	device->type = (uint8_t)type;
+	memcpy(device->serial, serial.serial, sizeof(device->serial));
+}
+
+void libredxx_record_find(libredxx_found_device** devices, size_t devices_count)
+{
+	if (!atomic_load_explicit(&libredxx_recording_active, memory_order_relaxed)) {
+		return;
+	}
+	struct libredxx_replay_device_record* records = calloc(devices_count ? devices_count : 1, sizeof(struct libredxx_replay_device_record));
+	if (!records) {
+		return;
+	}
+	for (size_t i = 0; i < devices_count; ++i) {
+		libredxx_record_device(devices[i], &records[i]);
+	}
+	libredxx_mutex_lock(&libredxx_recording.mutex);
+	libredxx_record(LIBREDXX_REPLAY_FIND, 0, LIBREDXX_ENDPOINT_A, LIBREDXX_STATUS_SUCCESS, records, devices_count * sizeof(struct libredxx_replay_device_record));
+	libredxx_mutex_unlock(&libredxx_recording.mutex);
+	free(records);
+}
+
+uint32_t libredxx_record_open(const libredxx_found_device* found)
+{
+	if (!atomic_load_explicit(&libredxx_recording_active, memory_order_relaxed)) {
+		return 0;
+	}
+	struct libredxx_replay_device_record device;
+	libredxx_record_device(found, &device);
+	libredxx_mutex_lock(&libredxx_recording.mutex);
+	uint32_t session = 0;
+	if (libredxx_recording.file) {
+		session = ++libredxx_recording.session_count;
+		libredxx_record(LIBREDXX_REPLAY_OPEN, session, LIBREDXX_ENDPOINT_A, LIBREDXX_STATUS_SUCCESS, &device, sizeof(device));
+	}
+	libredxx_mutex_unlock(&libredxx_recording.mutex);
+	return session;
+}
+
+static void libredxx_record_session(uint32_t kind, uint32_t session, libredxx_endpoint endpoint, libredxx_status status, const void* payload, size_t size)
+{
+	if (!session || !atomic_load_explicit(&libredxx_recording_active, memory_order_relaxed)) {
+		return;
+	}
+	libredxx_mutex_lock(&libredxx_recording.mutex);
+	libredxx_record(kind, session, endpoint, status, payload, size);
+	libredxx_mutex_unlock(&libredxx_recording.mutex);
+}
+
+void libredxx_record_close(uint32_t session)
+{
+	libredxx_record_session(LIBREDXX_REPLAY_CLOSE, session, LIBREDXX_ENDPOINT_A, LIBREDXX_STATUS_SUCCESS, NULL, 0);
+}
+
+void libredxx_record_read(uint32_t session, libredxx_endpoint endpoint, libredxx_status status, const void* data, size_t size)
+{
+	libredxx_record_session(LIBREDXX_REPLAY_READ, session, endpoint, status, data, status == LIBREDXX_STATUS_SUCCESS ? size : 0);
+}
+
+void libredxx_record_write(uint32_t session, libredxx_endpoint endpoint, libredxx_status status, size_t size)
+{
+	// only the size is kept, replay doesn't check what is written
+	uint64_t written = size;
+	libredxx_record_session(LIBREDXX_REPLAY_WRITE, session, endpoint, status, &written, sizeof(written));
+}
+
+void libredxx_record_interrupt(uint32_t session)
+{
+	libredxx_record_session(LIBREDXX_REPLAY_INTERRUPT, session, LIBREDXX_ENDPOINT_A, LIBREDXX_STATUS_SUCCESS, NULL, 0);
+}
+
+libredxx_status libredxx_record_start(const char* path)
+{
+	libredxx_mutex_lock(&libredxx_recording.mutex);
+	if (libredxx_recording.file) {
+		libredxx_mutex_unlock(&libredxx_recording.mutex);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		libredxx_mutex_unlock(&libredxx_recording.mutex);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	if (fwrite(LIBREDXX_REPLAY_MAGIC, LIBREDXX_REPLAY_MAGIC_SIZE, 1, file) != 1) {
+		fclose(file);
+		libredxx_mutex_unlock(&libredxx_recording.mutex);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	libredxx_recording.file = file;
+	libredxx_recording.start_ns = libredxx_time_ns();
+	libredxx_recording.session_count = 0;
+	libredxx_recording.failed = false;
+	atomic_store_explicit(&libredxx_recording_active, true, memory_order_relaxed);
+	libredxx_mutex_unlock(&libredxx_recording.mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_record_stop(void)
+{
+	libredxx_mutex_lock(&libredxx_recording.mutex);
+	if (!libredxx_recording.file) {
+		libredxx_mutex_unlock(&libredxx_recording.mutex);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	atomic_store_explicit(&libredxx_recording_active, false, memory_order_relaxed);
+	bool failed = libredxx_recording.failed;
+	failed |= fclose(libredxx_recording.file) != 0;
+	libredxx_recording.file = NULL;
+	libredxx_mutex_unlock(&libredxx_recording.mutex);
+	return failed ? LIBREDXX_STATUS_ERROR_SYS : LIBREDXX_STATUS_SUCCESS;
+}
+
+struct libredxx_replay_entry {
+	struct libredxx_replay_record record;
+	const uint8_t* payload;
+};
+
+struct libredxx_replay_queue {
+	size_t* entries;
+	size_t count;
+	size_t cursor;
+	size_t offset; // into the current read, when it didn't fit the buffer
+};
+
+struct libredxx_replay_session {
+	libredxx_replay_device device;
+	uint64_t open_time_ns;
+	uint64_t base_ns; // when the session was opened during replay
+	struct libredxx_replay_queue reads[LIBREDXX_REPLAY_ENDPOINT_COUNT];
+	struct libredxx_replay_queue writes[LIBREDXX_REPLAY_ENDPOINT_COUNT];
+	bool claimed;
+	bool interrupted;
+};
+
+static struct {
+	libredxx_mutex mutex;
+	libredxx_cond cond;
+	uint8_t* data;
+	struct libredxx_replay_entry* entries;
+	size_t entry_count;
+	size_t* finds;
+	size_t find_count;
+	size_t find_cursor;
+	libredxx_replay_session* sessions;
+	size_t session_count;
+	size_t open_count;
+	uint32_t flags;
+} libredxx_replay = {.mutex = LIBREDXX_MUTEX_INIT, .cond = LIBREDXX_COND_INIT};
+static _Atomic bool libredxx_replay_active;
+
+bool libredxx_replay_enabled(void)
+{
+	return atomic_load_explicit(&libredxx_replay_active, memory_order_acquire);
+}
+
+static void libredxx_replay_device_from_record(const struct libredxx_replay_device_record* record, libredxx_replay_device* device)
+{
+	memset(device, 0, sizeof(*device));
+	device->id.vid = record->vid;
+	device->id.pid = record->pid;
+	device->type = (libredxx_device_type)record->type;
+	device->interface_index = record->interface_index;
+	memcpy(device->serial.serial, record->serial, sizeof(device->serial.serial));
+}
+
+static bool libredxx_replay_device_equal(const libredxx_replay_device* a, const libredxx_replay_device* b)
+{
+	return a->id.vid == b->id.vid && a->id.pid == b->id.pid && a->type == b->type && a->interface_index == b->interface_index && memcmp(a->serial.serial, b->serial.serial, sizeof(a->serial.serial)) == 0;
+}
+
+libredxx_status libredxx_replay_find(const libredxx_find_filter* filters, size_t filters_count, libredxx_replay_device** devices, size_t* devices_count)
+{
+	*devices = NULL;
+	*devices_count = 0;
+	libredxx_mutex_lock(&libredxx_replay.mutex);
+	if (libredxx_replay.find_count == 0) {
+		libredxx_mutex_unlock(&libredxx_replay.mutex);
+		return LIBREDXX_STATUS_SUCCESS;
+	}
+	// every find plays the next recorded one, the last one repeats
+	size_t find = libredxx_replay.find_cursor < libredxx_replay.find_count ? libredxx_replay.find_cursor++ : libredxx_replay.find_count - 1;
+	const struct libredxx_replay_entry* entry = &libredxx_replay.entries[libredxx_replay.finds[find]];
+	const size_t recorded_count = entry->record.size / sizeof(struct libredxx_replay_device_record);
+	libredxx_mutex_unlock(&libredxx_replay.mutex);
+
+	libredxx_replay_device* found = malloc((recorded_count ? recorded_count : 1) * sizeof(libredxx_replay_device));
+	if (!found) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	size_t found_count = 0;
+	for (size_t i = 0; i < recorded_count; ++i) {
+		struct libredxx_replay_device_record record;
+		memcpy(&record, entry->payload + i * sizeof(record), sizeof(record));
+		for (size_t j = 0; j < filters_count; ++j) {
+			if (filters[j].id.vid == record.vid && filters[j].id.pid == record.pid) {
+				libredxx_replay_device_from_record(&record, &found[found_count++]);
+				break;
+			}
+		}
+	}
+	*devices = found;
+	*devices_count = found_count;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_replay_session* libredxx_replay_open(const libredxx_replay_device* device)
+{
+	libredxx_replay_session* opened = NULL;
+	libredxx_mutex_lock(&libredxx_replay.mutex);
+	// the nth open of a device plays the nth recorded session of it
+	for (size_t i = 0; i < libredxx_replay.session_count; ++i) {
+		libredxx_replay_session* session = &libredxx_replay.sessions[i];
+		if (!session->claimed && libredxx_replay_device_equal(&session->device, device)) {
+			session->claimed = true;
+			session->interrupted = false;
+			session->base_ns = libredxx_time_ns();
+			++libredxx_replay.open_count;
+			opened = session;
+			break;
+		}
+	}
+	libredxx_mutex_unlock(&libredxx_replay.mutex);
+	return opened;
+}
+
+void libredxx_replay_close(libredxx_replay_session* session)
+{
+	libredxx_mutex_lock(&libredxx_replay.mutex);
+	session->interrupted = true;
+	libredxx_cond_broadcast(&libredxx_replay.cond);
+	--libredxx_replay.open_count;
+	libredxx_mutex_unlock(&libredxx_replay.mutex);
+}
+
+libredxx_status libredxx_replay_read(libredxx_replay_session* session, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	if ((unsigned int)endpoint >= LIBREDXX_REPLAY_ENDPOINT_COUNT) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_mutex_lock(&libredxx_replay.mutex);
+	session->interrupted = false;
+	struct libredxx_replay_queue* queue = &session->reads[endpoint];
+	if (queue->cursor == queue->count) {
+		libredxx_mutex_unlock(&libredxx_replay.mutex);
+		return LIBREDXX_STATUS_ERROR_IO; // the recording ended
+	}
+	const struct libredxx_replay_entry* entry = &libredxx_replay.entries[queue->entries[queue->cursor]];
+	if (libredxx_replay.flags & LIBREDXX_REPLAY_REALTIME) {
+		// keeps the timing relative to when the session was opened
+		const uint64_t deadline = session->base_ns + (entry->record.time_ns - session->open_time_ns);
+		while (!session->interrupted) {
+			const uint64_t now = libredxx_time_ns();
+			if (now >= deadline) {
+				break;
+			}
+			libredxx_cond_wait_for(&libredxx_replay.cond, &libredxx_replay.mutex, deadline - now);
+		}
+		if (session->interrupted) {
+			libredxx_mutex_unlock(&libredxx_replay.mutex);
+			return LIBREDXX_STATUS_ERROR_INTERRUPTED;
+		}
+	}
+	const libredxx_status status = (libredxx_status)entry->record.status;
+	if (status == LIBREDXX_STATUS_SUCCESS) {
+		const size_t remaining = (size_t)entry->record.size - queue->offset;
+		const size_t size = remaining < *buffer_size ? remaining : *buffer_size;
+		memcpy(buffer, entry->payload + queue->offset, size);
+		*buffer_size = size;
+		queue->offset += size;
+		if (queue->offset == entry->record.size) {
+			++queue->cursor;
+			queue->offset = 0;
+		}
+	} else {
+		++queue->cursor;
+	}
+	libredxx_mutex_unlock(&libredxx_replay.mutex);
+	return status;
+}
+
+libredxx_status libredxx_replay_write(libredxx_replay_session* session, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	if ((unsigned int)endpoint >= LIBREDXX_REPLAY_ENDPOINT_COUNT) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_mutex_lock(&libredxx_replay.mutex);
+	struct libredxx_replay_queue* queue = &session->writes[endpoint];
+	libredxx_status status = LIBREDXX_STATUS_SUCCESS;
+	if (queue->cursor < queue->count) {
+		// writes past the end of the recording just succeed
+		status = (libredxx_status)libredxx_replay.entries[queue->entries[queue->cursor++]].record.status;
+	}
+	libredxx_mutex_unlock(&libredxx_replay.mutex);
+	(void)buffer_size;
+	return status;
+}
+
+libredxx_status libredxx_replay_interrupt(libredxx_replay_session* session)
+{
+	libredxx_mutex_lock(&libredxx_replay.mutex);
+	session->interrupted = true;
+	libredxx_cond_broadcast(&libredxx_replay.cond);
+	libredxx_mutex_unlock(&libredxx_replay.mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static bool libredxx_replay_push(size_t** array, size_t* count, size_t value)
+{
+	// grows at powers of two
+	if ((*count & (*count - 1)) == 0) {
+		size_t* grown = realloc(*array, (*count ? *count * 2 : 1) * sizeof(size_t));
+		if (!grown) {
+			return false;
+		}
+		*array = grown;
+	}
+	(*array)[(*count)++] = value;
+	return true;
+}
+
+static void libredxx_replay_free(void)
+{
+	for (size_t i = 0; i < libredxx_replay.session_count; ++i) {
+		for (size_t endpoint = 0; endpoint < LIBREDXX_REPLAY_ENDPOINT_COUNT; ++endpoint) {
+			free(libredxx_replay.sessions[i].reads[endpoint].entries);
+			free(libredxx_replay.sessions[i].writes[endpoint].entries);
+		}
+	}
+	free(libredxx_replay.sessions);
+	free(libredxx_replay.finds);
+	free(libredxx_replay.entries);
+	free(libredxx_replay.data);
+	libredxx_replay.sessions = NULL;
+	libredxx_replay.session_count = 0;
+	libredxx_replay.finds = NULL;
+	libredxx_replay.find_count = 0;
+	libredxx_replay.find_cursor = 0;
+	libredxx_replay.entries = NULL;
+	libredxx_replay.entry_count = 0;
+	libredxx_replay.data = NULL;
+}
+
+static libredxx_status libredxx_replay_load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	size_t size = 0;
+	size_t capacity = 1 << 16;
+	uint8_t* data = malloc(capacity);
+	while (data) {
+		size += fread(data + size, 1, capacity - size, file);
+		if (size < capacity) {
+			break;
+		}
+		capacity *= 2;
+		uint8_t* grown = realloc(data, capacity);
+		if (!grown) {
+			free(data);
+		}
+		data = grown;
+	}
+	const bool failed = ferror(file) != 0;
+	fclose(file);
+	if (!data || failed) {
+		free(data);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	libredxx_replay.data = data;
+	if (size < LIBREDXX_REPLAY_MAGIC_SIZE || memcmp(data, LIBREDXX_REPLAY_MAGIC, LIBREDXX_REPLAY_MAGIC_SIZE) != 0) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+
+	size_t offset = LIBREDXX_REPLAY_MAGIC_SIZE;
+	size_t entries_capacity = 0;
+	while (offset < size) {
+		struct libredxx_replay_entry entry;
+		if (size - offset < sizeof(entry.record)) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		memcpy(&entry.record, data + offset, sizeof(entry.record));
+		offset += sizeof(entry.record);
+		if (size - offset < entry.record.size) {
+			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+		}
+		entry.payload = data + offset;
+		offset += (size_t)entry.record.size;
+		if (libredxx_replay.entry_count == entries_capacity) {
+			entries_capacity = entries_capacity ? entries_capacity * 2 : 256;
+			struct libredxx_replay_entry* grown = realloc(libredxx_replay.entries, entries_capacity * sizeof(entry));
+			if (!grown) {
+				return LIBREDXX_STATUS_ERROR_SYS;
+			}
+			libredxx_replay.entries = grown;
+		}
+		libredxx_replay.entries[libredxx_replay.entry_count++] = entry;
+	}
+
+	for (size_t i = 0; i < libredxx_replay.entry_count; ++i) {
+		const struct libredxx_replay_entry* entry = &libredxx_replay.entries[i];
+		const uint32_t kind = entry->record.kind;
+		if (kind == LIBREDXX_REPLAY_FIND) {
+			if (!libredxx_replay_push(&libredxx_replay.finds, &libredxx_replay.find_count, i)) {
+				return LIBREDXX_STATUS_ERROR_SYS;
+			}
+		} else if (kind == LIBREDXX_REPLAY_OPEN) {
+			if (entry->record.session != libredxx_replay.session_count + 1 || entry->record.size != sizeof(struct libredxx_replay_device_record)) {
+				return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+			}
+			libredxx_replay_session* sessions = realloc(libredxx_replay.sessions, (libredxx_replay.session_count + 1) * sizeof(libredxx_replay_session));
+			if (!sessions) {
+				return LIBREDXX_STATUS_ERROR_SYS;
+			}
+			libredxx_replay.sessions = sessions;
+			libredxx_replay_session* session = &sessions[libredxx_replay.session_count++];
+			memset(session, 0, sizeof(*session));
+			struct libredxx_replay_device_record record;
+			memcpy(&record, entry->payload, sizeof(record));
+			libredxx_replay_device_from_record(&record, &session->device);
+			session->open_time_ns = entry->record.time_ns;
+		} else if (kind == LIBREDXX_REPLAY_READ || kind == LIBREDXX_REPLAY_WRITE) {
+			if (entry->record.session == 0 || entry->record.session > libredxx_replay.session_count || entry->record.endpoint >= LIBREDXX_REPLAY_ENDPOINT_COUNT) {
+				return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+			}
+			libredxx_replay_session* session = &libredxx_replay.sessions[entry->record.session - 1];
+			struct libredxx_replay_queue* queue = kind == LIBREDXX_REPLAY_READ ? &session->reads[entry->record.endpoint] : &session->writes[entry->record.endpoint];
+			if (!libredxx_replay_push(&queue->entries, &queue->count, i)) {
+				return LIBREDXX_STATUS_ERROR_SYS;
+			}
+		}
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_replay_start(const char* path, uint32_t flags)
+{
+	libredxx_mutex_lock(&libredxx_replay.mutex);
+	if (atomic_load_explicit(&libredxx_replay_active, memory_order_relaxed)) {
+		libredxx_mutex_unlock(&libredxx_replay.mutex);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_status status = libredxx_replay_load(path);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_replay_free();
+		libredxx_mutex_unlock(&libredxx_replay.mutex);
+		return status;
+	}
+	libredxx_replay.flags = flags;
+	libredxx_replay.open_count = 0;
+	atomic_store_explicit(&libredxx_replay_active, true, memory_order_release);
+	libredxx_mutex_unlock(&libredxx_replay.mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_replay_stop(void)
+{
+	libredxx_mutex_lock(&libredxx_replay.mutex);
+	if (!atomic_load_explicit(&libredxx_replay_active, memory_order_relaxed) || libredxx_replay.open_count != 0) {
+		libredxx_mutex_unlock(&libredxx_replay.mutex);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	atomic_store_explicit(&libredxx_replay_active, false, memory_order_relaxed);
+	libredxx_replay_free();
+	libredxx_mutex_unlock(&libredxx_replay.mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LIBREDXX_LIBREDXX_REPLAY_H
+#define LIBREDXX_LIBREDXX_REPLAY_H
+
+#include "libredxx.h"
+
+/*
+ * Recording hooks, called by the backends on the public API paths. A session
+ * id of 0 means the device isn't being recorded, which is the case for devices
+ * opened before recording started.
+ */
+void libredxx_record_find(libredxx_found_device** devices, size_t devices_count);
+uint32_t libredxx_record_open(const libredxx_found_device* found);
+void libredxx_record_close(uint32_t session);
+void libredxx_record_read(uint32_t session, libredxx_endpoint endpoint, libredxx_status status, const void* data, size_t size);
+void libredxx_record_write(uint32_t session, libredxx_endpoint endpoint, libredxx_status status, size_t size);
+void libredxx_record_interrupt(uint32_t session);
+
+// a device as it was found while recording
+struct libredxx_replay_device {
+	libredxx_device_id id;
+	libredxx_device_type type;
+	uint8_t interface_index;
+	libredxx_serial serial;
+};
+typedef struct libredxx_replay_device libredxx_replay_device;
+
+typedef struct libredxx_replay_session libredxx_replay_session;
+
+/*
+ * Replay, the backends hand found and opened replay devices over to these
+ * instead of touching hardware. devices is allocated with malloc.
+ */
+bool libredxx_replay_enabled(void);
+libredxx_status libredxx_replay_find(const libredxx_find_filter* filters, size_t filters_count, libredxx_replay_device** devices, size_t* devices_count);
+libredxx_replay_session* libredxx_replay_open(const libredxx_replay_device* device);
+void libredxx_replay_close(libredxx_replay_session* session);
+libredxx_status libredxx_replay_read(libredxx_replay_session* session, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint);
+libredxx_status libredxx_replay_write(libredxx_replay_session* session, size_t* buffer_size, libredxx_endpoint endpoint);
+libredxx_status libredxx_replay_interrupt(libredxx_replay_session* session);
+
+#endif // LIBREDXX_LIBREDXX_REPLAY_H
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "libredxx_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+libredxx_status libredxx_ring_init(libredxx_ring* ring, size_t entry_size, size_t capacity)
+{
+	if (!entry_size || !capacity || capacity > SIZE_MAX / 2) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	size_t rounded = 1;
+	while (rounded < capacity) {
+		rounded <<= 1;
+	}
+	if (rounded > SIZE_MAX / entry_size) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	ring->entries = malloc(rounded * entry_size);
+	if (!ring->entries) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	ring->cached_head = 0;
+	ring->cached_tail = 0;
+	ring->entry_size = entry_size;
+	ring->mask = rounded - 1;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+void libredxx_ring_destroy(libredxx_ring* ring)
+{
+	free(ring->entries);
+	ring->entries = NULL;
+}
+
+bool libredxx_ring_push(libredxx_ring* ring, const void* entry)
+{
+	const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	if (tail - ring->cached_head > ring->mask) {
+		ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+		if (tail - ring->cached_head > ring->mask) {
+			return false;
+		}
+	}
+	memcpy(&ring->entries[(tail & ring->mask) * ring->entry_size], entry, ring->entry_size);
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+	return true;
+}
+
+bool libredxx_ring_pop(libredxx_ring* ring, void* entry)
+{
+	const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	if (head == ring->cached_tail) {
+		ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+		if (head == ring->cached_tail) {
+			return false;
+		}
+	}
+	memcpy(entry, &ring->entries[(head & ring->mask) * ring->entry_size], ring->entry_size);
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	return true;
+}
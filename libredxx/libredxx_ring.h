@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LIBREDXX_LIBREDXX_RING_H
+#define LIBREDXX_LIBREDXX_RING_H
+
+#include "libredxx.h"
+#include "libredxx_pool.h"
+
+#include <stdatomic.h>
+
+/*
+ * Lock-free ring of fixed size entries for exactly one producer and one consumer.
+ * The producer only writes tail and the consumer only writes head, each on its own
+ * cache line next to that side's cached copy of the other index, so the two sides
+ * only touch each other's line when the cached copy says the ring looks full or empty.
+ */
+struct libredxx_ring {
+	_Alignas(LIBREDXX_CACHE_LINE_SIZE) _Atomic size_t head;
+	size_t cached_tail;
+	_Alignas(LIBREDXX_CACHE_LINE_SIZE) _Atomic size_t tail;
+	size_t cached_head;
+	_Alignas(LIBREDXX_CACHE_LINE_SIZE) uint8_t* entries;
+	size_t entry_size;
+	size_t mask; // capacity - 1, the capacity is a power of two
+};
+typedef struct libredxx_ring libredxx_ring;
+
+libredxx_status libredxx_ring_init(libredxx_ring* ring, size_t entry_size, size_t capacity);
+void libredxx_ring_destroy(libredxx_ring* ring);
+// false when full
+bool libredxx_ring_push(libredxx_ring* ring, const void* entry);
+// false when empty
+bool libredxx_ring_pop(libredxx_ring* ring, void* entry);
+
+#endif // LIBREDXX_LIBREDXX_RING_H
@@ -0,0 +1,491 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE // memfd_create, accept4
+#endif
+
+#include "libredxx.h"
+
+#ifdef __linux__
+
+#include "libredxx_pool.h"
+#include "libredxx_thread.h"
+#include "libredxx_time.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * The owner keeps a memfd holding a header and slot_count slots, chunk n going
+ * into slot n % slot_count. A slot's sequence says which chunk it holds and is
+ * LIBREDXX_SHM_WRITING while it is replaced, so a client that copied a chunk
+ * checks the sequence again to know the owner didn't overwrite it meanwhile.
+ * Clients wait on the futex word, which the owner bumps with every chunk. The
+ * memfd is handed out read-only over an abstract unix socket named after the
+ * fan-out, by a thread of the owner. Abstract sockets have no file permissions,
+ * so the thread checks the peer's credentials and only serves its own user.
+ */
+#define LIBREDXX_SHM_MAGIC "RDXXSHM1"
+#define LIBREDXX_SHM_MAGIC_SIZE 8
+#define LIBREDXX_SHM_SOCKET_PREFIX "libredxx-shm-"
+#define LIBREDXX_SHM_NAME_MAX 64
+#define LIBREDXX_SHM_WRITING UINT64_MAX
+
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared counters need lock-free 64 bit atomics");
+
+struct libredxx_shm_header {
+	char magic[LIBREDXX_SHM_MAGIC_SIZE];
+	uint64_t slot_size;
+	uint64_t slot_count;
+	uint64_t slot_stride;
+	_Alignas(LIBREDXX_CACHE_LINE_SIZE) _Atomic uint64_t head; // chunks published
+	_Atomic uint32_t futex;
+	_Atomic uint32_t closed;
+};
+
+struct libredxx_shm_slot {
+	_Atomic uint64_t sequence;
+	_Atomic uint64_t timestamp_ns;
+	_Atomic uint64_t size;
+};
+
+struct libredxx_shm_owner {
+	struct libredxx_shm_header* header;
+	size_t map_size;
+	int memfd;
+	int readonly_fd; // what clients get
+	int listener;
+	libredxx_thread thread;
+	bool thread_started;
+};
+
+struct libredxx_shm_client {
+	const struct libredxx_shm_header* header;
+	size_t map_size;
+	uint64_t cursor; // next chunk to read
+	uint64_t lost;
+};
+
+static struct libredxx_shm_slot* libredxx_shm_slot_at(const struct libredxx_shm_header* header, uint64_t sequence)
+{
+	const size_t offset = sizeof(struct libredxx_shm_header) + (size_t)(sequence % header->slot_count) * (size_t)header->slot_stride;
+	return (struct libredxx_shm_slot*)((uint8_t*)header + offset);
+}
+
+static bool libredxx_shm_address(const char* name, struct sockaddr_un* address, socklen_t* address_size)
+{
+	const size_t name_size = strlen(name);
+	if (!name_size || name_size > LIBREDXX_SHM_NAME_MAX) {
+		return false;
+	}
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	// abstract, the leading NUL keeps it off the file system and it goes away with the owner
+	const int length = snprintf(&address->sun_path[1], sizeof(address->sun_path) - 1, LIBREDXX_SHM_SOCKET_PREFIX "%s", name);
+	*address_size = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + (size_t)length);
+	return true;
+}
+
+static void libredxx_shm_main(void* arg)
+{
+	struct libredxx_shm_owner* owner = arg;
+	while (true) {
+		const int connection = accept4(owner->listener, NULL, NULL, SOCK_CLOEXEC);
+		if (connection == -1) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			// shut down by libredxx_shm_destroy
+			break;
+		}
+		// the memfd only goes to processes of the same user, anyone else fails to attach
+		struct ucred credentials;
+		socklen_t credentials_size = sizeof(credentials);
+		if (getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_size) != 0 || credentials.uid != geteuid()) {
+			close(connection);
+			continue;
+		}
+		char byte = 0;
+		struct iovec iov = {&byte, 1};
+		union {
+			struct cmsghdr header;
+			char buffer[CMSG_SPACE(sizeof(int))];
+		} control;
+		memset(&control, 0, sizeof(control));
+		struct msghdr message = {0};
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control.buffer;
+		message.msg_controllen = sizeof(control.buffer);
+		struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &owner->readonly_fd, sizeof(int));
+		// a client that went away meanwhile just doesn't get it
+		sendmsg(connection, &message, MSG_NOSIGNAL);
+		close(connection);
+	}
+}
+
+libredxx_status libredxx_shm_destroy(libredxx_shm_owner* owner)
+{
+	if (!owner) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	if (owner->thread_started) {
+		shutdown(owner->listener, SHUT_RDWR);
+		libredxx_thread_join(owner->thread);
+	}
+	if (owner->listener != -1) {
+		close(owner->listener);
+	}
+	if (owner->header) {
+		// attached clients keep their mapping, this lets them finish reading and stop
+		atomic_store_explicit(&owner->header->closed, 1, memory_order_release);
+		atomic_fetch_add_explicit(&owner->header->futex, 1, memory_order_release);
+		syscall(SYS_futex, &owner->header->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+		munmap(owner->header, owner->map_size);
+	}
+	if (owner->readonly_fd != -1) {
+		close(owner->readonly_fd);
+	}
+	if (owner->memfd != -1) {
+		close(owner->memfd);
+	}
+	free(owner);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_shm_create(const char* name, size_t slot_size, size_t slot_count, libredxx_shm_owner** owner)
+{
+	struct sockaddr_un address;
+	socklen_t address_size;
+	if (!name || !owner || !slot_size || slot_count < 2 || !libredxx_shm_address(name, &address, &address_size)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const size_t stride = (sizeof(struct libredxx_shm_slot) + slot_size + LIBREDXX_CACHE_LINE_SIZE - 1) / LIBREDXX_CACHE_LINE_SIZE * LIBREDXX_CACHE_LINE_SIZE;
+	if (stride < slot_size || slot_count > (SIZE_MAX - sizeof(struct libredxx_shm_header)) / stride) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	struct libredxx_shm_owner* private_owner = calloc(1, sizeof(struct libredxx_shm_owner));
+	if (!private_owner) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	private_owner->memfd = -1;
+	private_owner->readonly_fd = -1;
+	private_owner->listener = -1;
+	private_owner->map_size = sizeof(struct libredxx_shm_header) + slot_count * stride;
+	private_owner->memfd = memfd_create("libredxx-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (private_owner->memfd == -1 || ftruncate(private_owner->memfd, (off_t)private_owner->map_size) != 0
+		|| fcntl(private_owner->memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+		libredxx_shm_destroy(private_owner);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	void* map = mmap(NULL, private_owner->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, private_owner->memfd, 0);
+	if (map == MAP_FAILED) {
+		libredxx_shm_destroy(private_owner);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	struct libredxx_shm_header* header = map;
+	private_owner->header = header;
+	header->slot_size = slot_size;
+	header->slot_count = slot_count;
+	header->slot_stride = stride;
+	atomic_init(&header->head, 0);
+	atomic_init(&header->futex, 0);
+	atomic_init(&header->closed, 0);
+	for (size_t i = 0; i < slot_count; ++i) {
+		atomic_init(&libredxx_shm_slot_at(header, i)->sequence, LIBREDXX_SHM_WRITING);
+	}
+	memcpy(header->magic, LIBREDXX_SHM_MAGIC, LIBREDXX_SHM_MAGIC_SIZE);
+	// reopening through /proc gives a descriptor that can't be mapped writable
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/self/fd/%d", private_owner->memfd);
+	private_owner->readonly_fd = open(path, O_RDONLY | O_CLOEXEC);
+	private_owner->listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (private_owner->readonly_fd == -1 || private_owner->listener == -1 || bind(private_owner->listener, (struct sockaddr*)&address, address_size) != 0
+		|| listen(private_owner->listener, 16) != 0) {
+		libredxx_shm_destroy(private_owner);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	libredxx_status status = libredxx_thread_create(&private_owner->thread, libredxx_shm_main, private_owner);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_shm_destroy(private_owner);
+		return status;
+	}
+	private_owner->thread_started = true;
+	*owner = private_owner;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_shm_publish(libredxx_shm_owner* owner, const void* data, size_t size, uint64_t timestamp_ns)
+{
+	if (!owner || (!data && size) || size > owner->header->slot_size) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	struct libredxx_shm_header* header = owner->header;
+	const uint64_t sequence = atomic_load_explicit(&header->head, memory_order_relaxed);
+	struct libredxx_shm_slot* slot = libredxx_shm_slot_at(header, sequence);
+	atomic_store_explicit(&slot->sequence, LIBREDXX_SHM_WRITING, memory_order_relaxed);
+	// keeps the data from being written before a client can see the slot is being replaced
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&slot->timestamp_ns, timestamp_ns, memory_order_relaxed);
+	atomic_store_explicit(&slot->size, size, memory_order_relaxed);
+	memcpy(slot + 1, data, size);
+	atomic_store_explicit(&slot->sequence, sequence, memory_order_release);
+	atomic_store_explicit(&header->head, sequence + 1, memory_order_release);
+	atomic_fetch_add_explicit(&header->futex, 1, memory_order_release);
+	// clients don't write to the mapping to say they sleep, so every chunk wakes
+	syscall(SYS_futex, &header->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_shm_attach(const char* name, libredxx_shm_client** client)
+{
+	struct sockaddr_un address;
+	socklen_t address_size;
+	if (!name || !client || !libredxx_shm_address(name, &address, &address_size)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (connection == -1) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	if (connect(connection, (struct sockaddr*)&address, address_size) != 0) {
+		close(connection);
+		return errno == ECONNREFUSED ? LIBREDXX_STATUS_ERROR_IO : LIBREDXX_STATUS_ERROR_SYS;
+	}
+	char byte;
+	struct iovec iov = {&byte, 1};
+	union {
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(int))];
+	} control;
+	struct msghdr message = {0};
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+	ssize_t received;
+	while ((received = recvmsg(connection, &message, MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR) {
+	}
+	close(connection);
+	struct cmsghdr* cmsg = received == 1 ? CMSG_FIRSTHDR(&message) : NULL;
+	if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(int))) {
+		return LIBREDXX_STATUS_ERROR_IO;
+	}
+	int fd;
+	memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	const size_t map_size = (size_t)st.st_size;
+	void* map = map_size >= sizeof(struct libredxx_shm_header) ? mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (map == MAP_FAILED) {
+		return LIBREDXX_STATUS_ERROR_IO;
+	}
+	const struct libredxx_shm_header* header = map;
+	if (memcmp(header->magic, LIBREDXX_SHM_MAGIC, LIBREDXX_SHM_MAGIC_SIZE) != 0 || !header->slot_count
+		|| header->slot_stride < sizeof(struct libredxx_shm_slot) + header->slot_size
+		|| header->slot_count > (map_size - sizeof(struct libredxx_shm_header)) / header->slot_stride) {
+		munmap(map, map_size);
+		return LIBREDXX_STATUS_ERROR_IO;
+	}
+	struct libredxx_shm_client* private_client = calloc(1, sizeof(struct libredxx_shm_client));
+	if (!private_client) {
+		munmap(map, map_size);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	private_client->header = header;
+	private_client->map_size = map_size;
+	// only what is published from now on
+	private_client->cursor = atomic_load_explicit(&header->head, memory_order_acquire);
+	*client = private_client;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_shm_detach(libredxx_shm_client* client)
+{
+	if (!client) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	munmap((void*)client->header, client->map_size);
+	free(client);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_shm_get_slot_size(const libredxx_shm_client* client, size_t* slot_size)
+{
+	if (!client || !slot_size) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	*slot_size = (size_t)client->header->slot_size;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_shm_get_lost(const libredxx_shm_client* client, uint64_t* lost)
+{
+	if (!client || !lost) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	*lost = client->lost;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_shm_read(libredxx_shm_client* client, void* buffer, size_t* buffer_size, uint64_t* timestamp_ns, uint32_t timeout_ms)
+{
+	if (!client || !buffer || !buffer_size) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const struct libredxx_shm_header* header = client->header;
+	const uint64_t deadline_ns = libredxx_time_ns() + (uint64_t)timeout_ms * 1000000u;
+	while (true) {
+		// loaded before head, a chunk published after this changes it and the wait returns right away
+		const uint32_t futex = atomic_load_explicit(&header->futex, memory_order_acquire);
+		const uint64_t head = atomic_load_explicit(&header->head, memory_order_acquire);
+		if (client->cursor < head) {
+			if (head - client->cursor > header->slot_count) {
+				// overrun, carry on with the oldest chunk still there
+				client->lost += head - header->slot_count - client->cursor;
+				client->cursor = head - header->slot_count;
+				return LIBREDXX_STATUS_ERROR_OVERFLOW;
+			}
+			const struct libredxx_shm_slot* slot = libredxx_shm_slot_at(header, client->cursor);
+			bool overwritten = atomic_load_explicit(&slot->sequence, memory_order_acquire) != client->cursor;
+			const uint64_t size = atomic_load_explicit(&slot->size, memory_order_relaxed);
+			const uint64_t slot_timestamp_ns = atomic_load_explicit(&slot->timestamp_ns, memory_order_relaxed);
+			if (!overwritten && size > *buffer_size) {
+				return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+			}
+			if (!overwritten) {
+				memcpy(buffer, slot + 1, (size_t)size);
+				atomic_thread_fence(memory_order_acquire);
+				overwritten = atomic_load_explicit(&slot->sequence, memory_order_relaxed) != client->cursor;
+			}
+			if (overwritten) {
+				// the owner lapped this client while it was copying
+				++client->lost;
+				++client->cursor;
+				return LIBREDXX_STATUS_ERROR_OVERFLOW;
+			}
+			++client->cursor;
+			*buffer_size = (size_t)size;
+			if (timestamp_ns) {
+				*timestamp_ns = slot_timestamp_ns;
+			}
+			return LIBREDXX_STATUS_SUCCESS;
+		}
+		if (atomic_load_explicit(&header->closed, memory_order_acquire)) {
+			return LIBREDXX_STATUS_ERROR_IO;
+		}
+		const uint64_t now_ns = libredxx_time_ns();
+		if (now_ns >= deadline_ns) {
+			return LIBREDXX_STATUS_ERROR_TIMEOUT;
+		}
+		const uint64_t remaining_ns = deadline_ns - now_ns;
+		struct timespec timeout = {(time_t)(remaining_ns / 1000000000u), (long)(remaining_ns % 1000000000u)};
+		syscall(SYS_futex, &header->futex, FUTEX_WAIT, futex, &timeout, NULL, 0);
+	}
+}
+
+#else
+
+libredxx_status libredxx_shm_create(const char* name, size_t slot_size, size_t slot_count, libredxx_shm_owner** owner)
+{
+	(void)name;
+	(void)slot_size;
+	(void)slot_count;
+	(void)owner;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_shm_publish(libredxx_shm_owner* owner, const void* data, size_t size, uint64_t timestamp_ns)
+{
+	(void)owner;
+	(void)data;
+	(void)size;
+	(void)timestamp_ns;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_shm_destroy(libredxx_shm_owner* owner)
+{
+	(void)owner;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_shm_attach(const char* name, libredxx_shm_client** client)
+{
+	(void)name;
+	(void)client;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_shm_detach(libredxx_shm_client* client)
+{
+	(void)client;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_shm_get_slot_size(const libredxx_shm_client* client, size_t* slot_size)
+{
+	(void)client;
+	(void)slot_size;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_shm_get_lost(const libredxx_shm_client* client, uint64_t* lost)
+{
+	(void)client;
+	(void)lost;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_shm_read(libredxx_shm_client* client, void* buffer, size_t* buffer_size, uint64_t* timestamp_ns, uint32_t timeout_ms)
+{
+	(void)client;
+	(void)buffer;
+	(void)buffer_size;
+	(void)timestamp_ns;
+	(void)timeout_ms;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+#endif
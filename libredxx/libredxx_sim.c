@@ -0,0 +1,1388 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "libredxx.h"
+
+#ifdef LIBREDXX_SIM
+
+#include "libredxx_d2xx.h"
+#include "libredxx_ft260.h"
+#include "libredxx_thread.h"
+#include "libredxx_time.h"
+#include "libredxx_usbfs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/usbdevice_fs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * The simulator replaces usbfs and sysfs underneath the Linux backend. Each
+ * simulated device gets a directory in a private sysfs tree, so enumeration
+ * reads real files, and opening its node hands out an eventfd that is readable
+ * while reaped URBs are waiting, which is what POLLOUT means for usbfs. Sync
+ * transfers run on the calling thread, URBs are completed by a worker thread
+ * per device. All device state is guarded by the device mutex, the lists of
+ * devices and handles by the global one, which is always taken first.
+ */
+
+#define LIBREDXX_SIM_BUS 1
+#define LIBREDXX_SIM_MAX_ADDRESS 127
+#define LIBREDXX_SIM_CHANNEL_COUNT 4
+#define LIBREDXX_SIM_FIFO_SIZE (64 * 1024)
+#define LIBREDXX_SIM_MAX_PACKET 1024
+#define LIBREDXX_SIM_TRIGGER_COUNT 16
+#define LIBREDXX_SIM_FEATURE_COUNT 8
+#define LIBREDXX_SIM_I2C_ADDRESS_COUNT 128
+#define LIBREDXX_SIM_I2C_READ_SIZE 60 // payload of an FT260 input report
+#define LIBREDXX_SIM_REPORT_COUNT (UINT16_MAX / LIBREDXX_SIM_I2C_READ_SIZE + 1) // one maximum I2C read
+#define LIBREDXX_SIM_D2XX_HEADER_SIZE 2
+#define LIBREDXX_SIM_D2XX_LATENCY_MS 16 // the chip default
+#define LIBREDXX_SIM_FT260_I2C_IDLE 0x20
+#define LIBREDXX_SIM_FT260_I2C_NACK 0x26 // idle, error and address not acknowledged
+
+enum libredxx_sim_pipe {
+	LIBREDXX_SIM_PIPE_INVALID,
+	LIBREDXX_SIM_PIPE_IN,
+	LIBREDXX_SIM_PIPE_OUT,
+	LIBREDXX_SIM_PIPE_TRIGGER, // D3XX read requests
+	LIBREDXX_SIM_PIPE_REPORT_IN, // FT260 input reports
+	LIBREDXX_SIM_PIPE_REPORT_OUT,
+};
+
+struct libredxx_sim_channel {
+	uint8_t* fifo; // device to host, loopback only
+	size_t fifo_head;
+	size_t fifo_count;
+	uint8_t pattern; // next byte of the source
+	uint8_t latency_ms;
+	uint16_t baud_value; // of the last SET_BAUD_RATE
+	uint16_t baud_index;
+	uint32_t triggers[LIBREDXX_SIM_TRIGGER_COUNT];
+	size_t trigger_head;
+	size_t trigger_count;
+};
+
+struct libredxx_sim_handle;
+
+struct libredxx_sim_urb {
+	struct libredxx_sim_urb* next;
+	struct libredxx_sim_handle* handle;
+	struct usbdevfs_urb* urb;
+	enum libredxx_sim_pipe pipe;
+	uint8_t channel;
+	bool counted; // towards fault_interval, once however often an IN URB is looked at before data arrives
+	bool started; // the device has taken it on, it completes at due_ns
+	int status;
+	size_t offset; // of an OUT transfer the device took so far
+	uint64_t submitted_ns;
+	uint64_t due_ns;
+};
+
+struct libredxx_sim_device {
+	struct libredxx_sim_device* next;
+	uint32_t id;
+	uint8_t address;
+	libredxx_sim_device_config config;
+	char sysfs_dir[512];
+	uint8_t interface_count;
+	uint16_t max_packet;
+	size_t refs; // the device list and every handle, guarded by the global mutex
+	libredxx_mutex mutex;
+	libredxx_cond cond;
+	libredxx_thread worker;
+	bool stopping;
+	bool removed;
+	uint64_t busy_until_ns;
+	uint64_t transfers;
+	uint32_t halted; // bit per endpoint, see libredxx_sim_endpoint_bit
+	struct libredxx_sim_handle* claims[LIBREDXX_SIM_CHANNEL_COUNT];
+	struct libredxx_sim_channel channels[LIBREDXX_SIM_CHANNEL_COUNT];
+	struct libredxx_sim_urb* urbs; // submitted and not completed, in order
+	uint8_t (*reports)[LIBREDXX_FT260_REPORT_SIZE];
+	size_t report_head;
+	size_t report_count;
+	uint8_t features[LIBREDXX_SIM_FEATURE_COUNT][LIBREDXX_FT260_REPORT_SIZE];
+	uint8_t i2c_status;
+	uint8_t (*i2c_memory)[256];
+	uint8_t i2c_pointers[LIBREDXX_SIM_I2C_ADDRESS_COUNT];
+};
+
+struct libredxx_sim_handle {
+	struct libredxx_sim_handle* next;
+	int fd;
+	struct libredxx_sim_device* device;
+	struct libredxx_sim_urb* completed; // not reaped yet, in order
+	struct libredxx_sim_urb** completed_tail;
+	uint32_t disabled; // bulk endpoints a failed URB took down, continuations are refused until a new transfer
+};
+
+static struct {
+	libredxx_mutex mutex;
+	bool started;
+	char root[256];
+	char usbfs_path[300];
+	char sysfs_path[300];
+	struct libredxx_sim_device* devices;
+	struct libredxx_sim_handle* handles;
+	uint32_t next_id;
+} libredxx_sim = {.mutex = LIBREDXX_MUTEX_INIT};
+
+static size_t libredxx_sim_min(size_t a, size_t b)
+{
+	return a < b ? a : b;
+}
+
+static void libredxx_sim_put16(uint8_t* data, uint16_t value)
+{
+	data[0] = (uint8_t)value;
+	data[1] = (uint8_t)(value >> 8);
+}
+
+// sysfs
+
+static bool libredxx_sim_write_file(const char* dir, const char* name, const void* data, size_t size)
+{
+	char path[600];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		return false;
+	}
+	const bool written = fwrite(data, 1, size, file) == size;
+	return fclose(file) == 0 && written;
+}
+
+static bool libredxx_sim_write_text(const char* dir, const char* name, const char* text)
+{
+	return libredxx_sim_write_file(dir, name, text, strlen(text));
+}
+
+static size_t libredxx_sim_endpoint_descriptor(uint8_t* data, uint8_t address, uint8_t attributes, uint16_t max_packet, uint8_t interval)
+{
+	data[0] = 7;
+	data[1] = 0x05; // endpoint
+	data[2] = address;
+	data[3] = attributes;
+	libredxx_sim_put16(&data[4], max_packet);
+	data[6] = interval;
+	return 7;
+}
+
+static size_t libredxx_sim_interface_descriptor(uint8_t* data, uint8_t number, uint8_t endpoint_count, uint8_t interface_class)
+{
+	data[0] = 9;
+	data[1] = 0x04; // interface
+	data[2] = number;
+	data[3] = 0;
+	data[4] = endpoint_count;
+	data[5] = interface_class;
+	data[6] = interface_class == 0xFF ? 0xFF : 0;
+	data[7] = interface_class == 0xFF ? 0xFF : 0;
+	data[8] = 0;
+	return 9;
+}
+
+// the device descriptor followed by the active configuration, as sysfs has it
+static size_t libredxx_sim_descriptors(const struct libredxx_sim_device* device, uint8_t* data)
+{
+	const libredxx_sim_device_config* config = &device->config;
+	uint8_t* d = data;
+	d[0] = 18;
+	d[1] = 0x01; // device
+	libredxx_sim_put16(&d[2], config->type == LIBREDXX_DEVICE_TYPE_D3XX ? 0x0310 : 0x0200);
+	d[4] = 0;
+	d[5] = 0;
+	d[6] = 0;
+	d[7] = config->type == LIBREDXX_DEVICE_TYPE_D3XX ? 9 : 64;
+	libredxx_sim_put16(&d[8], config->id.vid);
+	libredxx_sim_put16(&d[10], config->id.pid);
+	libredxx_sim_put16(&d[12], config->release);
+	d[14] = 1;
+	d[15] = 2;
+	d[16] = 3;
+	d[17] = 1;
+	d += 18;
+
+	uint8_t* configuration = d;
+	d[0] = 9;
+	d[1] = 0x02; // configuration
+	d[4] = device->interface_count;
+	d[5] = 1;
+	d[6] = 0;
+	d[7] = 0x80; // bus powered
+	d[8] = 50; // 100 mA
+	d += 9;
+	if (config->type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		for (uint8_t i = 0; i < device->interface_count; ++i) {
+			d += libredxx_sim_interface_descriptor(d, i, 2, 0xFF);
+			d += libredxx_sim_endpoint_descriptor(d, (uint8_t)(0x81 + i * 2), 0x02, device->max_packet, 0);
+			d += libredxx_sim_endpoint_descriptor(d, (uint8_t)(0x02 + i * 2), 0x02, device->max_packet, 0);
+		}
+	} else if (config->type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		d += libredxx_sim_interface_descriptor(d, 0, 2, 0xFF);
+		d += libredxx_sim_endpoint_descriptor(d, 0x01, 0x02, device->max_packet, 0);
+		d += libredxx_sim_endpoint_descriptor(d, 0x81, 0x03, 64, 9);
+		d += libredxx_sim_interface_descriptor(d, 1, LIBREDXX_SIM_CHANNEL_COUNT * 2, 0xFF);
+		for (uint8_t i = 0; i < LIBREDXX_SIM_CHANNEL_COUNT; ++i) {
+			d += libredxx_sim_endpoint_descriptor(d, (uint8_t)(0x02 + i), 0x02, device->max_packet, 0);
+		}
+		for (uint8_t i = 0; i < LIBREDXX_SIM_CHANNEL_COUNT; ++i) {
+			d += libredxx_sim_endpoint_descriptor(d, (uint8_t)(0x82 + i), 0x02, device->max_packet, 0);
+		}
+	} else {
+		d += libredxx_sim_interface_descriptor(d, 0, 2, 0x03); // HID
+		d[0] = 9;
+		d[1] = 0x21; // HID
+		libredxx_sim_put16(&d[2], 0x0111);
+		d[4] = 0;
+		d[5] = 1;
+		d[6] = 0x22; // report
+		libredxx_sim_put16(&d[7], 0);
+		d += 9;
+		d += libredxx_sim_endpoint_descriptor(d, 0x81, 0x03, device->max_packet, 1);
+		d += libredxx_sim_endpoint_descriptor(d, 0x02, 0x03, device->max_packet, 1);
+	}
+	libredxx_sim_put16(&configuration[2], (uint16_t)(d - configuration));
+	return (size_t)(d - data);
+}
+
+static const char* const libredxx_sim_sysfs_files[] = {"descriptors", "busnum", "devnum", "serial", "bNumInterfaces", "speed"};
+
+static void libredxx_sim_remove_sysfs(const struct libredxx_sim_device* device)
+{
+	char path[600];
+	for (size_t i = 0; i < sizeof(libredxx_sim_sysfs_files) / sizeof(libredxx_sim_sysfs_files[0]); ++i) {
+		snprintf(path, sizeof(path), "%s/%s", device->sysfs_dir, libredxx_sim_sysfs_files[i]);
+		unlink(path);
+	}
+	rmdir(device->sysfs_dir);
+}
+
+static bool libredxx_sim_create_sysfs(struct libredxx_sim_device* device)
+{
+	snprintf(device->sysfs_dir, sizeof(device->sysfs_dir), "%s/%u-%u", libredxx_sim.sysfs_path, LIBREDXX_SIM_BUS, device->address);
+	if (mkdir(device->sysfs_dir, 0700) != 0) {
+		return false;
+	}
+	uint8_t descriptors[512];
+	const size_t descriptors_size = libredxx_sim_descriptors(device, descriptors);
+	char busnum[8];
+	char devnum[8];
+	char serial[sizeof(libredxx_serial) + 1];
+	char interface_count[8];
+	const char* speed = "480\n";
+	snprintf(busnum, sizeof(busnum), "%u\n", LIBREDXX_SIM_BUS);
+	snprintf(devnum, sizeof(devnum), "%u\n", device->address);
+	snprintf(serial, sizeof(serial), "%.*s\n", (int)sizeof(libredxx_serial) - 1, device->config.serial.serial);
+	snprintf(interface_count, sizeof(interface_count), "%2u\n", device->interface_count);
+	if (device->config.type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		speed = "5000\n";
+	} else if (device->max_packet == 64) {
+		speed = "12\n";
+	}
+	if (!libredxx_sim_write_file(device->sysfs_dir, "descriptors", descriptors, descriptors_size)
+		|| !libredxx_sim_write_text(device->sysfs_dir, "busnum", busnum)
+		|| !libredxx_sim_write_text(device->sysfs_dir, "devnum", devnum)
+		|| !libredxx_sim_write_text(device->sysfs_dir, "serial", serial)
+		|| !libredxx_sim_write_text(device->sysfs_dir, "bNumInterfaces", interface_count)
+		|| !libredxx_sim_write_text(device->sysfs_dir, "speed", speed)) {
+		libredxx_sim_remove_sysfs(device);
+		return false;
+	}
+	return true;
+}
+
+// device model, everything below runs with the device mutex held
+
+static enum libredxx_sim_pipe libredxx_sim_pipe(const struct libredxx_sim_device* device, uint8_t endpoint, uint8_t* channel)
+{
+	*channel = 0;
+	switch (device->config.type) {
+	case LIBREDXX_DEVICE_TYPE_D2XX: {
+		const bool in = endpoint & 0x80;
+		const uint8_t offset = (uint8_t)((endpoint & 0x7F) - (in ? 1 : 2));
+		if ((endpoint & 0x7F) < (in ? 1 : 2) || offset % 2 || offset / 2 >= device->interface_count) {
+			return LIBREDXX_SIM_PIPE_INVALID;
+		}
+		*channel = offset / 2;
+		return in ? LIBREDXX_SIM_PIPE_IN : LIBREDXX_SIM_PIPE_OUT;
+	}
+	case LIBREDXX_DEVICE_TYPE_D3XX:
+		if (endpoint == 0x01) {
+			return LIBREDXX_SIM_PIPE_TRIGGER;
+		}
+		if (endpoint >= 0x02 && endpoint < 0x02 + LIBREDXX_SIM_CHANNEL_COUNT) {
+			*channel = (uint8_t)(endpoint - 0x02);
+			return LIBREDXX_SIM_PIPE_OUT;
+		}
+		if (endpoint >= 0x82 && endpoint < 0x82 + LIBREDXX_SIM_CHANNEL_COUNT) {
+			*channel = (uint8_t)(endpoint - 0x82);
+			return LIBREDXX_SIM_PIPE_IN;
+		}
+		return LIBREDXX_SIM_PIPE_INVALID;
+	case LIBREDXX_DEVICE_TYPE_FT260:
+		if (endpoint == 0x81) {
+			return LIBREDXX_SIM_PIPE_REPORT_IN;
+		}
+		return endpoint == 0x02 ? LIBREDXX_SIM_PIPE_REPORT_OUT : LIBREDXX_SIM_PIPE_INVALID;
+	}
+	return LIBREDXX_SIM_PIPE_INVALID;
+}
+
+static bool libredxx_sim_pipe_in(enum libredxx_sim_pipe pipe)
+{
+	return pipe == LIBREDXX_SIM_PIPE_IN || pipe == LIBREDXX_SIM_PIPE_REPORT_IN;
+}
+
+// the time a transfer of size bytes is done, transfers share the bandwidth one after another
+static uint64_t libredxx_sim_schedule(struct libredxx_sim_device* device, size_t size)
+{
+	const uint64_t now_ns = libredxx_time_ns();
+	uint64_t start_ns = device->busy_until_ns > now_ns ? device->busy_until_ns : now_ns;
+	if (device->config.bandwidth) {
+		start_ns += (uint64_t)size * 1000000000 / device->config.bandwidth;
+	}
+	device->busy_until_ns = start_ns;
+	return start_ns + (uint64_t)device->config.latency_us * 1000;
+}
+
+static uint32_t libredxx_sim_endpoint_bit(uint8_t endpoint)
+{
+	return (uint32_t)1 << ((endpoint & 0x0F) + ((endpoint & 0x80) ? 16 : 0));
+}
+
+// negative errno when this transfer is the one to fail, a stall halts the endpoint until it is cleared
+static int libredxx_sim_inject_fault(struct libredxx_sim_device* device, uint8_t endpoint)
+{
+	if (device->halted & libredxx_sim_endpoint_bit(endpoint)) {
+		return -EPIPE;
+	}
+	if (!device->config.fault_interval || ++device->transfers % device->config.fault_interval) {
+		return 0;
+	}
+	switch (device->config.fault) {
+	case LIBREDXX_SIM_FAULT_STALL:
+		device->halted |= libredxx_sim_endpoint_bit(endpoint);
+		return -EPIPE;
+	case LIBREDXX_SIM_FAULT_BABBLE:
+		return -EOVERFLOW;
+	default:
+		return -EPROTO;
+	}
+}
+
+// CLEAR_HALT clears the stall on the device, RESETEP only resets the host side
+static int libredxx_sim_clear_halt(struct libredxx_sim_device* device, unsigned int endpoint, bool device_side)
+{
+	uint8_t channel;
+	if (libredxx_sim_pipe(device, (uint8_t)endpoint, &channel) == LIBREDXX_SIM_PIPE_INVALID) {
+		return -ENOENT;
+	}
+	if (device_side) {
+		device->halted &= ~libredxx_sim_endpoint_bit((uint8_t)endpoint);
+	}
+	return 0;
+}
+
+// false if the device went away or deadline_ns passed first
+static bool libredxx_sim_wait(struct libredxx_sim_device* device, uint64_t deadline_ns)
+{
+	if (device->removed) {
+		return false;
+	}
+	if (deadline_ns == UINT64_MAX) {
+		libredxx_cond_wait(&device->cond, &device->mutex);
+		return !device->removed;
+	}
+	const uint64_t now_ns = libredxx_time_ns();
+	if (now_ns >= deadline_ns) {
+		return false;
+	}
+	libredxx_cond_wait_for(&device->cond, &device->mutex, deadline_ns - now_ns);
+	return !device->removed;
+}
+
+static bool libredxx_sim_sleep(struct libredxx_sim_device* device, uint64_t due_ns)
+{
+	while (libredxx_time_ns() < due_ns) {
+		if (!libredxx_sim_wait(device, due_ns) && device->removed) {
+			return false;
+		}
+	}
+	return !device->removed;
+}
+
+static size_t libredxx_sim_available(const struct libredxx_sim_device* device, const struct libredxx_sim_channel* channel)
+{
+	return device->config.mode == LIBREDXX_SIM_SOURCE ? SIZE_MAX : channel->fifo_count;
+}
+
+static void libredxx_sim_take(struct libredxx_sim_device* device, struct libredxx_sim_channel* channel, uint8_t* data, size_t size)
+{
+	if (device->config.mode == LIBREDXX_SIM_SOURCE) {
+		for (size_t i = 0; i < size; ++i) {
+			data[i] = channel->pattern++;
+		}
+		return;
+	}
+	for (size_t i = 0; i < size; ++i) {
+		data[i] = channel->fifo[(channel->fifo_head + i) % LIBREDXX_SIM_FIFO_SIZE];
+	}
+	channel->fifo_head = (channel->fifo_head + size) % LIBREDXX_SIM_FIFO_SIZE;
+	channel->fifo_count -= size;
+	libredxx_cond_broadcast(&device->cond);
+}
+
+static size_t libredxx_sim_put(struct libredxx_sim_device* device, struct libredxx_sim_channel* channel, const uint8_t* data, size_t size)
+{
+	if (device->config.mode == LIBREDXX_SIM_SOURCE) {
+		return size;
+	}
+	size = libredxx_sim_min(size, LIBREDXX_SIM_FIFO_SIZE - channel->fifo_count);
+	for (size_t i = 0; i < size; ++i) {
+		channel->fifo[(channel->fifo_head + channel->fifo_count + i) % LIBREDXX_SIM_FIFO_SIZE] = data[i];
+	}
+	channel->fifo_count += size;
+	if (size) {
+		libredxx_cond_broadcast(&device->cond);
+	}
+	return size;
+}
+
+/*
+ * Every packet starts with the modem and line status, a short packet ends the
+ * transfer. A packet bigger than the room left babbles, its data is lost.
+ */
+static size_t libredxx_sim_d2xx_in(struct libredxx_sim_device* device, struct libredxx_sim_channel* channel, uint8_t* data, size_t size, int* status)
+{
+	const size_t payload = (size_t)device->max_packet - LIBREDXX_SIM_D2XX_HEADER_SIZE;
+	size_t length = 0;
+	while (length < size) {
+		const size_t count = libredxx_sim_min(libredxx_sim_available(device, channel), payload);
+		if (LIBREDXX_SIM_D2XX_HEADER_SIZE + count > size - length) {
+			uint8_t lost[LIBREDXX_SIM_MAX_PACKET];
+			libredxx_sim_take(device, channel, lost, count);
+			*status = -EOVERFLOW;
+			break;
+		}
+		data[length] = 0x32;
+		data[length + 1] = 0x60;
+		libredxx_sim_take(device, channel, &data[length + LIBREDXX_SIM_D2XX_HEADER_SIZE], count);
+		length += LIBREDXX_SIM_D2XX_HEADER_SIZE + count;
+		if (count < payload) {
+			break;
+		}
+	}
+	return length;
+}
+
+// fills an IN transfer, false while the device has nothing to send yet, status is a negative errno on babble
+static bool libredxx_sim_in(struct libredxx_sim_device* device, enum libredxx_sim_pipe pipe, uint8_t channel_index, uint8_t* data, size_t size, uint64_t since_ns, size_t* length, int* status)
+{
+	if (pipe == LIBREDXX_SIM_PIPE_REPORT_IN) {
+		if (!device->report_count) {
+			return false;
+		}
+		*length = libredxx_sim_min(size, LIBREDXX_FT260_REPORT_SIZE);
+		memcpy(data, device->reports[device->report_head], *length);
+		device->report_head = (device->report_head + 1) % LIBREDXX_SIM_REPORT_COUNT;
+		--device->report_count;
+		return true;
+	}
+	struct libredxx_sim_channel* channel = &device->channels[channel_index];
+	const size_t available = libredxx_sim_available(device, channel);
+	if (device->config.type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		// the chip holds data back until a packet is full or the latency timer runs out
+		const bool expired = libredxx_time_ns() - since_ns >= (uint64_t)channel->latency_ms * 1000000;
+		if (available < (size_t)device->max_packet - LIBREDXX_SIM_D2XX_HEADER_SIZE && !expired) {
+			return false;
+		}
+		*length = libredxx_sim_d2xx_in(device, channel, data, size, status);
+		return true;
+	}
+	// D3XX only sends data against a read request
+	if (!channel->trigger_count || !available) {
+		return false;
+	}
+	*length = libredxx_sim_min(libredxx_sim_min(channel->triggers[channel->trigger_head], size), available);
+	channel->triggers[channel->trigger_head] -= (uint32_t)*length;
+	if (*length < size || !channel->triggers[channel->trigger_head]) {
+		// a short packet ends the request, a URB filled before that leaves the rest for the next one
+		channel->trigger_head = (channel->trigger_head + 1) % LIBREDXX_SIM_TRIGGER_COUNT;
+		--channel->trigger_count;
+	}
+	libredxx_sim_take(device, channel, data, *length);
+	return true;
+}
+
+static bool libredxx_sim_i2c_memory(struct libredxx_sim_device* device, uint8_t address, bool read, uint8_t* data, size_t size)
+{
+	uint8_t* memory = device->i2c_memory[address % LIBREDXX_SIM_I2C_ADDRESS_COUNT];
+	uint8_t* pointer = &device->i2c_pointers[address % LIBREDXX_SIM_I2C_ADDRESS_COUNT];
+	if (read) {
+		for (size_t i = 0; i < size; ++i) {
+			data[i] = memory[(*pointer)++];
+		}
+	} else if (size) {
+		// the first byte written selects the register
+		*pointer = data[0];
+		for (size_t i = 1; i < size; ++i) {
+			memory[(*pointer)++] = data[i];
+		}
+	}
+	return true;
+}
+
+static bool libredxx_sim_i2c(struct libredxx_sim_device* device, uint8_t address, bool read, uint8_t* data, size_t size)
+{
+	if (device->config.i2c) {
+		return device->config.i2c(device->config.i2c_context, address, read, data, size);
+	}
+	return libredxx_sim_i2c_memory(device, address, read, data, size);
+}
+
+static void libredxx_sim_ft260_report(struct libredxx_sim_device* device, const uint8_t* data, size_t size)
+{
+	if (size < 4) {
+		return;
+	}
+	const uint8_t report_id = data[0];
+	const uint8_t address = data[1];
+	if (report_id >= 0xD0 && report_id <= 0xDE) {
+		uint8_t payload[LIBREDXX_FT260_REPORT_SIZE];
+		const size_t length = libredxx_sim_min(data[3], size - 4);
+		memcpy(payload, &data[4], length);
+		device->i2c_status = libredxx_sim_i2c(device, address, false, payload, length) ? LIBREDXX_SIM_FT260_I2C_IDLE : LIBREDXX_SIM_FT260_I2C_NACK;
+	} else if (report_id == 0xC2 && size >= 5) {
+		const size_t length = (size_t)data[3] | (size_t)data[4] << 8;
+		uint8_t* read = malloc(length ? length : 1);
+		if (!read) {
+			return;
+		}
+		if (!libredxx_sim_i2c(device, address, true, read, length)) {
+			device->i2c_status = LIBREDXX_SIM_FT260_I2C_NACK;
+			free(read);
+			return;
+		}
+		device->i2c_status = LIBREDXX_SIM_FT260_I2C_IDLE;
+		for (size_t offset = 0; offset < length && device->report_count < LIBREDXX_SIM_REPORT_COUNT; offset += LIBREDXX_SIM_I2C_READ_SIZE) {
+			const size_t count = libredxx_sim_min(length - offset, LIBREDXX_SIM_I2C_READ_SIZE);
+			uint8_t* report = device->reports[(device->report_head + device->report_count++) % LIBREDXX_SIM_REPORT_COUNT];
+			memset(report, 0, LIBREDXX_FT260_REPORT_SIZE);
+			report[0] = (uint8_t)(0xD0 + (count - 1) / 4);
+			report[1] = (uint8_t)count;
+			memcpy(&report[2], &read[offset], count);
+		}
+		free(read);
+		libredxx_cond_broadcast(&device->cond);
+	}
+}
+
+// hands an OUT transfer to the device and returns how much it took, loopback channels only take what fits
+static size_t libredxx_sim_out(struct libredxx_sim_device* device, enum libredxx_sim_pipe pipe, uint8_t channel_index, const uint8_t* data, size_t size)
+{
+	if (pipe == LIBREDXX_SIM_PIPE_OUT) {
+		return libredxx_sim_put(device, &device->channels[channel_index], data, size);
+	}
+	if (pipe == LIBREDXX_SIM_PIPE_REPORT_OUT) {
+		libredxx_sim_ft260_report(device, data, size);
+		return size;
+	}
+	// a read request names the IN pipe at byte 4 and the size at bytes 8 to 11
+	if (size < 12 || data[4] < 0x82 || data[4] >= 0x82 + LIBREDXX_SIM_CHANNEL_COUNT) {
+		return size;
+	}
+	struct libredxx_sim_channel* channel = &device->channels[data[4] - 0x82];
+	const uint32_t request = (uint32_t)data[8] | (uint32_t)data[9] << 8 | (uint32_t)data[10] << 16 | (uint32_t)data[11] << 24;
+	if (channel->trigger_count == LIBREDXX_SIM_TRIGGER_COUNT) {
+		// never refused, holding the shared request pipe would stall every other channel behind it
+		uint32_t* newest = &channel->triggers[(channel->trigger_head + channel->trigger_count - 1) % LIBREDXX_SIM_TRIGGER_COUNT];
+		*newest = request > UINT32_MAX - *newest ? UINT32_MAX : *newest + request;
+	} else {
+		channel->triggers[(channel->trigger_head + channel->trigger_count++) % LIBREDXX_SIM_TRIGGER_COUNT] = request;
+	}
+	libredxx_cond_broadcast(&device->cond);
+	return size;
+}
+
+// usbfs
+
+static int libredxx_sim_claim(struct libredxx_sim_handle* handle, unsigned int interface_index, bool claim)
+{
+	struct libredxx_sim_device* device = handle->device;
+	if (interface_index >= device->interface_count) {
+		return -EINVAL;
+	}
+	if (claim) {
+		if (device->claims[interface_index] && device->claims[interface_index] != handle) {
+			return -EBUSY;
+		}
+		device->claims[interface_index] = handle;
+	} else {
+		if (device->claims[interface_index] != handle) {
+			return -EINVAL;
+		}
+		device->claims[interface_index] = NULL;
+	}
+	return 0;
+}
+
+static int libredxx_sim_bulk(struct libredxx_sim_handle* handle, struct usbdevfs_bulktransfer* bulk)
+{
+	struct libredxx_sim_device* device = handle->device;
+	uint8_t channel;
+	const enum libredxx_sim_pipe pipe = libredxx_sim_pipe(device, (uint8_t)bulk->ep, &channel);
+	if (pipe == LIBREDXX_SIM_PIPE_INVALID) {
+		return -EINVAL;
+	}
+	const uint64_t start_ns = libredxx_time_ns();
+	const uint64_t deadline_ns = bulk->timeout ? start_ns + (uint64_t)bulk->timeout * 1000000 : UINT64_MAX;
+	const int fault = libredxx_sim_inject_fault(device, (uint8_t)bulk->ep);
+	if (fault) {
+		return libredxx_sim_sleep(device, libredxx_sim_schedule(device, 0)) ? fault : -ENODEV;
+	}
+	uint8_t* data = bulk->data;
+	if (libredxx_sim_pipe_in(pipe)) {
+		size_t length = 0;
+		int status = 0;
+		while (!libredxx_sim_in(device, pipe, channel, data, bulk->len, start_ns, &length, &status)) {
+			uint64_t wake_ns = deadline_ns;
+			if (device->config.type == LIBREDXX_DEVICE_TYPE_D2XX) {
+				const uint64_t expiry_ns = start_ns + (uint64_t)device->channels[channel].latency_ms * 1000000;
+				wake_ns = expiry_ns < wake_ns ? expiry_ns : wake_ns;
+			}
+			if (!libredxx_sim_wait(device, wake_ns) && (device->removed || libredxx_time_ns() >= deadline_ns)) {
+				return device->removed ? -ENODEV : -ETIMEDOUT;
+			}
+		}
+		if (!libredxx_sim_sleep(device, libredxx_sim_schedule(device, length))) {
+			return -ENODEV;
+		}
+		return status ? status : (int)length;
+	}
+	if (!libredxx_sim_sleep(device, libredxx_sim_schedule(device, bulk->len))) {
+		return -ENODEV;
+	}
+	size_t offset = 0;
+	do {
+		const size_t count = libredxx_sim_out(device, pipe, channel, &data[offset], bulk->len - offset);
+		offset += count;
+		if (!count && !libredxx_sim_wait(device, deadline_ns)) {
+			return device->removed ? -ENODEV : -ETIMEDOUT;
+		}
+	} while (offset < bulk->len);
+	return (int)bulk->len;
+}
+
+static int libredxx_sim_control(struct libredxx_sim_handle* handle, struct usbdevfs_ctrltransfer* ctrl)
+{
+	struct libredxx_sim_device* device = handle->device;
+	uint8_t* data = ctrl->data;
+	int length = -EPIPE; // stall whatever isn't understood
+	if (device->config.type == LIBREDXX_DEVICE_TYPE_D2XX && ctrl->bRequestType == LIBREDXX_D2XX_REQUEST_TYPE_OUT) {
+		// wIndex has the channel, 0 on single channel chips and 1 to 4 otherwise
+		const uint8_t channel_index = (uint8_t)(ctrl->wIndex & 0xFF);
+		const uint8_t interface_index = channel_index ? (uint8_t)(channel_index - 1) : 0;
+		if (interface_index >= device->interface_count) {
+			return -EPIPE;
+		}
+		struct libredxx_sim_channel* channel = &device->channels[interface_index];
+		if (ctrl->bRequest == LIBREDXX_D2XX_SIO_SET_LATENCY_TIMER) {
+			channel->latency_ms = (uint8_t)ctrl->wValue;
+		} else if (ctrl->bRequest == LIBREDXX_D2XX_SIO_SET_BAUD_RATE) {
+			channel->baud_value = ctrl->wValue;
+			channel->baud_index = ctrl->wIndex;
+		} else if (ctrl->bRequest == LIBREDXX_D2XX_SIO_RESET && ctrl->wValue == 1) {
+			channel->fifo_count = 0; // purge RX
+			libredxx_cond_broadcast(&device->cond);
+		}
+		length = 0;
+	} else if (device->config.type == LIBREDXX_DEVICE_TYPE_FT260 && (ctrl->bRequestType & 0x60) == 0x20 && ctrl->wLength > 0) {
+		// HID class requests for feature reports
+		const uint8_t report_id = (uint8_t)ctrl->wValue;
+		const size_t size = libredxx_sim_min(ctrl->wLength, LIBREDXX_FT260_REPORT_SIZE);
+		uint8_t* feature = NULL;
+		for (size_t i = 0; i < LIBREDXX_SIM_FEATURE_COUNT && !feature; ++i) {
+			if (device->features[i][0] == report_id || !device->features[i][0]) {
+				feature = device->features[i];
+			}
+		}
+		if (ctrl->bRequest == 0x01) { // GET_REPORT
+			memset(data, 0, ctrl->wLength);
+			if (report_id == 0xC0) {
+				data[1] = device->i2c_status;
+				libredxx_sim_put16(&data[2], 100); // kHz
+			} else if (feature && feature[0]) {
+				memcpy(data, feature, size);
+			}
+			data[0] = report_id;
+			length = ctrl->wLength;
+		} else if (ctrl->bRequest == 0x09) { // SET_REPORT
+			if (feature) {
+				memcpy(feature, data, size);
+				feature[0] = report_id;
+			}
+			length = ctrl->wLength;
+		}
+	}
+	if (!libredxx_sim_sleep(device, libredxx_sim_schedule(device, ctrl->wLength))) {
+		return -ENODEV;
+	}
+	return length;
+}
+
+static void libredxx_sim_complete(struct libredxx_sim_urb* sim_urb)
+{
+	struct libredxx_sim_handle* handle = sim_urb->handle;
+	sim_urb->urb->status = sim_urb->status;
+	sim_urb->next = NULL;
+	*handle->completed_tail = sim_urb;
+	handle->completed_tail = &sim_urb->next;
+	const uint64_t one = 1;
+	if (write(handle->fd, &one, sizeof(one)) != sizeof(one)) {
+		// can only fail once the counter is close to overflowing, which reaping prevents
+	}
+	libredxx_cond_broadcast(&handle->device->cond);
+}
+
+// advances a URB as far as the device allows, true once it is complete
+static bool libredxx_sim_step(struct libredxx_sim_device* device, struct libredxx_sim_urb* sim_urb, uint64_t* wake_ns)
+{
+	struct usbdevfs_urb* urb = sim_urb->urb;
+	if (!sim_urb->started) {
+		if (!sim_urb->counted) {
+			sim_urb->status = libredxx_sim_inject_fault(device, urb->endpoint);
+			sim_urb->counted = true;
+		}
+		if (sim_urb->status) {
+			sim_urb->due_ns = libredxx_sim_schedule(device, 0);
+		} else if (libredxx_sim_pipe_in(sim_urb->pipe)) {
+			size_t length;
+			if (!libredxx_sim_in(device, sim_urb->pipe, sim_urb->channel, urb->buffer, (size_t)urb->buffer_length, sim_urb->submitted_ns, &length, &sim_urb->status)) {
+				if (device->config.type == LIBREDXX_DEVICE_TYPE_D2XX) {
+					const uint64_t expiry_ns = sim_urb->submitted_ns + (uint64_t)device->channels[sim_urb->channel].latency_ms * 1000000;
+					*wake_ns = expiry_ns < *wake_ns ? expiry_ns : *wake_ns;
+				}
+				return false;
+			}
+			urb->actual_length = (int)length;
+			if (!sim_urb->status && length < (size_t)urb->buffer_length && (urb->flags & USBDEVFS_URB_SHORT_NOT_OK)) {
+				sim_urb->status = -EREMOTEIO;
+			}
+			sim_urb->due_ns = libredxx_sim_schedule(device, length);
+		} else {
+			sim_urb->due_ns = libredxx_sim_schedule(device, (size_t)urb->buffer_length);
+		}
+		sim_urb->started = true;
+	}
+	if (libredxx_time_ns() < sim_urb->due_ns) {
+		*wake_ns = sim_urb->due_ns < *wake_ns ? sim_urb->due_ns : *wake_ns;
+		return false;
+	}
+	if (!sim_urb->status && !libredxx_sim_pipe_in(sim_urb->pipe)) {
+		// OUT data reaches the device once the transfer is done
+		sim_urb->offset += libredxx_sim_out(device, sim_urb->pipe, sim_urb->channel, (const uint8_t*)urb->buffer + sim_urb->offset, (size_t)urb->buffer_length - sim_urb->offset);
+		if (sim_urb->offset < (size_t)urb->buffer_length) {
+			return false;
+		}
+		urb->actual_length = urb->buffer_length;
+	}
+	return true;
+}
+
+// an endpoint works through its URBs in submission order, later ones wait for the oldest
+static bool libredxx_sim_queued_behind(const struct libredxx_sim_device* device, const struct libredxx_sim_urb* sim_urb)
+{
+	for (const struct libredxx_sim_urb* earlier = device->urbs; earlier != sim_urb; earlier = earlier->next) {
+		if (earlier->handle == sim_urb->handle && earlier->urb->endpoint == sim_urb->urb->endpoint) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// like usbfs, a failed or short bulk URB takes the queued URBs continuing its transfer with it
+static void libredxx_sim_cancel_continuations(struct libredxx_sim_device* device, const struct libredxx_sim_urb* failed)
+{
+	failed->handle->disabled |= libredxx_sim_endpoint_bit(failed->urb->endpoint);
+	for (struct libredxx_sim_urb** link = &device->urbs; *link;) {
+		struct libredxx_sim_urb* sim_urb = *link;
+		if (sim_urb->handle == failed->handle && sim_urb->urb->endpoint == failed->urb->endpoint && (sim_urb->urb->flags & USBDEVFS_URB_BULK_CONTINUATION)) {
+			*link = sim_urb->next;
+			sim_urb->status = -ECONNRESET;
+			libredxx_sim_complete(sim_urb);
+		} else {
+			link = &sim_urb->next;
+		}
+	}
+}
+
+static void libredxx_sim_worker(void* arg)
+{
+	struct libredxx_sim_device* device = arg;
+	libredxx_mutex_lock(&device->mutex);
+	while (!device->stopping) {
+		uint64_t wake_ns = UINT64_MAX;
+		bool completed = false;
+		for (struct libredxx_sim_urb** link = &device->urbs; *link;) {
+			struct libredxx_sim_urb* sim_urb = *link;
+			if (!libredxx_sim_queued_behind(device, sim_urb) && libredxx_sim_step(device, sim_urb, &wake_ns)) {
+				*link = sim_urb->next;
+				libredxx_sim_complete(sim_urb);
+				if (sim_urb->status && sim_urb->urb->type == USBDEVFS_URB_TYPE_BULK) {
+					libredxx_sim_cancel_continuations(device, sim_urb);
+				}
+				completed = true;
+			} else {
+				link = &sim_urb->next;
+			}
+		}
+		if (completed) {
+			continue; // a completion can unblock URBs that were already passed over
+		}
+		if (wake_ns == UINT64_MAX) {
+			libredxx_cond_wait(&device->cond, &device->mutex);
+		} else {
+			const uint64_t now_ns = libredxx_time_ns();
+			if (wake_ns > now_ns) {
+				libredxx_cond_wait_for(&device->cond, &device->mutex, wake_ns - now_ns);
+			}
+		}
+	}
+	libredxx_mutex_unlock(&device->mutex);
+}
+
+static int libredxx_sim_submit(struct libredxx_sim_handle* handle, struct usbdevfs_urb* urb)
+{
+	struct libredxx_sim_device* device = handle->device;
+	uint8_t channel;
+	const enum libredxx_sim_pipe pipe = libredxx_sim_pipe(device, urb->endpoint, &channel);
+	if (pipe == LIBREDXX_SIM_PIPE_INVALID || (urb->type != USBDEVFS_URB_TYPE_BULK && urb->type != USBDEVFS_URB_TYPE_INTERRUPT) || urb->buffer_length < 0) {
+		return -EINVAL;
+	}
+	if (urb->type == USBDEVFS_URB_TYPE_BULK) {
+		const uint32_t bit = libredxx_sim_endpoint_bit(urb->endpoint);
+		if (!(urb->flags & USBDEVFS_URB_BULK_CONTINUATION)) {
+			handle->disabled &= ~bit;
+		} else if (handle->disabled & bit) {
+			return -EREMOTEIO;
+		}
+	}
+	struct libredxx_sim_urb* sim_urb = calloc(1, sizeof(struct libredxx_sim_urb));
+	if (!sim_urb) {
+		return -ENOMEM;
+	}
+	sim_urb->handle = handle;
+	sim_urb->urb = urb;
+	sim_urb->pipe = pipe;
+	sim_urb->channel = channel;
+	sim_urb->submitted_ns = libredxx_time_ns();
+	urb->status = -EINPROGRESS;
+	urb->actual_length = 0;
+	struct libredxx_sim_urb** link = &device->urbs;
+	while (*link) {
+		link = &(*link)->next;
+	}
+	*link = sim_urb;
+	libredxx_cond_broadcast(&device->cond);
+	return 0;
+}
+
+static int libredxx_sim_discard(struct libredxx_sim_handle* handle, struct usbdevfs_urb* urb)
+{
+	for (struct libredxx_sim_urb** link = &handle->device->urbs; *link; link = &(*link)->next) {
+		struct libredxx_sim_urb* sim_urb = *link;
+		if (sim_urb->urb == urb && sim_urb->handle == handle) {
+			*link = sim_urb->next;
+			sim_urb->status = -ENOENT;
+			libredxx_sim_complete(sim_urb);
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
+static int libredxx_sim_reap(struct libredxx_sim_handle* handle, void** urb, bool wait)
+{
+	struct libredxx_sim_device* device = handle->device;
+	while (!handle->completed) {
+		if (device->removed) {
+			return -ENODEV;
+		}
+		if (!wait) {
+			return -EAGAIN;
+		}
+		libredxx_cond_wait(&device->cond, &device->mutex);
+	}
+	struct libredxx_sim_urb* sim_urb = handle->completed;
+	handle->completed = sim_urb->next;
+	if (!handle->completed) {
+		handle->completed_tail = &handle->completed;
+		if (!device->removed) {
+			uint64_t count;
+			if (read(handle->fd, &count, sizeof(count)) != sizeof(count)) {
+				// already zero
+			}
+		}
+	}
+	*urb = sim_urb->urb;
+	free(sim_urb);
+	return 0;
+}
+
+static struct libredxx_sim_handle* libredxx_sim_find_handle(int fd)
+{
+	libredxx_mutex_lock(&libredxx_sim.mutex);
+	struct libredxx_sim_handle* handle = libredxx_sim.handles;
+	while (handle && handle->fd != fd) {
+		handle = handle->next;
+	}
+	libredxx_mutex_unlock(&libredxx_sim.mutex);
+	return handle;
+}
+
+static int libredxx_sim_ioctl(int fd, unsigned long request, void* arg)
+{
+	struct libredxx_sim_handle* handle = libredxx_sim_find_handle(fd);
+	if (!handle) {
+		return ioctl(fd, request, arg);
+	}
+	struct libredxx_sim_device* device = handle->device;
+	int r;
+	libredxx_mutex_lock(&device->mutex);
+	if (request == USBDEVFS_REAPURB || request == USBDEVFS_REAPURBNDELAY) {
+		// completions are still handed out after the device is gone
+		r = libredxx_sim_reap(handle, arg, request == USBDEVFS_REAPURB);
+	} else if (device->removed) {
+		r = -ENODEV;
+	} else if (request == USBDEVFS_CLAIMINTERFACE || request == USBDEVFS_RELEASEINTERFACE) {
+		r = libredxx_sim_claim(handle, *(unsigned int*)arg, request == USBDEVFS_CLAIMINTERFACE);
+	} else if (request == USBDEVFS_BULK) {
+		r = libredxx_sim_bulk(handle, arg);
+	} else if (request == USBDEVFS_CONTROL) {
+		r = libredxx_sim_control(handle, arg);
+	} else if (request == USBDEVFS_SUBMITURB) {
+		r = libredxx_sim_submit(handle, arg);
+	} else if (request == USBDEVFS_DISCARDURB) {
+		r = libredxx_sim_discard(handle, arg);
+	} else if (request == USBDEVFS_CLEAR_HALT || request == USBDEVFS_RESETEP) {
+		r = libredxx_sim_clear_halt(device, *(unsigned int*)arg, request == USBDEVFS_CLEAR_HALT);
+	} else if (request == USBDEVFS_GET_CAPABILITIES) {
+		*(uint32_t*)arg = USBDEVFS_CAP_BULK_CONTINUATION;
+		r = 0;
+	} else {
+		r = -ENOTTY;
+	}
+	libredxx_mutex_unlock(&device->mutex);
+	if (r < 0) {
+		errno = -r;
+		return -1;
+	}
+	return r;
+}
+
+// usbfs signals reapable URBs with POLLOUT, an eventfd with POLLIN
+static int libredxx_sim_poll(struct pollfd* fds, nfds_t fds_count, int timeout)
+{
+	bool sim[64] = {0};
+	if (fds_count > sizeof(sim) / sizeof(sim[0])) {
+		errno = EINVAL;
+		return -1;
+	}
+	for (nfds_t i = 0; i < fds_count; ++i) {
+		sim[i] = libredxx_sim_find_handle(fds[i].fd) != NULL;
+		if (sim[i] && (fds[i].events & POLLOUT)) {
+			fds[i].events = (short)((fds[i].events & ~POLLOUT) | POLLIN);
+		}
+	}
+	const int r = poll(fds, fds_count, timeout);
+	for (nfds_t i = 0; i < fds_count; ++i) {
+		if (sim[i]) {
+			fds[i].events = (short)((fds[i].events & ~POLLIN) | POLLOUT);
+			if (fds[i].revents & POLLIN) {
+				fds[i].revents = (short)((fds[i].revents & ~POLLIN) | POLLOUT);
+			}
+		}
+	}
+	return r;
+}
+
+static void libredxx_sim_unref(struct libredxx_sim_device* device)
+{
+	if (--device->refs) {
+		return;
+	}
+	for (size_t i = 0; i < LIBREDXX_SIM_CHANNEL_COUNT; ++i) {
+		free(device->channels[i].fifo);
+	}
+	free(device->reports);
+	free(device->i2c_memory);
+	libredxx_cond_destroy(&device->cond);
+	libredxx_mutex_destroy(&device->mutex);
+	free(device);
+}
+
+static int libredxx_sim_open(const char* path, int flags)
+{
+	const size_t prefix_size = strlen(libredxx_sim.usbfs_path);
+	unsigned int bus;
+	unsigned int address;
+	if (strncmp(path, libredxx_sim.usbfs_path, prefix_size) != 0 || sscanf(path + prefix_size, "/%u/%u", &bus, &address) != 2) {
+		return open(path, flags);
+	}
+	libredxx_mutex_lock(&libredxx_sim.mutex);
+	struct libredxx_sim_device* device = libredxx_sim.devices;
+	while (device && (bus != LIBREDXX_SIM_BUS || device->address != address)) {
+		device = device->next;
+	}
+	struct libredxx_sim_handle* handle = device ? calloc(1, sizeof(struct libredxx_sim_handle)) : NULL;
+	if (!handle) {
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		errno = device ? ENOMEM : ENOENT;
+		return -1;
+	}
+	handle->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (handle->fd == -1) {
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		free(handle);
+		return -1;
+	}
+	handle->device = device;
+	handle->completed_tail = &handle->completed;
+	++device->refs;
+	handle->next = libredxx_sim.handles;
+	libredxx_sim.handles = handle;
+	libredxx_mutex_unlock(&libredxx_sim.mutex);
+	return handle->fd;
+}
+
+static int libredxx_sim_close(int fd)
+{
+	libredxx_mutex_lock(&libredxx_sim.mutex);
+	struct libredxx_sim_handle** link = &libredxx_sim.handles;
+	while (*link && (*link)->fd != fd) {
+		link = &(*link)->next;
+	}
+	struct libredxx_sim_handle* handle = *link;
+	if (!handle) {
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		return close(fd);
+	}
+	*link = handle->next;
+	// like the kernel, closing kills everything still in flight
+	struct libredxx_sim_device* device = handle->device;
+	libredxx_mutex_lock(&device->mutex);
+	for (struct libredxx_sim_urb** urb_link = &device->urbs; *urb_link;) {
+		struct libredxx_sim_urb* sim_urb = *urb_link;
+		if (sim_urb->handle == handle) {
+			*urb_link = sim_urb->next;
+			free(sim_urb);
+		} else {
+			urb_link = &sim_urb->next;
+		}
+	}
+	while (handle->completed) {
+		struct libredxx_sim_urb* sim_urb = handle->completed;
+		handle->completed = sim_urb->next;
+		free(sim_urb);
+	}
+	for (size_t i = 0; i < LIBREDXX_SIM_CHANNEL_COUNT; ++i) {
+		if (device->claims[i] == handle) {
+			device->claims[i] = NULL;
+		}
+	}
+	libredxx_mutex_unlock(&device->mutex);
+	libredxx_sim_unref(device);
+	libredxx_mutex_unlock(&libredxx_sim.mutex);
+	const int r = close(handle->fd);
+	free(handle);
+	return r;
+}
+
+static libredxx_usbfs_ops libredxx_sim_ops = {
+	.usbfs_path = libredxx_sim.usbfs_path,
+	.sysfs_path = libredxx_sim.sysfs_path,
+	.open = libredxx_sim_open,
+	.close = libredxx_sim_close,
+	.ioctl = libredxx_sim_ioctl,
+	.poll = libredxx_sim_poll,
+};
+
+// public API, with the global mutex held from here on
+
+static void libredxx_sim_unplug(struct libredxx_sim_device* device)
+{
+	libredxx_mutex_lock(&device->mutex);
+	device->removed = true;
+	device->stopping = true;
+	while (device->urbs) {
+		struct libredxx_sim_urb* sim_urb = device->urbs;
+		device->urbs = sim_urb->next;
+		sim_urb->status = -ESHUTDOWN;
+		libredxx_sim_complete(sim_urb);
+	}
+	// usbfs polls as ready once the device is gone, leave every eventfd readable
+	for (struct libredxx_sim_handle* handle = libredxx_sim.handles; handle; handle = handle->next) {
+		if (handle->device == device) {
+			const uint64_t one = 1;
+			if (write(handle->fd, &one, sizeof(one)) != sizeof(one)) {
+				// already readable
+			}
+		}
+	}
+	libredxx_cond_broadcast(&device->cond);
+	libredxx_mutex_unlock(&device->mutex);
+	libredxx_thread_join(device->worker);
+	libredxx_sim_remove_sysfs(device);
+	libredxx_sim_unref(device);
+}
+
+static uint8_t libredxx_sim_free_address(void)
+{
+	for (unsigned int address = 1; address <= LIBREDXX_SIM_MAX_ADDRESS; ++address) {
+		const struct libredxx_sim_device* device = libredxx_sim.devices;
+		while (device && device->address != address) {
+			device = device->next;
+		}
+		if (!device) {
+			return (uint8_t)address;
+		}
+	}
+	return 0;
+}
+
+static libredxx_status libredxx_sim_init_device(struct libredxx_sim_device* device)
+{
+	const libredxx_sim_device_config* config = &device->config;
+	device->interface_count = 1;
+	device->max_packet = 64;
+	if (config->type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		switch (libredxx_d2xx_get_chip(config->release)) {
+		case LIBREDXX_D2XX_CHIP_2232C:
+			device->interface_count = 2;
+			break;
+		case LIBREDXX_D2XX_CHIP_2232H:
+			device->interface_count = 2;
+			device->max_packet = 512;
+			break;
+		case LIBREDXX_D2XX_CHIP_4232H:
+			device->interface_count = 4;
+			device->max_packet = 512;
+			break;
+		case LIBREDXX_D2XX_CHIP_232H:
+			device->max_packet = 512;
+			break;
+		default:
+			break;
+		}
+	} else if (config->type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		device->interface_count = 2;
+		device->max_packet = 1024;
+	} else if (config->type == LIBREDXX_DEVICE_TYPE_FT260) {
+		device->reports = calloc(LIBREDXX_SIM_REPORT_COUNT, sizeof(device->reports[0]));
+		if (!config->i2c) {
+			device->i2c_memory = calloc(LIBREDXX_SIM_I2C_ADDRESS_COUNT, sizeof(device->i2c_memory[0]));
+		}
+		if (!device->reports || (!config->i2c && !device->i2c_memory)) {
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		device->i2c_status = LIBREDXX_SIM_FT260_I2C_IDLE;
+	} else {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	for (size_t i = 0; i < LIBREDXX_SIM_CHANNEL_COUNT; ++i) {
+		struct libredxx_sim_channel* channel = &device->channels[i];
+		channel->latency_ms = LIBREDXX_SIM_D2XX_LATENCY_MS;
+		if (config->mode == LIBREDXX_SIM_LOOPBACK && config->type != LIBREDXX_DEVICE_TYPE_FT260) {
+			channel->fifo = malloc(LIBREDXX_SIM_FIFO_SIZE);
+			if (!channel->fifo) {
+				return LIBREDXX_STATUS_ERROR_SYS;
+			}
+		}
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_sim_start(void)
+{
+	libredxx_mutex_lock(&libredxx_sim.mutex);
+	if (libredxx_sim.started) {
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	const char* tmp = getenv("TMPDIR");
+	snprintf(libredxx_sim.root, sizeof(libredxx_sim.root), "%s/libredxx-sim-XXXXXX", tmp && *tmp ? tmp : "/tmp");
+	if (!mkdtemp(libredxx_sim.root)) {
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	snprintf(libredxx_sim.usbfs_path, sizeof(libredxx_sim.usbfs_path), "%s/usb", libredxx_sim.root);
+	snprintf(libredxx_sim.sysfs_path, sizeof(libredxx_sim.sysfs_path), "%s/devices", libredxx_sim.root);
+	if (mkdir(libredxx_sim.sysfs_path, 0700) != 0) {
+		rmdir(libredxx_sim.root);
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	libredxx_sim.started = true;
+	libredxx_usbfs_set_ops(&libredxx_sim_ops);
+	libredxx_mutex_unlock(&libredxx_sim.mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_sim_stop(void)
+{
+	libredxx_mutex_lock(&libredxx_sim.mutex);
+	if (!libredxx_sim.started || libredxx_sim.handles) {
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_usbfs_set_ops(NULL);
+	while (libredxx_sim.devices) {
+		struct libredxx_sim_device* device = libredxx_sim.devices;
+		libredxx_sim.devices = device->next;
+		libredxx_sim_unplug(device);
+	}
+	rmdir(libredxx_sim.sysfs_path);
+	rmdir(libredxx_sim.root);
+	libredxx_sim.started = false;
+	libredxx_mutex_unlock(&libredxx_sim.mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_sim_add_device(const libredxx_sim_device_config* config, uint32_t* device_id)
+{
+	struct libredxx_sim_device* device = calloc(1, sizeof(struct libredxx_sim_device));
+	if (!device) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	device->config = *config;
+	device->refs = 1;
+	libredxx_mutex_init(&device->mutex);
+	libredxx_cond_init(&device->cond);
+	libredxx_status status = libredxx_sim_init_device(device);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_sim_unref(device);
+		return status;
+	}
+	libredxx_mutex_lock(&libredxx_sim.mutex);
+	if (!libredxx_sim.started) {
+		status = LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	} else if ((device->address = libredxx_sim_free_address()) == 0) {
+		status = LIBREDXX_STATUS_ERROR_OVERFLOW;
+	} else if (!libredxx_sim_create_sysfs(device)) {
+		status = LIBREDXX_STATUS_ERROR_SYS;
+	} else if ((status = libredxx_thread_create(&device->worker, libredxx_sim_worker, device)) != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_sim_remove_sysfs(device);
+	}
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		libredxx_sim_unref(device);
+		return status;
+	}
+	device->id = ++libredxx_sim.next_id;
+	device->next = libredxx_sim.devices;
+	libredxx_sim.devices = device;
+	*device_id = device->id;
+	libredxx_mutex_unlock(&libredxx_sim.mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_sim_remove_device(uint32_t device_id)
+{
+	libredxx_mutex_lock(&libredxx_sim.mutex);
+	struct libredxx_sim_device** link = &libredxx_sim.devices;
+	while (*link && (*link)->id != device_id) {
+		link = &(*link)->next;
+	}
+	struct libredxx_sim_device* device = *link;
+	if (!device) {
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	*link = device->next;
+	libredxx_sim_unplug(device);
+	libredxx_mutex_unlock(&libredxx_sim.mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_sim_get_d2xx_channel(uint32_t device_id, uint8_t interface_index, libredxx_sim_d2xx_channel* channel)
+{
+	libredxx_mutex_lock(&libredxx_sim.mutex);
+	struct libredxx_sim_device* device = libredxx_sim.devices;
+	while (device && device->id != device_id) {
+		device = device->next;
+	}
+	if (!device || device->config.type != LIBREDXX_DEVICE_TYPE_D2XX || interface_index >= device->interface_count) {
+		libredxx_mutex_unlock(&libredxx_sim.mutex);
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	libredxx_mutex_lock(&device->mutex);
+	channel->baud_value = device->channels[interface_index].baud_value;
+	channel->baud_index = device->channels[interface_index].baud_index;
+	channel->latency_ms = device->channels[interface_index].latency_ms;
+	libredxx_mutex_unlock(&device->mutex);
+	libredxx_mutex_unlock(&libredxx_sim.mutex);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+#else
+
+libredxx_status libredxx_sim_start(void)
+{
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_sim_stop(void)
+{
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_sim_add_device(const libredxx_sim_device_config* config, uint32_t* device_id)
+{
+	(void)config;
+	(void)device_id;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_sim_remove_device(uint32_t device_id)
+{
+	(void)device_id;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_sim_get_d2xx_channel(uint32_t device_id, uint8_t interface_index, libredxx_sim_d2xx_channel* channel)
+{
+	(void)device_id;
+	(void)interface_index;
+	(void)channel;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "libredxx_stats.h"
+#include "libredxx_time.h"
+
+#include <string.h>
+
+// bucket n holds [2^n, 2^(n+1)) microseconds, bucket 0 everything below 2
+static unsigned int libredxx_latency_bucket(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	unsigned int bucket = 0;
+	while (us > 1 && bucket < LIBREDXX_LATENCY_BUCKET_COUNT - 1) {
+		us >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
+
+static void libredxx_stats_add(_Atomic uint64_t* counter, uint64_t value)
+{
+	atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+void libredxx_stats_read(libredxx_stats_counters* counters, libredxx_endpoint endpoint, libredxx_status status, size_t requested, size_t transferred, uint64_t start_ns)
+{
+	if ((unsigned int)endpoint >= LIBREDXX_STATS_ENDPOINT_COUNT) {
+		return;
+	}
+	struct libredxx_endpoint_counters* endpoint_counters = &counters->endpoints[endpoint];
+	const uint64_t elapsed = libredxx_time_ns() - start_ns;
+	libredxx_stats_add(&endpoint_counters->read_ns, elapsed);
+	if (status == LIBREDXX_STATUS_SUCCESS) {
+		libredxx_stats_add(&endpoint_counters->read_bytes, transferred);
+		libredxx_stats_add(&endpoint_counters->read_transfers, 1);
+		libredxx_stats_add(&endpoint_counters->read_latency[libredxx_latency_bucket(elapsed)], 1);
+		if (transferred < requested) {
+			libredxx_stats_add(&endpoint_counters->short_reads, 1);
+		}
+	} else if (status == LIBREDXX_STATUS_ERROR_INTERRUPTED) {
+		libredxx_stats_add(&endpoint_counters->interrupted, 1);
+	} else {
+		libredxx_stats_add(&endpoint_counters->errors, 1);
+	}
+}
+
+void libredxx_stats_write(libredxx_stats_counters* counters, libredxx_endpoint endpoint, libredxx_status status, size_t transferred, uint64_t start_ns)
+{
+	if ((unsigned int)endpoint >= LIBREDXX_STATS_ENDPOINT_COUNT) {
+		return;
+	}
+	struct libredxx_endpoint_counters* endpoint_counters = &counters->endpoints[endpoint];
+	const uint64_t elapsed = libredxx_time_ns() - start_ns;
+	libredxx_stats_add(&endpoint_counters->write_ns, elapsed);
+	if (status == LIBREDXX_STATUS_SUCCESS) {
+		libredxx_stats_add(&endpoint_counters->write_bytes, transferred);
+		libredxx_stats_add(&endpoint_counters->write_transfers, 1);
+		libredxx_stats_add(&endpoint_counters->write_latency[libredxx_latency_bucket(elapsed)], 1);
+	} else if (status == LIBREDXX_STATUS_ERROR_INTERRUPTED) {
+		libredxx_stats_add(&endpoint_counters->interrupted, 1);
+	} else {
+		libredxx_stats_add(&endpoint_counters->errors, 1);
+	}
+}
+
+void libredxx_stats_d2xx_status_packet(libredxx_stats_counters* counters)
+{
+	libredxx_stats_add(&counters->d2xx_status_packets, 1);
+}
+
+void libredxx_stats_interrupt(libredxx_stats_counters* counters)
+{
+	libredxx_stats_add(&counters->interrupts, 1);
+}
+
+static uint64_t libredxx_stats_load(_Atomic uint64_t* counter)
+{
+	return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+void libredxx_stats_snapshot(libredxx_stats_counters* counters, libredxx_stats* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	for (size_t i = 0; i < LIBREDXX_STATS_ENDPOINT_COUNT; ++i) {
+		struct libredxx_endpoint_counters* from = &counters->endpoints[i];
+		libredxx_endpoint_stats* to = &stats->endpoints[i];
+		to->read_bytes = libredxx_stats_load(&from->read_bytes);
+		to->read_transfers = libredxx_stats_load(&from->read_transfers);
+		to->short_reads = libredxx_stats_load(&from->short_reads);
+		to->read_ns = libredxx_stats_load(&from->read_ns);
+		to->write_bytes = libredxx_stats_load(&from->write_bytes);
+		to->write_transfers = libredxx_stats_load(&from->write_transfers);
+		to->write_ns = libredxx_stats_load(&from->write_ns);
+		to->errors = libredxx_stats_load(&from->errors);
+		to->interrupted = libredxx_stats_load(&from->interrupted);
+		for (size_t bucket = 0; bucket < LIBREDXX_LATENCY_BUCKET_COUNT; ++bucket) {
+			to->read_latency[bucket] = libredxx_stats_load(&from->read_latency[bucket]);
+			to->write_latency[bucket] = libredxx_stats_load(&from->write_latency[bucket]);
+		}
+	}
+	stats->d2xx_status_packets = libredxx_stats_load(&counters->d2xx_status_packets);
+	stats->interrupts = libredxx_stats_load(&counters->interrupts);
+}
+
+static void libredxx_stats_clear(_Atomic uint64_t* counter)
+{
+	atomic_store_explicit(counter, 0, memory_order_relaxed);
+}
+
+void libredxx_stats_reset(libredxx_stats_counters* counters)
+{
+	for (size_t i = 0; i < LIBREDXX_STATS_ENDPOINT_COUNT; ++i) {
+		struct libredxx_endpoint_counters* endpoint_counters = &counters->endpoints[i];
+		libredxx_stats_clear(&endpoint_counters->read_bytes);
+		libredxx_stats_clear(&endpoint_counters->read_transfers);
+		libredxx_stats_clear(&endpoint_counters->short_reads);
+		libredxx_stats_clear(&endpoint_counters->read_ns);
+		libredxx_stats_clear(&endpoint_counters->write_bytes);
+		libredxx_stats_clear(&endpoint_counters->write_transfers);
+		libredxx_stats_clear(&endpoint_counters->write_ns);
+		libredxx_stats_clear(&endpoint_counters->errors);
+		libredxx_stats_clear(&endpoint_counters->interrupted);
+		for (size_t bucket = 0; bucket < LIBREDXX_LATENCY_BUCKET_COUNT; ++bucket) {
+			libredxx_stats_clear(&endpoint_counters->read_latency[bucket]);
+			libredxx_stats_clear(&endpoint_counters->write_latency[bucket]);
+		}
+	}
+	libredxx_stats_clear(&counters->d2xx_status_packets);
+	libredxx_stats_clear(&counters->interrupts);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LIBREDXX_LIBREDXX_STATS_H
+#define LIBREDXX_LIBREDXX_STATS_H
+
+#include "libredxx.h"
+
+#include <stdatomic.h>
+
+/*
+ * Mirrors libredxx_stats with relaxed atomics, so the I/O paths only ever pay
+ * for a few uncontended increments.
+ */
+
+struct libredxx_endpoint_counters {
+	_Atomic uint64_t read_bytes;
+	_Atomic uint64_t read_transfers;
+	_Atomic uint64_t short_reads;
+	_Atomic uint64_t read_ns;
+	_Atomic uint64_t write_bytes;
+	_Atomic uint64_t write_transfers;
+	_Atomic uint64_t write_ns;
+	_Atomic uint64_t errors;
+	_Atomic uint64_t interrupted;
+	_Atomic uint64_t read_latency[LIBREDXX_LATENCY_BUCKET_COUNT];
+	_Atomic uint64_t write_latency[LIBREDXX_LATENCY_BUCKET_COUNT];
+};
+
+struct libredxx_stats_counters {
+	struct libredxx_endpoint_counters endpoints[LIBREDXX_STATS_ENDPOINT_COUNT];
+	_Atomic uint64_t d2xx_status_packets;
+	_Atomic uint64_t interrupts;
+};
+typedef struct libredxx_stats_counters libredxx_stats_counters;
+
+// start_ns is libredxx_time_ns() from before the transfer
+void libredxx_stats_read(libredxx_stats_counters* counters, libredxx_endpoint endpoint, libredxx_status status, size_t requested, size_t transferred, uint64_t start_ns);
+void libredxx_stats_write(libredxx_stats_counters* counters, libredxx_endpoint endpoint, libredxx_status status, size_t transferred, uint64_t start_ns);
+void libredxx_stats_d2xx_status_packet(libredxx_stats_counters* counters);
+void libredxx_stats_interrupt(libredxx_stats_counters* counters);
+
+void libredxx_stats_snapshot(libredxx_stats_counters* counters, libredxx_stats* stats);
+void libredxx_stats_reset(libredxx_stats_counters* counters);
+
+#endif // LIBREDXX_LIBREDXX_STATS_H
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WIN32
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+
+#include "libredxx_thread.h"
+
+#include <stdlib.h>
+#ifndef _WIN32
+#include <sched.h>
+#include <time.h>
+#endif
+
+struct libredxx_thread_start {
+	void (*function)(void* arg);
+	void* arg;
+};
+
+#ifdef _WIN32
+
+static DWORD WINAPI libredxx_thread_main(LPVOID param)
+{
+	struct libredxx_thread_start start = *(struct libredxx_thread_start*)param;
+	free(param);
+	start.function(start.arg);
+	return 0;
+}
+
+libredxx_status libredxx_thread_create(libredxx_thread* thread, void (*function)(void* arg), void* arg)
+{
+	struct libredxx_thread_start* start = malloc(sizeof(struct libredxx_thread_start));
+	if (!start) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	start->function = function;
+	start->arg = arg;
+	*thread = CreateThread(NULL, 0, libredxx_thread_main, start, 0, NULL);
+	if (!*thread) {
+		free(start);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+void libredxx_thread_join(libredxx_thread thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+libredxx_status libredxx_thread_set_affinity(libredxx_thread thread, int cpu)
+{
+	if (cpu < 0 || cpu >= (int)(sizeof(DWORD_PTR) * 8)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return SetThreadAffinityMask(thread, (DWORD_PTR)1 << cpu) ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+}
+
+libredxx_status libredxx_thread_set_realtime(libredxx_thread thread, int priority)
+{
+	(void)priority; // Windows has no priority levels within the real-time class for one thread
+	return SetThreadPriority(thread, THREAD_PRIORITY_TIME_CRITICAL) ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+}
+
+void libredxx_mutex_init(libredxx_mutex* mutex)
+{
+	InitializeSRWLock(mutex);
+}
+
+void libredxx_mutex_destroy(libredxx_mutex* mutex)
+{
+	(void)mutex; // SRW locks hold no resources
+}
+
+void libredxx_mutex_lock(libredxx_mutex* mutex)
+{
+	AcquireSRWLockExclusive(mutex);
+}
+
+void libredxx_mutex_unlock(libredxx_mutex* mutex)
+{
+	ReleaseSRWLockExclusive(mutex);
+}
+
+void libredxx_rwlock_init(libredxx_rwlock* rwlock)
+{
+	InitializeSRWLock(rwlock);
+}
+
+void libredxx_rwlock_destroy(libredxx_rwlock* rwlock)
+{
+	(void)rwlock;
+}
+
+void libredxx_rwlock_lock_shared(libredxx_rwlock* rwlock)
+{
+	AcquireSRWLockShared(rwlock);
+}
+
+void libredxx_rwlock_unlock_shared(libredxx_rwlock* rwlock)
+{
+	ReleaseSRWLockShared(rwlock);
+}
+
+void libredxx_rwlock_lock(libredxx_rwlock* rwlock)
+{
+	AcquireSRWLockExclusive(rwlock);
+}
+
+void libredxx_rwlock_unlock(libredxx_rwlock* rwlock)
+{
+	ReleaseSRWLockExclusive(rwlock);
+}
+
+void libredxx_cond_init(libredxx_cond* cond)
+{
+	InitializeConditionVariable(cond);
+}
+
+void libredxx_cond_destroy(libredxx_cond* cond)
+{
+	(void)cond;
+}
+
+void libredxx_cond_wait(libredxx_cond* cond, libredxx_mutex* mutex)
+{
+	SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+}
+
+void libredxx_cond_wait_for(libredxx_cond* cond, libredxx_mutex* mutex, uint64_t timeout_ns)
+{
+	const uint64_t timeout_ms = (timeout_ns + 999999) / 1000000;
+	SleepConditionVariableSRW(cond, mutex, timeout_ms < INFINITE ? (DWORD)timeout_ms : INFINITE - 1, 0);
+}
+
+void libredxx_cond_signal(libredxx_cond* cond)
+{
+	WakeConditionVariable(cond);
+}
+
+void libredxx_cond_broadcast(libredxx_cond* cond)
+{
+	WakeAllConditionVariable(cond);
+}
+
+#else
+
+static void* libredxx_thread_main(void* param)
+{
+	struct libredxx_thread_start start = *(struct libredxx_thread_start*)param;
+	free(param);
+	start.function(start.arg);
+	return NULL;
+}
+
+libredxx_status libredxx_thread_create(libredxx_thread* thread, void (*function)(void* arg), void* arg)
+{
+	struct libredxx_thread_start* start = malloc(sizeof(struct libredxx_thread_start));
+	if (!start) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	start->function = function;
+	start->arg = arg;
+	if (pthread_create(thread, NULL, libredxx_thread_main, start) != 0) {
+		free(start);
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+void libredxx_thread_join(libredxx_thread thread)
+{
+	pthread_join(thread, NULL);
+}
+
+libredxx_status libredxx_thread_set_affinity(libredxx_thread thread, int cpu)
+{
+#ifdef __linux__
+	if (cpu < 0 || cpu >= CPU_SETSIZE) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(thread, sizeof(set), &set) == 0 ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+#else
+	// macOS only takes affinity hints between threads, not CPUs
+	(void)thread;
+	(void)cpu;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+#endif
+}
+
+libredxx_status libredxx_thread_set_realtime(libredxx_thread thread, int priority)
+{
+	if (priority < sched_get_priority_min(SCHED_FIFO) || priority > sched_get_priority_max(SCHED_FIFO)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	struct sched_param param = {0};
+	param.sched_priority = priority;
+	return pthread_setschedparam(thread, SCHED_FIFO, &param) == 0 ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
+}
+
+void libredxx_mutex_init(libredxx_mutex* mutex)
+{
+	pthread_mutex_init(mutex, NULL);
+}
+
+void libredxx_mutex_destroy(libredxx_mutex* mutex)
+{
+	pthread_mutex_destroy(mutex);
+}
+
+void libredxx_mutex_lock(libredxx_mutex* mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+void libredxx_mutex_unlock(libredxx_mutex* mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+void libredxx_rwlock_init(libredxx_rwlock* rwlock)
+{
+#ifdef __GLIBC__
+	// glibc lets a steady stream of readers starve a writer by default
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init(&attr);
+	pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	pthread_rwlock_init(rwlock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+#else
+	pthread_rwlock_init(rwlock, NULL);
+#endif
+}
+
+void libredxx_rwlock_destroy(libredxx_rwlock* rwlock)
+{
+	pthread_rwlock_destroy(rwlock);
+}
+
+void libredxx_rwlock_lock_shared(libredxx_rwlock* rwlock)
+{
+	pthread_rwlock_rdlock(rwlock);
+}
+
+void libredxx_rwlock_unlock_shared(libredxx_rwlock* rwlock)
+{
+	pthread_rwlock_unlock(rwlock);
+}
+
+void libredxx_rwlock_lock(libredxx_rwlock* rwlock)
+{
+	pthread_rwlock_wrlock(rwlock);
+}
+
+void libredxx_rwlock_unlock(libredxx_rwlock* rwlock)
+{
+	pthread_rwlock_unlock(rwlock);
+}
+
+void libredxx_cond_init(libredxx_cond* cond)
+{
+	pthread_cond_init(cond, NULL);
+}
+
+void libredxx_cond_destroy(libredxx_cond* cond)
+{
+	pthread_cond_destroy(cond);
+}
+
+void libredxx_cond_wait(libredxx_cond* cond, libredxx_mutex* mutex)
+{
+	pthread_cond_wait(cond, mutex);
+}
+
+void libredxx_cond_wait_for(libredxx_cond* cond, libredxx_mutex* mutex, uint64_t timeout_ns)
+{
+	// the default condition clock is CLOCK_REALTIME everywhere, macOS can't change it
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	const uint64_t nsec = (uint64_t)deadline.tv_nsec + timeout_ns % 1000000000;
+	deadline.tv_sec += (time_t)(timeout_ns / 1000000000 + nsec / 1000000000);
+	deadline.tv_nsec = (long)(nsec % 1000000000);
+	pthread_cond_timedwait(cond, mutex, &deadline);
+}
+
+void libredxx_cond_signal(libredxx_cond* cond)
+{
+	pthread_cond_signal(cond);
+}
+
+void libredxx_cond_broadcast(libredxx_cond* cond)
+{
+	pthread_cond_broadcast(cond);
+}
+
+#endif
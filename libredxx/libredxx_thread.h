@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LIBREDXX_LIBREDXX_THREAD_H
+#define LIBREDXX_LIBREDXX_THREAD_H
+
+#include "libredxx.h"
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE libredxx_thread;
+typedef SRWLOCK libredxx_mutex;
+typedef SRWLOCK libredxx_rwlock;
+typedef CONDITION_VARIABLE libredxx_cond;
+#define LIBREDXX_MUTEX_INIT SRWLOCK_INIT
+#define LIBREDXX_COND_INIT CONDITION_VARIABLE_INIT
+#else
+#include <pthread.h>
+typedef pthread_t libredxx_thread;
+typedef pthread_mutex_t libredxx_mutex;
+typedef pthread_rwlock_t libredxx_rwlock;
+typedef pthread_cond_t libredxx_cond;
+#define LIBREDXX_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#define LIBREDXX_COND_INIT PTHREAD_COND_INITIALIZER
+#endif
+
+libredxx_status libredxx_thread_create(libredxx_thread* thread, void (*function)(void* arg), void* arg);
+void libredxx_thread_join(libredxx_thread thread);
+// pins thread to one CPU
+libredxx_status libredxx_thread_set_affinity(libredxx_thread thread, int cpu);
+// real-time FIFO scheduling at priority, needs CAP_SYS_NICE or an rtprio limit on Linux
+libredxx_status libredxx_thread_set_realtime(libredxx_thread thread, int priority);
+
+void libredxx_mutex_init(libredxx_mutex* mutex);
+void libredxx_mutex_destroy(libredxx_mutex* mutex);
+void libredxx_mutex_lock(libredxx_mutex* mutex);
+void libredxx_mutex_unlock(libredxx_mutex* mutex);
+
+void libredxx_rwlock_init(libredxx_rwlock* rwlock);
+void libredxx_rwlock_destroy(libredxx_rwlock* rwlock);
+void libredxx_rwlock_lock_shared(libredxx_rwlock* rwlock);
+void libredxx_rwlock_unlock_shared(libredxx_rwlock* rwlock);
+void libredxx_rwlock_lock(libredxx_rwlock* rwlock);
+void libredxx_rwlock_unlock(libredxx_rwlock* rwlock);
+
+void libredxx_cond_init(libredxx_cond* cond);
+void libredxx_cond_destroy(libredxx_cond* cond);
+void libredxx_cond_wait(libredxx_cond* cond, libredxx_mutex* mutex);
+// may wake early, callers check their own deadline
+void libredxx_cond_wait_for(libredxx_cond* cond, libredxx_mutex* mutex, uint64_t timeout_ns);
+void libredxx_cond_signal(libredxx_cond* cond);
+void libredxx_cond_broadcast(libredxx_cond* cond);
+
+#endif // LIBREDXX_LIBREDXX_THREAD_H
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "libredxx_trace.h"
+
+#ifdef LIBREDXX_TRACE
+
+#include "libredxx_time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+_Atomic(libredxx_trace_callback) libredxx_trace_hook;
+static _Atomic(void*) libredxx_trace_context;
+
+void libredxx_trace_emit(libredxx_trace_event_type type, const libredxx_opened_device* device, libredxx_endpoint endpoint, bool write, size_t size, libredxx_status status)
+{
+	libredxx_trace_callback callback = atomic_load_explicit(&libredxx_trace_hook, memory_order_acquire);
+	if (!callback) {
+		return;
+	}
+	libredxx_trace_event event;
+	event.type = type;
+	event.device = device;
+	event.endpoint = endpoint;
+	event.write = write;
+	event.size = size;
+	event.status = status;
+	event.timestamp_ns = libredxx_time_ns();
+	callback(&event, atomic_load_explicit(&libredxx_trace_context, memory_order_relaxed));
+}
+
+libredxx_status libredxx_set_trace_callback(libredxx_trace_callback callback, void* context)
+{
+	atomic_store_explicit(&libredxx_trace_context, context, memory_order_relaxed);
+	atomic_store_explicit(&libredxx_trace_hook, callback, memory_order_release);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+/*
+ * Each thread only ever appends to its own buffer and publishes the new count
+ * with a release store, the writer reads up to that count. Buffers are linked
+ * into a global list once and kept for the life of the process, as there is no
+ * portable way to learn that a thread exited.
+ */
+struct libredxx_trace_buffer {
+	struct libredxx_trace_buffer* next;
+	uint32_t thread_index;
+	size_t capacity;
+	libredxx_trace_event* events;
+	_Atomic size_t count;
+	_Atomic uint64_t dropped;
+};
+
+static _Atomic(struct libredxx_trace_buffer*) libredxx_trace_buffers;
+static _Atomic uint32_t libredxx_trace_thread_count;
+static _Atomic size_t libredxx_trace_capacity;
+static _Atomic uint64_t libredxx_trace_start_ns;
+static _Thread_local struct libredxx_trace_buffer* libredxx_trace_thread_buffer;
+
+static struct libredxx_trace_buffer* libredxx_trace_create_buffer(void)
+{
+	struct libredxx_trace_buffer* buffer = calloc(1, sizeof(struct libredxx_trace_buffer));
+	if (!buffer) {
+		return NULL;
+	}
+	buffer->capacity = atomic_load_explicit(&libredxx_trace_capacity, memory_order_relaxed);
+	buffer->events = malloc(buffer->capacity * sizeof(libredxx_trace_event));
+	if (!buffer->events) {
+		free(buffer);
+		return NULL;
+	}
+	buffer->thread_index = atomic_fetch_add_explicit(&libredxx_trace_thread_count, 1, memory_order_relaxed);
+	struct libredxx_trace_buffer* head = atomic_load_explicit(&libredxx_trace_buffers, memory_order_relaxed);
+	do {
+		buffer->next = head;
+	} while (!atomic_compare_exchange_weak_explicit(&libredxx_trace_buffers, &head, buffer, memory_order_release, memory_order_relaxed));
+	return buffer;
+}
+
+static void libredxx_trace_record(const libredxx_trace_event* event, void* context)
+{
+	(void)context;
+	struct libredxx_trace_buffer* buffer = libredxx_trace_thread_buffer;
+	if (!buffer) {
+		buffer = libredxx_trace_create_buffer();
+		if (!buffer) {
+			return;
+		}
+		libredxx_trace_thread_buffer = buffer;
+	}
+	const size_t count = atomic_load_explicit(&buffer->count, memory_order_relaxed);
+	if (count == buffer->capacity) {
+		atomic_fetch_add_explicit(&buffer->dropped, 1, memory_order_relaxed);
+		return;
+	}
+	buffer->events[count] = *event;
+	atomic_store_explicit(&buffer->count, count + 1, memory_order_release);
+}
+
+libredxx_status libredxx_trace_start(size_t events_per_thread)
+{
+	if (events_per_thread == 0) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	atomic_store_explicit(&libredxx_trace_hook, NULL, memory_order_release);
+	struct libredxx_trace_buffer* buffer = atomic_load_explicit(&libredxx_trace_buffers, memory_order_acquire);
+	for (; buffer; buffer = buffer->next) {
+		if (buffer->capacity < events_per_thread) {
+			libredxx_trace_event* events = realloc(buffer->events, events_per_thread * sizeof(libredxx_trace_event));
+			if (!events) {
+				return LIBREDXX_STATUS_ERROR_SYS;
+			}
+			buffer->events = events;
+			buffer->capacity = events_per_thread;
+		}
+		atomic_store_explicit(&buffer->count, 0, memory_order_relaxed);
+		atomic_store_explicit(&buffer->dropped, 0, memory_order_relaxed);
+	}
+	atomic_store_explicit(&libredxx_trace_capacity, events_per_thread, memory_order_relaxed);
+	atomic_store_explicit(&libredxx_trace_start_ns, libredxx_time_ns(), memory_order_relaxed);
+	return libredxx_set_trace_callback(libredxx_trace_record, NULL);
+}
+
+libredxx_status libredxx_trace_stop(void)
+{
+	// leaves a callback that isn't the recorder alone
+	libredxx_trace_callback expected = libredxx_trace_record;
+	atomic_compare_exchange_strong_explicit(&libredxx_trace_hook, &expected, NULL, memory_order_release, memory_order_relaxed);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static void libredxx_trace_write_event(FILE* file, const struct libredxx_trace_buffer* buffer, const libredxx_trace_event* event, uint64_t start_ns)
+{
+	const double ts = event->timestamp_ns > start_ns ? (double)(event->timestamp_ns - start_ns) / 1000.0 : 0.0;
+	const unsigned int tid = buffer->thread_index + 1;
+	const char endpoint = (char)('A' + event->endpoint);
+	const char* name = event->write ? "write" : "read";
+	switch (event->type) {
+	case LIBREDXX_TRACE_SUBMIT:
+		fprintf(file, ",\n{\"name\":\"%s %c\",\"cat\":\"libredxx\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"device\":\"%p\",\"size\":%zu}}", name, endpoint, ts, tid, (const void*)event->device, event->size);
+		break;
+	case LIBREDXX_TRACE_COMPLETE:
+		fprintf(file, ",\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"transferred\":%zu}}", ts, tid, event->size);
+		break;
+	case LIBREDXX_TRACE_ERROR:
+		fprintf(file, ",\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"status\":%d}}", ts, tid, (int)event->status);
+		break;
+	case LIBREDXX_TRACE_INTERRUPT:
+		fprintf(file, ",\n{\"name\":\"interrupt\",\"cat\":\"libredxx\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"device\":\"%p\"}}", ts, tid, (const void*)event->device);
+		break;
+	}
+}
+
+libredxx_status libredxx_trace_write_json(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	const uint64_t start_ns = atomic_load_explicit(&libredxx_trace_start_ns, memory_order_relaxed);
+	uint64_t dropped = 0;
+	fprintf(file, "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"libredxx\"}}");
+	struct libredxx_trace_buffer* buffer = atomic_load_explicit(&libredxx_trace_buffers, memory_order_acquire);
+	for (; buffer; buffer = buffer->next) {
+		const size_t count = atomic_load_explicit(&buffer->count, memory_order_acquire);
+		dropped += atomic_load_explicit(&buffer->dropped, memory_order_relaxed);
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", buffer->thread_index + 1, buffer->thread_index + 1);
+		for (size_t i = 0; i < count; ++i) {
+			libredxx_trace_write_event(file, buffer, &buffer->events[i], start_ns);
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":\"%llu\"}}\n", (unsigned long long)dropped);
+	const bool failed = ferror(file) != 0;
+	if (fclose(file) != 0 || failed) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+#else
+
+libredxx_status libredxx_set_trace_callback(libredxx_trace_callback callback, void* context)
+{
+	(void)callback;
+	(void)context;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_trace_start(size_t events_per_thread)
+{
+	(void)events_per_thread;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_trace_stop(void)
+{
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_trace_write_json(const char* path)
+{
+	(void)path;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+#endif
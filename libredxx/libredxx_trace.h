@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LIBREDXX_LIBREDXX_TRACE_H
+#define LIBREDXX_LIBREDXX_TRACE_H
+
+#include "libredxx.h"
+
+#ifdef LIBREDXX_TRACE
+
+#include <stdatomic.h>
+
+extern _Atomic(libredxx_trace_callback) libredxx_trace_hook;
+
+void libredxx_trace_emit(libredxx_trace_event_type type, const libredxx_opened_device* device, libredxx_endpoint endpoint, bool write, size_t size, libredxx_status status);
+
+// a single relaxed load and branch while no callback is set
+#define LIBREDXX_TRACE_EVENT(type, device, endpoint, write, size, status) \
+	do { \
+		if (atomic_load_explicit(&libredxx_trace_hook, memory_order_relaxed)) { \
+			libredxx_trace_emit(type, device, endpoint, write, size, status); \
+		} \
+	} while (0)
+
+#else
+
+#define LIBREDXX_TRACE_EVENT(type, device, endpoint, write, size, status) do {} while (0)
+
+#endif
+
+#endif // LIBREDXX_LIBREDXX_TRACE_H
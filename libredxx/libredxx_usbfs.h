@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LIBREDXX_LIBREDXX_USBFS_H
+#define LIBREDXX_LIBREDXX_USBFS_H
+
+#include <poll.h>
+
+/*
+ * Everything the Linux backend does with usbfs goes through one of these, so
+ * the simulator can stand in for the kernel. Enumeration reads sysfs_path the
+ * way it reads /sys/bus/usb/devices, and device nodes live under usbfs_path.
+ * Found devices keep the ops they were found with.
+ */
+struct libredxx_usbfs_ops {
+	const char* usbfs_path;
+	const char* sysfs_path;
+	int (*open)(const char* path, int flags);
+	int (*close)(int fd);
+	int (*ioctl)(int fd, unsigned long request, void* arg);
+	int (*poll)(struct pollfd* fds, nfds_t fds_count, int timeout);
+};
+typedef struct libredxx_usbfs_ops libredxx_usbfs_ops;
+
+// NULL goes back to the kernel
+void libredxx_usbfs_set_ops(const libredxx_usbfs_ops* ops);
+
+#endif // LIBREDXX_LIBREDXX_USBFS_H
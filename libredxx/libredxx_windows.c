@@ -22,8 +22,16 @@
 
 #include "libredxx.h"
 #include "libredxx_ft260.h"
+#include "libredxx_pool.h"
+#include "libredxx_pcap.h"
+#include "libredxx_replay.h"
+#include "libredxx_stats.h"
+#include "libredxx_time.h"
+#include "libredxx_trace.h"
 
 #include <stdlib.h>
+#include <errno.h>
+#include <stdatomic.h>
 
 #define WIN32_LEAN_AND_MEAN
 #define UNICODE
@@ -36,19 +44,29 @@
 #include <winioctl.h>
 #include <hidclass.h>
 
+#define LIBREDXX_D3XX_CHANNEL_COUNT 4
+
 struct libredxx_found_device {
 	WCHAR path[256];
 	libredxx_serial serial;
 	libredxx_device_id id;
 	libredxx_device_type type;
+	uint8_t interface_index;
+	bool replay;
 };
 
 struct libredxx_opened_device {
 	libredxx_found_device found;
 	HANDLE handle;
 	HANDLE d2xx_read_event;
-	size_t d3xx_stream_pipe;
-	bool read_interrupted;
+	size_t d3xx_stream_pipe[LIBREDXX_D3XX_CHANNEL_COUNT];
+	uint8_t d3xx_channels; // bit per channel with its pipe timeouts disabled
+	libredxx_buffer_pool pool;
+	libredxx_stats_counters stats;
+	libredxx_pcap_address pcap_address;
+	uint32_t record_session;
+	libredxx_replay_session* replay;
+	atomic_bool read_interrupted[LIBREDXX_D3XX_CHANNEL_COUNT];
 };
 
 static int32_t find_last_of(const wchar_t* str, uint32_t str_len, wchar_t needle)
@@ -112,6 +130,7 @@ libredxx_status libredxx_enumerate_interfaces(HDEVINFO dev_info, const libredxx_
 					DEVPROPTYPE ptype;
 					DWORD prop_size;
 					wchar_t* serial = NULL;
+					uint8_t interface_index = 0;
 
 					wchar_t inst[256];
 					if (!SetupDiGetDevicePropertyW(dev_info, &did, &DEVPKEY_Device_InstanceId, &ptype, (PBYTE)inst, sizeof(inst), &prop_size, 0)) {
@@ -140,10 +159,8 @@ libredxx_status libredxx_enumerate_interfaces(HDEVINFO dev_info, const libredxx_
 								break; // not a valid multi-channel device with a parent
 							}
 							++channel_offset; // move past &
-							uint16_t channel_number = (uint16_t)wcstol(&inst[channel_offset], NULL, 16);
-							if (channel_number > 0) {
-								break; // TODO: support multi-channel
-							}
+							// each channel is its own interface with its own device path
+							interface_index = (uint8_t)wcstol(&inst[channel_offset], NULL, 16);
 							int32_t serial_offset = find_last_of(parent, parent_len, L'\\');
 							if (serial_offset != -1) {
 								++serial_offset; // move past backslash
@@ -166,6 +183,7 @@ libredxx_status libredxx_enumerate_interfaces(HDEVINFO dev_info, const libredxx_
 					device->id.pid = pid;
 					wcscpy_s(device->path, sizeof(device->path) / sizeof(device->path[0]), detail->DevicePath);
 					device->type = filter->type;
+					device->interface_index = interface_index;
 					if (serial) {
 						WideCharToMultiByte(CP_UTF8, 0, serial, -1, device->serial.serial, sizeof(device->serial.serial), NULL, NULL);
 					}
@@ -182,11 +200,50 @@ libredxx_status libredxx_enumerate_interfaces(HDEVINFO dev_info, const libredxx_
 			(*devices)[i] = &private_devices[i];
 		}
 	}
+	libredxx_record_find(*devices, *devices_count);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+static libredxx_status libredxx_find_replay_devices(const libredxx_find_filter* filters, size_t filters_count, libredxx_found_device*** devices, size_t* devices_count)
+{
+	libredxx_replay_device* replay_devices;
+	size_t replay_devices_count;
+	libredxx_status status = libredxx_replay_find(filters, filters_count, &replay_devices, &replay_devices_count);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	*devices = NULL;
+	*devices_count = 0;
+	if (replay_devices_count > 0) {
+		libredxx_found_device* private_devices = calloc(replay_devices_count, sizeof(libredxx_found_device));
+		*devices = malloc(sizeof(libredxx_found_device*) * replay_devices_count);
+		if (!private_devices || !*devices) {
+			free(private_devices);
+			free(*devices);
+			free(replay_devices);
+			*devices = NULL;
+			return LIBREDXX_STATUS_ERROR_SYS;
+		}
+		for (size_t i = 0; i < replay_devices_count; ++i) {
+			libredxx_found_device* private_device = &private_devices[i];
+			private_device->serial = replay_devices[i].serial;
+			private_device->id = replay_devices[i].id;
+			private_device->type = replay_devices[i].type;
+			private_device->interface_index = replay_devices[i].interface_index;
+			private_device->replay = true;
+			(*devices)[i] = private_device;
+		}
+		*devices_count = replay_devices_count;
+	}
+	free(replay_devices);
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
 libredxx_status libredxx_find_devices(const libredxx_find_filter* filters, size_t filters_count, libredxx_found_device*** devices, size_t* devices_count)
 {
+	if (libredxx_replay_enabled()) {
+		return libredxx_find_replay_devices(filters, filters_count, devices, devices_count);
+	}
 	libredxx_status status;
 	HDEVINFO dev_info = SetupDiGetClassDevsW(NULL, NULL, NULL, DIGCF_DEVICEINTERFACE | DIGCF_ALLCLASSES | DIGCF_PRESENT);
 	if (dev_info == INVALID_HANDLE_VALUE) {
@@ -226,6 +283,26 @@ libredxx_status libredxx_get_device_type(const libredxx_found_device* found, lib
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
+libredxx_status libredxx_get_interface_index(const libredxx_found_device* found, uint8_t* interface_index)
+{
+	*interface_index = found->interface_index;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_get_link_speed(const libredxx_found_device* found, libredxx_link_speed* speed)
+{
+	(void)found;
+	(void)speed;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_get_packet_size(const libredxx_found_device* found, size_t* packet_size)
+{
+	(void)found;
+	(void)packet_size;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
 static libredxx_status libredxx_d3xx_set_timeout(libredxx_opened_device* device, uint8_t pipe, uint32_t timeout)
 {
 	uint8_t* timeout_bytes = (uint8_t*)&timeout;
@@ -245,6 +322,25 @@ static libredxx_status libredxx_d3xx_set_timeout(libredxx_opened_device* device,
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
+static libredxx_status libredxx_d3xx_open_channel(libredxx_opened_device* device, uint8_t channel)
+{
+	if (device->d3xx_channels & (1 << channel)) {
+		return LIBREDXX_STATUS_SUCCESS;
+	}
+	libredxx_status status;
+	// disable timeouts
+	status = libredxx_d3xx_set_timeout(device, (uint8_t)(0x02 + channel), 0);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	status = libredxx_d3xx_set_timeout(device, (uint8_t)(0x82 + channel), 0);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	device->d3xx_channels |= (uint8_t)(1 << channel);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
 static libredxx_status libredxx_d2xx_init_event(libredxx_opened_device* device)
 {
 	HANDLE event = CreateEventW(NULL, false, false, NULL);
@@ -279,31 +375,54 @@ static libredxx_status libredxx_d2xx_init_event(libredxx_opened_device* device)
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
+static libredxx_status libredxx_open_replay_device(const libredxx_found_device* found, libredxx_opened_device** opened)
+{
+	libredxx_replay_device device = {0};
+	device.id = found->id;
+	device.type = found->type;
+	device.interface_index = found->interface_index;
+	device.serial = found->serial;
+	libredxx_opened_device* private_opened = calloc(1, sizeof(libredxx_opened_device));
+	if (!private_opened) {
+		return LIBREDXX_STATUS_ERROR_SYS;
+	}
+	private_opened->found = *found;
+	private_opened->replay = libredxx_replay_open(&device);
+	if (!private_opened->replay) {
+		free(private_opened);
+		return LIBREDXX_STATUS_ERROR_IO; // no recorded session left for this device
+	}
+	*opened = private_opened;
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
 libredxx_status libredxx_open_device(const libredxx_found_device* found, libredxx_opened_device** opened)
 {
+	if (found->replay) {
+		return libredxx_open_replay_device(found, opened);
+	}
 	DWORD create_flags = found->type == LIBREDXX_DEVICE_TYPE_D2XX ? 0 : FILE_FLAG_OVERLAPPED | FILE_ATTRIBUTE_NORMAL;
 	HANDLE handle = CreateFileW(found->path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, create_flags, NULL);
 	if (handle == INVALID_HANDLE_VALUE) {
 		return LIBREDXX_STATUS_ERROR_SYS;
 	}
-	libredxx_opened_device* private_opened = malloc(sizeof(libredxx_opened_device));
+	libredxx_opened_device* private_opened = calloc(1, sizeof(libredxx_opened_device));
 	if (!private_opened) {
 		return LIBREDXX_STATUS_ERROR_SYS;
 	}
 	private_opened->found = *found;
 	private_opened->handle = handle;
 	private_opened->d2xx_read_event = NULL;
-	private_opened->d3xx_stream_pipe = 0;
-	private_opened->read_interrupted = false;
+	memset(private_opened->d3xx_stream_pipe, 0, sizeof(private_opened->d3xx_stream_pipe));
+	private_opened->d3xx_channels = 0;
+	for (uint8_t channel = 0; channel < LIBREDXX_D3XX_CHANNEL_COUNT; ++channel) {
+		atomic_init(&private_opened->read_interrupted[channel], false);
+	}
+	private_opened->pcap_address.bus = 1;
+	private_opened->pcap_address.device = libredxx_pcap_next_device();
 	if (found->type == LIBREDXX_DEVICE_TYPE_D3XX) {
-		libredxx_status status;
-		// disable timeouts
-		status = libredxx_d3xx_set_timeout(private_opened, 0x02, 0);
-		if (status != LIBREDXX_STATUS_SUCCESS) {
-			free(private_opened);
-			return status;
-		}
-		status = libredxx_d3xx_set_timeout(private_opened, 0x82, 0);
+		// the other channels only exist depending on the chip configuration, they're set up on first use
+		libredxx_status status = libredxx_d3xx_open_channel(private_opened, 0);
 		if (status != LIBREDXX_STATUS_SUCCESS) {
 			free(private_opened);
 			return status;
@@ -315,12 +434,20 @@ libredxx_status libredxx_open_device(const libredxx_found_device* found, libredx
 			return status;
 		}
 	}
+	private_opened->record_session = libredxx_record_open(found);
 	*opened = private_opened;
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
 libredxx_status libredxx_close_device(libredxx_opened_device* device)
 {
+	libredxx_record_close(device->record_session);
+	if (device->replay) {
+		libredxx_replay_close(device->replay);
+		libredxx_buffer_pool_destroy(&device->pool);
+		free(device);
+		return LIBREDXX_STATUS_SUCCESS;
+	}
 	libredxx_interrupt(device);
 	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
 		if (device->d2xx_read_event) {
@@ -330,6 +457,7 @@ libredxx_status libredxx_close_device(libredxx_opened_device* device)
 	}
 	CloseHandle(device->handle);
 	device->handle = NULL;
+	libredxx_buffer_pool_destroy(&device->pool);
 	free(device);
 	return LIBREDXX_STATUS_SUCCESS;
 }
@@ -365,20 +493,143 @@ static libredxx_status libredxx_d3xx_set_stream_pipe(libredxx_opened_device* dev
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
-libredxx_status libredxx_interrupt(libredxx_opened_device* device)
+libredxx_status libredxx_create_pool(libredxx_opened_device* device, size_t buffer_size, size_t buffer_count, uint32_t flags)
+{
+	return libredxx_buffer_pool_init(&device->pool, buffer_size, buffer_count, flags);
+}
+
+libredxx_status libredxx_get_buffer(libredxx_opened_device* device, void** buffer)
+{
+	return libredxx_buffer_pool_get(&device->pool, buffer);
+}
+
+libredxx_status libredxx_free_buffer(libredxx_opened_device* device, void* buffer)
+{
+	return libredxx_buffer_pool_free(&device->pool, buffer);
+}
+
+// the completion thread is built on usbfs URBs, not available here yet
+libredxx_status libredxx_stream_start(const libredxx_stream_source* sources, size_t sources_count, const libredxx_stream_config* config, libredxx_stream** stream)
+{
+	(void)sources;
+	(void)sources_count;
+	(void)config;
+	(void)stream;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_stream_stop(libredxx_stream* stream)
+{
+	(void)stream;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_stream_pop(libredxx_stream* stream, size_t source, libredxx_stream_chunk* chunk, uint32_t timeout_ms)
+{
+	(void)stream;
+	(void)source;
+	(void)chunk;
+	(void)timeout_ms;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_stream_pop_merged(libredxx_stream* stream, size_t* source, libredxx_stream_chunk* chunk, uint32_t timeout_ms)
+{
+	(void)stream;
+	(void)source;
+	(void)chunk;
+	(void)timeout_ms;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_stream_release(libredxx_stream* stream, size_t source, const libredxx_stream_chunk* chunk)
+{
+	(void)stream;
+	(void)source;
+	(void)chunk;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+// asynchronous transfers are Linux only, the D2XX/D3XX drivers here have no equivalent wired up
+libredxx_status libredxx_alloc_transfer(libredxx_transfer** transfer)
 {
-	device->read_interrupted = true;
+	(void)transfer;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_free_transfer(libredxx_transfer* transfer)
+{
+	(void)transfer;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_submit_transfer(libredxx_transfer* transfer)
+{
+	(void)transfer;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_cancel_transfer(libredxx_transfer* transfer)
+{
+	(void)transfer;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_poll_completions(libredxx_opened_device* device, uint32_t timeout_ms)
+{
+	(void)device;
+	(void)timeout_ms;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_get_stats(libredxx_opened_device* device, libredxx_stats* stats)
+{
+	libredxx_stats_snapshot(&device->stats, stats);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_reset_stats(libredxx_opened_device* device)
+{
+	libredxx_stats_reset(&device->stats);
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+// endpoints a read can block on, and so can be interrupted
+static unsigned int libredxx_read_endpoint_count(const libredxx_found_device* found)
+{
+	return found->type == LIBREDXX_DEVICE_TYPE_D3XX ? LIBREDXX_D3XX_CHANNEL_COUNT : 1;
+}
+
+static libredxx_status libredxx_interrupt_endpoints(libredxx_opened_device* device, unsigned int first, unsigned int end)
+{
+	libredxx_stats_interrupt(&device->stats);
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_INTERRUPT, device, (libredxx_endpoint)first, false, 0, LIBREDXX_STATUS_SUCCESS);
+	libredxx_record_interrupt(device->record_session);
+	if (device->replay) {
+		return libredxx_replay_interrupt(device->replay);
+	}
+	for (unsigned int endpoint = first; endpoint < end; ++endpoint) {
+		atomic_store_explicit(&device->read_interrupted[endpoint], true, memory_order_release);
+	}
 	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
 		return SetEvent(device->d2xx_read_event) ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_SYS;
 	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
 		// abort also released the overlapped event
-		libredxx_status status;
-		status = libredxx_d3xx_abort_pipe(device, 0x82);
-		if (status != LIBREDXX_STATUS_SUCCESS) {
-			return status;
+		for (unsigned int channel = first; channel < end; ++channel) {
+			if (!(device->d3xx_channels & (1 << channel))) {
+				continue;
+			}
+			libredxx_status status;
+			status = libredxx_d3xx_abort_pipe(device, (uint8_t)(0x82 + channel));
+			if (status != LIBREDXX_STATUS_SUCCESS) {
+				return status;
+			}
+			status = libredxx_d3xx_abort_pipe(device, (uint8_t)(0x02 + channel));
+			if (status != LIBREDXX_STATUS_SUCCESS) {
+				return status;
+			}
 		}
-		status = libredxx_d3xx_abort_pipe(device, 0x02);
-		return status;
+		return LIBREDXX_STATUS_SUCCESS;
 	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_FT260) {
 		if (!CancelIoEx(device->handle, NULL)) {
 			return LIBREDXX_STATUS_ERROR_SYS;
@@ -389,6 +640,19 @@ libredxx_status libredxx_interrupt(libredxx_opened_device* device)
 	}
 }
 
+libredxx_status libredxx_interrupt(libredxx_opened_device* device)
+{
+	return libredxx_interrupt_endpoints(device, 0, libredxx_read_endpoint_count(&device->found));
+}
+
+libredxx_status libredxx_interrupt_endpoint(libredxx_opened_device* device, libredxx_endpoint endpoint)
+{
+	if ((unsigned int)endpoint >= libredxx_read_endpoint_count(&device->found)) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return libredxx_interrupt_endpoints(device, endpoint, endpoint + 1u);
+}
+
 static libredxx_status libredxx_d2xx_rx_available(libredxx_opened_device* device, size_t* available)
 {
 	DWORD available_dw;
@@ -400,14 +664,17 @@ static libredxx_status libredxx_d2xx_rx_available(libredxx_opened_device* device
 	return LIBREDXX_STATUS_SUCCESS;
 }
 
-libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+static libredxx_status libredxx_read_endpoint(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
 {
+	if (device->replay) {
+		return libredxx_replay_read(device->replay, buffer, buffer_size, endpoint);
+	}
 	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
 		if (endpoint == LIBREDXX_ENDPOINT_A) {
 			size_t available = 0;
 			do {
 				WaitForSingleObject(device->d2xx_read_event, INFINITE);
-				if (device->read_interrupted) {
+				if (atomic_load_explicit(&device->read_interrupted[LIBREDXX_ENDPOINT_A], memory_order_acquire)) {
 					return LIBREDXX_STATUS_ERROR_INTERRUPTED;
 				}
 				libredxx_status status = libredxx_d2xx_rx_available(device, &available);
@@ -427,15 +694,19 @@ libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size
 			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
 		}
 	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
-		if (endpoint == LIBREDXX_ENDPOINT_A) {
-			libredxx_status ret = LIBREDXX_STATUS_SUCCESS;
-			uint8_t read_pipe = 0x82;
-			if (device->d3xx_stream_pipe != *buffer_size) {
+		if (endpoint < LIBREDXX_D3XX_CHANNEL_COUNT) {
+			// endpoints A to D are FIFO channels 1 to 4
+			libredxx_status ret = libredxx_d3xx_open_channel(device, (uint8_t)endpoint);
+			if (ret != LIBREDXX_STATUS_SUCCESS) {
+				return ret;
+			}
+			uint8_t read_pipe = (uint8_t)(0x82 + endpoint);
+			if (device->d3xx_stream_pipe[endpoint] != *buffer_size) {
 				ret = libredxx_d3xx_set_stream_pipe(device, read_pipe, *buffer_size);
 				if (ret != LIBREDXX_STATUS_SUCCESS) {
 					return ret;
 				}
-				device->d3xx_stream_pipe = *buffer_size;
+				device->d3xx_stream_pipe[endpoint] = *buffer_size;
 			}
 			OVERLAPPED overlapped = {0};
 			overlapped.hEvent = CreateEventW(NULL, true, false, NULL);
@@ -443,10 +714,11 @@ libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size
 				if (GetLastError() != ERROR_IO_PENDING) {
 					ret = LIBREDXX_STATUS_ERROR_SYS;
 				} else {
-					device->read_interrupted = false;
+					atomic_store_explicit(&device->read_interrupted[endpoint], false, memory_order_relaxed);
 					DWORD transferred = 0;
-					if (!GetOverlappedResult(device->handle, &overlapped, &transferred, true)) {
-						ret = (GetLastError() == ERROR_OPERATION_ABORTED && device->read_interrupted) ? LIBREDXX_STATUS_ERROR_INTERRUPTED : LIBREDXX_STATUS_ERROR_SYS;
+					if (!GetOverlappedResult(device->handle, &overlapped, &transferred, true) && transferred == 0) {
+						// data that made it before the abort is not thrown away
+						ret = (GetLastError() == ERROR_OPERATION_ABORTED && atomic_load_explicit(&device->read_interrupted[endpoint], memory_order_acquire)) ? LIBREDXX_STATUS_ERROR_INTERRUPTED : LIBREDXX_STATUS_ERROR_SYS;
 					}
 					*buffer_size = transferred;
 				}
@@ -458,7 +730,7 @@ libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size
 		}
 	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_FT260) {
 		if (endpoint == LIBREDXX_ENDPOINT_A) {
-			device->read_interrupted = false;
+			atomic_store_explicit(&device->read_interrupted[LIBREDXX_ENDPOINT_A], false, memory_order_relaxed);
 			libredxx_status ret = LIBREDXX_STATUS_SUCCESS;
 			OVERLAPPED overlapped = {0};
 			overlapped.hEvent = CreateEventW(NULL, true, false, NULL);
@@ -466,7 +738,7 @@ libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size
 				if (GetLastError() != ERROR_IO_PENDING) {
 					ret = LIBREDXX_STATUS_ERROR_SYS;
 				} else if (!GetOverlappedResult(device->handle, &overlapped, (DWORD*)buffer_size, true)) {
-					ret = (GetLastError() == ERROR_OPERATION_ABORTED && device->read_interrupted) ? LIBREDXX_STATUS_ERROR_INTERRUPTED : LIBREDXX_STATUS_ERROR_SYS;
+					ret = (GetLastError() == ERROR_OPERATION_ABORTED && atomic_load_explicit(&device->read_interrupted[LIBREDXX_ENDPOINT_A], memory_order_acquire)) ? LIBREDXX_STATUS_ERROR_INTERRUPTED : LIBREDXX_STATUS_ERROR_SYS;
 				}
 			}
 			CloseHandle(overlapped.hEvent);
@@ -500,8 +772,56 @@ libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size
 	}
 }
 
-libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+libredxx_status libredxx_d3xx_set_stream_size(libredxx_opened_device* device, libredxx_endpoint endpoint, size_t size)
 {
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D3XX || endpoint >= LIBREDXX_D3XX_CHANNEL_COUNT || size > UINT32_MAX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	if (device->replay) {
+		return LIBREDXX_STATUS_SUCCESS;
+	}
+	libredxx_status status = libredxx_d3xx_open_channel(device, (uint8_t)endpoint);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		return status;
+	}
+	// the driver streams on its own, reads of another size just switch the stream pipe over
+	if (size != 0 && device->d3xx_stream_pipe[endpoint] != size) {
+		status = libredxx_d3xx_set_stream_pipe(device, (uint8_t)(0x82 + endpoint), size);
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			return status;
+		}
+		device->d3xx_stream_pipe[endpoint] = size;
+	}
+	return LIBREDXX_STATUS_SUCCESS;
+}
+
+libredxx_status libredxx_set_urb_size(libredxx_opened_device* device, size_t urb_size, size_t urb_count)
+{
+	(void)device;
+	(void)urb_size;
+	(void)urb_count;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_set_reconnect(libredxx_opened_device* device, const libredxx_reconnect_config* config)
+{
+	(void)device;
+	(void)config;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_set_stall_retries(libredxx_opened_device* device, uint32_t retries)
+{
+	(void)device;
+	(void)retries;
+	return LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+static libredxx_status libredxx_write_endpoint(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	if (device->replay) {
+		return libredxx_replay_write(device->replay, buffer_size, endpoint);
+	}
 	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
 		if (endpoint == LIBREDXX_ENDPOINT_A) {
 			DWORD written = 0;
@@ -514,11 +834,14 @@ libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, siz
 			return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
 		}
 	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
-		if (endpoint == LIBREDXX_ENDPOINT_A) {
-			libredxx_status ret = LIBREDXX_STATUS_SUCCESS;
+		if (endpoint < LIBREDXX_D3XX_CHANNEL_COUNT) {
+			libredxx_status ret = libredxx_d3xx_open_channel(device, (uint8_t)endpoint);
+			if (ret != LIBREDXX_STATUS_SUCCESS) {
+				return ret;
+			}
 			OVERLAPPED overlapped = {0};
 			overlapped.hEvent = CreateEventW(NULL, true, false, NULL);
-			uint8_t write_pipe = 0x02;
+			uint8_t write_pipe = (uint8_t)(0x02 + endpoint);
 			if (!DeviceIoControl(device->handle, 0x0022220D, &write_pipe, sizeof(write_pipe), (DWORD*)buffer, (DWORD)*buffer_size, NULL, &overlapped)) {
 				if (GetLastError() != ERROR_IO_PENDING) {
 					ret = LIBREDXX_STATUS_ERROR_SYS;
@@ -577,3 +900,123 @@ libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, siz
 		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
 	}
 }
+
+/*
+ * The drivers hide the USB transfers, so reads and writes are captured as the
+ * transfer they stand for. Returns the setup packet for FT260 feature reports.
+ */
+static const uint8_t* libredxx_pcap_describe(const libredxx_opened_device* device, libredxx_endpoint endpoint, bool in, const void* buffer, size_t size, uint8_t* transfer_type, uint8_t* address, uint8_t setup[8])
+{
+	*transfer_type = LIBREDXX_PCAP_BULK;
+	if (device->found.type == LIBREDXX_DEVICE_TYPE_D2XX) {
+		*address = (uint8_t)((in ? 0x81 : 0x02) + device->found.interface_index * 2);
+	} else if (device->found.type == LIBREDXX_DEVICE_TYPE_D3XX) {
+		*address = (uint8_t)((in ? 0x82 : 0x02) + endpoint);
+	} else if (endpoint == LIBREDXX_ENDPOINT_B) {
+		*transfer_type = LIBREDXX_PCAP_CONTROL;
+		*address = in ? 0x80 : 0x00;
+		const uint8_t report_id = size ? ((const uint8_t*)buffer)[0] : 0;
+		// HID GET_REPORT and SET_REPORT of a feature report
+		libredxx_pcap_setup(setup, in ? 0xA1 : 0x21, in ? 0x01 : 0x09, (uint16_t)(0x0300 | report_id), 0, (uint16_t)size);
+		return setup;
+	} else {
+		*transfer_type = LIBREDXX_PCAP_INTERRUPT;
+		*address = in ? 0x81 : 0x02;
+	}
+	return NULL;
+}
+
+static int libredxx_pcap_status(libredxx_status status)
+{
+	if (status == LIBREDXX_STATUS_SUCCESS) {
+		return 0;
+	}
+	return status == LIBREDXX_STATUS_ERROR_INTERRUPTED ? -ENOENT : -EIO;
+}
+
+libredxx_status libredxx_read(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	const size_t requested = *buffer_size;
+	const uint64_t start_ns = libredxx_time_ns();
+	uint8_t transfer_type;
+	uint8_t address;
+	uint8_t setup[8];
+	const uint8_t* pcap_setup = libredxx_pcap_describe(device, endpoint, true, buffer, requested, &transfer_type, &address, setup);
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_SUBMIT, device, endpoint, false, requested, LIBREDXX_STATUS_SUCCESS);
+	libredxx_pcap_submit(&device->pcap_address, buffer_size, transfer_type, address, pcap_setup, buffer, requested);
+	libredxx_status status = libredxx_read_endpoint(device, buffer, buffer_size, endpoint);
+	libredxx_pcap_complete(&device->pcap_address, buffer_size, transfer_type, address, libredxx_pcap_status(status), buffer, status == LIBREDXX_STATUS_SUCCESS ? *buffer_size : 0);
+	LIBREDXX_TRACE_EVENT(status == LIBREDXX_STATUS_SUCCESS ? LIBREDXX_TRACE_COMPLETE : LIBREDXX_TRACE_ERROR, device, endpoint, false, *buffer_size, status);
+	libredxx_stats_read(&device->stats, endpoint, status, requested, *buffer_size, start_ns);
+	libredxx_record_read(device->record_session, endpoint, status, buffer, *buffer_size);
+	return status;
+}
+
+libredxx_status libredxx_write(libredxx_opened_device* device, void* buffer, size_t* buffer_size, libredxx_endpoint endpoint)
+{
+	const uint64_t start_ns = libredxx_time_ns();
+	uint8_t transfer_type;
+	uint8_t address;
+	uint8_t setup[8];
+	const uint8_t* pcap_setup = libredxx_pcap_describe(device, endpoint, false, buffer, *buffer_size, &transfer_type, &address, setup);
+	LIBREDXX_TRACE_EVENT(LIBREDXX_TRACE_SUBMIT, device, endpoint, true, *buffer_size, LIBREDXX_STATUS_SUCCESS);
+	libredxx_pcap_submit(&device->pcap_address, buffer_size, transfer_type, address, pcap_setup, buffer, *buffer_size);
+	libredxx_status status = libredxx_write_endpoint(device, buffer, buffer_size, endpoint);
+	libredxx_pcap_complete(&device->pcap_address, buffer_size, transfer_type, address, libredxx_pcap_status(status), buffer, status == LIBREDXX_STATUS_SUCCESS ? *buffer_size : 0);
+	LIBREDXX_TRACE_EVENT(status == LIBREDXX_STATUS_SUCCESS ? LIBREDXX_TRACE_COMPLETE : LIBREDXX_TRACE_ERROR, device, endpoint, true, *buffer_size, status);
+	libredxx_stats_write(&device->stats, endpoint, status, *buffer_size, start_ns);
+	libredxx_record_write(device->record_session, endpoint, status, *buffer_size);
+	return status;
+}
+
+// the FTDI bus driver owns the UART configuration here, only replayed sessions accept it
+
+libredxx_status libredxx_d2xx_set_baud_rate(libredxx_opened_device* device, uint32_t baud_rate)
+{
+	(void)baud_rate;
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return device->replay ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_d2xx_set_data_characteristics(libredxx_opened_device* device, uint8_t data_bits, libredxx_d2xx_stop_bits stop_bits, libredxx_d2xx_parity parity)
+{
+	(void)data_bits;
+	(void)stop_bits;
+	(void)parity;
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return device->replay ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_d2xx_set_flow_control(libredxx_opened_device* device, libredxx_d2xx_flow_control flow_control, uint8_t xon, uint8_t xoff)
+{
+	(void)flow_control;
+	(void)xon;
+	(void)xoff;
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return device->replay ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_d2xx_set_latency_timer(libredxx_opened_device* device, uint8_t latency_ms)
+{
+	(void)latency_ms;
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return device->replay ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
+
+libredxx_status libredxx_d2xx_set_bit_mode(libredxx_opened_device* device, uint8_t mask, libredxx_d2xx_bit_mode mode)
+{
+	(void)mask;
+	(void)mode;
+	if (device->found.type != LIBREDXX_DEVICE_TYPE_D2XX) {
+		return LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT;
+	}
+	return device->replay ? LIBREDXX_STATUS_SUCCESS : LIBREDXX_STATUS_ERROR_UNSUPPORTED;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "libredxx_test.h"
+
+/*
+ * Records go through two small segments, so the writer rotates hundreds of
+ * times and the disk falls behind now and then. The finished capture has to
+ * give back every chunk written, with the chunk after a drop flagged OVERFLOW,
+ * and find them by timestamp. A copy cut off in the middle of a record, with
+ * the header of a capture that was never finished, has to rebuild the index
+ * of the records before the cut.
+ */
+
+#define TEST_PATH "libredxx_test_capture.rdxc"
+#define TEST_UNFINISHED_PATH "libredxx_test_capture_unfinished.rdxc"
+#define TEST_SEGMENT_SIZE (16 * 1024)
+#define TEST_MAX_CHUNK_SIZE 6000
+#define TEST_CHUNKS_COUNT 4000
+#define TEST_MAX_CHUNKS_COUNT 100000
+#define TEST_BLOCK_SIZE 4096 // the header block, records start after it
+#define TEST_RECORD_SIZE 24 // each record's header
+
+struct test_chunk {
+	size_t attempt; // picks the size, data and timestamp
+	size_t size;
+	uint32_t flags;
+	uint64_t offset;
+	uint64_t position; // of the record in the file
+};
+
+static size_t test_size(size_t attempt)
+{
+	return attempt % 97 == 0 ? 0 : (attempt * 2654435761u) % TEST_MAX_CHUNK_SIZE + 1;
+}
+
+static uint64_t test_timestamp(size_t attempt)
+{
+	return (uint64_t)(attempt + 1) * 1000;
+}
+
+static void test_fill(uint8_t* data, size_t attempt, size_t size)
+{
+	for (size_t i = 0; i < size; ++i) {
+		data[i] = (uint8_t)(attempt * 31 + i);
+	}
+}
+
+static void test_check(const char* path, const struct test_chunk* chunks, size_t chunks_count, uint64_t dropped_bytes, bool complete)
+{
+	libredxx_capture* capture;
+	LIBREDXX_TEST_CHECK(libredxx_capture_open(path, &capture) == LIBREDXX_STATUS_SUCCESS);
+	libredxx_capture_info info;
+	LIBREDXX_TEST_CHECK(libredxx_capture_get_info(capture, &info) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(info.complete == complete);
+	LIBREDXX_TEST_CHECK(info.chunks_count == chunks_count);
+	LIBREDXX_TEST_CHECK(info.bytes == (chunks_count ? chunks[chunks_count - 1].offset + chunks[chunks_count - 1].size : 0));
+	// an unfinished capture doesn't know what was dropped
+	LIBREDXX_TEST_CHECK(info.dropped_bytes == (complete ? dropped_bytes : 0));
+	static uint8_t expected[TEST_MAX_CHUNK_SIZE];
+	for (size_t i = 0; i < chunks_count; ++i) {
+		libredxx_capture_chunk chunk;
+		LIBREDXX_TEST_CHECK(libredxx_capture_get_chunk(capture, i, &chunk) == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK(chunk.size == chunks[i].size);
+		LIBREDXX_TEST_CHECK(chunk.timestamp_ns == test_timestamp(chunks[i].attempt));
+		LIBREDXX_TEST_CHECK(chunk.offset == chunks[i].offset);
+		LIBREDXX_TEST_CHECK(chunk.flags == chunks[i].flags);
+		test_fill(expected, chunks[i].attempt, chunks[i].size);
+		LIBREDXX_TEST_CHECK(memcmp(chunk.data, expected, chunk.size) == 0);
+
+		// the first chunk at or after a timestamp, also for timestamps of dropped chunks in between
+		size_t index;
+		LIBREDXX_TEST_CHECK(libredxx_capture_find(capture, test_timestamp(chunks[i].attempt), &index) == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK(index == i);
+		LIBREDXX_TEST_CHECK(libredxx_capture_find(capture, test_timestamp(chunks[i].attempt) - 1, &index) == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK(index == i);
+	}
+	libredxx_capture_chunk chunk;
+	LIBREDXX_TEST_CHECK(libredxx_capture_get_chunk(capture, chunks_count, &chunk) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+	size_t index;
+	LIBREDXX_TEST_CHECK(libredxx_capture_find(capture, UINT64_MAX, &index) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(index == chunks_count);
+	LIBREDXX_TEST_CHECK(libredxx_capture_close(capture) == LIBREDXX_STATUS_SUCCESS);
+}
+
+// copies the records before cut_chunk and part of it under the header of a capture that was never finished
+static void test_write_unfinished(const struct test_chunk* cut_chunk)
+{
+	FILE* file = fopen(TEST_PATH, "rb");
+	LIBREDXX_TEST_CHECK(file);
+	const size_t size = (size_t)(cut_chunk->position + TEST_RECORD_SIZE + cut_chunk->size - 1);
+	uint8_t* data = malloc(size);
+	LIBREDXX_TEST_CHECK(data);
+	LIBREDXX_TEST_CHECK(fread(data, 1, size, file) == size);
+	fclose(file);
+	// data_end follows the magic, 0 until the capture is finished
+	memset(&data[8], 0, sizeof(uint64_t));
+	file = fopen(TEST_UNFINISHED_PATH, "wb");
+	LIBREDXX_TEST_CHECK(file);
+	LIBREDXX_TEST_CHECK(fwrite(data, 1, size, file) == size);
+	LIBREDXX_TEST_CHECK(fclose(file) == 0);
+	free(data);
+}
+
+int main(void)
+{
+	struct test_chunk* chunks = malloc(TEST_MAX_CHUNKS_COUNT * sizeof(struct test_chunk));
+	LIBREDXX_TEST_CHECK(chunks);
+	libredxx_capture_config config = {0};
+	config.segment_size = TEST_SEGMENT_SIZE;
+	config.segment_count = 2;
+	libredxx_capture_writer* writer;
+	LIBREDXX_TEST_CHECK(libredxx_capture_create(TEST_PATH, &config, &writer) == LIBREDXX_STATUS_SUCCESS);
+	static uint8_t data[TEST_MAX_CHUNK_SIZE];
+	size_t chunks_count = 0;
+	size_t overflows = 0;
+	bool overflowed = false;
+	uint64_t bytes = 0;
+	uint64_t dropped_bytes = 0;
+	uint64_t position = TEST_BLOCK_SIZE;
+	// carries on until a drop was followed by a chunk that made it
+	for (size_t attempt = 0; chunks_count < TEST_CHUNKS_COUNT || !overflows || overflowed; ++attempt) {
+		LIBREDXX_TEST_CHECK(chunks_count < TEST_MAX_CHUNKS_COUNT);
+		const size_t size = test_size(attempt);
+		const uint32_t flags = attempt % 50 == 0 ? LIBREDXX_CAPTURE_GAP : 0;
+		test_fill(data, attempt, size);
+		const libredxx_status status = libredxx_capture_write(writer, data, size, test_timestamp(attempt), flags);
+		if (status == LIBREDXX_STATUS_ERROR_OVERFLOW) {
+			++overflows;
+			overflowed = true;
+			dropped_bytes += size;
+			continue;
+		}
+		LIBREDXX_TEST_CHECK(status == LIBREDXX_STATUS_SUCCESS);
+		struct test_chunk* chunk = &chunks[chunks_count++];
+		chunk->attempt = attempt;
+		chunk->size = size;
+		chunk->flags = flags | (overflowed ? LIBREDXX_CAPTURE_OVERFLOW : 0);
+		chunk->offset = bytes;
+		chunk->position = position;
+		overflowed = false;
+		bytes += size;
+		position += TEST_RECORD_SIZE + (size + 7) / 8 * 8;
+	}
+	// too big for a segment less what a rotation carries over
+	LIBREDXX_TEST_CHECK(libredxx_capture_write(writer, data, TEST_SEGMENT_SIZE - TEST_BLOCK_SIZE, 0, 0) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+	LIBREDXX_TEST_CHECK(libredxx_capture_finish(writer) == LIBREDXX_STATUS_SUCCESS);
+	test_check(TEST_PATH, chunks, chunks_count, dropped_bytes, true);
+
+	// cut inside a record that has data, the ones before it are all there is
+	size_t cut = chunks_count / 2;
+	while (!chunks[cut].size) {
+		++cut;
+	}
+	test_write_unfinished(&chunks[cut]);
+	test_check(TEST_UNFINISHED_PATH, chunks, cut, dropped_bytes, false);
+
+	remove(TEST_PATH);
+	remove(TEST_UNFINISHED_PATH);
+	free(chunks);
+	return 0;
+}
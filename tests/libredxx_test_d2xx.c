@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+
+#include "libredxx/libredxx_d2xx.h"
+
+/*
+ * Baud rate divisors against the values worked out by hand from FTDI AN232B-05
+ * and AN_120, no device needed.
+ */
+
+struct test_case {
+	libredxx_d2xx_chip chip;
+	uint8_t channel;
+	uint32_t baud_rate;
+	libredxx_status status;
+	uint16_t value;
+	uint16_t index;
+	uint32_t actual_baud_rate;
+};
+
+static const struct test_case test_cases[] = {
+	// 3 MHz base, whole divisors and the two special codes below 2
+	{LIBREDXX_D2XX_CHIP_BM, 0, 3000000, LIBREDXX_STATUS_SUCCESS, 0x0000, 0x0000, 3000000},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 2000000, LIBREDXX_STATUS_SUCCESS, 0x0001, 0x0000, 2000000},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 115200, LIBREDXX_STATUS_SUCCESS, 0x001A, 0x0000, 115385},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 9600, LIBREDXX_STATUS_SUCCESS, 0x4138, 0x0000, 9600},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 300, LIBREDXX_STATUS_SUCCESS, 0x2710, 0x0000, 300},
+	// every eighth of 100, the high fraction bit spills into wIndex
+	{LIBREDXX_D2XX_CHIP_BM, 0, 29959, LIBREDXX_STATUS_SUCCESS, 0xC064, 0x0000, 29963},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 29922, LIBREDXX_STATUS_SUCCESS, 0x8064, 0x0000, 29925},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 29884, LIBREDXX_STATUS_SUCCESS, 0x0064, 0x0001, 29888},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 29847, LIBREDXX_STATUS_SUCCESS, 0x4064, 0x0000, 29851},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 29810, LIBREDXX_STATUS_SUCCESS, 0x4064, 0x0001, 29814},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 29773, LIBREDXX_STATUS_SUCCESS, 0x8064, 0x0001, 29777},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 29736, LIBREDXX_STATUS_SUCCESS, 0xC064, 0x0001, 29740},
+	// the FT2232C, FT-X and H chips shift the high bits up, making room for a channel
+	{LIBREDXX_D2XX_CHIP_2232C, 2, 29884, LIBREDXX_STATUS_SUCCESS, 0x0064, 0x0102, 29888},
+	{LIBREDXX_D2XX_CHIP_2232C, 1, 9600, LIBREDXX_STATUS_SUCCESS, 0x4138, 0x0001, 9600},
+	{LIBREDXX_D2XX_CHIP_X, 0, 29884, LIBREDXX_STATUS_SUCCESS, 0x0064, 0x0100, 29888},
+	{LIBREDXX_D2XX_CHIP_X, 0, 29736, LIBREDXX_STATUS_SUCCESS, 0xC064, 0x0100, 29740},
+	{LIBREDXX_D2XX_CHIP_R, 0, 29884, LIBREDXX_STATUS_SUCCESS, 0x0064, 0x0001, 29888},
+	// the AM has no 1.5 and only 0, 1/8, 1/4 and 1/2 fractions
+	{LIBREDXX_D2XX_CHIP_AM, 0, 2000000, LIBREDXX_STATUS_SUCCESS, 0x0002, 0x0000, 1500000},
+	{LIBREDXX_D2XX_CHIP_AM, 0, 9600, LIBREDXX_STATUS_SUCCESS, 0x4138, 0x0000, 9600},
+	{LIBREDXX_D2XX_CHIP_AM, 0, 29959, LIBREDXX_STATUS_SUCCESS, 0xC064, 0x0000, 29963},
+	{LIBREDXX_D2XX_CHIP_AM, 0, 29884, LIBREDXX_STATUS_SUCCESS, 0x8064, 0x0000, 29925},
+	// H chips run from 12 MHz and flag it, except below 1200
+	{LIBREDXX_D2XX_CHIP_232H, 0, 12000000, LIBREDXX_STATUS_SUCCESS, 0x0000, 0x0200, 12000000},
+	{LIBREDXX_D2XX_CHIP_232H, 0, 115200, LIBREDXX_STATUS_SUCCESS, 0xC068, 0x0200, 115246},
+	{LIBREDXX_D2XX_CHIP_2232H, 1, 115200, LIBREDXX_STATUS_SUCCESS, 0xC068, 0x0201, 115246},
+	{LIBREDXX_D2XX_CHIP_4232H, 4, 3000000, LIBREDXX_STATUS_SUCCESS, 0x0004, 0x0204, 3000000},
+	{LIBREDXX_D2XX_CHIP_232H, 0, 300, LIBREDXX_STATUS_SUCCESS, 0x2710, 0x0000, 300},
+	// out of range
+	{LIBREDXX_D2XX_CHIP_BM, 0, 0, LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT, 0, 0, 0},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 3000001, LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT, 0, 0, 0},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 183, LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT, 0, 0, 0},
+	{LIBREDXX_D2XX_CHIP_BM, 0, 184, LIBREDXX_STATUS_SUCCESS, 0x3FB0, 0x0001, 184},
+	{LIBREDXX_D2XX_CHIP_232H, 0, 12000001, LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT, 0, 0, 0},
+};
+
+int main(void)
+{
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(test_cases) / sizeof(test_cases[0]); ++i) {
+		const struct test_case* test_case = &test_cases[i];
+		libredxx_d2xx_request request = {0};
+		uint32_t actual_baud_rate = 0;
+		libredxx_status status = libredxx_d2xx_baud_rate_request(test_case->chip, test_case->channel, test_case->baud_rate, &request, &actual_baud_rate);
+		if (status != test_case->status) {
+			printf("case %zu: %u baud, status %d, expected %d\n", i, test_case->baud_rate, status, test_case->status);
+			++failed;
+			continue;
+		}
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			continue;
+		}
+		if (request.request != LIBREDXX_D2XX_SIO_SET_BAUD_RATE || request.value != test_case->value || request.index != test_case->index || actual_baud_rate != test_case->actual_baud_rate) {
+			printf("case %zu: %u baud, got %04X/%04X at %u, expected %04X/%04X at %u\n", i, test_case->baud_rate, request.value, request.index, actual_baud_rate, test_case->value, test_case->index, test_case->actual_baud_rate);
+			++failed;
+		}
+	}
+	return failed ? 1 : 0;
+}
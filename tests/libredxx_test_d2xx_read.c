@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "libredxx_test.h"
+
+/*
+ * D2XX reads of sizes that don't line up with packets, one byte up to more
+ * than a packet's worth. The simulator babbles like the chip when a transfer
+ * ends within a packet, so every read has to ask for whole packets and keep
+ * what didn't fit for the next one.
+ */
+
+#define TEST_STREAM_SIZE 20000
+
+static const size_t test_read_sizes[] = {1, 7, 61, 62, 63, 64, 100, 509, 510, 511, 513, 1000, 4093};
+
+static void test_reads(uint16_t release, uint16_t pid)
+{
+	libredxx_sim_device_config config = {0};
+	config.type = LIBREDXX_DEVICE_TYPE_D2XX;
+	config.id.vid = 0x0403;
+	config.id.pid = pid;
+	config.release = release;
+	config.mode = LIBREDXX_SIM_LOOPBACK;
+	snprintf(config.serial.serial, sizeof(config.serial.serial), "READ%04X", release);
+	uint32_t device_id;
+	LIBREDXX_TEST_CHECK(libredxx_sim_add_device(&config, &device_id) == LIBREDXX_STATUS_SUCCESS);
+
+	libredxx_find_filter filter = {LIBREDXX_DEVICE_TYPE_D2XX, {0x0403, pid}};
+	libredxx_found_device** devices;
+	size_t devices_count;
+	LIBREDXX_TEST_CHECK(libredxx_find_devices(&filter, 1, &devices, &devices_count) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(devices_count >= 1);
+	libredxx_opened_device* device;
+	LIBREDXX_TEST_CHECK(libredxx_open_device(devices[0], &device) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_d2xx_set_latency_timer(device, 1) == LIBREDXX_STATUS_SUCCESS);
+
+	static uint8_t written[TEST_STREAM_SIZE];
+	static uint8_t read[TEST_STREAM_SIZE];
+	for (size_t i = 0; i < TEST_STREAM_SIZE; ++i) {
+		written[i] = (uint8_t)(i * 7 + i / 251);
+	}
+	// the loopback only holds so much, so write and read back in rounds
+	size_t done = 0;
+	size_t read_index = 0;
+	while (done < TEST_STREAM_SIZE) {
+		size_t round = TEST_STREAM_SIZE - done < 5000 ? TEST_STREAM_SIZE - done : 5000;
+		size_t size = round;
+		LIBREDXX_TEST_CHECK(libredxx_write(device, &written[done], &size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK(size == round);
+		size_t got = 0;
+		while (got < round) {
+			size_t read_size = test_read_sizes[read_index++ % (sizeof(test_read_sizes) / sizeof(test_read_sizes[0]))];
+			read_size = read_size < round - got ? read_size : round - got;
+			LIBREDXX_TEST_CHECK(libredxx_read(device, &read[done + got], &read_size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_SUCCESS);
+			LIBREDXX_TEST_CHECK(read_size > 0);
+			got += read_size;
+		}
+		done += round;
+	}
+	LIBREDXX_TEST_CHECK(memcmp(written, read, TEST_STREAM_SIZE) == 0);
+
+	libredxx_stats stats;
+	LIBREDXX_TEST_CHECK(libredxx_get_stats(device, &stats) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(stats.endpoints[LIBREDXX_ENDPOINT_A].errors == 0);
+
+	LIBREDXX_TEST_CHECK(libredxx_close_device(device) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_free_found(devices) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_sim_remove_device(device_id) == LIBREDXX_STATUS_SUCCESS);
+}
+
+int main(void)
+{
+	LIBREDXX_TEST_CHECK(libredxx_sim_start() == LIBREDXX_STATUS_SUCCESS);
+	test_reads(0x0600, 0x6001); // FT232R, 64 byte packets
+	test_reads(0x0900, 0x6014); // FT232H, 512 byte packets
+	LIBREDXX_TEST_CHECK(libredxx_sim_stop() == LIBREDXX_STATUS_SUCCESS);
+	return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "libredxx_test.h"
+
+/*
+ * Every channel of a multi-channel D2XX device is found on its own. Enough
+ * devices to make the found list move while channels are copied out of it.
+ */
+
+#define TEST_DEVICE_COUNT 32
+#define TEST_CHANNEL_COUNT 4 // FT4232H
+
+int main(void)
+{
+	LIBREDXX_TEST_CHECK(libredxx_sim_start() == LIBREDXX_STATUS_SUCCESS);
+	for (int i = 0; i < TEST_DEVICE_COUNT; ++i) {
+		libredxx_sim_device_config config = {0};
+		config.type = LIBREDXX_DEVICE_TYPE_D2XX;
+		config.id.vid = 0x0403;
+		config.id.pid = 0x6011;
+		config.release = 0x0800;
+		snprintf(config.serial.serial, sizeof(config.serial.serial), "FIND%02d", i);
+		uint32_t device_id;
+		LIBREDXX_TEST_CHECK(libredxx_sim_add_device(&config, &device_id) == LIBREDXX_STATUS_SUCCESS);
+	}
+
+	libredxx_find_filter filter = {LIBREDXX_DEVICE_TYPE_D2XX, {0x0403, 0x6011}};
+	libredxx_found_device** devices;
+	size_t devices_count;
+	LIBREDXX_TEST_CHECK(libredxx_find_devices(&filter, 1, &devices, &devices_count) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(devices_count == TEST_DEVICE_COUNT * TEST_CHANNEL_COUNT);
+
+	// channels of a device follow each other and only differ in their interface
+	uint32_t seen[TEST_DEVICE_COUNT] = {0};
+	for (size_t i = 0; i < devices_count; i += TEST_CHANNEL_COUNT) {
+		libredxx_serial first_serial;
+		LIBREDXX_TEST_CHECK(libredxx_get_serial(devices[i], &first_serial) == LIBREDXX_STATUS_SUCCESS);
+		int device_number = -1;
+		LIBREDXX_TEST_CHECK(sscanf(first_serial.serial, "FIND%d", &device_number) == 1);
+		LIBREDXX_TEST_CHECK(device_number >= 0 && device_number < TEST_DEVICE_COUNT);
+		++seen[device_number];
+		for (uint8_t channel = 0; channel < TEST_CHANNEL_COUNT; ++channel) {
+			libredxx_serial serial;
+			libredxx_device_id id;
+			uint8_t interface_index;
+			LIBREDXX_TEST_CHECK(libredxx_get_serial(devices[i + channel], &serial) == LIBREDXX_STATUS_SUCCESS);
+			LIBREDXX_TEST_CHECK(libredxx_get_device_id(devices[i + channel], &id) == LIBREDXX_STATUS_SUCCESS);
+			LIBREDXX_TEST_CHECK(libredxx_get_interface_index(devices[i + channel], &interface_index) == LIBREDXX_STATUS_SUCCESS);
+			LIBREDXX_TEST_CHECK(strcmp(serial.serial, first_serial.serial) == 0);
+			LIBREDXX_TEST_CHECK(id.vid == 0x0403 && id.pid == 0x6011);
+			LIBREDXX_TEST_CHECK(interface_index == channel);
+		}
+	}
+	for (int i = 0; i < TEST_DEVICE_COUNT; ++i) {
+		LIBREDXX_TEST_CHECK(seen[i] == 1);
+	}
+
+	LIBREDXX_TEST_CHECK(libredxx_free_found(devices) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_sim_stop() == LIBREDXX_STATUS_SUCCESS);
+	return 0;
+}
@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "libredxx_test.h"
+
+/*
+ * Every framing is fed a stream built by a reference encoder, with garbage,
+ * oversize and broken frames between the good ones, and has to give back
+ * exactly the good frames with the expected stats. The stream is split at
+ * every offset, pushed byte by byte, and run both with the scalar scan and the
+ * SIMD one, so state carried over a push boundary and the vector loops get
+ * checked against the same answer. Random noise, where there is no answer,
+ * has to come out byte for byte the same from both scans.
+ */
+
+#define TEST_MAX_FRAME_SIZE 300 // above the 254 bytes of a full COBS block
+#define TEST_FRAMES_COUNT 24
+#define TEST_MAX_STREAM_SIZE (64 * 1024)
+#define TEST_MAX_OUTPUT_SIZE (1024 * 1024)
+#define TEST_NOISE_SIZE (64 * 1024)
+#define TEST_SYNC_0 0xA5
+#define TEST_SYNC_1 0x5A
+#define TEST_SYNC_2 0xC3
+#define TEST_SYNC_3 0x3C
+#define TEST_SLIP_END 0xC0
+#define TEST_SLIP_ESC 0xDB
+#define TEST_SLIP_ESC_END 0xDC
+#define TEST_SLIP_ESC_ESC 0xDD
+
+// frames as a size_t size followed by the bytes, and the stats
+struct test_output {
+	uint8_t data[TEST_MAX_OUTPUT_SIZE];
+	size_t size;
+	libredxx_framer_stats stats;
+};
+
+struct test_stream {
+	uint8_t data[TEST_MAX_STREAM_SIZE];
+	size_t size;
+	struct test_output expected;
+	bool dropped_exact; // SLIP and COBS count what they had buffered, not everything they skipped
+};
+
+static struct test_stream test_stream;
+static struct test_output test_output;
+static struct test_output test_scalar_output;
+static uint32_t test_random_state = 12345;
+
+static uint32_t test_random(void)
+{
+	test_random_state ^= test_random_state << 13;
+	test_random_state ^= test_random_state >> 17;
+	test_random_state ^= test_random_state << 5;
+	return test_random_state;
+}
+
+// mostly random, often one of the bytes some framing cares about
+static uint8_t test_byte(void)
+{
+	static const uint8_t special[] = {0x00, TEST_SYNC_0, TEST_SYNC_1, TEST_SLIP_END, TEST_SLIP_ESC, TEST_SLIP_ESC_END, 0xFF};
+	const uint32_t value = test_random();
+	return value % 4 == 0 ? special[(value >> 8) % sizeof(special)] : (uint8_t)(value >> 8);
+}
+
+// random, but never the byte a sync word starts with
+static uint8_t test_garbage_byte(void)
+{
+	uint8_t byte;
+	do {
+		byte = test_byte();
+	} while (byte == TEST_SYNC_0);
+	return byte;
+}
+
+static void test_append(struct test_output* output, const void* data, size_t size)
+{
+	LIBREDXX_TEST_CHECK(size <= TEST_MAX_OUTPUT_SIZE - output->size);
+	memcpy(&output->data[output->size], data, size);
+	output->size += size;
+}
+
+static void test_collect(void* context, const void* frame, size_t size)
+{
+	struct test_output* output = context;
+	test_append(output, &size, sizeof(size));
+	test_append(output, frame, size);
+}
+
+static void test_put(struct test_stream* stream, uint8_t byte)
+{
+	LIBREDXX_TEST_CHECK(stream->size < TEST_MAX_STREAM_SIZE);
+	stream->data[stream->size++] = byte;
+}
+
+static void test_put_garbage(struct test_stream* stream, size_t size)
+{
+	for (size_t i = 0; i < size; ++i) {
+		test_put(stream, test_garbage_byte());
+	}
+	stream->expected.stats.dropped_bytes += size;
+}
+
+static void test_expect_frame(struct test_stream* stream, const uint8_t* frame, size_t size)
+{
+	test_collect(&stream->expected, frame, size);
+	++stream->expected.stats.frames;
+	stream->expected.stats.frame_bytes += size;
+}
+
+static size_t test_payload(uint8_t* payload, size_t max_size)
+{
+	const size_t size = test_random() % (max_size + 1);
+	for (size_t i = 0; i < size; ++i) {
+		payload[i] = test_byte();
+	}
+	return size;
+}
+
+static void test_reset(struct test_stream* stream, bool dropped_exact)
+{
+	memset(stream, 0, sizeof(*stream));
+	stream->dropped_exact = dropped_exact;
+}
+
+static void test_put_header(struct test_stream* stream, const libredxx_framer_config* config, size_t payload_size)
+{
+	for (size_t i = 0; i < config->sync_size; ++i) {
+		test_put(stream, config->sync[i]);
+	}
+	for (size_t i = 0; config->type == LIBREDXX_FRAMER_LENGTH_PREFIX && i < config->length_size; ++i) {
+		const size_t shift = config->big_endian ? config->length_size - 1 - i : i;
+		test_put(stream, (uint8_t)(payload_size >> (shift * 8)));
+	}
+}
+
+// sync words and length prefixes, with garbage, half sync words and too long lengths between the frames
+static void test_build_header(struct test_stream* stream, const libredxx_framer_config* config)
+{
+	test_reset(stream, true);
+	uint8_t payload[TEST_MAX_FRAME_SIZE];
+	for (size_t i = 0; i < TEST_FRAMES_COUNT; ++i) {
+		const uint32_t event = config->sync_size ? test_random() % 8 : 0;
+		if (event == 1) {
+			test_put_garbage(stream, test_random() % 40 + 1);
+		} else if (event == 2) {
+			// a sync word cut short, one byte goes and the rest has no sync start
+			for (size_t j = 0; j + 1 < config->sync_size; ++j) {
+				test_put(stream, config->sync[j]);
+			}
+			test_put(stream, test_garbage_byte());
+			stream->expected.stats.dropped_bytes += config->sync_size;
+		} else if (event == 3 && config->type == LIBREDXX_FRAMER_LENGTH_PREFIX) {
+			size_t length;
+			do {
+				length = TEST_MAX_FRAME_SIZE + 1 + test_random() % 1000;
+			} while ((length & 0xFF) == TEST_SYNC_0 || (length >> 8) == TEST_SYNC_0);
+			test_put_header(stream, config, length);
+			stream->expected.stats.dropped_bytes += config->sync_size + config->length_size;
+			++stream->expected.stats.errors;
+			test_put_garbage(stream, test_random() % 40);
+		}
+		const size_t size = config->type == LIBREDXX_FRAMER_SYNC_WORD ? config->frame_size : test_payload(payload, TEST_MAX_FRAME_SIZE);
+		if (config->type == LIBREDXX_FRAMER_SYNC_WORD) {
+			for (size_t j = 0; j < size; ++j) {
+				payload[j] = test_byte();
+			}
+		}
+		test_put_header(stream, config, size);
+		for (size_t j = 0; j < size; ++j) {
+			test_put(stream, payload[j]);
+		}
+		test_expect_frame(stream, payload, size);
+	}
+}
+
+static void test_put_slip(struct test_stream* stream, const uint8_t* payload, size_t size)
+{
+	for (size_t i = 0; i < size; ++i) {
+		if (payload[i] == TEST_SLIP_END) {
+			test_put(stream, TEST_SLIP_ESC);
+			test_put(stream, TEST_SLIP_ESC_END);
+		} else if (payload[i] == TEST_SLIP_ESC) {
+			test_put(stream, TEST_SLIP_ESC);
+			test_put(stream, TEST_SLIP_ESC_ESC);
+		} else {
+			test_put(stream, payload[i]);
+		}
+	}
+	test_put(stream, TEST_SLIP_END);
+}
+
+// SLIP, with bad escapes, aborted frames, too long frames and empty ones between the frames
+static void test_build_slip(struct test_stream* stream)
+{
+	test_reset(stream, false);
+	uint8_t payload[TEST_MAX_FRAME_SIZE + 100];
+	test_put(stream, TEST_SLIP_END);
+	for (size_t i = 0; i < TEST_FRAMES_COUNT; ++i) {
+		const uint32_t event = test_random() % 6;
+		if (event == 1) {
+			static const uint8_t bad_escape[] = {0x41, TEST_SLIP_ESC, 0x01, 0x42, TEST_SLIP_END};
+			for (size_t j = 0; j < sizeof(bad_escape); ++j) {
+				test_put(stream, bad_escape[j]);
+			}
+			++stream->expected.stats.errors;
+		} else if (event == 2) {
+			// ESC then END aborts the frame
+			static const uint8_t aborted[] = {0x41, TEST_SLIP_ESC, TEST_SLIP_END};
+			for (size_t j = 0; j < sizeof(aborted); ++j) {
+				test_put(stream, aborted[j]);
+			}
+			++stream->expected.stats.errors;
+		} else if (event == 3) {
+			const size_t size = TEST_MAX_FRAME_SIZE + 1 + test_random() % 100;
+			for (size_t j = 0; j < size; ++j) {
+				payload[j] = test_byte();
+			}
+			test_put_slip(stream, payload, size);
+			++stream->expected.stats.errors;
+		} else if (event == 4) {
+			test_put(stream, TEST_SLIP_END);
+		}
+		size_t size;
+		do {
+			size = test_payload(payload, TEST_MAX_FRAME_SIZE);
+		} while (!size);
+		test_put_slip(stream, payload, size);
+		test_expect_frame(stream, payload, size);
+	}
+}
+
+static void test_put_cobs(struct test_stream* stream, const uint8_t* payload, size_t size)
+{
+	size_t code_index = stream->size;
+	uint8_t code = 1;
+	test_put(stream, 0);
+	for (size_t i = 0; i < size; ++i) {
+		if (payload[i]) {
+			test_put(stream, payload[i]);
+			++code;
+		}
+		if (!payload[i] || code == 0xFF) {
+			stream->data[code_index] = code;
+			code_index = stream->size;
+			code = 1;
+			test_put(stream, 0);
+		}
+	}
+	stream->data[code_index] = code;
+	test_put(stream, 0);
+}
+
+// COBS, with full blocks, empty frames, blocks cut short, too long frames and extra delimiters between the frames
+static void test_build_cobs(struct test_stream* stream)
+{
+	test_reset(stream, false);
+	uint8_t payload[TEST_MAX_FRAME_SIZE + 100];
+	for (size_t i = 0; i < TEST_FRAMES_COUNT; ++i) {
+		const uint32_t event = test_random() % 7;
+		size_t size = 0;
+		if (event == 1) {
+			static const uint8_t short_block[] = {0x05, 0x01, 0x02, 0x00};
+			for (size_t j = 0; j < sizeof(short_block); ++j) {
+				test_put(stream, short_block[j]);
+			}
+			++stream->expected.stats.errors;
+		} else if (event == 2) {
+			size = TEST_MAX_FRAME_SIZE + 1 + test_random() % 100;
+			for (size_t j = 0; j < size; ++j) {
+				payload[j] = test_byte();
+			}
+			test_put_cobs(stream, payload, size);
+			++stream->expected.stats.errors;
+		} else if (event == 3) {
+			test_put(stream, 0);
+		} else if (event == 4) {
+			// a full block right before the delimiter, without the 0x01 block most encoders add
+			test_put(stream, 0xFF);
+			for (size_t j = 0; j < 254; ++j) {
+				payload[j] = (uint8_t)(j % 255 + 1);
+				test_put(stream, payload[j]);
+			}
+			test_put(stream, 0);
+			test_expect_frame(stream, payload, 254);
+		}
+		if (event == 5) {
+			// full blocks, then one more byte or none
+			size = 254 + test_random() % 2 * (TEST_MAX_FRAME_SIZE - 254);
+			for (size_t j = 0; j < size; ++j) {
+				payload[j] = (uint8_t)(j % 255 + 1);
+			}
+		} else {
+			size = test_random() % 8 == 0 ? 0 : test_payload(payload, TEST_MAX_FRAME_SIZE);
+		}
+		test_put_cobs(stream, payload, size);
+		test_expect_frame(stream, payload, size);
+	}
+}
+
+// pushes the first bytes, then the rest in chunks, chunk 0 for all of it at once
+static void test_run(const libredxx_framer_config* base, uint32_t flags, const uint8_t* data, size_t size, size_t first, size_t chunk, struct test_output* output)
+{
+	libredxx_framer_config config = *base;
+	config.flags = flags;
+	config.callback = test_collect;
+	config.context = output;
+	output->size = 0;
+	libredxx_framer* framer;
+	LIBREDXX_TEST_CHECK(libredxx_framer_create(&config, &framer) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_framer_push(framer, data, first) == LIBREDXX_STATUS_SUCCESS);
+	for (size_t offset = first; offset < size;) {
+		const size_t push = chunk && chunk < size - offset ? chunk : size - offset;
+		LIBREDXX_TEST_CHECK(libredxx_framer_push(framer, &data[offset], push) == LIBREDXX_STATUS_SUCCESS);
+		offset += push;
+	}
+	LIBREDXX_TEST_CHECK(libredxx_framer_get_stats(framer, &output->stats) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_framer_destroy(framer) == LIBREDXX_STATUS_SUCCESS);
+}
+
+static void test_check_output(const struct test_output* output, const struct test_output* expected, bool dropped_exact)
+{
+	LIBREDXX_TEST_CHECK(output->size == expected->size);
+	LIBREDXX_TEST_CHECK(memcmp(output->data, expected->data, expected->size) == 0);
+	LIBREDXX_TEST_CHECK(output->stats.frames == expected->stats.frames);
+	LIBREDXX_TEST_CHECK(output->stats.frame_bytes == expected->stats.frame_bytes);
+	LIBREDXX_TEST_CHECK(output->stats.errors == expected->stats.errors);
+	LIBREDXX_TEST_CHECK(!dropped_exact || output->stats.dropped_bytes == expected->stats.dropped_bytes);
+}
+
+static void test_check_stream(const libredxx_framer_config* config, const struct test_stream* stream)
+{
+	static const uint32_t flags[] = {LIBREDXX_FRAMER_SCALAR, 0};
+	for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+		for (size_t first = 0; first <= stream->size; ++first) {
+			test_run(config, flags[i], stream->data, stream->size, first, 0, &test_output);
+			test_check_output(&test_output, &stream->expected, stream->dropped_exact);
+		}
+		test_run(config, flags[i], stream->data, stream->size, 0, 1, &test_output);
+		test_check_output(&test_output, &stream->expected, stream->dropped_exact);
+	}
+}
+
+// no right answer for noise, but both scans have to give the same one
+static void test_check_noise(const libredxx_framer_config* config)
+{
+	static const size_t chunks[] = {0, 1, 7, 33, 1000};
+	// with a header now and then, or the sync words would hardly ever show up
+	test_reset(&test_stream, false);
+	while (test_stream.size < TEST_NOISE_SIZE) {
+		if (test_random() % 64 == 0) {
+			test_put_header(&test_stream, config, test_random() % (TEST_MAX_FRAME_SIZE + 1));
+		} else {
+			test_put(&test_stream, test_byte());
+		}
+	}
+	for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+		test_run(config, LIBREDXX_FRAMER_SCALAR, test_stream.data, test_stream.size, 0, chunks[i], &test_scalar_output);
+		test_run(config, 0, test_stream.data, test_stream.size, 0, chunks[i], &test_output);
+		test_check_output(&test_output, &test_scalar_output, true);
+		LIBREDXX_TEST_CHECK(test_output.stats.dropped_bytes == test_scalar_output.stats.dropped_bytes);
+	}
+}
+
+static void test_check_pushes(const libredxx_framer_config* config, const uint8_t* first, size_t first_size, const uint8_t* second, size_t second_size, const uint8_t* frame, size_t frame_size, uint64_t errors)
+{
+	libredxx_framer_config private_config = *config;
+	private_config.callback = test_collect;
+	private_config.context = &test_output;
+	test_output.size = 0;
+	libredxx_framer* framer;
+	LIBREDXX_TEST_CHECK(libredxx_framer_create(&private_config, &framer) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_framer_push(framer, first, first_size) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_framer_push(framer, second, second_size) == LIBREDXX_STATUS_SUCCESS);
+	libredxx_framer_stats stats;
+	LIBREDXX_TEST_CHECK(libredxx_framer_get_stats(framer, &stats) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_framer_destroy(framer) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(stats.frames == 1);
+	LIBREDXX_TEST_CHECK(stats.errors == errors);
+	LIBREDXX_TEST_CHECK(test_output.size == sizeof(size_t) + frame_size);
+	LIBREDXX_TEST_CHECK(memcmp(&test_output.data[sizeof(size_t)], frame, frame_size) == 0);
+}
+
+int main(void)
+{
+	libredxx_framer_config config = {0};
+	config.max_frame_size = TEST_MAX_FRAME_SIZE;
+	config.callback = test_collect;
+	config.context = &test_output;
+	config.sync[0] = TEST_SYNC_0;
+	config.sync[1] = TEST_SYNC_1;
+	config.sync[2] = TEST_SYNC_2;
+	config.sync[3] = TEST_SYNC_3;
+
+	libredxx_framer* framer;
+	config.type = LIBREDXX_FRAMER_SYNC_WORD;
+	config.sync_size = 4;
+	config.frame_size = TEST_MAX_FRAME_SIZE + 1;
+	LIBREDXX_TEST_CHECK(libredxx_framer_create(&config, &framer) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+	config.frame_size = 40;
+	test_build_header(&test_stream, &config);
+	test_check_stream(&config, &test_stream);
+	test_check_noise(&config);
+
+	config.type = LIBREDXX_FRAMER_LENGTH_PREFIX;
+	config.sync_size = 2;
+	config.length_size = 2;
+	config.big_endian = true;
+	test_build_header(&test_stream, &config);
+	test_check_stream(&config, &test_stream);
+	test_check_noise(&config);
+
+	// no sync word to resync on, so no garbage either
+	config.sync_size = 0;
+	config.length_size = 4;
+	config.big_endian = false;
+	test_build_header(&test_stream, &config);
+	test_check_stream(&config, &test_stream);
+	test_check_noise(&config);
+
+	config.type = LIBREDXX_FRAMER_SLIP;
+	config.sync_size = 0;
+	test_build_slip(&test_stream);
+	test_check_stream(&config, &test_stream);
+	test_check_noise(&config);
+
+	// ESC as the last byte of a push, then the byte it escapes, or END aborting the frame
+	static const uint8_t slip_escape_first[] = {TEST_SLIP_END, 0x41, TEST_SLIP_ESC};
+	static const uint8_t slip_escape_second[] = {TEST_SLIP_ESC_END, TEST_SLIP_END};
+	static const uint8_t slip_escaped[] = {0x41, TEST_SLIP_END};
+	test_check_pushes(&config, slip_escape_first, sizeof(slip_escape_first), slip_escape_second, sizeof(slip_escape_second), slip_escaped, sizeof(slip_escaped), 0);
+	static const uint8_t slip_abort_second[] = {TEST_SLIP_END, 0x42, TEST_SLIP_END};
+	static const uint8_t slip_resynced[] = {0x42};
+	test_check_pushes(&config, slip_escape_first, sizeof(slip_escape_first), slip_abort_second, sizeof(slip_abort_second), slip_resynced, sizeof(slip_resynced), 1);
+	static const uint8_t slip_abort[] = {0x41, TEST_SLIP_ESC, TEST_SLIP_END, 0x42, TEST_SLIP_END};
+	test_check_pushes(&config, slip_abort, sizeof(slip_abort), NULL, 0, slip_resynced, sizeof(slip_resynced), 1);
+
+	config.type = LIBREDXX_FRAMER_COBS;
+	test_build_cobs(&test_stream);
+	test_check_stream(&config, &test_stream);
+	test_check_noise(&config);
+
+	// an empty frame is a single block with no data
+	static const uint8_t cobs_empty[] = {0x00, 0x01, 0x00};
+	test_check_pushes(&config, cobs_empty, sizeof(cobs_empty), NULL, 0, cobs_empty, 0, 0);
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "libredxx_test.h"
+
+/*
+ * The merged pop hands out the chunks of every source in timestamp order. Two
+ * channels of one device stream, so reaping for one also reaps for the other
+ * and chunks aren't pushed in timestamp order. Another source gets a few bursts
+ * and then goes idle, and one fails part way. The consumer spins instead of
+ * sleeping, so it looks while the completion thread is half way through pushing.
+ * The timestamps must never go back, every source's data must come out in
+ * order, and the idle and failed sources must not hold the others up.
+ */
+
+#define TEST_SOURCES_COUNT 4
+#define TEST_CHUNKS 20000
+#define TEST_BURST_SIZE 100
+#define TEST_BURSTS_COUNT 3
+
+enum {
+	TEST_CHANNEL_A,
+	TEST_CHANNEL_B,
+	TEST_IDLE,
+	TEST_FAILING,
+};
+
+static uint64_t test_time_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static libredxx_opened_device* test_open(libredxx_sim_mode mode, const char* serial, uint64_t bandwidth, uint32_t fault_interval)
+{
+	libredxx_sim_device_config config = {0};
+	config.type = LIBREDXX_DEVICE_TYPE_D3XX;
+	config.id.vid = 0x0403;
+	config.id.pid = 0x601f;
+	config.mode = mode;
+	config.bandwidth = bandwidth;
+	config.fault_interval = fault_interval;
+	config.fault = LIBREDXX_SIM_FAULT_IO;
+	snprintf(config.serial.serial, sizeof(config.serial.serial), "%s", serial);
+	uint32_t device_id;
+	LIBREDXX_TEST_CHECK(libredxx_sim_add_device(&config, &device_id) == LIBREDXX_STATUS_SUCCESS);
+
+	libredxx_find_filter filter = {LIBREDXX_DEVICE_TYPE_D3XX, {0x0403, 0x601f}};
+	libredxx_found_device** found;
+	size_t found_count;
+	LIBREDXX_TEST_CHECK(libredxx_find_devices(&filter, 1, &found, &found_count) == LIBREDXX_STATUS_SUCCESS);
+	libredxx_opened_device* device = NULL;
+	for (size_t i = 0; i < found_count; ++i) {
+		libredxx_serial found_serial;
+		LIBREDXX_TEST_CHECK(libredxx_get_serial(found[i], &found_serial) == LIBREDXX_STATUS_SUCCESS);
+		if (strcmp(found_serial.serial, serial) == 0) {
+			LIBREDXX_TEST_CHECK(libredxx_open_device(found[i], &device) == LIBREDXX_STATUS_SUCCESS);
+		}
+	}
+	LIBREDXX_TEST_CHECK(libredxx_free_found(found) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(device);
+	return device;
+}
+
+int main(void)
+{
+	LIBREDXX_TEST_CHECK(libredxx_sim_start() == LIBREDXX_STATUS_SUCCESS);
+	libredxx_stream_source sources[TEST_SOURCES_COUNT];
+	sources[TEST_CHANNEL_A].device = test_open(LIBREDXX_SIM_SOURCE, "MERGE1", 0, 0);
+	sources[TEST_CHANNEL_B].device = sources[TEST_CHANNEL_A].device;
+	sources[TEST_IDLE].device = test_open(LIBREDXX_SIM_LOOPBACK, "MERGE2", 0, 0);
+	// the read request and the read both count, this fails after a few dozen chunks
+	sources[TEST_FAILING].device = test_open(LIBREDXX_SIM_SOURCE, "MERGE3", 4 * 1024 * 1024, 101);
+	for (size_t i = 0; i < TEST_SOURCES_COUNT; ++i) {
+		sources[i].endpoint = LIBREDXX_ENDPOINT_A;
+	}
+	sources[TEST_CHANNEL_B].endpoint = LIBREDXX_ENDPOINT_B;
+
+	libredxx_stream_config config = {0};
+	config.buffer_size = 512;
+	config.buffer_count = 8;
+	config.depth = 4;
+	config.cpu = -1;
+	libredxx_stream* stream;
+	LIBREDXX_TEST_CHECK(libredxx_stream_start(sources, TEST_SOURCES_COUNT, &config, &stream) == LIBREDXX_STATUS_SUCCESS);
+
+	size_t chunks[TEST_SOURCES_COUNT] = {0};
+	size_t bytes[TEST_SOURCES_COUNT] = {0};
+	size_t errors[TEST_SOURCES_COUNT] = {0};
+	uint8_t expected[TEST_SOURCES_COUNT] = {0};
+	size_t bursts = 0;
+	uint64_t last_ns = 0;
+	while (chunks[TEST_CHANNEL_A] < TEST_CHUNKS || !errors[TEST_FAILING]) {
+		// the idle source gets a burst every 5000 chunks of channel A, then nothing
+		if (bursts < TEST_BURSTS_COUNT && chunks[TEST_CHANNEL_A] >= bursts * 5000) {
+			uint8_t burst[TEST_BURST_SIZE];
+			for (size_t i = 0; i < sizeof(burst); ++i) {
+				burst[i] = (uint8_t)(bursts * TEST_BURST_SIZE + i);
+			}
+			size_t size = sizeof(burst);
+			LIBREDXX_TEST_CHECK(libredxx_write(sources[TEST_IDLE].device, burst, &size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_SUCCESS);
+			LIBREDXX_TEST_CHECK(size == sizeof(burst));
+			++bursts;
+		}
+		size_t source;
+		libredxx_stream_chunk chunk;
+		// idle and failed sources only hold chunks back until the watermark passes, never for long
+		const uint64_t deadline_ns = test_time_ns() + 5000000000u;
+		libredxx_status status;
+		while ((status = libredxx_stream_pop_merged(stream, &source, &chunk, 0)) == LIBREDXX_STATUS_ERROR_TIMEOUT) {
+			LIBREDXX_TEST_CHECK(test_time_ns() < deadline_ns);
+		}
+		LIBREDXX_TEST_CHECK(status == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK(source < TEST_SOURCES_COUNT);
+		LIBREDXX_TEST_CHECK(chunk.timestamp_ns >= last_ns);
+		last_ns = chunk.timestamp_ns;
+		// a failed source reads no more, its error is the last chunk
+		LIBREDXX_TEST_CHECK(errors[source] == 0);
+		if (chunk.status != LIBREDXX_STATUS_SUCCESS) {
+			LIBREDXX_TEST_CHECK(source == TEST_FAILING);
+			LIBREDXX_TEST_CHECK(!chunk.data && chunk.size == 0);
+			++errors[source];
+		} else {
+			const uint8_t* data = chunk.data;
+			for (size_t i = 0; i < chunk.size; ++i) {
+				LIBREDXX_TEST_CHECK(data[i] == expected[source]);
+				++expected[source];
+			}
+			++chunks[source];
+			bytes[source] += chunk.size;
+		}
+		LIBREDXX_TEST_CHECK(libredxx_stream_release(stream, source, &chunk) == LIBREDXX_STATUS_SUCCESS);
+	}
+	LIBREDXX_TEST_CHECK(libredxx_stream_stop(stream) == LIBREDXX_STATUS_SUCCESS);
+
+	LIBREDXX_TEST_CHECK(chunks[TEST_CHANNEL_B] > 0);
+	LIBREDXX_TEST_CHECK(bytes[TEST_IDLE] == TEST_BURSTS_COUNT * TEST_BURST_SIZE);
+	LIBREDXX_TEST_CHECK(chunks[TEST_FAILING] > 0 && errors[TEST_FAILING] == 1);
+	for (size_t i = 0; i < TEST_SOURCES_COUNT; ++i) {
+		if (i != TEST_CHANNEL_B) {
+			LIBREDXX_TEST_CHECK(libredxx_close_device(sources[i].device) == LIBREDXX_STATUS_SUCCESS);
+		}
+	}
+	LIBREDXX_TEST_CHECK(libredxx_sim_stop() == LIBREDXX_STATUS_SUCCESS);
+	return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "libredxx_test.h"
+#include "libredxx/libredxx_pool.h"
+
+/*
+ * Buffers come out cache line aligned and distinct, the pool runs dry instead
+ * of allocating, and only its own buffers go back into it.
+ */
+
+#define TEST_BUFFER_SIZE 1000
+#define TEST_BUFFER_COUNT 16
+
+int main(void)
+{
+	libredxx_buffer_pool pool = {0};
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_init(&pool, TEST_BUFFER_SIZE, 0, 0) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_init(&pool, TEST_BUFFER_SIZE, TEST_BUFFER_COUNT, 0) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_init(&pool, TEST_BUFFER_SIZE, TEST_BUFFER_COUNT, 0) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+
+	uint8_t* buffers[TEST_BUFFER_COUNT];
+	for (size_t i = 0; i < TEST_BUFFER_COUNT; ++i) {
+		LIBREDXX_TEST_CHECK(libredxx_buffer_pool_get(&pool, (void**)&buffers[i]) == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK((uintptr_t)buffers[i] % LIBREDXX_CACHE_LINE_SIZE == 0);
+		for (size_t j = 0; j < i; ++j) {
+			LIBREDXX_TEST_CHECK(buffers[i] + TEST_BUFFER_SIZE <= buffers[j] || buffers[j] + TEST_BUFFER_SIZE <= buffers[i]);
+		}
+		memset(buffers[i], (int)i, TEST_BUFFER_SIZE);
+	}
+	void* extra;
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_get(&pool, &extra) == LIBREDXX_STATUS_ERROR_OVERFLOW);
+
+	// anything that was not handed out by this pool is refused
+	uint8_t outside[TEST_BUFFER_SIZE];
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_free(&pool, outside) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_free(&pool, buffers[0] + 1) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_free(&pool, buffers[0] - 1) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_free(&pool, pool.memory + pool.stride * pool.buffer_count) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+
+	for (size_t i = 0; i < TEST_BUFFER_COUNT; ++i) {
+		LIBREDXX_TEST_CHECK(buffers[i][TEST_BUFFER_SIZE - 1] == (uint8_t)i);
+		LIBREDXX_TEST_CHECK(libredxx_buffer_pool_free(&pool, buffers[i]) == LIBREDXX_STATUS_SUCCESS);
+	}
+	// freed buffers come back, last in first out
+	void* buffer;
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_get(&pool, &buffer) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(buffer == buffers[TEST_BUFFER_COUNT - 1]);
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_free(&pool, buffer) == LIBREDXX_STATUS_SUCCESS);
+
+	libredxx_buffer_pool_destroy(&pool);
+	LIBREDXX_TEST_CHECK(libredxx_buffer_pool_free(&pool, buffers[0]) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+	return 0;
+}
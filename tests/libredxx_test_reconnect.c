@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libredxx_test.h"
+#include "libredxx/libredxx_d2xx.h"
+
+/*
+ * Unplugs an FT2232H while a read is waiting on it and plugs it back in. The
+ * read comes back with ERROR_DISCONNECTED once the device is reopened, and both
+ * channels have their baud rate and latency timer again on the new device. A
+ * writer keeps submitting on the same channel meanwhile, so ThreadSanitizer sees
+ * it use the device while the handle is replaced.
+ */
+
+#define TEST_SERIAL "RECONNECT"
+
+static libredxx_sim_device_config test_config;
+static atomic_uint test_device_id;
+static atomic_bool test_waiting;
+static atomic_bool test_read_done;
+
+static void* test_reader(void* context)
+{
+	libredxx_opened_device* device = context;
+	uint8_t buffer[64];
+	size_t size = sizeof(buffer);
+	libredxx_status status = libredxx_read(device, buffer, &size, LIBREDXX_ENDPOINT_A);
+	atomic_store(&test_read_done, true);
+	return (void*)(intptr_t)status;
+}
+
+// asynchronous writes never wait for the device, so some are submitted while the handle is replaced
+static void* test_writer(void* context)
+{
+	libredxx_opened_device* device = context;
+	libredxx_transfer* transfer;
+	LIBREDXX_TEST_CHECK(libredxx_alloc_transfer(&transfer) == LIBREDXX_STATUS_SUCCESS);
+	uint8_t byte = 0xAA;
+	transfer->device = device;
+	transfer->endpoint = LIBREDXX_ENDPOINT_A;
+	transfer->write = true;
+	transfer->buffer = &byte;
+	transfer->size = 1;
+	uintptr_t written = 0;
+	while (!atomic_load(&test_read_done)) {
+		if (libredxx_submit_transfer(transfer) != LIBREDXX_STATUS_SUCCESS) {
+			continue;
+		}
+		LIBREDXX_TEST_CHECK(libredxx_poll_completions(device, 1000) == LIBREDXX_STATUS_SUCCESS);
+		written += transfer->transferred;
+	}
+	LIBREDXX_TEST_CHECK(libredxx_free_transfer(transfer) == LIBREDXX_STATUS_SUCCESS);
+	return (void*)written;
+}
+
+static void* test_replug(void* context)
+{
+	(void)context;
+	usleep(50000);
+	uint32_t device_id;
+	LIBREDXX_TEST_CHECK(libredxx_sim_add_device(&test_config, &device_id) == LIBREDXX_STATUS_SUCCESS);
+	atomic_store(&test_device_id, device_id);
+	return NULL;
+}
+
+static void test_disconnected(void* context, libredxx_opened_device* device)
+{
+	(void)context;
+	(void)device;
+	atomic_store(&test_waiting, true);
+}
+
+static void test_check_channel(uint8_t interface_index, uint32_t baud_rate, uint8_t latency_ms)
+{
+	libredxx_d2xx_request request;
+	const uint8_t channel = libredxx_d2xx_get_channel(interface_index, 2);
+	LIBREDXX_TEST_CHECK(libredxx_d2xx_baud_rate_request(LIBREDXX_D2XX_CHIP_2232H, channel, baud_rate, &request, NULL) == LIBREDXX_STATUS_SUCCESS);
+	libredxx_sim_d2xx_channel state;
+	LIBREDXX_TEST_CHECK(libredxx_sim_get_d2xx_channel(atomic_load(&test_device_id), interface_index, &state) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(state.baud_value == request.value);
+	LIBREDXX_TEST_CHECK(state.baud_index == request.index);
+	LIBREDXX_TEST_CHECK(state.latency_ms == latency_ms);
+}
+
+static void test_echo(libredxx_opened_device* device)
+{
+	uint8_t written[3] = {1, 2, 3};
+	uint8_t read[3];
+	size_t size = sizeof(written);
+	LIBREDXX_TEST_CHECK(libredxx_write(device, written, &size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_SUCCESS);
+	size_t got = 0;
+	while (got < sizeof(read)) {
+		size = sizeof(read) - got;
+		LIBREDXX_TEST_CHECK(libredxx_read(device, &read[got], &size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_SUCCESS);
+		got += size;
+	}
+	LIBREDXX_TEST_CHECK(memcmp(written, read, sizeof(read)) == 0);
+}
+
+int main(void)
+{
+	LIBREDXX_TEST_CHECK(libredxx_sim_start() == LIBREDXX_STATUS_SUCCESS);
+	test_config.type = LIBREDXX_DEVICE_TYPE_D2XX;
+	test_config.id.vid = 0x0403;
+	test_config.id.pid = 0x6010;
+	test_config.release = 0x0700;
+	test_config.mode = LIBREDXX_SIM_LOOPBACK;
+	snprintf(test_config.serial.serial, sizeof(test_config.serial.serial), "%s", TEST_SERIAL);
+	uint32_t device_id;
+	LIBREDXX_TEST_CHECK(libredxx_sim_add_device(&test_config, &device_id) == LIBREDXX_STATUS_SUCCESS);
+	atomic_store(&test_device_id, device_id);
+
+	libredxx_find_filter filter = {LIBREDXX_DEVICE_TYPE_D2XX, {0x0403, 0x6010}};
+	libredxx_found_device** found;
+	size_t found_count;
+	LIBREDXX_TEST_CHECK(libredxx_find_devices(&filter, 1, &found, &found_count) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(found_count == 2);
+	libredxx_opened_device* devices[2];
+	for (size_t i = 0; i < found_count; ++i) {
+		LIBREDXX_TEST_CHECK(libredxx_open_device(found[i], &devices[i]) == LIBREDXX_STATUS_SUCCESS);
+	}
+	LIBREDXX_TEST_CHECK(libredxx_free_found(found) == LIBREDXX_STATUS_SUCCESS);
+
+	static const uint32_t baud_rates[2] = {115200, 3000000};
+	static const uint8_t latencies[2] = {2, 5};
+	libredxx_reconnect_config reconnect = {0};
+	reconnect.timeout_ms = 5000;
+	reconnect.poll_interval_ms = 5;
+	reconnect.disconnected = test_disconnected;
+	for (size_t i = 0; i < 2; ++i) {
+		LIBREDXX_TEST_CHECK(libredxx_set_reconnect(devices[i], &reconnect) == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK(libredxx_d2xx_set_baud_rate(devices[i], baud_rates[i]) == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK(libredxx_d2xx_set_latency_timer(devices[i], latencies[i]) == LIBREDXX_STATUS_SUCCESS);
+		test_check_channel((uint8_t)i, baud_rates[i], latencies[i]);
+	}
+
+	// the read is waiting for data when the device goes away
+	pthread_t reader;
+	LIBREDXX_TEST_CHECK(pthread_create(&reader, NULL, test_reader, devices[0]) == 0);
+	usleep(20000);
+	LIBREDXX_TEST_CHECK(libredxx_sim_remove_device(device_id) == LIBREDXX_STATUS_SUCCESS);
+	pthread_t replug;
+	LIBREDXX_TEST_CHECK(pthread_create(&replug, NULL, test_replug, NULL) == 0);
+	pthread_t writer;
+	LIBREDXX_TEST_CHECK(pthread_create(&writer, NULL, test_writer, devices[0]) == 0);
+	void* result;
+	pthread_join(reader, &result);
+	pthread_join(replug, NULL);
+	LIBREDXX_TEST_CHECK((libredxx_status)(intptr_t)result == LIBREDXX_STATUS_ERROR_DISCONNECTED);
+	void* written;
+	pthread_join(writer, &written);
+	for (size_t got = 0; got < (uintptr_t)written;) {
+		uint8_t buffer[64];
+		size_t size = (uintptr_t)written - got < sizeof(buffer) ? (uintptr_t)written - got : sizeof(buffer);
+		LIBREDXX_TEST_CHECK(libredxx_read(devices[0], buffer, &size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_SUCCESS);
+		for (size_t i = 0; i < size; ++i) {
+			LIBREDXX_TEST_CHECK(buffer[i] == 0xAA);
+		}
+		got += size;
+	}
+	// the other channel finds out on its next transfer and reopens right away
+	uint8_t byte = 0;
+	size_t size = 1;
+	LIBREDXX_TEST_CHECK(libredxx_write(devices[1], &byte, &size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_ERROR_DISCONNECTED);
+	for (size_t i = 0; i < 2; ++i) {
+		test_check_channel((uint8_t)i, baud_rates[i], latencies[i]);
+		test_echo(devices[i]);
+	}
+
+	// an interrupt ends the wait for a device that doesn't come back
+	reconnect.timeout_ms = 0;
+	LIBREDXX_TEST_CHECK(libredxx_set_reconnect(devices[0], &reconnect) == LIBREDXX_STATUS_SUCCESS);
+	atomic_store(&test_waiting, false);
+	LIBREDXX_TEST_CHECK(libredxx_sim_remove_device(atomic_load(&test_device_id)) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(pthread_create(&reader, NULL, test_reader, devices[0]) == 0);
+	while (!atomic_load(&test_waiting)) {
+	}
+	LIBREDXX_TEST_CHECK(libredxx_interrupt(devices[0]) == LIBREDXX_STATUS_SUCCESS);
+	pthread_join(reader, &result);
+	LIBREDXX_TEST_CHECK((libredxx_status)(intptr_t)result == LIBREDXX_STATUS_ERROR_INTERRUPTED);
+
+	for (size_t i = 0; i < 2; ++i) {
+		LIBREDXX_TEST_CHECK(libredxx_close_device(devices[i]) == LIBREDXX_STATUS_SUCCESS);
+	}
+	LIBREDXX_TEST_CHECK(libredxx_sim_stop() == LIBREDXX_STATUS_SUCCESS);
+	return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "libredxx_test.h"
+
+/*
+ * Forked clients attach to a fan-out while the parent publishes. The fast ones
+ * tell the parent after every batch, so they never fall behind and have to see
+ * every chunk in order. The slow one only reads after the owner is gone, so it
+ * has to get ERROR_OVERFLOW once, count the lost chunks, and read the last
+ * ring full. All of them have to stop on the closed fan-out. When the test
+ * runs as root, a client of another user must not get the memfd.
+ */
+
+#define TEST_FAST_CLIENTS_COUNT 3
+#define TEST_SLOT_SIZE 256
+#define TEST_SLOT_COUNT 16
+#define TEST_BATCH_SIZE 8 // fast clients never lag further, well within the ring
+#define TEST_CHUNKS_COUNT 1024
+#define TEST_TIMEOUT_MS 10000
+#define TEST_STRANGER_UID 65534 // nobody
+
+static char test_name[64];
+
+static size_t test_size(uint64_t sequence)
+{
+	return sizeof(sequence) + (size_t)(sequence * 2654435761u % (TEST_SLOT_SIZE - sizeof(sequence) + 1));
+}
+
+static uint64_t test_timestamp(uint64_t sequence)
+{
+	return sequence * 1000 + 1;
+}
+
+static void test_fill(uint8_t* data, uint64_t sequence)
+{
+	memcpy(data, &sequence, sizeof(sequence));
+	for (size_t i = sizeof(sequence); i < test_size(sequence); ++i) {
+		data[i] = (uint8_t)(sequence * 31 + i);
+	}
+}
+
+static void test_read(libredxx_shm_client* client, uint64_t sequence)
+{
+	uint8_t data[TEST_SLOT_SIZE];
+	uint8_t expected[TEST_SLOT_SIZE];
+	size_t size = sizeof(data);
+	uint64_t timestamp_ns = 0;
+	LIBREDXX_TEST_CHECK(libredxx_shm_read(client, data, &size, &timestamp_ns, TEST_TIMEOUT_MS) == LIBREDXX_STATUS_SUCCESS);
+	test_fill(expected, sequence);
+	LIBREDXX_TEST_CHECK(size == test_size(sequence));
+	LIBREDXX_TEST_CHECK(memcmp(data, expected, size) == 0);
+	LIBREDXX_TEST_CHECK(timestamp_ns == test_timestamp(sequence));
+}
+
+static void test_read_closed(libredxx_shm_client* client)
+{
+	uint8_t data[TEST_SLOT_SIZE];
+	size_t size = sizeof(data);
+	LIBREDXX_TEST_CHECK(libredxx_shm_read(client, data, &size, NULL, TEST_TIMEOUT_MS) == LIBREDXX_STATUS_ERROR_IO);
+}
+
+static void test_wait(int fd, size_t count)
+{
+	char byte;
+	for (size_t i = 0; i < count; ++i) {
+		LIBREDXX_TEST_CHECK(read(fd, &byte, 1) == 1);
+	}
+}
+
+static void test_signal(int fd)
+{
+	LIBREDXX_TEST_CHECK(write(fd, "", 1) == 1);
+}
+
+static libredxx_shm_client* test_attach(int go_fd, int ready_fd)
+{
+	test_wait(go_fd, 1);
+	libredxx_shm_client* client;
+	LIBREDXX_TEST_CHECK(libredxx_shm_attach(test_name, &client) == LIBREDXX_STATUS_SUCCESS);
+	size_t slot_size;
+	LIBREDXX_TEST_CHECK(libredxx_shm_get_slot_size(client, &slot_size) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(slot_size == TEST_SLOT_SIZE);
+	test_signal(ready_fd);
+	return client;
+}
+
+static void test_fast_client(int go_fd, int ready_fd)
+{
+	libredxx_shm_client* client = test_attach(go_fd, ready_fd);
+	for (uint64_t sequence = 0; sequence < TEST_CHUNKS_COUNT; ++sequence) {
+		test_read(client, sequence);
+		if ((sequence + 1) % TEST_BATCH_SIZE == 0) {
+			test_signal(ready_fd);
+		}
+	}
+	test_read_closed(client);
+	uint64_t lost;
+	LIBREDXX_TEST_CHECK(libredxx_shm_get_lost(client, &lost) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(lost == 0);
+	LIBREDXX_TEST_CHECK(libredxx_shm_detach(client) == LIBREDXX_STATUS_SUCCESS);
+}
+
+static void test_slow_client(int go_fd, int ready_fd, int release_fd)
+{
+	libredxx_shm_client* client = test_attach(go_fd, ready_fd);
+	// the parent closes its end once the owner is destroyed
+	char byte;
+	LIBREDXX_TEST_CHECK(read(release_fd, &byte, 1) == 0);
+	uint8_t data[TEST_SLOT_SIZE];
+	size_t size = sizeof(data);
+	LIBREDXX_TEST_CHECK(libredxx_shm_read(client, data, &size, NULL, TEST_TIMEOUT_MS) == LIBREDXX_STATUS_ERROR_OVERFLOW);
+	uint64_t lost;
+	LIBREDXX_TEST_CHECK(libredxx_shm_get_lost(client, &lost) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(lost == TEST_CHUNKS_COUNT - TEST_SLOT_COUNT);
+	for (uint64_t sequence = TEST_CHUNKS_COUNT - TEST_SLOT_COUNT; sequence < TEST_CHUNKS_COUNT; ++sequence) {
+		test_read(client, sequence);
+	}
+	test_read_closed(client);
+	LIBREDXX_TEST_CHECK(libredxx_shm_get_lost(client, &lost) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(lost == TEST_CHUNKS_COUNT - TEST_SLOT_COUNT);
+	LIBREDXX_TEST_CHECK(libredxx_shm_detach(client) == LIBREDXX_STATUS_SUCCESS);
+}
+
+static void test_stranger(void)
+{
+	LIBREDXX_TEST_CHECK(setuid(TEST_STRANGER_UID) == 0);
+	libredxx_shm_client* client;
+	LIBREDXX_TEST_CHECK(libredxx_shm_attach(test_name, &client) == LIBREDXX_STATUS_ERROR_IO);
+}
+
+static void test_join(pid_t pid)
+{
+	int status;
+	LIBREDXX_TEST_CHECK(waitpid(pid, &status, 0) == pid);
+	LIBREDXX_TEST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(void)
+{
+	snprintf(test_name, sizeof(test_name), "test-%d", (int)getpid());
+	int go[2];
+	int ready[2];
+	int release[2];
+	LIBREDXX_TEST_CHECK(pipe(go) == 0 && pipe(ready) == 0 && pipe(release) == 0);
+	pid_t clients[TEST_FAST_CLIENTS_COUNT + 1];
+	for (size_t i = 0; i < TEST_FAST_CLIENTS_COUNT + 1; ++i) {
+		clients[i] = fork();
+		LIBREDXX_TEST_CHECK(clients[i] != -1);
+		if (clients[i] == 0) {
+			close(go[1]);
+			close(ready[0]);
+			close(release[1]);
+			if (i < TEST_FAST_CLIENTS_COUNT) {
+				test_fast_client(go[0], ready[1]);
+			} else {
+				test_slow_client(go[0], ready[1], release[0]);
+			}
+			exit(0);
+		}
+	}
+	close(go[0]);
+	close(ready[1]);
+	close(release[0]);
+
+	libredxx_shm_owner* owner;
+	LIBREDXX_TEST_CHECK(libredxx_shm_create(test_name, TEST_SLOT_SIZE, TEST_SLOT_COUNT, &owner) == LIBREDXX_STATUS_SUCCESS);
+	for (size_t i = 0; i < TEST_FAST_CLIENTS_COUNT + 1; ++i) {
+		test_signal(go[1]);
+	}
+	// chunks published before a client attached are not for it
+	test_wait(ready[0], TEST_FAST_CLIENTS_COUNT + 1);
+
+	if (geteuid() == 0) {
+		const pid_t stranger = fork();
+		LIBREDXX_TEST_CHECK(stranger != -1);
+		if (stranger == 0) {
+			test_stranger();
+			exit(0);
+		}
+		test_join(stranger);
+	}
+
+	uint8_t data[TEST_SLOT_SIZE + 1];
+	LIBREDXX_TEST_CHECK(libredxx_shm_publish(owner, data, sizeof(data), 0) == LIBREDXX_STATUS_ERROR_INVALID_ARGUMENT);
+	for (uint64_t sequence = 0; sequence < TEST_CHUNKS_COUNT; ++sequence) {
+		test_fill(data, sequence);
+		LIBREDXX_TEST_CHECK(libredxx_shm_publish(owner, data, test_size(sequence), test_timestamp(sequence)) == LIBREDXX_STATUS_SUCCESS);
+		if ((sequence + 1) % TEST_BATCH_SIZE == 0) {
+			test_wait(ready[0], TEST_FAST_CLIENTS_COUNT);
+		}
+	}
+	LIBREDXX_TEST_CHECK(libredxx_shm_destroy(owner) == LIBREDXX_STATUS_SUCCESS);
+	close(release[1]);
+	for (size_t i = 0; i < TEST_FAST_CLIENTS_COUNT + 1; ++i) {
+		test_join(clients[i]);
+	}
+
+	libredxx_shm_client* client;
+	LIBREDXX_TEST_CHECK(libredxx_shm_attach(test_name, &client) == LIBREDXX_STATUS_ERROR_IO);
+	close(go[1]);
+	close(ready[0]);
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "libredxx_test.h"
+
+/*
+ * Transfers larger than the URB size go out as runs of URBs. They have to come
+ * back whole and in order whatever the URB size and count, and a run whose
+ * second URB stalls has to report the stall with the pipe cleared, the kernel
+ * refuses the URBs submitted after it with EREMOTEIO.
+ */
+
+#define TEST_TRANSFER_SIZE (1024 * 1024 + 123)
+#define TEST_URB_SIZE (16 * 1024)
+
+static libredxx_opened_device* test_open(libredxx_sim_mode mode, const char* serial, uint32_t fault_interval, libredxx_sim_fault fault)
+{
+	libredxx_sim_device_config config = {0};
+	config.type = LIBREDXX_DEVICE_TYPE_D3XX;
+	config.id.vid = 0x0403;
+	config.id.pid = 0x601f;
+	config.mode = mode;
+	config.fault_interval = fault_interval;
+	config.fault = fault;
+	snprintf(config.serial.serial, sizeof(config.serial.serial), "%s", serial);
+	uint32_t device_id;
+	LIBREDXX_TEST_CHECK(libredxx_sim_add_device(&config, &device_id) == LIBREDXX_STATUS_SUCCESS);
+
+	libredxx_find_filter filter = {LIBREDXX_DEVICE_TYPE_D3XX, {0x0403, 0x601f}};
+	libredxx_found_device** found;
+	size_t found_count;
+	LIBREDXX_TEST_CHECK(libredxx_find_devices(&filter, 1, &found, &found_count) == LIBREDXX_STATUS_SUCCESS);
+	libredxx_opened_device* device = NULL;
+	for (size_t i = 0; i < found_count; ++i) {
+		libredxx_serial found_serial;
+		LIBREDXX_TEST_CHECK(libredxx_get_serial(found[i], &found_serial) == LIBREDXX_STATUS_SUCCESS);
+		if (strcmp(found_serial.serial, serial) == 0) {
+			LIBREDXX_TEST_CHECK(libredxx_open_device(found[i], &device) == LIBREDXX_STATUS_SUCCESS);
+		}
+	}
+	LIBREDXX_TEST_CHECK(libredxx_free_found(found) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(device);
+	return device;
+}
+
+// a source counts up from 0, every read continues where the last one stopped
+static void test_source(uint8_t* buffer)
+{
+	static const size_t urb_counts[] = {4, 1, 3, 8, 4};
+	libredxx_opened_device* device = test_open(LIBREDXX_SIM_SOURCE, "SPLIT1", 0, LIBREDXX_SIM_FAULT_IO);
+	uint8_t expected = 0;
+	for (size_t round = 0; round < sizeof(urb_counts) / sizeof(urb_counts[0]); ++round) {
+		// every count but the first reallocates the URBs
+		LIBREDXX_TEST_CHECK(libredxx_set_urb_size(device, TEST_URB_SIZE, urb_counts[round]) == LIBREDXX_STATUS_SUCCESS);
+		size_t size = TEST_TRANSFER_SIZE;
+		LIBREDXX_TEST_CHECK(libredxx_read(device, buffer, &size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK(size == TEST_TRANSFER_SIZE);
+		for (size_t i = 0; i < size; ++i) {
+			LIBREDXX_TEST_CHECK(buffer[i] == expected);
+			++expected;
+		}
+	}
+	LIBREDXX_TEST_CHECK(libredxx_close_device(device) == LIBREDXX_STATUS_SUCCESS);
+}
+
+static void test_stalled_write(uint8_t* buffer)
+{
+	// the second transfer of the device stalls, the second URB of the first write
+	libredxx_opened_device* device = test_open(LIBREDXX_SIM_SOURCE, "SPLIT2", 2, LIBREDXX_SIM_FAULT_STALL);
+	LIBREDXX_TEST_CHECK(libredxx_set_urb_size(device, TEST_URB_SIZE, 4) == LIBREDXX_STATUS_SUCCESS);
+	memset(buffer, 0x55, TEST_TRANSFER_SIZE);
+	size_t size = TEST_TRANSFER_SIZE;
+	LIBREDXX_TEST_CHECK(libredxx_write(device, buffer, &size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_ERROR_STALL);
+	LIBREDXX_TEST_CHECK(size == TEST_URB_SIZE);
+	// cleared in place, the next write goes through up to the next fault
+	size = TEST_URB_SIZE;
+	LIBREDXX_TEST_CHECK(libredxx_write(device, buffer, &size, LIBREDXX_ENDPOINT_A) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(size == TEST_URB_SIZE);
+	LIBREDXX_TEST_CHECK(libredxx_close_device(device) == LIBREDXX_STATUS_SUCCESS);
+}
+
+int main(void)
+{
+	uint8_t* buffer = malloc(TEST_TRANSFER_SIZE);
+	LIBREDXX_TEST_CHECK(buffer);
+	LIBREDXX_TEST_CHECK(libredxx_sim_start() == LIBREDXX_STATUS_SUCCESS);
+	test_source(buffer);
+	test_stalled_write(buffer);
+	LIBREDXX_TEST_CHECK(libredxx_sim_stop() == LIBREDXX_STATUS_SUCCESS);
+	free(buffer);
+	return 0;
+}
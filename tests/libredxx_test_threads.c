@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libredxx_test.h"
+
+/*
+ * Every thread a device allows at once: a reader and a writer per endpoint
+ * while another thread keeps interrupting, repeated shutdowns with reads
+ * blocked, and D3XX reads whose requests fail. Meant to be run with
+ * LIBREDXX_ENABLE_TSAN as well, the data checks alone don't catch races.
+ */
+
+#define TEST_STREAM_SIZE 100000
+#define TEST_SHUTDOWN_ROUNDS 20
+
+struct test_endpoint {
+	libredxx_opened_device* device;
+	libredxx_endpoint endpoint;
+	unsigned int seed;
+	atomic_bool exited;
+};
+
+static atomic_bool test_done;
+
+static void* test_reader(void* context)
+{
+	struct test_endpoint* endpoint = context;
+	uint8_t buffer[1024];
+	uint8_t expected = 0;
+	size_t total = 0;
+	while (total < TEST_STREAM_SIZE) {
+		size_t size = 1 + (size_t)rand_r(&endpoint->seed) % sizeof(buffer);
+		libredxx_status status = libredxx_read(endpoint->device, buffer, &size, endpoint->endpoint);
+		if (status == LIBREDXX_STATUS_ERROR_INTERRUPTED) {
+			continue;
+		}
+		LIBREDXX_TEST_CHECK(status == LIBREDXX_STATUS_SUCCESS);
+		for (size_t i = 0; i < size; ++i) {
+			LIBREDXX_TEST_CHECK(buffer[i] == expected);
+			++expected;
+		}
+		total += size;
+	}
+	return NULL;
+}
+
+static void* test_writer(void* context)
+{
+	struct test_endpoint* endpoint = context;
+	uint8_t buffer[700];
+	uint8_t value = 0;
+	size_t total = 0;
+	while (total < TEST_STREAM_SIZE) {
+		size_t count = 1 + (size_t)rand_r(&endpoint->seed) % sizeof(buffer);
+		count = count < TEST_STREAM_SIZE - total ? count : TEST_STREAM_SIZE - total;
+		for (size_t i = 0; i < count; ++i) {
+			buffer[i] = value++;
+		}
+		size_t size = count;
+		LIBREDXX_TEST_CHECK(libredxx_write(endpoint->device, buffer, &size, endpoint->endpoint) == LIBREDXX_STATUS_SUCCESS);
+		LIBREDXX_TEST_CHECK(size == count);
+		total += count;
+	}
+	return NULL;
+}
+
+struct test_interrupter {
+	libredxx_opened_device** devices;
+	size_t devices_count;
+	libredxx_endpoint endpoint_count;
+};
+
+static void* test_interrupter(void* context)
+{
+	struct test_interrupter* interrupter = context;
+	unsigned int seed = 1;
+	while (!atomic_load(&test_done)) {
+		usleep(200 + (unsigned int)rand_r(&seed) % 2000);
+		libredxx_opened_device* device = interrupter->devices[(size_t)rand_r(&seed) % interrupter->devices_count];
+		const int endpoint = rand_r(&seed) % ((int)interrupter->endpoint_count + 1);
+		if (endpoint == (int)interrupter->endpoint_count) {
+			libredxx_interrupt(device);
+		} else {
+			libredxx_interrupt_endpoint(device, (libredxx_endpoint)endpoint);
+		}
+	}
+	return NULL;
+}
+
+static void test_add_device(libredxx_device_type type, uint16_t pid, uint16_t release, const char* serial, uint32_t fault_interval)
+{
+	libredxx_sim_device_config config = {0};
+	config.type = type;
+	config.id.vid = 0x0403;
+	config.id.pid = pid;
+	config.release = release;
+	config.mode = LIBREDXX_SIM_LOOPBACK;
+	config.fault_interval = fault_interval;
+	config.fault = LIBREDXX_SIM_FAULT_IO;
+	snprintf(config.serial.serial, sizeof(config.serial.serial), "%s", serial);
+	uint32_t device_id;
+	LIBREDXX_TEST_CHECK(libredxx_sim_add_device(&config, &device_id) == LIBREDXX_STATUS_SUCCESS);
+}
+
+// opens every interface of the device with this serial
+static size_t test_open(libredxx_device_type type, uint16_t pid, const char* serial, libredxx_opened_device** devices)
+{
+	libredxx_find_filter filter = {type, {0x0403, pid}};
+	libredxx_found_device** found;
+	size_t found_count;
+	LIBREDXX_TEST_CHECK(libredxx_find_devices(&filter, 1, &found, &found_count) == LIBREDXX_STATUS_SUCCESS);
+	size_t count = 0;
+	for (size_t i = 0; i < found_count; ++i) {
+		libredxx_serial found_serial;
+		LIBREDXX_TEST_CHECK(libredxx_get_serial(found[i], &found_serial) == LIBREDXX_STATUS_SUCCESS);
+		if (strcmp(found_serial.serial, serial) == 0) {
+			LIBREDXX_TEST_CHECK(libredxx_open_device(found[i], &devices[count++]) == LIBREDXX_STATUS_SUCCESS);
+		}
+	}
+	LIBREDXX_TEST_CHECK(libredxx_free_found(found) == LIBREDXX_STATUS_SUCCESS);
+	LIBREDXX_TEST_CHECK(count > 0);
+	return count;
+}
+
+// a reader and a writer on each of endpoint_count endpoints of every device
+static void test_streams(libredxx_opened_device** devices, size_t devices_count, libredxx_endpoint endpoint_count)
+{
+	struct test_endpoint endpoints[8] = {0};
+	pthread_t readers[8];
+	pthread_t writers[8];
+	size_t count = 0;
+	for (size_t i = 0; i < devices_count; ++i) {
+		for (libredxx_endpoint endpoint = LIBREDXX_ENDPOINT_A; endpoint < endpoint_count; ++endpoint) {
+			endpoints[count].device = devices[i];
+			endpoints[count].endpoint = endpoint;
+			endpoints[count].seed = (unsigned int)count + 10;
+			++count;
+		}
+	}
+	struct test_endpoint write_endpoints[8];
+	memcpy(write_endpoints, endpoints, sizeof(endpoints));
+	atomic_store(&test_done, false);
+	struct test_interrupter interrupter = {devices, devices_count, endpoint_count};
+	pthread_t interrupter_thread;
+	LIBREDXX_TEST_CHECK(pthread_create(&interrupter_thread, NULL, test_interrupter, &interrupter) == 0);
+	for (size_t i = 0; i < count; ++i) {
+		LIBREDXX_TEST_CHECK(pthread_create(&readers[i], NULL, test_reader, &endpoints[i]) == 0);
+		LIBREDXX_TEST_CHECK(pthread_create(&writers[i], NULL, test_writer, &write_endpoints[i]) == 0);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		pthread_join(writers[i], NULL);
+		pthread_join(readers[i], NULL);
+	}
+	atomic_store(&test_done, true);
+	pthread_join(interrupter_thread, NULL);
+}
+
+static void* test_blocked_reader(void* context)
+{
+	struct test_endpoint* endpoint = context;
+	uint8_t buffer[64];
+	while (!atomic_load(&test_done)) {
+		size_t size = sizeof(buffer);
+		libredxx_status status = libredxx_read(endpoint->device, buffer, &size, endpoint->endpoint);
+		LIBREDXX_TEST_CHECK(status == LIBREDXX_STATUS_ERROR_INTERRUPTED);
+	}
+	atomic_store(&endpoint->exited, true);
+	return NULL;
+}
+
+// the way an application shuts down: interrupt the blocked readers, join them, close
+static void test_shutdowns(void)
+{
+	for (int round = 0; round < TEST_SHUTDOWN_ROUNDS; ++round) {
+		libredxx_opened_device* device;
+		test_open(LIBREDXX_DEVICE_TYPE_D3XX, 0x601f, "THREADS3", &device);
+		struct test_endpoint endpoints[4] = {0};
+		pthread_t readers[4];
+		atomic_store(&test_done, false);
+		for (int i = 0; i < 4; ++i) {
+			endpoints[i].device = device;
+			endpoints[i].endpoint = (libredxx_endpoint)i;
+			LIBREDXX_TEST_CHECK(pthread_create(&readers[i], NULL, test_blocked_reader, &endpoints[i]) == 0);
+		}
+		usleep(1000 * (round % 4));
+		atomic_store(&test_done, true);
+		// readers between two reads miss an interrupt, keep going until they are all out
+		for (int i = 0; i < 4; ++i) {
+			while (!atomic_load(&endpoints[i].exited)) {
+				LIBREDXX_TEST_CHECK(libredxx_interrupt(device) == LIBREDXX_STATUS_SUCCESS);
+				usleep(100);
+			}
+			pthread_join(readers[i], NULL);
+		}
+		LIBREDXX_TEST_CHECK(libredxx_close_device(device) == LIBREDXX_STATUS_SUCCESS);
+	}
+}
+
+/*
+ * Every fifth transfer fails, the read requests of D3XX reads included. A read
+ * whose request failed has to give up its data URB instead of waiting for data
+ * that never comes, and the channel has to work for the next one.
+ */
+static void test_failed_requests(void)
+{
+	libredxx_opened_device* device;
+	test_open(LIBREDXX_DEVICE_TYPE_D3XX, 0x601f, "THREADS4", &device);
+	uint8_t written[256];
+	uint8_t read[256];
+	int errors = 0;
+	int complete = 0;
+	for (int round = 0; round < 100; ++round) {
+		for (size_t i = 0; i < sizeof(written); ++i) {
+			written[i] = (uint8_t)(i + (size_t)round);
+		}
+		size_t size = sizeof(written);
+		if (libredxx_write(device, written, &size, LIBREDXX_ENDPOINT_A) != LIBREDXX_STATUS_SUCCESS) {
+			++errors;
+			continue;
+		}
+		size_t got = 0;
+		while (got < size) {
+			size_t read_size = size - got;
+			libredxx_status status = libredxx_read(device, &read[got], &read_size, LIBREDXX_ENDPOINT_A);
+			if (status != LIBREDXX_STATUS_SUCCESS) {
+				LIBREDXX_TEST_CHECK(status == LIBREDXX_STATUS_ERROR_SYS);
+				++errors;
+				break;
+			}
+			got += read_size;
+		}
+		if (got == size) {
+			++complete;
+		} else {
+			// whatever the failed read left behind would shift the next round
+			libredxx_close_device(device);
+			test_open(LIBREDXX_DEVICE_TYPE_D3XX, 0x601f, "THREADS4", &device);
+		}
+	}
+	LIBREDXX_TEST_CHECK(errors > 0 && complete > 0);
+	LIBREDXX_TEST_CHECK(libredxx_close_device(device) == LIBREDXX_STATUS_SUCCESS);
+}
+
+int main(void)
+{
+	LIBREDXX_TEST_CHECK(libredxx_sim_start() == LIBREDXX_STATUS_SUCCESS);
+	test_add_device(LIBREDXX_DEVICE_TYPE_D3XX, 0x601f, 0, "THREADS1", 0);
+	test_add_device(LIBREDXX_DEVICE_TYPE_D2XX, 0x6010, 0x0700, "THREADS2", 0);
+	test_add_device(LIBREDXX_DEVICE_TYPE_D3XX, 0x601f, 0, "THREADS3", 0);
+	test_add_device(LIBREDXX_DEVICE_TYPE_D3XX, 0x601f, 0, "THREADS4", 5);
+
+	libredxx_opened_device* devices[4];
+	size_t count = test_open(LIBREDXX_DEVICE_TYPE_D3XX, 0x601f, "THREADS1", devices);
+	test_streams(devices, count, LIBREDXX_ENDPOINT_D + 1);
+	LIBREDXX_TEST_CHECK(libredxx_close_device(devices[0]) == LIBREDXX_STATUS_SUCCESS);
+
+	// the two channels of an FT2232H are separate devices, one endpoint each
+	count = test_open(LIBREDXX_DEVICE_TYPE_D2XX, 0x6010, "THREADS2", devices);
+	LIBREDXX_TEST_CHECK(count == 2);
+	for (size_t i = 0; i < count; ++i) {
+		LIBREDXX_TEST_CHECK(libredxx_d2xx_set_latency_timer(devices[i], 1) == LIBREDXX_STATUS_SUCCESS);
+	}
+	test_streams(devices, count, LIBREDXX_ENDPOINT_A + 1);
+	for (size_t i = 0; i < count; ++i) {
+		LIBREDXX_TEST_CHECK(libredxx_close_device(devices[i]) == LIBREDXX_STATUS_SUCCESS);
+	}
+
+	test_shutdowns();
+	test_failed_requests();
+	LIBREDXX_TEST_CHECK(libredxx_sim_stop() == LIBREDXX_STATUS_SUCCESS);
+	return 0;
+}
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2025 Kyle Schwarz <zeranoe@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libredxx/libredxx.h"
+
+/*
+ * Streams one endpoint of a D2XX or D3XX device into a capture file until
+ * interrupted or a byte or time limit is reached, or prints a summary of a
+ * capture with --show. A failed read restarts the stream and flags a gap.
+ * --sim captures a simulated device that keeps sending.
+ */
+
+#define CAPTURE_SIM_SERIAL "CAPTURESRC"
+
+struct capture_options {
+	libredxx_device_type type;
+	libredxx_device_id id;
+	const char* serial;
+	libredxx_endpoint endpoint;
+	bool sim;
+	uint64_t sim_bandwidth;
+	libredxx_stream_config stream;
+	libredxx_capture_config capture;
+	uint64_t max_bytes;
+	uint64_t duration_ms;
+	bool show;
+	const char* path;
+};
+
+static volatile sig_atomic_t capture_stop;
+
+static void capture_interrupt(int signal_number)
+{
+	(void)signal_number;
+	capture_stop = 1;
+}
+
+static libredxx_opened_device* capture_open(const struct capture_options* options)
+{
+	if (options->sim) {
+		libredxx_status status = libredxx_sim_start();
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			printf("error: unable to start the simulator: %d\n", status);
+			return NULL;
+		}
+		libredxx_sim_device_config config = {0};
+		config.type = options->type;
+		config.id = options->id;
+		strcpy(config.serial.serial, CAPTURE_SIM_SERIAL);
+		config.release = options->type == LIBREDXX_DEVICE_TYPE_D2XX ? 0x0700 : 0; // FT2232H
+		config.mode = LIBREDXX_SIM_SOURCE;
+		config.bandwidth = options->sim_bandwidth;
+		uint32_t device_id;
+		status = libredxx_sim_add_device(&config, &device_id);
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			printf("error: unable to simulate a device: %d\n", status);
+			return NULL;
+		}
+	}
+	const char* serial = options->sim ? CAPTURE_SIM_SERIAL : options->serial;
+	libredxx_find_filter filter = {options->type, options->id};
+	libredxx_found_device** found = NULL;
+	size_t found_count = 0;
+	if (libredxx_find_devices(&filter, 1, &found, &found_count) != LIBREDXX_STATUS_SUCCESS) {
+		return NULL;
+	}
+	libredxx_opened_device* opened = NULL;
+	for (size_t i = 0; i < found_count && !opened; ++i) {
+		libredxx_serial found_serial;
+		uint8_t interface_index;
+		libredxx_get_serial(found[i], &found_serial);
+		libredxx_get_interface_index(found[i], &interface_index);
+		if (interface_index != 0 || (serial && strcmp(found_serial.serial, serial) != 0)) {
+			continue;
+		}
+		if (libredxx_open_device(found[i], &opened) != LIBREDXX_STATUS_SUCCESS) {
+			opened = NULL;
+		}
+	}
+	libredxx_free_found(found);
+	return opened;
+}
+
+static int capture_run(const struct capture_options* options)
+{
+	libredxx_opened_device* device = capture_open(options);
+	if (!device) {
+		printf("error: unable to open device\n");
+		return -1;
+	}
+	libredxx_capture_writer* writer;
+	libredxx_status status = libredxx_capture_create(options->path, &options->capture, &writer);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		printf("error: unable to create %s: %d\n", options->path, status);
+		libredxx_close_device(device);
+		return -1;
+	}
+	libredxx_stream_source source = {device, options->endpoint};
+	libredxx_stream* stream;
+	status = libredxx_stream_start(&source, 1, &options->stream, &stream);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		printf("error: unable to start streaming: %d\n", status);
+		libredxx_capture_finish(writer);
+		libredxx_close_device(device);
+		return -1;
+	}
+	signal(SIGINT, capture_interrupt);
+	uint64_t bytes = 0;
+	uint64_t dropped = 0;
+	uint64_t gaps = 0;
+	uint64_t first_ns = 0;
+	uint64_t last_ns = 0;
+	uint32_t flags = 0;
+	int result = 0;
+	while (!capture_stop && (!options->max_bytes || bytes < options->max_bytes) && (!options->duration_ms || last_ns - first_ns < options->duration_ms * 1000000)) {
+		libredxx_stream_chunk chunk;
+		status = libredxx_stream_pop(stream, 0, &chunk, 100);
+		if (status == LIBREDXX_STATUS_ERROR_TIMEOUT) {
+			continue;
+		}
+		if (status == LIBREDXX_STATUS_SUCCESS && chunk.status != LIBREDXX_STATUS_SUCCESS) {
+			// the source stopped, whatever the device sends until it reads again is lost
+			printf("warning: read failed: %d, restarting\n", chunk.status);
+			libredxx_stream_stop(stream);
+			status = libredxx_stream_start(&source, 1, &options->stream, &stream);
+			if (status != LIBREDXX_STATUS_SUCCESS) {
+				printf("error: unable to restart streaming: %d\n", status);
+				result = -1;
+				break;
+			}
+			flags |= LIBREDXX_CAPTURE_GAP;
+			++gaps;
+			continue;
+		}
+		if (status != LIBREDXX_STATUS_SUCCESS) {
+			printf("error: unable to read: %d\n", status);
+			result = -1;
+			break;
+		}
+		if (!first_ns) {
+			first_ns = chunk.timestamp_ns;
+		}
+		last_ns = chunk.timestamp_ns;
+		status = libredxx_capture_write(writer, chunk.data, chunk.size, chunk.timestamp_ns, flags);
+		libredxx_stream_release(stream, 0, &chunk);
+		if (status == LIBREDXX_STATUS_ERROR_OVERFLOW) {
+			dropped += chunk.size;
+		} else if (status != LIBREDXX_STATUS_SUCCESS) {
+			printf("error: unable to write %s: %d\n", options->path, status);
+			result = -1;
+			break;
+		} else {
+			bytes += chunk.size;
+			flags = 0;
+		}
+	}
+	libredxx_stream_stop(stream);
+	status = libredxx_capture_finish(writer);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		printf("error: unable to finish %s: %d\n", options->path, status);
+		result = -1;
+	}
+	libredxx_close_device(device);
+	if (options->sim) {
+		libredxx_sim_stop();
+	}
+	const double seconds = (double)(last_ns - first_ns) / 1e9;
+	printf("info: captured %llu bytes in %.3f s (%.1f MB/s), dropped %llu bytes, %llu gaps\n", (unsigned long long)bytes, seconds,
+		seconds > 0 ? (double)bytes / seconds / 1e6 : 0.0, (unsigned long long)dropped, (unsigned long long)gaps);
+	return result;
+}
+
+static int capture_show(const char* path)
+{
+	libredxx_capture* capture;
+	libredxx_status status = libredxx_capture_open(path, &capture);
+	if (status != LIBREDXX_STATUS_SUCCESS) {
+		printf("error: unable to open %s: %d\n", path, status);
+		return -1;
+	}
+	libredxx_capture_info info;
+	libredxx_capture_get_info(capture, &info);
+	printf("chunks: %zu\nbytes: %llu\ndropped bytes: %llu\nfinished: %s\n", info.chunks_count, (unsigned long long)info.bytes,
+		(unsigned long long)info.dropped_bytes, info.complete ? "yes" : "no");
+	libredxx_capture_chunk first;
+	libredxx_capture_chunk chunk;
+	if (info.chunks_count && libredxx_capture_get_chunk(capture, 0, &first) == LIBREDXX_STATUS_SUCCESS) {
+		libredxx_capture_get_chunk(capture, info.chunks_count - 1, &chunk);
+		printf("duration: %.6f s\n", (double)(chunk.timestamp_ns - first.timestamp_ns) / 1e9);
+	}
+	for (size_t i = 0; i < info.chunks_count; ++i) {
+		if (libredxx_capture_get_chunk(capture, i, &chunk) != LIBREDXX_STATUS_SUCCESS) {
+			printf("error: chunk %zu is damaged\n", i);
+			break;
+		}
+		if (chunk.flags) {
+			printf("%s%s at %.6f s, offset %llu\n", chunk.flags & LIBREDXX_CAPTURE_GAP ? "gap " : "", chunk.flags & LIBREDXX_CAPTURE_OVERFLOW ? "overflow " : "",
+				(double)(chunk.timestamp_ns - first.timestamp_ns) / 1e9, (unsigned long long)chunk.offset);
+		}
+	}
+	libredxx_capture_close(capture);
+	return 0;
+}
+
+static void capture_usage(const char* name)
+{
+	printf("usage: %s [options] FILE\n", name);
+	printf("  --type d2xx|d3xx         device type (d3xx)\n");
+	printf("  --vid VID --pid PID      hex device id (0403:6010, 0403:601F by type)\n");
+	printf("  --serial SERIAL          device to use, the first one otherwise\n");
+	printf("  --endpoint A|B|C|D       endpoint to capture (A)\n");
+	printf("  --bytes N                stop after N bytes\n");
+	printf("  --duration MS            stop after MS milliseconds\n");
+	printf("  --buffer-size BYTES      bytes per read (1048576, whole packets for d2xx)\n");
+	printf("  --buffers N              read buffers (64)\n");
+	printf("  --depth N                reads in flight (16)\n");
+	printf("  --cpu N                  pin the completion thread\n");
+	printf("  --priority N             real-time priority of the completion thread\n");
+	printf("  --segment-size BYTES     bytes per disk write, a multiple of 4096 (8388608)\n");
+	printf("  --segments N             disk write buffers (8)\n");
+	printf("  --preallocate BYTES      disk space to reserve up front\n");
+	printf("  --sim                    capture a simulated device\n");
+	printf("  --sim-bandwidth BYTES    simulated bytes per second (0 for unlimited)\n");
+	printf("  --show                   print a summary of FILE and its gaps instead\n");
+}
+
+static bool capture_parse(int argc, char** argv, struct capture_options* options)
+{
+	options->type = LIBREDXX_DEVICE_TYPE_D3XX;
+	options->endpoint = LIBREDXX_ENDPOINT_A;
+	options->stream.buffer_size = 1024 * 1024;
+	options->stream.buffer_count = 64;
+	options->stream.depth = 16;
+	options->stream.cpu = -1;
+	options->capture.segment_size = 8 * 1024 * 1024;
+	options->capture.segment_count = 8;
+	bool id_set = false;
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (strcmp(arg, "--sim") == 0) {
+			options->sim = true;
+			continue;
+		}
+		if (strcmp(arg, "--show") == 0) {
+			options->show = true;
+			continue;
+		}
+		if (strncmp(arg, "--", 2) != 0) {
+			if (options->path) {
+				return false;
+			}
+			options->path = arg;
+			continue;
+		}
+		if (!value) {
+			return false;
+		}
+		++i;
+		if (strcmp(arg, "--type") == 0) {
+			if (strcmp(value, "d2xx") == 0) {
+				options->type = LIBREDXX_DEVICE_TYPE_D2XX;
+			} else if (strcmp(value, "d3xx") == 0) {
+				options->type = LIBREDXX_DEVICE_TYPE_D3XX;
+			} else {
+				return false;
+			}
+		} else if (strcmp(arg, "--vid") == 0) {
+			options->id.vid = (uint16_t)strtoul(value, NULL, 16);
+			id_set = true;
+		} else if (strcmp(arg, "--pid") == 0) {
+			options->id.pid = (uint16_t)strtoul(value, NULL, 16);
+			id_set = true;
+		} else if (strcmp(arg, "--serial") == 0) {
+			options->serial = value;
+		} else if (strcmp(arg, "--endpoint") == 0) {
+			if (value[0] < 'A' || value[0] > 'D' || value[1]) {
+				return false;
+			}
+			options->endpoint = (libredxx_endpoint)(value[0] - 'A');
+		} else if (strcmp(arg, "--bytes") == 0) {
+			options->max_bytes = strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--duration") == 0) {
+			options->duration_ms = strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--buffer-size") == 0) {
+			options->stream.buffer_size = strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--buffers") == 0) {
+			options->stream.buffer_count = strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--depth") == 0) {
+			options->stream.depth = strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--cpu") == 0) {
+			options->stream.cpu = atoi(value);
+		} else if (strcmp(arg, "--priority") == 0) {
+			options->stream.priority = atoi(value);
+		} else if (strcmp(arg, "--segment-size") == 0) {
+			options->capture.segment_size = strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--segments") == 0) {
+			options->capture.segment_count = strtoul(value, NULL, 10);
+		} else if (strcmp(arg, "--preallocate") == 0) {
+			options->capture.preallocate_size = strtoull(value, NULL, 10);
+		} else if (strcmp(arg, "--sim-bandwidth") == 0) {
+			options->sim_bandwidth = strtoull(value, NULL, 10);
+		} else {
+			return false;
+		}
+	}
+	if (!id_set) {
+		options->id.vid = 0x0403;
+		options->id.pid = options->type == LIBREDXX_DEVICE_TYPE_D2XX ? 0x6010 : 0x601F;
+	}
+	return options->path != NULL;
+}
+
+int main(int argc, char** argv)
+{
+	struct capture_options options = {0};
+	if (!capture_parse(argc, argv, &options)) {
+		capture_usage(argv[0]);
+		return -1;
+	}
+	return options.show ? capture_show(options.path) : capture_run(&options);
+}